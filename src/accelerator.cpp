@@ -0,0 +1,548 @@
+/* Contains definitions shared by all acceleration structures. */
+
+#include <vector> /* STL vector. */
+#include <cstring>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+#include "accelerator.h"
+#include "bvh.h"
+#include "lbvh.h"
+#include "widebvh.h"
+#include "grid.h"
+#include "kdtree.h"
+#include "raytrace.h"
+#include "boundingbox.h"
+#include "sceneobject.h"
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+using namespace std;
+
+
+/* Scenes with fewer objects with bounds than this always get a BVH from chooseAccelerator(). */
+#define AUTO_MIN_GRID_OBJECTS 1000
+
+/* Scenes whose objects' sizes vary more than this, as the standard deviation over the mean, get a BVH. */
+#define AUTO_MAX_SIZE_VARIATION 0.5
+
+/* Scenes whose objects bunch together more than this get a two-level grid rather than a single one. This is the
+   variance over the mean of the number of objects in each cell of a coarse grid, which is about 1 for objects
+   scattered evenly at random. */
+#define AUTO_MAX_DISPERSION 4.0
+
+/* Number of objects per cell of the coarse grid chooseAccelerator() measures bunching with. */
+#define AUTO_OBJECTS_PER_CELL 8
+
+/* Ray parameter an occlusion query's Intersection is given once something is found. Being negative, it's closer than any
+   box or cell, so every search skips whatever it has left. */
+#define ACCELERATOR_OCCLUDED -1.0
+
+
+/* Default constructor. The Accelerator holds no objects until build() is called. */
+Accelerator::Accelerator (void) {
+    objects = NULL;
+}
+
+
+/* Destructor. */
+Accelerator::~Accelerator (void) {
+}
+
+
+/* Returns an Intersection that is farther away than any real one. */
+Intersection Accelerator::getEmptyIntersection(void) {
+    Intersection empty;
+
+    empty.hit.t = SCALAR_MAX;
+    empty.index = UINT_MAX;
+    empty.occlusionQuery = false;
+
+    return empty;
+}
+
+
+/* Returns the largest ray parameter at which an object could still be as close as CLOSEST. The limit is loosened
+   slightly so that rounding never skips a box holding an object at exactly the same parameter, which may still
+   win on index: by a billionth, or by a few units in the last place of a Scalar if that is more, since hits are
+   found in Scalars and boxes are tested in doubles. */
+double Accelerator::getMaxT(const Intersection &closest) {
+    if (closest.hit.t == SCALAR_MAX) {
+        return DBL_MAX;
+    }
+    return closest.hit.t * (1.0 + max(1e-9, 8*(double)SCALAR_EPSILON));
+}
+
+
+/* Points the Accelerator at OBJECTS and compiles them into SCENE. Called at the start of build(). */
+void Accelerator::setObjects(const vector <SceneObject *> &objects) {
+    this->objects = &objects;
+    scene.compile(objects);
+}
+
+
+/* Replaces each object index in INDICES with the object's PrimitiveRef. */
+void Accelerator::compileIndices(vector <unsigned int> &indices) const {
+    for (unsigned int i = 0; i < indices.size(); i++) {
+        indices[i] = scene.getRef(indices[i]);
+    }
+}
+
+
+/* Replaces CLOSEST with HIT, an intersection with the primitive REF, if it is closer. For an occlusion query, a hit
+   closer than CLOSEST on anything but a light ends the search instead. */
+void Accelerator::keepCloser(PrimitiveRef ref, const HitRecord &hit, Intersection &closest) const {
+    unsigned int index = scene.getObjectIndex(ref);
+
+    if (closest.occlusionQuery) {
+        if (hit.t < closest.hit.t && !scene.isLight(ref)) {
+            closest.hit.t = ACCELERATOR_OCCLUDED;
+            closest.index = index;
+        }
+        return;
+    }
+
+    if (hit.t < closest.hit.t || (hit.t == closest.hit.t && index < closest.index)) {
+        closest.hit = hit;
+        closest.index = index;
+    }
+}
+
+
+/* Tests the primitive REF against the ray defined by RAY_START_POINT and RAY_DIRECTION, and replaces CLOSEST
+   with the intersection if it is closer. Of two intersections at exactly the same ray parameter the object with the
+   lower index is kept, so every Accelerator picks the same object as a linear scan over the list would. */
+void Accelerator::testPrimitive(PrimitiveRef ref, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+
+    /* An occlusion query that found something is over. */
+    if (closest.hit.t < 0.0) {
+        return;
+    }
+
+    HitRecord hit;
+
+    if (scene.intersect(ref, rayStartPoint, rayDirection, hit)) {
+        keepCloser(ref, hit, closest);
+    }
+}
+
+
+/* Tests the COUNT primitives REFS refers to against the ray as testPrimitive() does. The spheres among them are
+   set aside and tested KERNEL_BATCH_SIZE at a time by the SIMD kernel. Which intersection is kept doesn't depend on
+   the order the primitives are tested in, so this finds the same one as testing them one by one. A lone sphere is
+   cheaper to test on its own. */
+void Accelerator::testPrimitives(const PrimitiveRef *refs, unsigned int count, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+    testPrimitives(refs, count, false, rayStartPoint, rayDirection, closest);
+}
+
+
+/* testPrimitives(), skipping the triangles if SKIP_TRIANGLES is true. */
+void Accelerator::testPrimitives(const PrimitiveRef *refs, unsigned int count, bool skipTriangles, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+    PrimitiveRef sphereRefs [KERNEL_BATCH_SIZE];
+    unsigned int sphereCount = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        PrimitiveType type = getPrimitiveType(refs[i]);
+
+        if (type == PRIMITIVE_TRIANGLE && skipTriangles) {
+            continue;
+        }
+
+        if (type != PRIMITIVE_SPHERE) {
+            testPrimitive(refs[i], rayStartPoint, rayDirection, closest);
+            continue;
+        }
+
+        sphereRefs[sphereCount++] = refs[i];
+
+        if (sphereCount == KERNEL_BATCH_SIZE) {
+            testSpheres(sphereRefs, sphereCount, rayStartPoint, rayDirection, closest);
+            sphereCount = 0;
+        }
+    }
+
+    if (sphereCount == 1) {
+        testPrimitive(sphereRefs[0], rayStartPoint, rayDirection, closest);
+    }
+    else if (sphereCount > 1) {
+        testSpheres(sphereRefs, sphereCount, rayStartPoint, rayDirection, closest);
+    }
+}
+
+
+/* Tests the COUNT spheres REFS refers to, at most KERNEL_BATCH_SIZE of them, against the ray together, and replaces
+   CLOSEST with the closest intersection among them as testPrimitive() would. */
+void Accelerator::testSpheres(const PrimitiveRef *refs, unsigned int count, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+
+    /* An occlusion query that found something is over. */
+    if (closest.hit.t < 0.0) {
+        return;
+    }
+
+    Scalar start [3] = {rayStartPoint.getEntry(0), rayStartPoint.getEntry(1), rayStartPoint.getEntry(2)};
+    Scalar direction [3] = {rayDirection.getEntry(0), rayDirection.getEntry(1), rayDirection.getEntry(2)};
+    Scalar t [KERNEL_BATCH_SIZE];
+
+    scene.intersectSpheres(refs, count, start, direction, t);
+
+    HitRecord hit;
+
+    for (unsigned int i = 0; i < count; i++) {
+        /* Only a hit at least as close as CLOSEST can replace it, so don't fill in the others. */
+        if (t[i] <= closest.hit.t) {
+            CompiledScene::getSphereHit(t[i], start, direction, hit);
+            keepCloser(refs[i], hit, closest);
+        }
+    }
+}
+
+
+
+/* Packs the triangles of the leaves of REFS into trianglePackets, replacing any packed before. Each leaf is a run of
+   REFS starting at one of LEAF_OFFSETS and ending where the next begins, or at the end of REFS. Within a leaf, triangles
+   are packed in increasing order of object index, so that of two at the same distance the kernel picks the one
+   testPrimitive() would keep. */
+void Accelerator::packTriangles(const vector <PrimitiveRef> &refs, const vector <unsigned int> &leafOffsets) {
+    trianglePackets.clear();
+    packetRefs.clear();
+    leafPackets.clear();
+
+    if (scene.getTriangleCount() == 0) {
+        return;
+    }
+
+    vector <bool> leafStarts (refs.size() + 1, false);
+    for (unsigned int i = 0; i < leafOffsets.size(); i++) {
+        leafStarts[leafOffsets[i]] = true;
+    }
+
+    leafPackets.resize(refs.size() + 1);
+
+    /* The triangles of the current leaf, by object index. */
+    vector < pair <unsigned int, PrimitiveRef> > leafTriangles;
+
+    for (unsigned int i = 0; i <= refs.size(); i++) {
+
+        /* Pack the leaf that ends here. Lanes left over stay zero, which no ray hits. */
+        if (i == refs.size() || leafStarts[i]) {
+            sort(leafTriangles.begin(), leafTriangles.end());
+
+            for (unsigned int j = 0; j < leafTriangles.size(); j++) {
+                if (j % KERNEL_PACKET_WIDTH == 0) {
+                    trianglePackets.push_back(TrianglePacket());
+                    packetRefs.resize(packetRefs.size() + KERNEL_PACKET_WIDTH, UINT_MAX);
+                }
+
+                scene.packTriangle(leafTriangles[j].second, trianglePackets.back(), j % KERNEL_PACKET_WIDTH);
+                packetRefs[packetRefs.size() - KERNEL_PACKET_WIDTH + j % KERNEL_PACKET_WIDTH] = leafTriangles[j].second;
+            }
+
+            leafTriangles.clear();
+        }
+
+        leafPackets[i] = trianglePackets.size();
+
+        if (i < refs.size() && getPrimitiveType(refs[i]) == PRIMITIVE_TRIANGLE) {
+            leafTriangles.push_back(make_pair(scene.getObjectIndex(refs[i]), refs[i]));
+        }
+    }
+}
+
+
+/* Returns the number of bytes the packed triangles take up. */
+size_t Accelerator::getPacketMemoryUsage(void) const {
+    return trianglePackets.capacity()*sizeof(TrianglePacket) + (packetRefs.capacity() + leafPackets.capacity())*sizeof(unsigned int);
+}
+
+
+/* Tests the COUNT primitives starting at position OFFSET of REFS, a leaf of the list given to packTriangles(), against
+   the ray as testPrimitives() does, but tests the leaf's triangles from their packets. */
+void Accelerator::testLeaf(const PrimitiveRef *refs, unsigned int offset, unsigned int count, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+
+    if (leafPackets.empty()) {
+        testPrimitives(refs + offset, count, rayStartPoint, rayDirection, closest);
+        return;
+    }
+
+    testPrimitives(refs + offset, count, true, rayStartPoint, rayDirection, closest);
+
+    unsigned int firstPacket = leafPackets[offset];
+    unsigned int endPacket = leafPackets[offset + count];
+
+    if (firstPacket == endPacket) {
+        return;
+    }
+
+    Scalar start [3] = {rayStartPoint.getEntry(0), rayStartPoint.getEntry(1), rayStartPoint.getEntry(2)};
+    Scalar direction [3] = {rayDirection.getEntry(0), rayDirection.getEntry(1), rayDirection.getEntry(2)};
+
+    for (unsigned int packet = firstPacket; packet < endPacket; packet++) {
+        testTrianglePacket(packet, start, direction, closest);
+    }
+}
+
+
+/* Tests the triangles of trianglePackets[PACKET] against the ray from START along DIRECTION together, and replaces
+   CLOSEST with the closest intersection among them as testPrimitive() would. */
+void Accelerator::testTrianglePacket(unsigned int packet, const Scalar start[3], const Scalar direction[3], Intersection &closest) const {
+
+    /* An occlusion query that found something is over. */
+    if (closest.hit.t < 0.0) {
+        return;
+    }
+
+    unsigned int lane;
+    Scalar t, u, v;
+
+    if (intersectTrianglePacket(trianglePackets[packet], start, direction, lane, t, u, v, 0) == 0 || t > closest.hit.t) {
+        return;
+    }
+
+    PrimitiveRef ref = packetRefs[packet*KERNEL_PACKET_WIDTH + lane];
+    HitRecord hit;
+
+    scene.getTriangleHit(ref, t, u, v, hit);
+    keepCloser(ref, hit, closest);
+}
+
+
+
+/* Takes a point and a direction from that point to form a ray, and finds the first object the ray intersects.
+   Upon success, returns true, places the point of intersection in INTERSECTION_POINT, and places a pointer to
+   the intersecting object into INTERSECTION_OBJECT. Upon failure, false will simply be returned. */
+bool Accelerator::findFirstIntersection(const Point3 &rayStartPoint, const Direction3 &rayDirection, Point3 &intersectionPoint, SceneObject *&intersectionObject) const {
+
+    Intersection closest = getEmptyIntersection();
+    findClosest(rayStartPoint, rayDirection, closest);
+
+    if (closest.index == UINT_MAX) {
+        return false;
+    }
+
+    intersectionPoint = closest.hit.point;
+    intersectionObject = (*objects)[closest.index];
+
+    return true;
+}
+
+
+/* Takes a point and a direction from that point to form a ray, and finds the first object the ray intersects.
+   Upon success, returns true, places the intersection into RETURN_HIT, and places the index of the object in
+   the list the Accelerator was built over into RETURN_INDEX. Upon failure, false will simply be returned. */
+bool Accelerator::findFirstIntersection(const Point3 &rayStartPoint, const Direction3 &rayDirection, HitRecord &returnHit, unsigned int &returnIndex) const {
+
+    Intersection closest = getEmptyIntersection();
+    findClosest(rayStartPoint, rayDirection, closest);
+
+    if (closest.index == UINT_MAX) {
+        return false;
+    }
+
+    returnHit = closest.hit;
+    returnIndex = closest.index;
+
+    return true;
+}
+
+
+/* Takes COUNT rays, ray i from RAY_START_POINTS[i] along RAY_DIRECTIONS[i], and finds the first object each of them
+   intersects. For ray i, places the intersection into RETURN_HITS[i] and the index of the object into RETURN_INDICES[i],
+   or UINT_MAX into RETURN_INDICES[i] if it intersects nothing. */
+void Accelerator::findFirstIntersections(const Point3 *rayStartPoints, const Direction3 *rayDirections, unsigned int count, HitRecord *returnHits, unsigned int *returnIndices) const {
+
+    Intersection closest [MAX_PACKET_SIZE];
+
+    for (unsigned int i = 0; i < count; i++) {
+        closest[i] = getEmptyIntersection();
+    }
+
+    findClosestInPacket(rayStartPoints, rayDirections, count, closest);
+
+    for (unsigned int i = 0; i < count; i++) {
+        returnHits[i] = closest[i].hit;
+        returnIndices[i] = closest[i].index;
+    }
+}
+
+
+/* Searches the structure for the closest intersection with each of COUNT rays, narrowing CLOSEST[i] for ray i. By
+   default each ray is traced on its own. */
+void Accelerator::findClosestInPacket(const Point3 *rayStartPoints, const Direction3 *rayDirections, unsigned int count, Intersection *closest) const {
+    for (unsigned int i = 0; i < count; i++) {
+        findClosest(rayStartPoints[i], rayDirections[i], closest[i]);
+    }
+}
+
+
+/* Takes a point and a direction from that point to form a ray, and returns true if the ray intersects any object
+   other than a light less than MAX_DISTANCE from the point. Returns as soon as one is found, without looking
+   for the closest, which is all a shadow ray needs. */
+bool Accelerator::isOccluded(const Point3 &rayStartPoint, const Direction3 &rayDirection, double maxDistance) const {
+
+    /* The search is the closest-hit search, limited to MAX_DISTANCE, and cut short by testPrimitive(). */
+    Intersection query = getEmptyIntersection();
+    query.hit.t = maxDistance / rayDirection.magnitude();
+    query.occlusionQuery = true;
+
+    findClosest(rayStartPoint, rayDirection, query);
+
+    return query.index != UINT_MAX;
+}
+
+
+/* Brings the acceleration structure up to date after the objects at MOVED_INDICES in the list it was built
+   over have moved or changed shape. Objects must not be added, removed, or lose or gain bounds. Returns what
+   was done. By default the whole structure is built again, compiling the objects again with it. */
+AcceleratorUpdate Accelerator::update(const vector <unsigned int> &movedIndices) {
+    build(*objects);
+    return ACCELERATOR_REBUILD;
+}
+
+
+/* Returns the estimated cost of tracing a ray through the structure, relative to its cost right after it
+   was last built. Grows above 1.0 as update() lets the structure degrade. By default 1.0. */
+double Accelerator::getCostRatio(void) const {
+    return 1.0;
+}
+
+
+
+/* Returns a new Accelerator of the kind named by NAME: "bvh" for a BVH built with the SAH, "sbvh" for a BVH that also
+   splits space, making up to SPLIT_BUDGET extra copies of objects per object, "lbvh" for a BVH built quickly from
+   Morton codes, "bvh8" for a BVH with 8 children per node tested with AVX2 (or 4 if the processor lacks it), "bvh4"
+   for a BVH with 4 children per node tested with SSE, "cbvh" for a "bvh8" whose nodes are stored compressed, "grid"
+   for a uniform grid, "grid2" for a two-level grid, or "kd" for a kd-tree. Returns NULL for "none", which means every
+   ray should be tested against every object, and also for names that aren't recognized, including "auto". */
+Accelerator* createAccelerator(const char *name) {
+    if (strcmp(name, "bvh") == 0) {
+        return new BVH();
+    }
+    if (strcmp(name, "sbvh") == 0) {
+        return new BVH(SPLIT_BUDGET);
+    }
+    if (strcmp(name, "lbvh") == 0) {
+        return new LBVH();
+    }
+    if (strcmp(name, "bvh8") == 0) {
+        return new WideBVH(0, false);
+    }
+    if (strcmp(name, "bvh4") == 0) {
+        return new WideBVH(4, false);
+    }
+    if (strcmp(name, "cbvh") == 0) {
+        return new WideBVH(0, true);
+    }
+    if (strcmp(name, "grid") == 0) {
+        return new Grid(false);
+    }
+    if (strcmp(name, "grid2") == 0) {
+        return new Grid(true);
+    }
+    if (strcmp(name, "kd") == 0) {
+        return new KDTree();
+    }
+
+    return NULL;
+}
+
+
+/* Returns true if NAME names a kind of Accelerator createAccelerator() can make, or is "none" or "auto". */
+bool isAcceleratorName(const char *name) {
+    return (strcmp(name, "none") == 0) || (strcmp(name, "auto") == 0) || (strcmp(name, "bvh") == 0) || (strcmp(name, "sbvh") == 0) ||
+           (strcmp(name, "lbvh") == 0) || (strcmp(name, "bvh8") == 0) || (strcmp(name, "bvh4") == 0) ||
+           (strcmp(name, "cbvh") == 0) || (strcmp(name, "grid") == 0) || (strcmp(name, "grid2") == 0) || (strcmp(name, "kd") == 0);
+}
+
+
+/* Returns the name of the kind of Accelerator that should suit OBJECTS best, for "auto". Grids are picked for
+   many objects of similar size, a two-level grid if they're bunched together unevenly, and a BVH otherwise. */
+const char* chooseAccelerator(const vector <SceneObject *> &objects) {
+
+    vector <BoundingBox> boxes;
+    BoundingBox centerBounds = getEmptyBoundingBox();
+
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        BoundingBox box;
+
+        if (objects[i]->getBounds(box)) {
+            boxes.push_back(box);
+
+            Point3 center (centroid(box, 0), centroid(box, 1), centroid(box, 2));
+            expand(centerBounds, center);
+        }
+    }
+
+    if (boxes.size() < AUTO_MIN_GRID_OBJECTS) {
+        return "bvh8";
+    }
+
+    /* A grid cell sized for small objects is crossed by many of the large ones, so sizes should be alike. */
+    double sizeSum = 0.0;
+    double sizeSquareSum = 0.0;
+
+    for (unsigned int i = 0; i < boxes.size(); i++) {
+        double size = 0.0;
+        for (int axis = 0; axis < 3; axis++) {
+            size += boxes[i].upper[axis] - boxes[i].lower[axis];
+        }
+
+        sizeSum += size;
+        sizeSquareSum += size*size;
+    }
+
+    double sizeMean = sizeSum / boxes.size();
+    double sizeVariance = max(sizeSquareSum / boxes.size() - sizeMean*sizeMean, 0.0);
+
+    if (sizeMean <= 0.0 || sqrt(sizeVariance) / sizeMean > AUTO_MAX_SIZE_VARIATION) {
+        return "bvh8";
+    }
+
+    /* Count the objects' centers in a coarse grid of cubic cells to see how evenly they're spread. */
+    double extent [3];
+    double maxExtent = 0.0;
+
+    for (int axis = 0; axis < 3; axis++) {
+        extent[axis] = centerBounds.upper[axis] - centerBounds.lower[axis];
+        maxExtent = max(maxExtent, extent[axis]);
+    }
+
+    if (maxExtent <= 0.0) {
+        return "bvh8";
+    }
+
+    double cellsPerUnit = cbrt((double)boxes.size() / AUTO_OBJECTS_PER_CELL) / maxExtent;
+    int resolution [3];
+
+    for (int axis = 0; axis < 3; axis++) {
+        resolution[axis] = max((int)(extent[axis] * cellsPerUnit), 1);
+    }
+
+    vector <unsigned int> counts (resolution[0] * resolution[1] * resolution[2], 0);
+
+    for (unsigned int i = 0; i < boxes.size(); i++) {
+        int cell [3];
+
+        for (int axis = 0; axis < 3; axis++) {
+            double position = (extent[axis] > 0.0) ? (centroid(boxes[i], axis) - centerBounds.lower[axis]) / extent[axis] : 0.0;
+            cell[axis] = min((int)(position * resolution[axis]), resolution[axis] - 1);
+        }
+
+        counts[cell[0] + resolution[0]*(cell[1] + resolution[1]*cell[2])]++;
+    }
+
+    double countMean = (double)boxes.size() / counts.size();
+    double countVariance = 0.0;
+
+    for (unsigned int i = 0; i < counts.size(); i++) {
+        countVariance += (counts[i] - countMean) * (counts[i] - countMean);
+    }
+    countVariance /= counts.size();
+
+    if (countVariance / countMean > AUTO_MAX_DISPERSION) {
+        return "grid2";
+    }
+
+    return "grid";
+}
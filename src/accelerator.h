@@ -0,0 +1,196 @@
+/* Contains the interface for an acceleration structure, which finds the first SceneObject a ray intersects
+   without testing the ray against every object in the scene. New acceleration structures can be created by
+   implementing the virtual functions declared here. */
+
+#ifndef ACCELERATOR
+#define ACCELERATOR
+
+	#include <vector> /* STL vector. */
+	#include <cstddef>
+	#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+	#include "sceneobject.h"
+	#include "compiledscene.h"
+	#include "kernels.h"
+
+	using namespace std;
+
+
+	/* The closest intersection an Accelerator has found so far while testing SceneObjects against a ray. */
+	struct Intersection {
+		/* Where the ray intersects the object. Before anything is found, only HIT.T is set, to how far along the ray
+		   to search. */
+		HitRecord hit;
+
+		/* Index of the intersected object in the list the Accelerator was built over. */
+		unsigned int index;
+
+		/* True for an occlusion query, which only asks whether any object other than a light is closer than HIT.T.
+		   The first one found ends the search, and the rest of HIT is left unset. */
+		bool occlusionQuery;
+	};
+
+
+	/* Most rays findFirstIntersections() traces together. */
+	#define MAX_PACKET_SIZE KERNEL_MAX_RAYS
+
+
+	/* What an Accelerator did to catch up with objects that moved. */
+	enum AcceleratorUpdate {
+		/* Only the boxes around the moved objects and their ancestors were resized. */
+		ACCELERATOR_REFIT,
+
+		/* Part of the structure was built again. */
+		ACCELERATOR_PARTIAL_REBUILD,
+
+		/* The whole structure was built again. */
+		ACCELERATOR_REBUILD
+	};
+
+
+	/* Abstract class for an acceleration structure built over a list of SceneObjects. */
+	class Accelerator {
+
+		protected:
+			/* The list of objects the Accelerator was built over. Object indices refer to this list. */
+			const vector <SceneObject *> *objects;
+
+			/* OBJECTS, compiled into pools by type. Leaves of the structure refer to objects by their PrimitiveRef in it. */
+			CompiledScene scene;
+
+			/* The triangles of the structure's leaves, packed KERNEL_PACKET_WIDTH at a time by packTriangles() so that
+			   the SIMD kernel tests them together, and the PrimitiveRef of the triangle in each lane of each packet. */
+			vector <TrianglePacket> trianglePackets;
+			vector <PrimitiveRef> packetRefs;
+
+			/* The triangles of the leaf starting at position i of the list given to packTriangles() are in packets
+			   leafPackets[i] up to, but not including, leafPackets[i + count], where COUNT is the leaf's length. Entries
+			   for positions no leaf starts at are left over from the leaf before. Empty if the triangles aren't packed. */
+			vector <unsigned int> leafPackets;
+
+			/* Points the Accelerator at OBJECTS and compiles them into SCENE. Called at the start of build(). */
+			void setObjects(const vector <SceneObject *> &objects);
+
+			/* Replaces each object index in INDICES with the object's PrimitiveRef. */
+			void compileIndices(vector <unsigned int> &indices) const;
+
+			/* Tests the primitive REF against the ray defined by RAY_START_POINT and RAY_DIRECTION, and replaces CLOSEST
+			   with the intersection if it is closer. Of two intersections at exactly the same ray parameter the object with the
+			   lower index is kept, so every Accelerator picks the same object as a linear scan over the list would.
+
+			   For an occlusion query, a hit closer than CLOSEST on anything but a light makes CLOSEST's T negative,
+			   so the search skips everything still to come, and later calls return at once. */
+			void testPrimitive(PrimitiveRef ref, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* Tests the COUNT primitives REFS refers to against the ray as testPrimitive() does, passing the spheres among
+			   them to the SIMD kernel together. Leaves call this rather than testing their primitives one at a time. */
+			void testPrimitives(const PrimitiveRef *refs, unsigned int count, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* testPrimitives(), skipping the triangles if SKIP_TRIANGLES is true. */
+			void testPrimitives(const PrimitiveRef *refs, unsigned int count, bool skipTriangles, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* Tests the COUNT spheres REFS refers to, at most KERNEL_BATCH_SIZE of them, against the ray together, and
+			   replaces CLOSEST with the closest intersection among them as testPrimitive() would. */
+			void testSpheres(const PrimitiveRef *refs, unsigned int count, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* Packs the triangles of the leaves of REFS into trianglePackets, replacing any packed before. Each leaf is a
+			   run of REFS starting at one of LEAF_OFFSETS and ending where the next begins, or at the end of REFS; together
+			   they must cover it. Within a leaf, triangles are packed in increasing order of object index. Does nothing but
+			   clear the packets if the scene has no triangles. */
+			void packTriangles(const vector <PrimitiveRef> &refs, const vector <unsigned int> &leafOffsets);
+
+			/* Returns the number of bytes the packed triangles take up. */
+			size_t getPacketMemoryUsage(void) const;
+
+			/* Tests the COUNT primitives starting at position OFFSET of REFS, a leaf of the list given to packTriangles(),
+			   against the ray as testPrimitives() does, but tests the leaf's triangles from their packets. If the triangles
+			   aren't packed, this is testPrimitives(). */
+			void testLeaf(const PrimitiveRef *refs, unsigned int offset, unsigned int count, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* Tests the triangles of trianglePackets[PACKET] against the ray together, and replaces CLOSEST with the
+			   closest intersection among them as testPrimitive() would. */
+			void testTrianglePacket(unsigned int packet, const Scalar start[3], const Scalar direction[3], Intersection &closest) const;
+
+			/* Replaces CLOSEST with HIT, an intersection with the primitive REF, if it is closer, or ends an occlusion
+			   query, as testPrimitive() describes. */
+			void keepCloser(PrimitiveRef ref, const HitRecord &hit, Intersection &closest) const;
+
+			/* Returns an Intersection that is farther away than any real one. */
+			static Intersection getEmptyIntersection(void);
+
+			/* Searches the structure for the closest intersection with the ray, narrowing CLOSEST as closer intersections
+			   are found with testPrimitive(). Objects farther away than CLOSEST may be skipped. */
+			virtual void findClosest(const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const = 0;
+
+			/* Searches the structure for the closest intersection with each of COUNT rays, ray i from RAY_START_POINTS[i]
+			   along RAY_DIRECTIONS[i], narrowing CLOSEST[i] as findClosest() does. By default each ray is traced on its own;
+			   structures that can trace rays together override this. */
+			virtual void findClosestInPacket(const Point3 *rayStartPoints, const Direction3 *rayDirections, unsigned int count, Intersection *closest) const;
+
+			/* Returns the largest ray parameter at which an object could still be as close as CLOSEST. */
+			static double getMaxT(const Intersection &closest);
+
+		public:
+			/* Default constructor. The Accelerator holds no objects until build() is called. */
+			Accelerator (void);
+
+			/* Destructor. */
+			virtual ~Accelerator (void);
+
+			/* Builds the acceleration structure over OBJECTS, replacing anything built before. OBJECTS must outlive
+			   the Accelerator and must not change between build() and the last query. */
+			virtual void build(const vector <SceneObject *> &objects) = 0;
+
+			/* Takes a point and a direction from that point to form a ray, and finds the first object the ray intersects.
+			   Upon success, returns true, places the point of intersection in INTERSECTION_POINT, and places a pointer to
+			   the intersecting object into INTERSECTION_OBJECT. Upon failure, false will simply be returned. */
+			bool findFirstIntersection(const Point3 &rayStartPoint, const Direction3 &rayDirection, Point3 &intersectionPoint, SceneObject *&intersectionObject) const;
+
+			/* Takes a point and a direction from that point to form a ray, and finds the first object the ray intersects.
+			   Upon success, returns true, places the intersection into RETURN_HIT, and places the index of the object in
+			   the list the Accelerator was built over into RETURN_INDEX. Upon failure, false will simply be returned. */
+			bool findFirstIntersection(const Point3 &rayStartPoint, const Direction3 &rayDirection, HitRecord &returnHit, unsigned int &returnIndex) const;
+
+			/* Takes COUNT rays, at most MAX_PACKET_SIZE, ray i from RAY_START_POINTS[i] along RAY_DIRECTIONS[i], and finds
+			   the first object each of them intersects, exactly as findFirstIntersection() would. For ray i, places the
+			   intersection into RETURN_HITS[i] and the index of the object into RETURN_INDICES[i], or UINT_MAX into
+			   RETURN_INDICES[i] if it intersects nothing. Rays that stay close together, such as the primary rays through
+			   a block of neighboring pixels, are traced together as a packet by the structures that support it. */
+			void findFirstIntersections(const Point3 *rayStartPoints, const Direction3 *rayDirections, unsigned int count, HitRecord *returnHits, unsigned int *returnIndices) const;
+
+			/* Takes a point and a direction from that point to form a ray, and returns true if the ray intersects any object
+			   other than a light less than MAX_DISTANCE from the point. Returns as soon as one is found, without looking
+			   for the closest, which is all a shadow ray needs. */
+			bool isOccluded(const Point3 &rayStartPoint, const Direction3 &rayDirection, double maxDistance) const;
+
+			/* Brings the acceleration structure up to date after the objects at MOVED_INDICES in the list it was built
+			   over have moved or changed shape. Objects must not be added, removed, or lose or gain bounds. Returns what
+			   was done. By default the whole structure is built again. */
+			virtual AcceleratorUpdate update(const vector <unsigned int> &movedIndices);
+
+			/* Returns the estimated cost of tracing a ray through the structure, relative to its cost right after it
+			   was last built. Grows above 1.0 as update() lets the structure degrade. By default 1.0. */
+			virtual double getCostRatio(void) const;
+
+			/* Returns the number of bytes the acceleration structure takes up, including the compiled copy of the objects
+			   but not counting the objects themselves. */
+			virtual size_t getMemoryUsage(void) const = 0;
+	};
+
+
+	/* Returns a new Accelerator of the kind named by NAME: "bvh" for a BVH built with the SAH, "sbvh" for a BVH that also
+	   splits space, making up to SPLIT_BUDGET extra copies of objects per object, "lbvh" for a BVH built quickly from
+	   Morton codes, "bvh8" for a BVH with 8 children per node tested with AVX2 (or 4 if the processor lacks it), "bvh4"
+	   for a BVH with 4 children per node tested with SSE, "cbvh" for a "bvh8" whose nodes are stored compressed, "grid"
+	   for a uniform grid, "grid2" for a two-level grid, or "kd" for a kd-tree. Returns NULL for "none", which means
+	   every ray should be tested against every object, and also for names that aren't recognized, including "auto". */
+	Accelerator* createAccelerator(const char *name);
+
+	/* Returns true if NAME names a kind of Accelerator createAccelerator() can make, or is "none" or "auto". */
+	bool isAcceleratorName(const char *name);
+
+	/* Returns the name of the kind of Accelerator that should suit OBJECTS best, for "auto". Grids are picked for
+	   many objects of similar size, a two-level grid if they're bunched together unevenly, and a BVH otherwise. */
+	const char* chooseAccelerator(const vector <SceneObject *> &objects);
+
+
+#endif
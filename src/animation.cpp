@@ -0,0 +1,124 @@
+/* Contains definitions for functions that render animation sequences, in which some objects move from frame to frame. */
+
+#include <vector> /* STL vector. */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "animation.h"
+#include "raytrace.h"
+#include "accelerator.h"
+#include "geometry.h"
+#include "lowlevel.h"
+#include "misc.h"
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+using namespace std;
+
+
+/* Number of spheres that move in each frame. */
+#define ANIMATION_MOVING_COUNT 16
+
+/* Farthest a moving sphere travels along each axis in one frame. */
+#define ANIMATION_MAX_STEP 0.25
+
+
+
+/* Places the name of the image file for FRAME into RETURN_FILENAME, which holds SIZE characters: OUTPUT_FILENAME with
+   the frame number added before its extension. */
+static void getFrameFilename(int frame, char *returnFilename, int size) {
+    const char *extension = strrchr(OUTPUT_FILENAME, '.');
+    int baseLength = (extension != NULL) ? (int)(extension - OUTPUT_FILENAME) : (int)strlen(OUTPUT_FILENAME);
+
+    snprintf(returnFilename, size, "%.*s-%03d%s", baseLength, OUTPUT_FILENAME, frame, (extension != NULL) ? extension : "");
+}
+
+
+/* Returns how an Accelerator caught up after objects moved, in words. */
+static const char* getUpdateName(AcceleratorUpdate update) {
+    switch (update) {
+        case ACCELERATOR_REFIT:           return "refit";
+        case ACCELERATOR_PARTIAL_REBUILD: return "partially rebuilt";
+        default:                          return "rebuilt";
+    }
+}
+
+
+/* Renders FRAME_COUNT frames of the loaded scene. Between frames a handful of its spheres move, and SCENE_ACCELERATOR
+   is updated rather than built again. Prints how long each update and frame took, and how long a full build takes
+   for comparison. If OUTPUT_FILENAME isn't NULL, each frame is written to it with the frame number added. */
+void renderAnimation(int frameCount) {
+
+    /* Pick spheres spread evenly through the scene to move, each with its own steady velocity. */
+    vector <unsigned int> sphereIndices;
+    for (unsigned int i = 0; i < SCENE_OBJECTS->size(); i++) {
+        if (dynamic_cast <Sphere *> ((*SCENE_OBJECTS)[i]) != NULL) {
+            sphereIndices.push_back(i);
+        }
+    }
+
+    vector <unsigned int> movingIndices;
+    vector <Direction3> velocities;
+    unsigned int movingCount = (sphereIndices.size() < ANIMATION_MOVING_COUNT) ? sphereIndices.size() : ANIMATION_MOVING_COUNT;
+
+    srand(frameCount);
+    for (unsigned int i = 0; i < movingCount; i++) {
+        movingIndices.push_back(sphereIndices[(unsigned long)i * sphereIndices.size() / movingCount]);
+        velocities.push_back(Direction3(randomDouble(-ANIMATION_MAX_STEP, ANIMATION_MAX_STEP), randomDouble(-ANIMATION_MAX_STEP, ANIMATION_MAX_STEP),
+                                    randomDouble(-ANIMATION_MAX_STEP, ANIMATION_MAX_STEP)));
+    }
+
+    double totalUpdateTime = 0.0;
+    int updateCounts [3] = {0, 0, 0};
+
+    for (int frame = 0; frame < frameCount; frame++) {
+
+        if (frame > 0) {
+            for (unsigned int i = 0; i < movingIndices.size(); i++) {
+                Sphere *s = (Sphere *)(*SCENE_OBJECTS)[movingIndices[i]];
+                s->position = s->position + velocities[i];
+            }
+
+            if (SCENE_ACCELERATOR != NULL) {
+                double startTime = getTime();
+                AcceleratorUpdate update = SCENE_ACCELERATOR->update(movingIndices);
+                double updateTime = getTime() - startTime;
+
+                totalUpdateTime += updateTime;
+                updateCounts[update]++;
+
+                printf("Frame %d: %s %s in %.3f ms, cost %.3f times that of a fresh build\n", frame, ACCELERATOR_NAME,
+                       getUpdateName(update), 1000.0*updateTime, SCENE_ACCELERATOR->getCostRatio());
+            }
+            else {
+                SCENE_PRIMITIVES.update(*SCENE_OBJECTS, movingIndices);
+            }
+        }
+
+        drawScene();
+
+        if (OUTPUT_FILENAME != NULL) {
+            char filename [1024];
+            getFrameFilename(frame, filename, sizeof(filename));
+
+            if (writeCanvas(filename) != 0) {
+                fprintf(stderr, "Couldn't write image to %s\n", filename);
+            }
+        }
+    }
+
+    if (SCENE_ACCELERATOR == NULL || frameCount < 2) {
+        return;
+    }
+
+    /* Build the same kind of structure over the final scene to show what rebuilding every frame would have cost. */
+    Accelerator *fresh = createAccelerator(ACCELERATOR_NAME);
+    double startTime = getTime();
+    fresh->build(*SCENE_OBJECTS);
+    double buildTime = getTime() - startTime;
+    delete fresh;
+
+    printf("Updated %s in %.3f ms per frame on average (%d refits, %d partial rebuilds, %d full rebuilds); a full build takes %.3f ms\n",
+           ACCELERATOR_NAME, 1000.0*totalUpdateTime/(frameCount-1), updateCounts[ACCELERATOR_REFIT],
+           updateCounts[ACCELERATOR_PARTIAL_REBUILD], updateCounts[ACCELERATOR_REBUILD], 1000.0*buildTime);
+}
@@ -0,0 +1,13 @@
+/* Contains declarations for functions that render animation sequences, in which some objects move from frame to frame. */
+
+#ifndef ANIMATION
+#define ANIMATION
+
+
+	/* Renders FRAME_COUNT frames of the loaded scene. Between frames a handful of its spheres move, and SCENE_ACCELERATOR
+	   is updated rather than built again. Prints how long each update and frame took, and how long a full build takes
+	   for comparison. If OUTPUT_FILENAME isn't NULL, each frame is written to it with the frame number added. */
+	void renderAnimation(int frameCount);
+
+
+#endif
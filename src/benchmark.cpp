@@ -0,0 +1,577 @@
+/* Contains definitions for functions that measure how quickly the acceleration structures are built and traced. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <vector> /* STL vector. */
+#include <typeinfo>
+
+#include "benchmark.h"
+#include "raytrace.h"
+#include "accelerator.h"
+#include "compiledscene.h"
+#include "kernels.h"
+#include "cpu.h"
+#include "geometry.h"
+#include "sceneobject.h"
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+#include "misc.h"
+#include "lowlevel.h"
+#include "parallel.h"
+#include "tiles.h"
+
+using namespace std;
+
+
+/* Kinds of acceleration structure to compare, by the names createAccelerator() takes. */
+static const char *BENCHMARK_ACCELERATORS [] = {"bvh", "sbvh", "lbvh", "bvh4", "bvh8", "cbvh", "grid", "grid2", "kd", "none"};
+
+/* Scenes with more objects than this are not traced with "none", which would take far too long. */
+#define BENCHMARK_MAX_LINEAR_OBJECTS 1000
+
+/* Number of times each set of rays is traced. The fastest pass is reported. */
+#define BENCHMARK_PASSES 3
+
+/* Number of ray/triangle tests each way of testing triangles is timed over. */
+#define BENCHMARK_TRIANGLE_TESTS 10000000
+
+
+
+/* Fills RETURN_DIRECTIONS with the direction of the primary ray through every pixel of the canvas, in the same
+   order and computed the same way as drawScene(), and RETURN_START_POINTS with the pixels' positions. */
+static void getPrimaryRays(vector <Point3> &returnStartPoints, vector <Direction3> &returnDirections) {
+    double imageWidth = 2*P_NEAR*tan(FOV_X/2);
+    Point3 pixel (0, 0, -P_NEAR);
+
+    for (int i = 0; i < CANVAS_WIDTH; i++) {
+        for (int j = 0; j < CANVAS_HEIGHT; j++) {
+            pixel[0] = (i-(CANVAS_WIDTH/2))*imageWidth/CANVAS_WIDTH;
+            pixel[1] = (j-(CANVAS_HEIGHT/2))*imageWidth/CANVAS_WIDTH;
+
+            returnStartPoints.push_back(pixel);
+            returnDirections.push_back((pixel - CAMERA_LOCATION).normalize());
+        }
+    }
+}
+
+
+/* Fills RETURN_START_POINTS and RETURN_DIRECTIONS with COUNT rays from the camera in random directions, so that
+   rays also go where the camera isn't looking. The same rays are made every time. */
+static void getRandomRays(unsigned int count, vector <Point3> &returnStartPoints, vector <Direction3> &returnDirections) {
+    srand(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        Direction3 direction;
+
+        /* Pick points in a cube until one falls within the unit sphere, which gives a uniform direction. */
+        do {
+            direction = Direction3(randomDouble(-1.0, 1.0), randomDouble(-1.0, 1.0), randomDouble(-1.0, 1.0));
+        } while (direction.magnitude() > 1.0 || direction.magnitude() < 1e-3);
+
+        returnStartPoints.push_back(CAMERA_LOCATION);
+        returnDirections.push_back(direction.normalize());
+    }
+}
+
+
+/* Traces every ray in START_POINTS and DIRECTIONS through ACCELERATOR. If ACCELERATOR is NULL, each ray is tested
+   against every object of SCENE, SCENE_OBJECTS compiled, keeping the closest hit, as rendering without an acceleration
+   structure does. Returns the number of rays that hit something, and places the fastest time of BENCHMARK_PASSES
+   passes in seconds into RETURN_SECONDS. */
+static unsigned int traceRays(const Accelerator *accelerator, const CompiledScene &scene, const vector <Point3> &startPoints,
+                              const vector <Direction3> &directions, double &returnSeconds) {
+    unsigned int hits = 0;
+    returnSeconds = HUGE_VAL;
+
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        double startTime = getTime();
+        hits = 0;
+
+        for (unsigned int i = 0; i < startPoints.size(); i++) {
+            Point3 point (0.0, 0.0, 0.0);
+            SceneObject *object;
+            bool hit = false;
+
+            if (accelerator != NULL) {
+                hit = accelerator->findFirstIntersection(startPoints[i], directions[i], point, object);
+            }
+            else {
+                HitRecord closestHit;
+                unsigned int index;
+
+                hit = scene.findFirstIntersection(startPoints[i], directions[i], closestHit, index);
+            }
+
+            if (hit) {
+                hits++;
+            }
+        }
+
+        double seconds = getTime() - startTime;
+        if (seconds < returnSeconds) {
+            returnSeconds = seconds;
+        }
+    }
+
+    return hits;
+}
+
+
+/* Traces the primary rays in START_POINTS and DIRECTIONS, made by getPrimaryRays(), through ACCELERATOR together in
+   blocks of PACKET_SIZE by PACKET_SIZE pixels, as drawScene() does with packets. Returns the number of rays that hit
+   something, and places the fastest time of BENCHMARK_PASSES passes in seconds into RETURN_SECONDS. */
+static unsigned int tracePackets(const Accelerator *accelerator, int packetSize, const vector <Point3> &startPoints,
+                                 const vector <Direction3> &directions, double &returnSeconds) {
+    Point3 packetStartPoints [MAX_PACKET_SIZE];
+    Direction3 packetDirections [MAX_PACKET_SIZE];
+    HitRecord hits [MAX_PACKET_SIZE];
+    unsigned int hitIndices [MAX_PACKET_SIZE];
+
+    unsigned int hitCount = 0;
+    returnSeconds = HUGE_VAL;
+
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        double startTime = getTime();
+        hitCount = 0;
+
+        for (int blockI = 0; blockI < CANVAS_WIDTH; blockI += packetSize) {
+            for (int blockJ = 0; blockJ < CANVAS_HEIGHT; blockJ += packetSize) {
+                unsigned int count = 0;
+
+                /* getPrimaryRays() goes column by column. */
+                for (int i = blockI; i < min(blockI + packetSize, CANVAS_WIDTH); i++) {
+                    for (int j = blockJ; j < min(blockJ + packetSize, CANVAS_HEIGHT); j++) {
+                        packetStartPoints[count] = startPoints[i*CANVAS_HEIGHT + j];
+                        packetDirections[count] = directions[i*CANVAS_HEIGHT + j];
+                        count++;
+                    }
+                }
+
+                accelerator->findFirstIntersections(packetStartPoints, packetDirections, count, hits, hitIndices);
+
+                for (unsigned int k = 0; k < count; k++) {
+                    if (hitIndices[k] != UINT_MAX) {
+                        hitCount++;
+                    }
+                }
+            }
+        }
+
+        double seconds = getTime() - startTime;
+        if (seconds < returnSeconds) {
+            returnSeconds = seconds;
+        }
+    }
+
+    return hitCount;
+}
+
+
+/* Builds every kind of acceleration structure over SCENE_OBJECTS in turn, and prints how long each took to build,
+   how much memory it takes up, in all and per object, and how many rays per second it finds intersections for. Each
+   is traced with the camera's primary rays, one at a time and in packets of PACKET_SIZE by PACKET_SIZE pixels (8 by 8
+   unless set), and with as many rays in random directions from the camera. A count of the rays that hit something is
+   printed too, which should be the same for every structure. */
+void benchmarkAccelerators(void) {
+    vector <Point3> primaryStartPoints, primaryDirections;
+    vector <Point3> randomStartPoints, randomDirections;
+
+    getPrimaryRays(primaryStartPoints, primaryDirections);
+    getRandomRays(primaryStartPoints.size(), randomStartPoints, randomDirections);
+
+    printf("Benchmarking %u objects, %u primary and %u random rays, in %s precision\n", (unsigned int)SCENE_OBJECTS->size(),
+           (unsigned int)primaryStartPoints.size(), (unsigned int)randomStartPoints.size(), (sizeof(Scalar) == sizeof(float)) ? "single" : "double");
+    int packetSize = (PACKET_SIZE > 1) ? PACKET_SIZE : 8;
+
+    printf("%-6s %12s %12s %10s %16s %10s %16s %10s %16s %10s\n", "accel", "build (ms)", "memory (MB)", "bytes/obj",
+           "primary (Mray/s)", "hits", "packets (Mray/s)", "hits", "random (Mray/s)", "hits");
+
+    for (unsigned int i = 0; i < sizeof(BENCHMARK_ACCELERATORS)/sizeof(BENCHMARK_ACCELERATORS[0]); i++) {
+        const char *name = BENCHMARK_ACCELERATORS[i];
+        Accelerator *accelerator = createAccelerator(name);
+        double buildSeconds = 0.0;
+        double megabytes = 0.0;
+        double bytesPerObject = 0.0;
+
+        if (accelerator == NULL && SCENE_OBJECTS->size() > BENCHMARK_MAX_LINEAR_OBJECTS) {
+            continue;
+        }
+
+        if (accelerator != NULL) {
+            double startTime = getTime();
+            accelerator->build(*SCENE_OBJECTS);
+            buildSeconds = getTime() - startTime;
+            megabytes = accelerator->getMemoryUsage() / 1e6;
+            bytesPerObject = (double)accelerator->getMemoryUsage() / max((size_t)1, SCENE_OBJECTS->size());
+        }
+
+        CompiledScene scene;
+        if (accelerator == NULL) {
+            scene.compile(*SCENE_OBJECTS);
+        }
+
+        double primarySeconds, randomSeconds;
+        unsigned int primaryHits = traceRays(accelerator, scene, primaryStartPoints, primaryDirections, primarySeconds);
+        unsigned int randomHits = traceRays(accelerator, scene, randomStartPoints, randomDirections, randomSeconds);
+
+        /* Without an acceleration structure there is nothing to trace packets through. */
+        double packetSeconds = primarySeconds;
+        unsigned int packetHits = primaryHits;
+        if (accelerator != NULL) {
+            packetHits = tracePackets(accelerator, packetSize, primaryStartPoints, primaryDirections, packetSeconds);
+        }
+
+        printf("%-6s %12.3f %12.2f %10.1f %16.3f %10u %16.3f %10u %16.3f %10u\n", name, 1000.0*buildSeconds, megabytes, bytesPerObject,
+               primaryStartPoints.size()/primarySeconds/1e6, primaryHits,
+               primaryStartPoints.size()/packetSeconds/1e6, packetHits,
+               randomStartPoints.size()/randomSeconds/1e6, randomHits);
+
+        delete accelerator;
+    }
+}
+
+
+
+/* Tests the ray defined by POINT and DIRECTION against TRIANGLE the way Triangle::intersect() did before triangles kept
+   their edges, working them out from the corners on every test, and fills in RETURN_HIT the same way. */
+static bool intersectRecomputingEdges(const Triangle &triangle, const Point3 &point, const Direction3 &direction, HitRecord &returnHit) {
+    Vec3 e1 = (triangle.getVertex(1)-triangle.getVertex(0));
+    Vec3 e2 = (triangle.getVertex(2)-triangle.getVertex(0));
+    Vec3 q = direction.crossProduct(e2);
+
+    Scalar a = e1.dotProduct(q);
+
+    if (a > Scalar(-0.0001) && a < Scalar(0.0001)) {
+        return false;
+    }
+
+    Scalar f = 1/a;
+
+    Vec3 s = point-triangle.getVertex(0);
+    Scalar u = f*(s.dotProduct(q));
+
+    if (u < 0.0) {
+        return false;
+    }
+
+    Vec3 r = s.crossProduct(e1);
+    Scalar v = f*(direction.dotProduct(r));
+
+    if (v < 0.0 || u+v > 1.0) {
+        return false;
+    }
+
+    Scalar t = f*(e2.dotProduct(r));
+
+    if (t < 0.0) {
+        return false;
+    }
+
+    returnHit.t = t;
+    returnHit.point = (1-u-v)*triangle.getVertex(0) + u*triangle.getVertex(1) + v*triangle.getVertex(2);
+    returnHit.primitive = 0;
+    returnHit.u = u;
+    returnHit.v = v;
+
+    return true;
+}
+
+
+/* Ways benchmarkTriangleTests() tests rays against triangles. */
+enum TriangleTest {
+    /* Triangle::intersect(), with the edges the triangle keeps. */
+    TRIANGLE_TEST_CACHED,
+
+    /* intersectRecomputingEdges(). */
+    TRIANGLE_TEST_RECOMPUTED,
+
+    /* CompiledScene::intersect(), over the triangle pool acceleration structures test against. */
+    TRIANGLE_TEST_COMPILED
+};
+
+
+/* Runs BENCHMARK_TRIANGLE_TESTS tests of the rays in START_POINTS and DIRECTIONS against TRIANGLES, whose PrimitiveRefs
+   in SCENE are REFS, in the way TEST names, pairing each ray with many triangles in turn. Returns the number of tests that
+   found an intersection, and places the fastest time of BENCHMARK_PASSES passes in seconds into RETURN_SECONDS. */
+static unsigned int runTriangleTests(TriangleTest test, const vector <const Triangle *> &triangles, const CompiledScene &scene,
+                                     const vector <PrimitiveRef> &refs, const vector <Point3> &startPoints,
+                                     const vector <Direction3> &directions, double &returnSeconds) {
+    unsigned int hits = 0;
+    returnSeconds = HUGE_VAL;
+
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        double startTime = getTime();
+        unsigned int triangle = 0;
+        hits = 0;
+
+        for (unsigned int i = 0; i < BENCHMARK_TRIANGLE_TESTS; i++) {
+            unsigned int ray = (i / triangles.size()) % startPoints.size();
+            HitRecord hit;
+            bool found = false;
+
+            switch (test) {
+                case TRIANGLE_TEST_CACHED:
+                    found = triangles[triangle]->intersect(startPoints[ray], directions[ray], hit);
+                    break;
+                case TRIANGLE_TEST_RECOMPUTED:
+                    found = intersectRecomputingEdges(*triangles[triangle], startPoints[ray], directions[ray], hit);
+                    break;
+                case TRIANGLE_TEST_COMPILED:
+                    found = scene.intersect(refs[triangle], startPoints[ray], directions[ray], hit);
+                    break;
+            }
+
+            if (found) {
+                hits++;
+            }
+
+            if (++triangle == triangles.size()) {
+                triangle = 0;
+            }
+        }
+
+        double seconds = getTime() - startTime;
+        if (seconds < returnSeconds) {
+            returnSeconds = seconds;
+        }
+    }
+
+    return hits;
+}
+
+
+/* Runs BENCHMARK_TRIANGLE_TESTS tests of the rays in START_POINTS and DIRECTIONS against the TRIANGLE_COUNT triangles
+   packed into PACKETS, KERNEL_PACKET_WIDTH at a time in order, with intersectTrianglePacket() at WIDTH. Each ray is
+   tested against every packet in turn, pairing rays and triangles as runTriangleTests() does. Returns the number of
+   tests that found an intersection, and places the fastest time of BENCHMARK_PASSES passes in seconds into
+   RETURN_SECONDS. */
+static unsigned int runPacketTests(int width, const vector <TrianglePacket> &packets, unsigned int triangleCount,
+                                   const vector <Point3> &startPoints, const vector <Direction3> &directions, double &returnSeconds) {
+    vector <Scalar> starts (3*startPoints.size());
+    vector <Scalar> rayDirections (3*directions.size());
+
+    for (unsigned int i = 0; i < startPoints.size(); i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            starts[3*i + axis] = startPoints[i].getEntry(axis);
+            rayDirections[3*i + axis] = directions[i].getEntry(axis);
+        }
+    }
+
+    unsigned int hits = 0;
+    returnSeconds = HUGE_VAL;
+
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        double startTime = getTime();
+        unsigned int tests = 0;
+        unsigned int ray = 0;
+        hits = 0;
+
+        while (tests < BENCHMARK_TRIANGLE_TESTS) {
+            for (unsigned int i = 0; i < packets.size() && tests < BENCHMARK_TRIANGLE_TESTS; i++) {
+                unsigned int lane;
+                Scalar t, u, v;
+                unsigned int mask = intersectTrianglePacket(packets[i], &starts[3*ray], &rayDirections[3*ray], lane, t, u, v, width);
+
+                /* Only count the triangles the other tests would have reached. */
+                unsigned int lanes = min(min(triangleCount - i*KERNEL_PACKET_WIDTH, (unsigned int)KERNEL_PACKET_WIDTH), BENCHMARK_TRIANGLE_TESTS - tests);
+                hits += __builtin_popcount(mask & ((1u << lanes) - 1));
+                tests += lanes;
+            }
+
+            if (++ray == startPoints.size()) {
+                ray = 0;
+            }
+        }
+
+        double seconds = getTime() - startTime;
+        if (seconds < returnSeconds) {
+            returnSeconds = seconds;
+        }
+    }
+
+    return hits;
+}
+
+
+/* Times the Moller-Trumbore ray/triangle test over the triangles in SCENE_OBJECTS and the camera's primary rays, with
+   the edges each triangle keeps, with the edges worked out again on every test, and over the compiled triangle pool,
+   and prints how many tests per second each manages. Then times the SIMD kernel over the triangles packed as the
+   leaves of acceleration structures pack them, at each width the processor supports. The counts of tests that found
+   an intersection should match. Prints nothing if the scene has no triangles. */
+void benchmarkTriangleTests(void) {
+    vector <const Triangle *> triangles;
+    vector <PrimitiveRef> refs;
+    CompiledScene scene;
+
+    scene.compile(*SCENE_OBJECTS);
+
+    for (unsigned int i = 0; i < SCENE_OBJECTS->size(); i++) {
+        if (typeid(*(*SCENE_OBJECTS)[i]) == typeid(Triangle)) {
+            triangles.push_back((const Triangle *)(*SCENE_OBJECTS)[i]);
+            refs.push_back(scene.getRef(i));
+        }
+    }
+
+    if (triangles.empty()) {
+        return;
+    }
+
+    vector <Point3> startPoints, directions;
+    getPrimaryRays(startPoints, directions);
+
+    const char *names [] = {"cached edges", "recomputed edges", "compiled pool"};
+    TriangleTest tests [] = {TRIANGLE_TEST_CACHED, TRIANGLE_TEST_RECOMPUTED, TRIANGLE_TEST_COMPILED};
+
+    printf("\nTesting %u primary rays against %u triangles, %u tests\n", (unsigned int)startPoints.size(),
+           (unsigned int)triangles.size(), BENCHMARK_TRIANGLE_TESTS);
+    printf("%-18s %16s %10s\n", "triangle test", "Mtests/s", "hits");
+
+    for (unsigned int i = 0; i < sizeof(tests)/sizeof(tests[0]); i++) {
+        double seconds;
+        unsigned int hits = runTriangleTests(tests[i], triangles, scene, refs, startPoints, directions, seconds);
+
+        printf("%-18s %16.3f %10u\n", names[i], BENCHMARK_TRIANGLE_TESTS/seconds/1e6, hits);
+    }
+
+    vector <TrianglePacket> packets ((refs.size() + KERNEL_PACKET_WIDTH - 1) / KERNEL_PACKET_WIDTH);
+    for (unsigned int i = 0; i < refs.size(); i++) {
+        scene.packTriangle(refs[i], packets[i / KERNEL_PACKET_WIDTH], i % KERNEL_PACKET_WIDTH);
+    }
+
+#ifdef SINGLE_PRECISION
+    /* A packet's four floats fill one SSE register, so every wider width runs the same SSE2 kernel. */
+    const char *packetNames [] = {"packets, scalar", "packets, SSE2"};
+    int widths [] = {1, 2};
+#else
+    const char *packetNames [] = {"packets, scalar", "packets, SSE2", "packets, AVX2"};
+    int widths [] = {1, 2, 4};
+#endif
+
+    for (unsigned int i = 0; i < sizeof(widths)/sizeof(widths[0]); i++) {
+        if (getKernelWidth(widths[i]) != widths[i]) {
+            continue;
+        }
+
+        double seconds;
+        unsigned int hits = runPacketTests(widths[i], packets, refs.size(), startPoints, directions, seconds);
+
+        printf("%-18s %16.3f %10u\n", packetNames[i], BENCHMARK_TRIANGLE_TESTS/seconds/1e6, hits);
+    }
+}
+
+
+
+/* Draws the scene with drawSceneTiles() on 1 thread, then on 2, 4 and so on up to getThreadCount(), and prints the
+   fastest of BENCHMARK_PASSES renders on each with its speedup over 1 thread, and whether the image came out exactly
+   the same as on 1 thread. The canvas must have been set up. */
+void benchmarkThreadScaling(void) {
+    GLfloat imageWidth = 2*P_NEAR*tan(FOV_X/2);
+    unsigned int maxThreads = getThreadCount();
+    unsigned int canvasBytes = 3*CANVAS_WIDTH*CANVAS_HEIGHT;
+
+    /* Every count of threads up to MAX_THREADS that is a power of 2, and MAX_THREADS itself. */
+    vector <unsigned int> threadCounts;
+    for (unsigned int count = 1; count < maxThreads; count *= 2) {
+        threadCounts.push_back(count);
+    }
+    threadCounts.push_back(maxThreads);
+
+    printf("Rendering %dx%d pixels in %u tiles on 1 to %u threads, on a machine with %u cores\n", CANVAS_WIDTH, CANVAS_HEIGHT,
+           ((CANVAS_WIDTH + TILE_SIZE - 1)/TILE_SIZE) * ((CANVAS_HEIGHT + TILE_SIZE - 1)/TILE_SIZE), maxThreads, getCoreCount());
+    printf("%-8s %12s %10s %12s %10s\n", "threads", "render (ms)", "speedup", "efficiency", "image");
+
+    vector <unsigned char> firstImage;
+    double firstSeconds = 0.0;
+
+    for (unsigned int i = 0; i < threadCounts.size(); i++) {
+        setThreadCount(threadCounts[i]);
+
+        double seconds = HUGE_VAL;
+        for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+            double startTime = getTime();
+            drawSceneTiles(imageWidth);
+            seconds = min(seconds, getTime() - startTime);
+        }
+
+        const unsigned char *image = getCanvas();
+        if (i == 0) {
+            firstImage.assign(image, image + canvasBytes);
+            firstSeconds = seconds;
+        }
+        bool same = equal(firstImage.begin(), firstImage.end(), image);
+
+        printf("%-8u %12.3f %9.2fx %11.0f%% %10s\n", threadCounts[i], 1000.0*seconds, firstSeconds/seconds,
+               100.0*firstSeconds/seconds/threadCounts[i], same ? "same" : "DIFFERENT");
+    }
+
+    setThreadCount(maxThreads);
+}
+
+
+
+/* Reads the binary PPM image in FILENAME, as writeCanvas() writes them, into RETURN_PIXELS, and its size into
+   RETURN_WIDTH and RETURN_HEIGHT. Returns false if the file can't be read or isn't such an image. */
+static bool readImage(const char *filename, vector <unsigned char> &returnPixels, int &returnWidth, int &returnHeight) {
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    int maxValue;
+    bool read = (fscanf(file, "P6 %d %d %d", &returnWidth, &returnHeight, &maxValue) == 3) && maxValue == 255 &&
+                returnWidth > 0 && returnHeight > 0 && fgetc(file) != EOF;
+
+    if (read) {
+        returnPixels.resize(3*returnWidth*returnHeight);
+        read = (fread(&returnPixels[0], 1, returnPixels.size(), file) == returnPixels.size());
+    }
+
+    fclose(file);
+    return read;
+}
+
+
+/* Compares the PPM images in FILENAME_1 and FILENAME_2, such as renders of the same scene in single and double
+   precision, and prints the peak signal-to-noise ratio between them and how many pixels differ. Returns false if
+   either can't be read or they aren't the same size. */
+bool compareImages(const char *filename1, const char *filename2) {
+    vector <unsigned char> pixels1, pixels2;
+    int width1, height1, width2, height2;
+
+    if (!readImage(filename1, pixels1, width1, height1) || !readImage(filename2, pixels2, width2, height2)) {
+        fprintf(stderr, "Couldn't read %s and %s as PPM images\n", filename1, filename2);
+        return false;
+    }
+    if (width1 != width2 || height1 != height2) {
+        fprintf(stderr, "%s is %dx%d pixels, but %s is %dx%d\n", filename1, width1, height1, filename2, width2, height2);
+        return false;
+    }
+
+    double squaredError = 0.0;
+    unsigned int differentPixels = 0;
+
+    for (unsigned int i = 0; i < pixels1.size(); i += 3) {
+        bool different = false;
+
+        for (unsigned int channel = i; channel < i + 3; channel++) {
+            double difference = (double)pixels1[channel] - (double)pixels2[channel];
+            squaredError += difference*difference;
+            different = different || (difference != 0.0);
+        }
+
+        differentPixels += different ? 1 : 0;
+    }
+
+    double meanSquaredError = squaredError / pixels1.size();
+    printf("%u of %d pixels differ, ", differentPixels, width1*height1);
+    if (meanSquaredError == 0.0) {
+        printf("PSNR infinite (identical)\n");
+    }
+    else {
+        printf("PSNR %.2f dB\n", 10.0*log10(255.0*255.0/meanSquaredError));
+    }
+
+    return true;
+}
@@ -0,0 +1,30 @@
+/* Contains declarations for functions that measure how quickly the acceleration structures are built and traced. */
+
+#ifndef BENCHMARK
+#define BENCHMARK
+
+
+	/* Builds every kind of acceleration structure over SCENE_OBJECTS in turn, and prints how long each took to build
+	   and how many rays per second it finds intersections for. Each is traced with the camera's primary rays, one at a
+	   time and in packets of neighboring pixels, and with as many rays in random directions from the camera. A count of the rays that hit something is printed
+	   too, which should be the same for every structure. */
+	void benchmarkAccelerators(void);
+
+	/* Times the Moller-Trumbore ray/triangle test over the triangles in SCENE_OBJECTS and the camera's primary rays, with
+	   the edges each triangle keeps, with the edges worked out again on every test, over the compiled triangle pool, and
+	   packed for the SIMD kernel at each width the processor supports, and prints how many tests per second each manages.
+	   The counts of tests that found an intersection should match. Prints nothing if the scene has no triangles. */
+	void benchmarkTriangleTests(void);
+
+	/* Draws the scene with drawSceneTiles() on 1 thread, then on 2, 4 and so on up to getThreadCount(), and prints the
+	   fastest of BENCHMARK_PASSES renders on each with its speedup over 1 thread, and whether the image came out
+	   exactly the same as on 1 thread. The canvas must have been set up. */
+	void benchmarkThreadScaling(void);
+
+	/* Compares the PPM images in FILENAME_1 and FILENAME_2, such as renders of the same scene in single and double
+	   precision, and prints the peak signal-to-noise ratio between them and how many pixels differ. Returns false if
+	   either can't be read or they aren't the same size. */
+	bool compareImages(const char *filename1, const char *filename2);
+
+
+#endif
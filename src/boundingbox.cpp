@@ -0,0 +1,195 @@
+/* Contains definitions for an axis-aligned bounding box, used by acceleration structures to bound SceneObjects. */
+
+#include <iostream>
+#include <cstdio>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+#include "boundingbox.h"
+#include "vector.h"
+
+using namespace std;
+
+
+/* Returns a box that contains nothing. Expanding it by any point or box gives that point or box. */
+BoundingBox getEmptyBoundingBox(void) {
+	BoundingBox box;
+
+	for (int i = 0; i < 3; i++) {
+		box.lower[i] =  DBL_MAX;
+		box.upper[i] = -DBL_MAX;
+	}
+
+	return box;
+}
+
+
+/* Returns true if BOX contains nothing. */
+bool isEmpty(const BoundingBox &box) {
+	return (box.lower[0] > box.upper[0]) || (box.lower[1] > box.upper[1]) || (box.lower[2] > box.upper[2]);
+}
+
+
+/* Grows BOX so that it also contains POINT. Modifies BOX and returns a reference to it. */
+BoundingBox& expand(BoundingBox &box, const Point3 &point) {
+	for (int i = 0; i < 3; i++) {
+		double value = point.getEntry(i);
+
+		if (value < box.lower[i]) {
+			box.lower[i] = value;
+		}
+		if (value > box.upper[i]) {
+			box.upper[i] = value;
+		}
+	}
+
+	return box;
+}
+
+
+/* Grows BOX so that it also contains OTHER. Modifies BOX and returns a reference to it. */
+BoundingBox& expand(BoundingBox &box, const BoundingBox &other) {
+	for (int i = 0; i < 3; i++) {
+		if (other.lower[i] < box.lower[i]) {
+			box.lower[i] = other.lower[i];
+		}
+		if (other.upper[i] > box.upper[i]) {
+			box.upper[i] = other.upper[i];
+		}
+	}
+
+	return box;
+}
+
+
+/* Grows BOX outward on every side by a small amount relative to its size. Modifies BOX and returns a reference to it. */
+BoundingBox& pad(BoundingBox &box) {
+	for (int i = 0; i < 3; i++) {
+		/* Scale the padding with the magnitude of the coordinates so it stays above rounding error far from the origin. */
+		double magnitude = fabs(box.lower[i]) + fabs(box.upper[i]) + (box.upper[i] - box.lower[i]);
+		double padding = 1e-9 * magnitude + 1e-12;
+
+		box.lower[i] -= padding;
+		box.upper[i] += padding;
+	}
+
+	return box;
+}
+
+
+/* Returns the surface area of BOX. Returns 0.0 for an empty box. */
+double surfaceArea(const BoundingBox &box) {
+	if (isEmpty(box)) {
+		return 0.0;
+	}
+
+	double dx = box.upper[0] - box.lower[0];
+	double dy = box.upper[1] - box.lower[1];
+	double dz = box.upper[2] - box.lower[2];
+
+	return 2.0 * (dx*dy + dy*dz + dz*dx);
+}
+
+
+/* Returns the coordinate of the center of BOX along AXIS. */
+double centroid(const BoundingBox &box, int axis) {
+	return 0.5 * (box.lower[axis] + box.upper[axis]);
+}
+
+
+/* Returns the axis (0, 1, or 2) along which BOX is longest. */
+int longestAxis(const BoundingBox &box) {
+	double dx = box.upper[0] - box.lower[0];
+	double dy = box.upper[1] - box.lower[1];
+	double dz = box.upper[2] - box.lower[2];
+
+	if (dx >= dy && dx >= dz) {
+		return 0;
+	}
+	return (dy >= dz) ? 1 : 2;
+}
+
+
+/* Takes the start point of a ray, the reciprocals of each component of its direction, and the largest
+   ray parameter of interest. Returns true if the ray enters BOX somewhere in [0, MAX_T], and places the
+   ray parameter where it enters the box into RETURN_T_NEAR. Components of INVERSE_DIRECTION may be infinite. */
+bool intersectRay(const BoundingBox &box, const double rayStartPoint[3], const double inverseDirection[3], double maxT, double &returnTNear) {
+	double tNear = 0.0;
+	double tFar = maxT;
+
+	for (int i = 0; i < 3; i++) {
+		double t0 = (box.lower[i] - rayStartPoint[i]) * inverseDirection[i];
+		double t1 = (box.upper[i] - rayStartPoint[i]) * inverseDirection[i];
+
+		if (t0 > t1) {
+			double temp = t0; t0 = t1; t1 = temp;
+		}
+
+		/* A ray parallel to this slab and starting on its boundary gives 0*infinity = NaN. The comparisons
+		   below are false for NaN, so such a slab simply places no limit on the ray. */
+		if (t0 > tNear) {
+			tNear = t0;
+		}
+		if (t1 < tFar) {
+			tFar = t1;
+		}
+	}
+
+	if (tNear > tFar) {
+		return false;
+	}
+
+	returnTNear = tNear;
+	return true;
+}
+
+
+/* Takes bounds on the start points of a group of rays and on the reciprocals of their directions' components, and the
+   largest ray parameter of interest to any of them. Returns false only if none of the rays enters BOX in [0, MAX_T].
+
+   This is intersectRay() in interval arithmetic. Along each axis, every ray's (lower - start) * inverse lies between
+   the smallest and largest of the products at the corners of the intervals, since rounding never reverses the order
+   of two results, and so does (upper - start) * inverse. The rays therefore enter the slab no earlier than the
+   smallest of those products, and leave it no later than the largest. */
+bool mayIntersectRays(const BoundingBox &box, const double startLower[3], const double startUpper[3], const double inverseLower[3], const double inverseUpper[3], double maxT) {
+	double tNear = 0.0;
+	double tFar = maxT;
+
+	for (int i = 0; i < 3; i++) {
+
+		/* An infinite reciprocal times a zero distance is NaN, which would give no bound at all. */
+		if (!isfinite(inverseLower[i]) || !isfinite(inverseUpper[i])) {
+			continue;
+		}
+
+		double distances [4] = {box.lower[i] - startUpper[i], box.lower[i] - startLower[i], box.upper[i] - startUpper[i], box.upper[i] - startLower[i]};
+		double earliest = DBL_MAX;
+		double latest = -DBL_MAX;
+
+		for (int j = 0; j < 4; j++) {
+			double t0 = distances[j] * inverseLower[i];
+			double t1 = distances[j] * inverseUpper[i];
+
+			earliest = min(earliest, min(t0, t1));
+			latest = max(latest, max(t0, t1));
+		}
+
+		if (earliest > tNear) {
+			tNear = earliest;
+		}
+		if (latest < tFar) {
+			tFar = latest;
+		}
+	}
+
+	return !(tNear > tFar);
+}
+
+
+/* Printing operator. */
+ostream& operator<< (ostream &os, const BoundingBox &box) {
+	printf("[BoundingBox from (%5.3f, %5.3f, %5.3f) to (%5.3f, %5.3f, %5.3f)]",
+		box.lower[0], box.lower[1], box.lower[2], box.upper[0], box.upper[1], box.upper[2]);
+	return os;
+}
@@ -0,0 +1,67 @@
+/* Contains declarations for an axis-aligned bounding box, used by acceleration structures to bound SceneObjects. */
+
+#ifndef BOUNDING_BOX
+#define BOUNDING_BOX
+
+	#include <iostream>
+
+	#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+	using namespace std;
+
+
+	/* An axis-aligned box given by its lower and upper corners. Entry 0 is x, 1 is y, and 2 is z.
+	   The corners are kept as plain arrays rather than Vectors so that acceleration structures can
+	   store and test them without going through Vector's bounds-checked accessors. */
+	struct BoundingBox {
+		double lower [3];
+		double upper [3];
+	};
+
+
+	/* Returns a box that contains nothing. Expanding it by any point or box gives that point or box. */
+	BoundingBox getEmptyBoundingBox(void);
+
+	/* Returns true if BOX contains nothing. */
+	bool isEmpty(const BoundingBox &box);
+
+
+	/* Grows BOX so that it also contains POINT. Modifies BOX and returns a reference to it. */
+	BoundingBox& expand(BoundingBox &box, const Point3 &point);
+
+	/* Grows BOX so that it also contains OTHER. Modifies BOX and returns a reference to it. */
+	BoundingBox& expand(BoundingBox &box, const BoundingBox &other);
+
+	/* Grows BOX outward on every side by a small amount relative to its size. Boxes of flat objects, such as
+	   axis-aligned triangles, would otherwise have no thickness and could be missed by rounding in the ray test.
+	   Modifies BOX and returns a reference to it. */
+	BoundingBox& pad(BoundingBox &box);
+
+
+	/* Returns the surface area of BOX. Returns 0.0 for an empty box. */
+	double surfaceArea(const BoundingBox &box);
+
+	/* Returns the coordinate of the center of BOX along AXIS. */
+	double centroid(const BoundingBox &box, int axis);
+
+	/* Returns the axis (0, 1, or 2) along which BOX is longest. */
+	int longestAxis(const BoundingBox &box);
+
+
+	/* Takes the start point of a ray, the reciprocals of each component of its direction, and the largest
+	   ray parameter of interest. Returns true if the ray enters BOX somewhere in [0, MAX_T], and places the
+	   ray parameter where it enters the box into RETURN_T_NEAR. Components of INVERSE_DIRECTION may be infinite. */
+	bool intersectRay(const BoundingBox &box, const double rayStartPoint[3], const double inverseDirection[3], double maxT, double &returnTNear);
+
+	/* Takes bounds on the start points of a group of rays and on the reciprocals of their directions' components, one
+	   interval per axis, and the largest ray parameter of interest to any of them. Returns false only if intersectRay()
+	   would find that none of the rays enters BOX somewhere in [0, MAX_T], so that the whole group can skip the box.
+	   Axes where the bounds on the reciprocals aren't finite place no limit on the rays. */
+	bool mayIntersectRays(const BoundingBox &box, const double startLower[3], const double startUpper[3], const double inverseLower[3], const double inverseUpper[3], double maxT);
+
+
+	/* Printing operator. */
+	ostream& operator<< (ostream &os, const BoundingBox &box);
+
+
+#endif
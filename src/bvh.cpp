@@ -0,0 +1,1238 @@
+/* Contains definitions for a bounding volume hierarchy (BVH) built using the surface area heuristic (SAH). */
+
+#include <vector> /* STL vector. */
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+#include "bvh.h"
+#include "accelerator.h"
+#include "kernels.h"
+#include "boundingbox.h"
+#include "sceneobject.h"
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+using namespace std;
+
+
+/* Number of bins that candidate split planes are placed between along each axis. */
+#define BVH_BIN_COUNT 16
+
+/* Cost of visiting a node, relative to testing a ray against one object. */
+#define BVH_TRAVERSAL_COST 1.0
+
+/* Cost of testing a ray against one object. */
+#define BVH_INTERSECTION_COST 1.0
+
+/* Leaves never hold more objects than this. */
+#define BVH_MAX_LEAF_SIZE 8
+
+/* Below this depth the builder stops using the SAH and splits at the median instead, which keeps the tree shallow
+   enough for the traversal stack even for badly distributed objects. */
+#define BVH_MAX_SAH_DEPTH 40
+
+/* Number of entries in the traversal stack. Must exceed the depth of the deepest tree that can be built. */
+#define BVH_STACK_SIZE 128
+
+/* A packet of rays going down the tree together splits into single rays once fewer than this many of them enter a
+   node, since the SIMD box test then saves little over testing the rays on their own. */
+#define BVH_MIN_PACKET_RAYS 4
+
+/* update() rebuilds part or all of the tree once refitting has raised its estimated cost by this factor. */
+#define BVH_MAX_COST_RATIO 1.25
+
+/* When part of the tree is rebuilt, it is the largest subtree whose box has grown by more than this factor
+   in surface area since it was built. */
+#define BVH_MAX_AREA_GROWTH 2.0
+
+/* Number of bins that candidate spatial split planes are placed between along each axis. */
+#define BVH_SPATIAL_BIN_COUNT 16
+
+/* Spatial splits are only tried for nodes whose best object split leaves the children's boxes overlapping by more
+   than this fraction of the root's surface area, as suggested by Stich et al. Elsewhere they rarely pay off. */
+#define BVH_SPATIAL_SPLIT_OVERLAP 1e-5
+
+
+
+/*
+----------------------
+    BVH construction.
+----------------------
+*/
+
+
+/* Orders BuildPrimitives by their center along one axis. */
+struct CompareCenters {
+    int axis;
+
+    CompareCenters (int axis) : axis(axis) {}
+
+    bool operator() (const BuildPrimitive &a, const BuildPrimitive &b) const {
+        return a.center[axis] < b.center[axis];
+    }
+};
+
+
+/* Returns the bin along AXIS that CENTER falls into when the range of CENTER_BOUNDS is divided into BVH_BIN_COUNT bins. */
+static int getBin(const double center[3], const BoundingBox &centerBounds, int axis) {
+    double extent = centerBounds.upper[axis] - centerBounds.lower[axis];
+    int bin = (int)(BVH_BIN_COUNT * (center[axis] - centerBounds.lower[axis]) / extent);
+
+    return (bin < BVH_BIN_COUNT) ? bin : BVH_BIN_COUNT-1;
+}
+
+
+/* Finds the split of PRIMITIVES[BEGIN, END) with the lowest SAH cost, placing its axis and bin in RETURN_AXIS and RETURN_BIN.
+   Objects in bins up to and including RETURN_BIN go to the left child. Returns the cost of the split, or DBL_MAX if the
+   objects can't be split because all of their centers coincide. */
+static double findBestSplit(const vector <BuildPrimitive> &primitives, unsigned int begin, unsigned int end,
+                            const BoundingBox &nodeBounds, const BoundingBox &centerBounds, int &returnAxis, int &returnBin) {
+
+    double bestCost = DBL_MAX;
+    double nodeArea = surfaceArea(nodeBounds);
+
+    for (int axis = 0; axis < 3; axis++) {
+
+        if (centerBounds.upper[axis] <= centerBounds.lower[axis]) {
+            continue;
+        }
+
+        /* Sort the objects into bins by their center. */
+        unsigned int binCounts [BVH_BIN_COUNT];
+        BoundingBox binBounds [BVH_BIN_COUNT];
+
+        for (int i = 0; i < BVH_BIN_COUNT; i++) {
+            binCounts[i] = 0;
+            binBounds[i] = getEmptyBoundingBox();
+        }
+
+        for (unsigned int i = begin; i < end; i++) {
+            int bin = getBin(primitives[i].center, centerBounds, axis);
+            binCounts[bin]++;
+            expand(binBounds[bin], primitives[i].bounds);
+        }
+
+        /* Sweep from the right to find the area and object count to the right of every bin boundary. */
+        double rightAreas [BVH_BIN_COUNT];
+        unsigned int rightCounts [BVH_BIN_COUNT];
+        BoundingBox rightBounds = getEmptyBoundingBox();
+        unsigned int rightCount = 0;
+
+        for (int i = BVH_BIN_COUNT-1; i > 0; i--) {
+            expand(rightBounds, binBounds[i]);
+            rightCount += binCounts[i];
+            rightAreas[i] = surfaceArea(rightBounds);
+            rightCounts[i] = rightCount;
+        }
+
+        /* Sweep from the left, costing a split after every bin. */
+        BoundingBox leftBounds = getEmptyBoundingBox();
+        unsigned int leftCount = 0;
+
+        for (int i = 0; i < BVH_BIN_COUNT-1; i++) {
+            expand(leftBounds, binBounds[i]);
+            leftCount += binCounts[i];
+
+            if (leftCount == 0 || rightCounts[i+1] == 0) {
+                continue;
+            }
+
+            double cost = BVH_TRAVERSAL_COST + BVH_INTERSECTION_COST *
+                          (surfaceArea(leftBounds)*leftCount + rightAreas[i+1]*rightCounts[i+1]) / nodeArea;
+
+            if (cost < bestCost) {
+                bestCost = cost;
+                returnAxis = axis;
+                returnBin = i;
+            }
+        }
+    }
+
+    return bestCost;
+}
+
+
+/* Builds the subtree over PRIMITIVES[BEGIN, END) at DEPTH, appending its nodes to NODES and its leaves' objects to
+   PRIMITIVE_INDICES. Returns the index of the subtree's root node. */
+static unsigned int buildNode(vector <BVHNode> &nodes, vector <unsigned int> &primitiveIndices,
+                              vector <BuildPrimitive> &primitives, unsigned int begin, unsigned int end, int depth) {
+
+    unsigned int nodeIndex = nodes.size();
+    nodes.push_back(BVHNode());
+
+    /* Find the box around the objects and the box around their centers. */
+    BoundingBox nodeBounds = getEmptyBoundingBox();
+    BoundingBox centerBounds = getEmptyBoundingBox();
+
+    for (unsigned int i = begin; i < end; i++) {
+        expand(nodeBounds, primitives[i].bounds);
+        expand(centerBounds, Point3(primitives[i].center[0], primitives[i].center[1], primitives[i].center[2]));
+    }
+
+    nodes[nodeIndex].bounds = nodeBounds;
+
+    unsigned int count = end - begin;
+    unsigned int middle = begin;
+
+    if (depth < BVH_MAX_SAH_DEPTH) {
+        int axis = 0;
+        int bin = 0;
+        double splitCost = findBestSplit(primitives, begin, end, nodeBounds, centerBounds, axis, bin);
+        double leafCost = BVH_INTERSECTION_COST * count;
+
+        /* Make a leaf if splitting wouldn't pay for itself. */
+        if (count <= BVH_MAX_LEAF_SIZE && leafCost <= splitCost) {
+            middle = begin;
+        }
+        else if (splitCost < DBL_MAX) {
+            /* Move every object left of the split to the front of the range. */
+            middle = begin;
+            for (unsigned int i = begin; i < end; i++) {
+                if (getBin(primitives[i].center, centerBounds, axis) <= bin) {
+                    swap(primitives[i], primitives[middle]);
+                    middle++;
+                }
+            }
+        }
+        else {
+            /* The centers all coincide, so any split is as good as another. */
+            middle = (count <= BVH_MAX_LEAF_SIZE) ? begin : begin + count/2;
+        }
+    }
+    else if (count > BVH_MAX_LEAF_SIZE) {
+        middle = begin + count/2;
+        nth_element(primitives.begin() + begin, primitives.begin() + middle, primitives.begin() + end, CompareCenters(longestAxis(centerBounds)));
+    }
+
+    /* Make a leaf. */
+    if (middle == begin || middle == end) {
+        nodes[nodeIndex].offset = primitiveIndices.size();
+        nodes[nodeIndex].primitiveCount = count;
+
+        for (unsigned int i = begin; i < end; i++) {
+            primitiveIndices.push_back(primitives[i].index);
+        }
+
+        return nodeIndex;
+    }
+
+    /* Make an interior node. The left child directly follows this node. */
+    buildNode(nodes, primitiveIndices, primitives, begin, middle, depth+1);
+    unsigned int rightChild = buildNode(nodes, primitiveIndices, primitives, middle, end, depth+1);
+
+    nodes[nodeIndex].offset = rightChild;
+    nodes[nodeIndex].primitiveCount = 0;
+
+    return nodeIndex;
+}
+
+
+
+/*
+----------------------
+    Spatial splits.
+----------------------
+*/
+
+
+/* What building a BVH with spatial splits needs beyond the objects being placed. */
+struct SpatialSplitBuild {
+    /* The objects, which are asked to clip themselves to split planes. */
+    const vector <SceneObject *> *objects;
+
+    /* Surface area of the box around every object. */
+    double rootArea;
+};
+
+
+/* Finds the spatial split of the node over REFERENCES, whose box is NODE_BOUNDS, with the lowest SAH cost. Unlike an
+   object split, the plane cuts through the objects in its way, and the part on each side goes to that side's child.
+   Places the axis and position of the plane in RETURN_AXIS and RETURN_POSITION, and the number of references the
+   split would add in RETURN_DUPLICATES. Returns the cost of the split, or DBL_MAX if there is none. */
+static double findBestSpatialSplit(const vector <BuildPrimitive> &references, const BoundingBox &nodeBounds, const SpatialSplitBuild &build,
+                                   int &returnAxis, double &returnPosition, unsigned int &returnDuplicates) {
+
+    double bestCost = DBL_MAX;
+    double nodeArea = surfaceArea(nodeBounds);
+
+    for (int axis = 0; axis < 3; axis++) {
+        double lower = nodeBounds.lower[axis];
+        double width = (nodeBounds.upper[axis] - lower) / BVH_SPATIAL_BIN_COUNT;
+
+        if (width <= 0.0) {
+            continue;
+        }
+
+        /* Clip every object to each bin it crosses, and count the objects starting and ending in each bin. */
+        unsigned int entries [BVH_SPATIAL_BIN_COUNT];
+        unsigned int exits [BVH_SPATIAL_BIN_COUNT];
+        BoundingBox binBounds [BVH_SPATIAL_BIN_COUNT];
+
+        for (int i = 0; i < BVH_SPATIAL_BIN_COUNT; i++) {
+            entries[i] = 0;
+            exits[i] = 0;
+            binBounds[i] = getEmptyBoundingBox();
+        }
+
+        for (unsigned int i = 0; i < references.size(); i++) {
+            const BuildPrimitive &reference = references[i];
+            int first = (int)((reference.bounds.lower[axis] - lower) / width);
+            int last = (int)((reference.bounds.upper[axis] - lower) / width);
+
+            first = min(max(first, 0), BVH_SPATIAL_BIN_COUNT-1);
+            last = min(max(last, first), BVH_SPATIAL_BIN_COUNT-1);
+
+            entries[first]++;
+            exits[last]++;
+
+            if (first == last) {
+                expand(binBounds[first], reference.bounds);
+                continue;
+            }
+
+            for (int bin = first; bin <= last; bin++) {
+                BoundingBox slab = reference.bounds;
+                if (bin > first) {
+                    slab.lower[axis] = lower + bin*width;
+                }
+                if (bin < last) {
+                    slab.upper[axis] = lower + (bin+1)*width;
+                }
+
+                BoundingBox clipped;
+                if ((*build.objects)[reference.index]->getClippedBounds(slab, clipped)) {
+                    expand(binBounds[bin], clipped);
+                }
+            }
+        }
+
+        /* Sweep from the right to find the area and object count to the right of every bin boundary. */
+        double rightAreas [BVH_SPATIAL_BIN_COUNT];
+        unsigned int rightCounts [BVH_SPATIAL_BIN_COUNT];
+        BoundingBox rightBounds = getEmptyBoundingBox();
+        unsigned int rightCount = 0;
+
+        for (int i = BVH_SPATIAL_BIN_COUNT-1; i > 0; i--) {
+            expand(rightBounds, binBounds[i]);
+            rightCount += exits[i];
+            rightAreas[i] = surfaceArea(rightBounds);
+            rightCounts[i] = rightCount;
+        }
+
+        /* Sweep from the left, costing a split after every bin. */
+        BoundingBox leftBounds = getEmptyBoundingBox();
+        unsigned int leftCount = 0;
+
+        for (int i = 0; i < BVH_SPATIAL_BIN_COUNT-1; i++) {
+            expand(leftBounds, binBounds[i]);
+            leftCount += entries[i];
+
+            if (leftCount == 0 || rightCounts[i+1] == 0) {
+                continue;
+            }
+
+            double cost = BVH_TRAVERSAL_COST + BVH_INTERSECTION_COST *
+                          (surfaceArea(leftBounds)*leftCount + rightAreas[i+1]*rightCounts[i+1]) / nodeArea;
+
+            if (cost < bestCost) {
+                bestCost = cost;
+                returnAxis = axis;
+                returnPosition = lower + (i+1)*width;
+                returnDuplicates = leftCount + rightCounts[i+1] - references.size();
+            }
+        }
+    }
+
+    return bestCost;
+}
+
+
+/* Places the part of REFERENCE inside BOX into RETURN_REFERENCES, if there is any. */
+static void addClippedReference(const BuildPrimitive &reference, const BoundingBox &box, const SpatialSplitBuild &build,
+                                vector <BuildPrimitive> &returnReferences) {
+    BuildPrimitive clipped = reference;
+
+    if (!(*build.objects)[reference.index]->getClippedBounds(box, clipped.bounds)) {
+        return;
+    }
+
+    pad(clipped.bounds);
+
+    for (int axis = 0; axis < 3; axis++) {
+        clipped.center[axis] = centroid(clipped.bounds, axis);
+    }
+
+    returnReferences.push_back(clipped);
+}
+
+
+/* Builds the subtree over REFERENCES at DEPTH, like buildNode(), but choosing between splitting the objects into two
+   groups and splitting space in two, whichever is cheaper by the SAH. Objects a spatial split cuts through are placed
+   into both children, clipped to each side, making at most BUDGET copies in the whole subtree. What a split leaves
+   of the budget is shared between the children by their number of references. REFERENCES is emptied. Returns the
+   index of the subtree's root node. */
+static unsigned int buildSpatialNode(vector <BVHNode> &nodes, vector <unsigned int> &primitiveIndices,
+                                     vector <BuildPrimitive> &references, int depth, unsigned int budget, const SpatialSplitBuild &build) {
+
+    unsigned int count = references.size();
+
+    /* Deep down, finish off with object splits only. */
+    if (depth >= BVH_MAX_SAH_DEPTH || count <= 1) {
+        return buildNode(nodes, primitiveIndices, references, 0, count, depth);
+    }
+
+    BoundingBox nodeBounds = getEmptyBoundingBox();
+    BoundingBox centerBounds = getEmptyBoundingBox();
+
+    for (unsigned int i = 0; i < count; i++) {
+        expand(nodeBounds, references[i].bounds);
+        expand(centerBounds, Point3(references[i].center[0], references[i].center[1], references[i].center[2]));
+    }
+
+    int objectAxis = 0;
+    int objectBin = 0;
+    double objectCost = findBestSplit(references, 0, count, nodeBounds, centerBounds, objectAxis, objectBin);
+
+    /* Only look for a spatial split if the object split leaves the children overlapping a lot. */
+    int spatialAxis = 0;
+    double spatialPosition = 0.0;
+    unsigned int duplicates = 0;
+    double spatialCost = DBL_MAX;
+
+    if (objectCost < DBL_MAX && budget > 0) {
+        BoundingBox left = getEmptyBoundingBox();
+        BoundingBox right = getEmptyBoundingBox();
+
+        for (unsigned int i = 0; i < count; i++) {
+            expand((getBin(references[i].center, centerBounds, objectAxis) <= objectBin) ? left : right, references[i].bounds);
+        }
+
+        BoundingBox overlap;
+        bool overlapping = true;
+
+        for (int axis = 0; axis < 3; axis++) {
+            overlap.lower[axis] = max(left.lower[axis], right.lower[axis]);
+            overlap.upper[axis] = min(left.upper[axis], right.upper[axis]);
+            overlapping = overlapping && (overlap.lower[axis] <= overlap.upper[axis]);
+        }
+
+        if (overlapping && surfaceArea(overlap) > BVH_SPATIAL_SPLIT_OVERLAP * build.rootArea) {
+            spatialCost = findBestSpatialSplit(references, nodeBounds, build, spatialAxis, spatialPosition, duplicates);
+
+            if (duplicates > budget) {
+                spatialCost = DBL_MAX;
+            }
+        }
+    }
+
+    double leafCost = BVH_INTERSECTION_COST * count;
+    double splitCost = min(objectCost, spatialCost);
+
+    /* Leaves, and nodes whose objects' centers all coincide, are handled the usual way. */
+    if (splitCost == DBL_MAX || (count <= BVH_MAX_LEAF_SIZE && leafCost <= splitCost)) {
+        return buildNode(nodes, primitiveIndices, references, 0, count, depth);
+    }
+
+    vector <BuildPrimitive> leftReferences, rightReferences;
+
+    if (spatialCost < objectCost) {
+        for (unsigned int i = 0; i < count; i++) {
+            const BuildPrimitive &reference = references[i];
+
+            if (reference.bounds.upper[spatialAxis] <= spatialPosition) {
+                leftReferences.push_back(reference);
+            }
+            else if (reference.bounds.lower[spatialAxis] >= spatialPosition) {
+                rightReferences.push_back(reference);
+            }
+            else {
+                BoundingBox leftBox = reference.bounds;
+                BoundingBox rightBox = reference.bounds;
+                leftBox.upper[spatialAxis] = spatialPosition;
+                rightBox.lower[spatialAxis] = spatialPosition;
+
+                addClippedReference(reference, leftBox, build, leftReferences);
+                addClippedReference(reference, rightBox, build, rightReferences);
+            }
+        }
+
+        unsigned int added = leftReferences.size() + rightReferences.size() - count;
+        budget -= min(added, budget);
+    }
+    else {
+        for (unsigned int i = 0; i < count; i++) {
+            bool left = getBin(references[i].center, centerBounds, objectAxis) <= objectBin;
+            (left ? leftReferences : rightReferences).push_back(references[i]);
+        }
+    }
+
+    /* The parent's list isn't needed any more, so free it before going deeper. */
+    vector <BuildPrimitive>().swap(references);
+
+    if (leftReferences.empty() || rightReferences.empty()) {
+        vector <BuildPrimitive> &all = leftReferences.empty() ? rightReferences : leftReferences;
+        return buildNode(nodes, primitiveIndices, all, 0, all.size(), depth);
+    }
+
+    unsigned int nodeIndex = nodes.size();
+    nodes.push_back(BVHNode());
+    nodes[nodeIndex].bounds = nodeBounds;
+
+    unsigned int leftBudget = (unsigned int)((double)budget * leftReferences.size() / (leftReferences.size() + rightReferences.size()));
+    unsigned int rightBudget = budget - leftBudget;
+
+    /* The left child directly follows this node. */
+    buildSpatialNode(nodes, primitiveIndices, leftReferences, depth+1, leftBudget, build);
+    unsigned int rightChild = buildSpatialNode(nodes, primitiveIndices, rightReferences, depth+1, rightBudget, build);
+
+    nodes[nodeIndex].offset = rightChild;
+    nodes[nodeIndex].primitiveCount = 0;
+
+    return nodeIndex;
+}
+
+
+
+/*
+----------------------
+    BVH methods.
+----------------------
+*/
+
+
+/* Default constructor. The BVH is empty until build() is called. */
+BVH::BVH (void) {
+    spatialSplitBudget = 0.0;
+    areaCost = 0.0;
+    builtCost = 0.0;
+}
+
+
+/* Constructor for a BVH that also splits space, cutting through objects, where that is cheaper than splitting the
+   objects into groups (an SBVH). Objects cut by a split are placed into both children, so the BVH may hold up to
+   SPATIAL_SPLIT_BUDGET times as many extra copies of objects as there are objects. The BVH is empty until build()
+   is called. */
+BVH::BVH (double spatialSplitBudget) {
+    this->spatialSplitBudget = spatialSplitBudget;
+    areaCost = 0.0;
+    builtCost = 0.0;
+}
+
+
+/* Clears the BVH and points it at OBJECTS. Fills unboundedIndices with the objects without bounds and
+   RETURN_PRIMITIVES with the rest. */
+void BVH::gatherPrimitives(const vector <SceneObject *> &objects, vector <BuildPrimitive> &primitives) {
+
+    setObjects(objects);
+
+    nodes.clear();
+    primitiveIndices.clear();
+    unboundedIndices.clear();
+    primitives.clear();
+
+    parents.clear();
+    objectLeaves.clear();
+    builtAreas.clear();
+
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        BuildPrimitive primitive;
+
+        if (!objects[i]->getBounds(primitive.bounds)) {
+            unboundedIndices.push_back(scene.getRef(i));
+            continue;
+        }
+
+        pad(primitive.bounds);
+
+        for (int axis = 0; axis < 3; axis++) {
+            primitive.center[axis] = centroid(primitive.bounds, axis);
+        }
+        primitive.index = i;
+
+        primitives.push_back(primitive);
+    }
+}
+
+
+/* Builds the BVH over OBJECTS, replacing anything built before. */
+void BVH::build(const vector <SceneObject *> &objects) {
+
+    /* Gather the objects with bounds, and set aside those without. */
+    vector <BuildPrimitive> primitives;
+    gatherPrimitives(objects, primitives);
+
+    if (primitives.empty()) {
+        packLeaves();
+        return;
+    }
+
+    nodes.reserve(2*primitives.size());
+    primitiveIndices.reserve(primitives.size());
+
+    if (spatialSplitBudget <= 0.0) {
+        buildNode(nodes, primitiveIndices, primitives, 0, primitives.size(), 0);
+        compileIndices(primitiveIndices);
+        packLeaves();
+        return;
+    }
+
+    SpatialSplitBuild build;
+    build.objects = &objects;
+
+    BoundingBox bounds = getEmptyBoundingBox();
+    for (unsigned int i = 0; i < primitives.size(); i++) {
+        expand(bounds, primitives[i].bounds);
+    }
+    build.rootArea = surfaceArea(bounds);
+
+    buildSpatialNode(nodes, primitiveIndices, primitives, 0, (unsigned int)(spatialSplitBudget * primitives.size()), build);
+    compileIndices(primitiveIndices);
+    packLeaves();
+}
+
+
+/* Packs the triangles of the leaves reachable from the root for the SIMD kernel. Nodes left unused by a partial
+   rebuild are skipped. */
+void BVH::packLeaves(void) {
+    vector <unsigned int> leafOffsets;
+    vector <unsigned int> stack;
+
+    if (!nodes.empty()) {
+        stack.push_back(0);
+    }
+
+    while (!stack.empty()) {
+        unsigned int nodeIndex = stack.back();
+        const BVHNode &node = nodes[nodeIndex];
+        stack.pop_back();
+
+        if (node.primitiveCount > 0) {
+            leafOffsets.push_back(node.offset);
+            continue;
+        }
+
+        stack.push_back(nodeIndex + 1);
+        stack.push_back(node.offset);
+    }
+
+    packTriangles(primitiveIndices, leafOffsets);
+}
+
+
+/* Searches the objects without bounds, then the tree, for the closest intersection with the ray, narrowing CLOSEST
+   as closer intersections are found. Objects farther away than CLOSEST may be skipped. */
+void BVH::findClosest(const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+
+    for (unsigned int i = 0; i < unboundedIndices.size(); i++) {
+        testPrimitive(unboundedIndices[i], rayStartPoint, rayDirection, closest);
+    }
+
+    traverse(rayStartPoint, rayDirection, closest);
+}
+
+
+/* findClosest() for each of COUNT rays: searches the objects without bounds for each ray, then traces the rays through
+   the tree together. */
+void BVH::findClosestInPacket(const Point3 *rayStartPoints, const Direction3 *rayDirections, unsigned int count, Intersection *closest) const {
+
+    for (unsigned int i = 0; i < count; i++) {
+        for (unsigned int j = 0; j < unboundedIndices.size(); j++) {
+            testPrimitive(unboundedIndices[j], rayStartPoints[i], rayDirections[i], closest[i]);
+        }
+    }
+
+    traversePacket(rayStartPoints, rayDirections, count, closest);
+}
+
+
+/* Searches the tree for the closest intersection with the ray, narrowing CLOSEST as closer
+   intersections are found. Boxes farther away than CLOSEST are skipped. */
+void BVH::traverse(const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+
+    if (nodes.empty()) {
+        return;
+    }
+
+    traverseSubtree(0, rayStartPoint, rayDirection, closest);
+}
+
+
+/* traverse(), searching only the subtree rooted at ROOT_INDEX. */
+void BVH::traverseSubtree(unsigned int rootIndex, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+
+    double origin [3];
+    double inverseDirection [3];
+
+    for (int i = 0; i < 3; i++) {
+        origin[i] = rayStartPoint.getEntry(i);
+        inverseDirection[i] = 1.0 / rayDirection.getEntry(i);
+    }
+
+
+    /* Nodes still to visit, along with the ray parameter where the ray enters each of them. */
+    unsigned int stackNodes [BVH_STACK_SIZE];
+    double stackT [BVH_STACK_SIZE];
+    int stackSize = 0;
+
+    double tNear;
+    if (!intersectRay(nodes[rootIndex].bounds, origin, inverseDirection, getMaxT(closest), tNear)) {
+        return;
+    }
+
+    stackNodes[0] = rootIndex;
+    stackT[0] = tNear;
+    stackSize = 1;
+
+    while (stackSize > 0) {
+        stackSize--;
+        unsigned int nodeIndex = stackNodes[stackSize];
+        double maxT = getMaxT(closest);
+
+        /* An intersection closer than this node may have been found since it was pushed. */
+        if (stackT[stackSize] > maxT) {
+            continue;
+        }
+
+        const BVHNode &node = nodes[nodeIndex];
+
+        if (node.primitiveCount > 0) {
+            testLeaf(primitiveIndices.data(), node.offset, node.primitiveCount, rayStartPoint, rayDirection, closest);
+            continue;
+        }
+
+        unsigned int leftChild = nodeIndex + 1;
+        unsigned int rightChild = node.offset;
+        double tLeft, tRight;
+
+        bool hitLeft = intersectRay(nodes[leftChild].bounds, origin, inverseDirection, maxT, tLeft);
+        bool hitRight = intersectRay(nodes[rightChild].bounds, origin, inverseDirection, maxT, tRight);
+
+        /* Push the farther child first so that the nearer one is visited first. */
+        if (hitLeft && hitRight) {
+            if (tLeft <= tRight) {
+                stackNodes[stackSize] = rightChild; stackT[stackSize] = tRight; stackSize++;
+                stackNodes[stackSize] = leftChild;  stackT[stackSize] = tLeft;  stackSize++;
+            }
+            else {
+                stackNodes[stackSize] = leftChild;  stackT[stackSize] = tLeft;  stackSize++;
+                stackNodes[stackSize] = rightChild; stackT[stackSize] = tRight; stackSize++;
+            }
+        }
+        else if (hitLeft) {
+            stackNodes[stackSize] = leftChild; stackT[stackSize] = tLeft; stackSize++;
+        }
+        else if (hitRight) {
+            stackNodes[stackSize] = rightChild; stackT[stackSize] = tRight; stackSize++;
+        }
+    }
+}
+
+
+/* Searches the tree for the closest intersection with each of COUNT rays, narrowing CLOSEST[i] for ray i.
+
+   The rays go down the tree together, carrying a mask of the rays still in the subtree. Before a node's box is
+   tested against those rays with the SIMD kernel, it is tested against bounds on all of the rays' start points and
+   directions at once with mayIntersectRays(), which for coherent rays skips most of the boxes they all miss for the
+   price of a single ray's test. Children are visited nearest first as seen by the first ray in the mask. A ray only
+   ever tests objects in leaves whose boxes it enters itself, with the same tests as traverse(), and visiting more
+   boxes than it would on its own can't change which intersection is the closest, so every ray ends up with exactly
+   what traverse() finds for it. */
+void BVH::traversePacket(const Point3 *rayStartPoints, const Direction3 *rayDirections, unsigned int count, Intersection *closest) const {
+
+    if (nodes.empty() || count == 0) {
+        return;
+    }
+
+    /* The rays' start points and the reciprocals of their directions, one array per axis for the kernel. */
+    double origins [3][MAX_PACKET_SIZE];
+    double inverseDirections [3][MAX_PACKET_SIZE];
+
+    /* The largest ray parameter of interest to each ray, and to any of them. */
+    double maxT [MAX_PACKET_SIZE];
+    double packetMaxT = 0.0;
+
+    /* Bounds on ORIGINS and INVERSE_DIRECTIONS along each axis. */
+    double originLower [3], originUpper [3];
+    double inverseLower [3], inverseUpper [3];
+
+    for (int axis = 0; axis < 3; axis++) {
+        originLower[axis] = originUpper[axis] = rayStartPoints[0].getEntry(axis);
+        inverseLower[axis] = inverseUpper[axis] = 1.0 / rayDirections[0].getEntry(axis);
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            origins[axis][i] = rayStartPoints[i].getEntry(axis);
+            inverseDirections[axis][i] = 1.0 / rayDirections[i].getEntry(axis);
+
+            originLower[axis] = min(originLower[axis], origins[axis][i]);
+            originUpper[axis] = max(originUpper[axis], origins[axis][i]);
+            inverseLower[axis] = min(inverseLower[axis], inverseDirections[axis][i]);
+            inverseUpper[axis] = max(inverseUpper[axis], inverseDirections[axis][i]);
+        }
+
+        maxT[i] = getMaxT(closest[i]);
+        packetMaxT = max(packetMaxT, maxT[i]);
+    }
+
+
+    /* Nodes still to visit, along with the rays to visit each of them with. */
+    unsigned int stackNodes [BVH_STACK_SIZE];
+    unsigned long long stackRays [BVH_STACK_SIZE];
+    int stackSize = 0;
+
+    stackNodes[0] = 0;
+    stackRays[0] = (count == 64) ? ~0ull : (1ull << count) - 1;
+    stackSize = 1;
+
+    while (stackSize > 0) {
+        stackSize--;
+        unsigned int nodeIndex = stackNodes[stackSize];
+        const BVHNode &node = nodes[nodeIndex];
+
+        if (!mayIntersectRays(node.bounds, originLower, originUpper, inverseLower, inverseUpper, packetMaxT)) {
+            continue;
+        }
+
+        /* Rays that enter the node, no farther than an intersection they have already found. */
+        unsigned long long rays = intersectRaysWithBox(node.bounds.lower, node.bounds.upper, origins[0], origins[1], origins[2],
+                                                       inverseDirections[0], inverseDirections[1], inverseDirections[2],
+                                                       maxT, count, stackRays[stackSize], 0);
+        if (rays == 0) {
+            continue;
+        }
+
+        /* Once the rays have spread out, they are cheaper to trace one at a time. */
+        if (node.primitiveCount > 0 || __builtin_popcountll(rays) < BVH_MIN_PACKET_RAYS) {
+            for (unsigned int i = 0; i < count; i++) {
+                if (!((rays >> i) & 1)) {
+                    continue;
+                }
+
+                if (node.primitiveCount > 0) {
+                    testLeaf(primitiveIndices.data(), node.offset, node.primitiveCount, rayStartPoints[i], rayDirections[i], closest[i]);
+                }
+                else {
+                    traverseSubtree(nodeIndex, rayStartPoints[i], rayDirections[i], closest[i]);
+                }
+
+                maxT[i] = getMaxT(closest[i]);
+            }
+
+            packetMaxT = 0.0;
+            for (unsigned int i = 0; i < count; i++) {
+                packetMaxT = max(packetMaxT, maxT[i]);
+            }
+            continue;
+        }
+
+        unsigned int leftChild = nodeIndex + 1;
+        unsigned int rightChild = node.offset;
+
+        /* Push the child the first ray enters later first, so that the other one is visited first. */
+        unsigned int first = __builtin_ctzll(rays);
+        double origin [3] = {origins[0][first], origins[1][first], origins[2][first]};
+        double inverseDirection [3] = {inverseDirections[0][first], inverseDirections[1][first], inverseDirections[2][first]};
+        double tLeft, tRight;
+
+        if (!intersectRay(nodes[leftChild].bounds, origin, inverseDirection, maxT[first], tLeft)) {
+            tLeft = DBL_MAX;
+        }
+        if (!intersectRay(nodes[rightChild].bounds, origin, inverseDirection, maxT[first], tRight)) {
+            tRight = DBL_MAX;
+        }
+
+        if (tLeft <= tRight) {
+            stackNodes[stackSize] = rightChild; stackRays[stackSize] = rays; stackSize++;
+            stackNodes[stackSize] = leftChild;  stackRays[stackSize] = rays; stackSize++;
+        }
+        else {
+            stackNodes[stackSize] = leftChild;  stackRays[stackSize] = rays; stackSize++;
+            stackNodes[stackSize] = rightChild; stackRays[stackSize] = rays; stackSize++;
+        }
+    }
+}
+
+
+/* Places the indices of the objects whose boxes contain POINT into RETURN_INDICES, replacing its contents.
+   Objects without bounds are not included. Only the binary tree is searched, so a WideBVH, which frees it,
+   finds nothing. */
+void BVH::findObjectsContaining(const Point3 &point, vector <unsigned int> &returnIndices) const {
+    returnIndices.clear();
+
+    if (nodes.empty()) {
+        return;
+    }
+
+    unsigned int stack [BVH_STACK_SIZE];
+    int stackSize = 1;
+    stack[0] = 0;
+
+    while (stackSize > 0) {
+        const BVHNode &node = nodes[stack[--stackSize]];
+        bool inside = true;
+
+        for (int axis = 0; axis < 3; axis++) {
+            double value = point.getEntry(axis);
+            if (value < node.bounds.lower[axis] || value > node.bounds.upper[axis]) {
+                inside = false;
+            }
+        }
+
+        if (!inside) {
+            continue;
+        }
+
+        if (node.primitiveCount > 0) {
+            for (unsigned int i = 0; i < node.primitiveCount; i++) {
+                returnIndices.push_back(scene.getObjectIndex(primitiveIndices[node.offset + i]));
+            }
+        }
+        else {
+            stack[stackSize++] = &node - &nodes[0] + 1;
+            stack[stackSize++] = node.offset;
+        }
+    }
+}
+
+
+/*
+----------------------
+    BVH updates.
+----------------------
+*/
+
+
+/* Fills in the members used by update() if they haven't been since the last build. */
+void BVH::prepareUpdate(void) {
+    if (nodes.empty() || !parents.empty()) {
+        return;
+    }
+
+    parents.assign(nodes.size(), UINT_MAX);
+    objectLeaves.assign(objects->size(), UINT_MAX);
+    builtAreas.resize(nodes.size());
+    areaCost = 0.0;
+
+    /* Nodes are stored depth-first, so walking the tree from the root visits every live node. */
+    unsigned int stack [BVH_STACK_SIZE];
+    int stackSize = 1;
+    stack[0] = 0;
+
+    while (stackSize > 0) {
+        unsigned int nodeIndex = stack[--stackSize];
+        const BVHNode &node = nodes[nodeIndex];
+
+        builtAreas[nodeIndex] = surfaceArea(node.bounds);
+        areaCost += builtAreas[nodeIndex] * getNodeCost(node);
+
+        if (node.primitiveCount > 0) {
+            for (unsigned int i = 0; i < node.primitiveCount; i++) {
+                objectLeaves[scene.getObjectIndex(primitiveIndices[node.offset + i])] = nodeIndex;
+            }
+        }
+        else {
+            parents[nodeIndex + 1] = nodeIndex;
+            parents[node.offset] = nodeIndex;
+            stack[stackSize++] = nodeIndex + 1;
+            stack[stackSize++] = node.offset;
+        }
+    }
+
+    builtCost = areaCost;
+}
+
+
+/* Returns the cost of visiting NODE, weighted by its surface area in AREA_COST. */
+double BVH::getNodeCost(const BVHNode &node) const {
+    return (node.primitiveCount > 0) ? BVH_INTERSECTION_COST * node.primitiveCount : BVH_TRAVERSAL_COST;
+}
+
+
+/* Sets the box of NODE_INDEX to BOUNDS, keeping AREA_COST up to date. */
+void BVH::setNodeBounds(unsigned int nodeIndex, const BoundingBox &bounds) {
+    BVHNode &node = nodes[nodeIndex];
+
+    areaCost += (surfaceArea(bounds) - surfaceArea(node.bounds)) * getNodeCost(node);
+    node.bounds = bounds;
+}
+
+
+/* Returns true if boxes A and B are exactly the same. */
+static bool sameBounds(const BoundingBox &a, const BoundingBox &b) {
+    for (int axis = 0; axis < 3; axis++) {
+        if (a.lower[axis] != b.lower[axis] || a.upper[axis] != b.upper[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/* Recomputes the boxes of the leaf holding the object at OBJECT_INDEX and of its ancestors, stopping once a box
+   comes out unchanged. Appends every node whose box changed to RETURN_CHANGED_NODES. */
+void BVH::refitObject(unsigned int objectIndex, vector <unsigned int> &returnChangedNodes) {
+    unsigned int nodeIndex = objectLeaves[objectIndex];
+
+    while (nodeIndex != UINT_MAX) {
+        const BVHNode &node = nodes[nodeIndex];
+        BoundingBox bounds = getEmptyBoundingBox();
+
+        if (node.primitiveCount > 0) {
+            /* Padded the same way as when the tree is built. */
+            for (unsigned int i = 0; i < node.primitiveCount; i++) {
+                BoundingBox objectBounds;
+                (*objects)[scene.getObjectIndex(primitiveIndices[node.offset + i])]->getBounds(objectBounds);
+                expand(bounds, pad(objectBounds));
+            }
+        }
+        else {
+            expand(bounds, nodes[nodeIndex + 1].bounds);
+            expand(bounds, nodes[node.offset].bounds);
+        }
+
+        if (sameBounds(bounds, node.bounds)) {
+            return;
+        }
+
+        setNodeBounds(nodeIndex, bounds);
+        returnChangedNodes.push_back(nodeIndex);
+        nodeIndex = parents[nodeIndex];
+    }
+}
+
+
+/* Returns the number of nodes between NODE_INDEX and the root. */
+unsigned int BVH::getDepth(unsigned int nodeIndex) const {
+    unsigned int depth = 0;
+
+    while (parents[nodeIndex] != UINT_MAX) {
+        nodeIndex = parents[nodeIndex];
+        depth++;
+    }
+
+    return depth;
+}
+
+
+/* Builds the subtree rooted at NODE_INDEX again from the objects it holds, in the nodes it occupies now. The indices
+   of those nodes are placed into RETURN_OLD_NODES. If the new subtree doesn't fit in them, it is placed at the end of
+   the node list instead, leaving the old nodes unused until the next full build. That is only possible for a right
+   child, so for a left child false is returned, leaving the tree alone. */
+bool BVH::rebuildSubtree(unsigned int nodeIndex, vector <unsigned int> &returnOldNodes) {
+
+    /* Find the subtree's nodes and the range of primitiveIndices its leaves cover, which is contiguous. Its nodes are
+       contiguous too unless part of it has been moved to the end of the list before. */
+    unsigned int firstPrimitive = UINT_MAX;
+    unsigned int lastPrimitive = 0;
+    unsigned int lastNode = nodeIndex;
+
+    returnOldNodes.clear();
+    returnOldNodes.push_back(nodeIndex);
+
+    for (unsigned int i = 0; i < returnOldNodes.size(); i++) {
+        const BVHNode &node = nodes[returnOldNodes[i]];
+        lastNode = max(lastNode, returnOldNodes[i]);
+
+        if (node.primitiveCount > 0) {
+            firstPrimitive = min(firstPrimitive, node.offset);
+            lastPrimitive = max(lastPrimitive, node.offset + node.primitiveCount);
+        }
+        else {
+            returnOldNodes.push_back(returnOldNodes[i] + 1);
+            returnOldNodes.push_back(node.offset);
+        }
+    }
+
+    vector <BuildPrimitive> primitives (lastPrimitive - firstPrimitive);
+
+    for (unsigned int i = firstPrimitive; i < lastPrimitive; i++) {
+        BuildPrimitive &primitive = primitives[i - firstPrimitive];
+
+        primitive.index = scene.getObjectIndex(primitiveIndices[i]);
+
+        (*objects)[primitive.index]->getBounds(primitive.bounds);
+        pad(primitive.bounds);
+
+        for (int axis = 0; axis < 3; axis++) {
+            primitive.center[axis] = centroid(primitive.bounds, axis);
+        }
+    }
+
+    vector <BVHNode> subtreeNodes;
+    vector <unsigned int> subtreeIndices;
+    buildNode(subtreeNodes, subtreeIndices, primitives, 0, primitives.size(), getDepth(nodeIndex));
+
+    /* Only a right child can be moved, since a left child must directly follow its parent. */
+    bool contiguous = (lastNode + 1 - nodeIndex == returnOldNodes.size());
+    bool relocate = !contiguous || subtreeNodes.size() > returnOldNodes.size();
+    unsigned int parent = parents[nodeIndex];
+
+    if (relocate && (parent == UINT_MAX || nodes[parent].offset != nodeIndex)) {
+        return false;
+    }
+
+    /* Take the old subtree's nodes out of the cost. */
+    for (unsigned int i = 0; i < returnOldNodes.size(); i++) {
+        const BVHNode &node = nodes[returnOldNodes[i]];
+        areaCost -= surfaceArea(node.bounds) * getNodeCost(node);
+    }
+
+    unsigned int base = nodeIndex;
+
+    if (relocate) {
+        base = nodes.size();
+        nodes.resize(base + subtreeNodes.size());
+        parents.resize(base + subtreeNodes.size());
+        builtAreas.resize(base + subtreeNodes.size());
+
+        nodes[parent].offset = base;
+        parents[base] = parent;
+    }
+
+    /* Copy the new subtree in, moving its indices to where it now sits. Any old nodes it doesn't need are left
+       unreferenced. */
+    for (unsigned int i = 0; i < subtreeNodes.size(); i++) {
+        BVHNode node = subtreeNodes[i];
+        unsigned int index = base + i;
+
+        if (node.primitiveCount > 0) {
+            node.offset += firstPrimitive;
+            for (unsigned int j = 0; j < node.primitiveCount; j++) {
+                unsigned int objectIndex = subtreeIndices[node.offset - firstPrimitive + j];
+                primitiveIndices[node.offset + j] = scene.getRef(objectIndex);
+                objectLeaves[objectIndex] = index;
+            }
+        }
+        else {
+            node.offset += base;
+            parents[index + 1] = index;
+            parents[node.offset] = index;
+        }
+
+        nodes[index] = node;
+        builtAreas[index] = surfaceArea(node.bounds);
+        areaCost += builtAreas[index] * getNodeCost(node);
+    }
+
+    return true;
+}
+
+
+/* Brings the BVH up to date after the objects at MOVED_INDICES have moved or changed shape. The boxes around
+   them are refit bottom-up. If that raises the tree's estimated cost by too much, the largest subtree whose
+   box grew a lot is built again, and if that isn't enough, or the subtree is the whole tree, the whole BVH is
+   built again. A BVH with spatial splits is always built again. Returns what was done. */
+AcceleratorUpdate BVH::update(const vector <unsigned int> &movedIndices) {
+
+    /* Objects cut by spatial splits are in many leaves, clipped differently in each, so they can't be refit. */
+    if (spatialSplitBudget > 0.0) {
+        return Accelerator::update(movedIndices);
+    }
+
+    scene.update(*objects, movedIndices);
+    prepareUpdate();
+
+    vector <unsigned int> changedNodes;
+
+    for (unsigned int i = 0; i < movedIndices.size(); i++) {
+        if (objectLeaves.empty() || objectLeaves[movedIndices[i]] == UINT_MAX) {
+            continue;
+        }
+        refitObject(movedIndices[i], changedNodes);
+    }
+
+    if (getCostRatio() <= BVH_MAX_COST_RATIO) {
+        /* The leaves are the same, but the packets hold copies of the triangles, which may have moved. */
+        for (unsigned int i = 0; i < movedIndices.size(); i++) {
+            if (getPrimitiveType(scene.getRef(movedIndices[i])) == PRIMITIVE_TRIANGLE) {
+                packLeaves();
+                break;
+            }
+        }
+        return ACCELERATOR_REFIT;
+    }
+
+    /* Rebuild every subtree whose box has grown by too much and that doesn't lie inside another such subtree. */
+    vector <bool> grown (nodes.size(), false);
+
+    for (unsigned int i = 0; i < changedNodes.size(); i++) {
+        unsigned int nodeIndex = changedNodes[i];
+        grown[nodeIndex] = (surfaceArea(nodes[nodeIndex].bounds) > BVH_MAX_AREA_GROWTH * builtAreas[nodeIndex]);
+    }
+
+    bool rebuilt = !grown[0];
+
+    for (unsigned int i = 0; i < changedNodes.size() && rebuilt; i++) {
+        unsigned int nodeIndex = changedNodes[i];
+
+        if (!grown[nodeIndex]) {
+            continue;
+        }
+
+        bool topmost = true;
+        for (unsigned int ancestor = parents[nodeIndex]; ancestor != UINT_MAX; ancestor = parents[ancestor]) {
+            if (grown[ancestor]) {
+                topmost = false;
+                break;
+            }
+        }
+
+        if (!topmost) {
+            continue;
+        }
+
+        /* A left child that no longer fits in its nodes can't be moved, so rebuild its parent's subtree instead. */
+        vector <unsigned int> oldNodes;
+        while (!(rebuilt = rebuildSubtree(nodeIndex, oldNodes)) && nodeIndex != 0) {
+            nodeIndex = parents[nodeIndex];
+        }
+
+        /* The nodes that were rebuilt are new, so they can't have grown. */
+        for (unsigned int j = 0; j < oldNodes.size() && rebuilt; j++) {
+            if (oldNodes[j] < grown.size()) {
+                grown[oldNodes[j]] = false;
+            }
+        }
+
+        /* The subtree's box is now exact, which may shrink its ancestors. */
+        for (unsigned int ancestor = parents[nodeIndex]; ancestor != UINT_MAX && rebuilt; ancestor = parents[ancestor]) {
+            BoundingBox bounds = getEmptyBoundingBox();
+            expand(bounds, nodes[ancestor + 1].bounds);
+            expand(bounds, nodes[nodes[ancestor].offset].bounds);
+            setNodeBounds(ancestor, bounds);
+        }
+    }
+
+    if (rebuilt && getCostRatio() <= BVH_MAX_COST_RATIO) {
+        packLeaves();
+        return ACCELERATOR_PARTIAL_REBUILD;
+    }
+
+    build(*objects);
+    return ACCELERATOR_REBUILD;
+}
+
+
+/* Returns the estimated cost of tracing a ray through the BVH, relative to its cost right after it was
+   last built. */
+double BVH::getCostRatio(void) const {
+    if (parents.empty() || builtCost == 0.0) {
+        return 1.0;
+    }
+    return areaCost / builtCost;
+}
+
+
+/* Returns the number of nodes in the tree. */
+unsigned int BVH::getNodeCount(void) const {
+    return nodes.size();
+}
+
+
+/* Returns the number of bytes the BVH takes up, including what update() keeps. */
+size_t BVH::getMemoryUsage(void) const {
+    return sizeof(BVH) + scene.getMemoryUsage() + getPacketMemoryUsage() + nodes.capacity()*sizeof(BVHNode) + builtAreas.capacity()*sizeof(double) +
+           (primitiveIndices.capacity() + unboundedIndices.capacity() + parents.capacity() + objectLeaves.capacity())*sizeof(unsigned int);
+}
@@ -0,0 +1,166 @@
+/* Contains declarations for a bounding volume hierarchy (BVH), an Accelerator that groups nearby objects
+   into a tree of nested boxes so that a ray only has to be tested against the objects in boxes it enters. */
+
+#ifndef BVH_HEADER
+#define BVH_HEADER
+
+	#include <vector> /* STL vector. */
+	#include "accelerator.h"
+	#include "boundingbox.h"
+	#include "sceneobject.h"
+	#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+	using namespace std;
+
+
+	/* A node of a BVH. The nodes are stored depth-first, so the left child of an interior node always
+	   directly follows it. */
+	struct BVHNode {
+		/* Box enclosing every object below this node. */
+		BoundingBox bounds;
+
+		/* For an interior node, the index of its right child. For a leaf, the index of its first object in primitiveIndices. */
+		unsigned int offset;
+
+		/* Number of objects in a leaf. Zero for an interior node. */
+		unsigned int primitiveCount;
+	};
+
+
+	/* An object waiting to be placed into a BVH. */
+	struct BuildPrimitive {
+		/* Box enclosing the object, padded slightly. */
+		BoundingBox bounds;
+
+		/* Center of BOUNDS. Objects are sorted into the tree by their center. */
+		double center [3];
+
+		/* Index of the object in the list the BVH is built over. */
+		unsigned int index;
+	};
+
+
+	/* A BVH built top-down using the surface area heuristic (SAH). Objects without bounds, such as
+	   planes and lights, are kept in a separate list and tested against every ray. */
+	class BVH : public Accelerator {
+
+		protected:
+			/* Nodes of the tree. The root is nodes[0]. Empty if no objects have bounds. */
+			vector <BVHNode> nodes;
+
+			/* Number of extra copies of objects spatial splits may make, as a fraction of the number of objects.
+			   Zero if only object splits are used. */
+			double spatialSplitBudget;
+
+			/* PrimitiveRefs of the objects in each leaf, stored contiguously leaf after leaf. They are object indices
+			   until the build is done. */
+			vector <PrimitiveRef> primitiveIndices;
+
+			/* PrimitiveRefs of the objects without bounds. */
+			vector <PrimitiveRef> unboundedIndices;
+
+			/* Used by update(), and only filled in by its first call after a build. The parent of each node, or
+			   UINT_MAX for the root. */
+			vector <unsigned int> parents;
+
+			/* The leaf holding each object in the list the BVH was built over, or UINT_MAX for objects without bounds. */
+			vector <unsigned int> objectLeaves;
+
+			/* The surface area of each node when it was last built. */
+			vector <double> builtAreas;
+
+			/* Sum over the nodes of their surface area times the cost of visiting them, which is proportional to the
+			   expected cost of tracing a ray through the tree. */
+			double areaCost;
+
+			/* AREA_COST right after the last full build. */
+			double builtCost;
+
+
+			/* Clears the BVH and points it at OBJECTS. Fills unboundedIndices with the objects without bounds and
+			   RETURN_PRIMITIVES with the rest. */
+			void gatherPrimitives(const vector <SceneObject *> &objects, vector <BuildPrimitive> &returnPrimitives);
+
+			/* Searches the tree for the closest intersection with the ray, narrowing CLOSEST as closer
+			   intersections are found. Boxes farther away than CLOSEST are skipped. */
+			virtual void traverse(const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* traverse(), searching only the subtree rooted at ROOT_INDEX. */
+			void traverseSubtree(unsigned int rootIndex, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* Searches the tree for the closest intersection with each of COUNT rays, narrowing CLOSEST[i] for ray i, as
+			   traverse() does for each of them. The rays go down the tree together, so each node is fetched once for all
+			   of them and skipped at once if none of them can hit it; once few enough of them are left in a subtree, they
+			   go down it one at a time. */
+			virtual void traversePacket(const Point3 *rayStartPoints, const Direction3 *rayDirections, unsigned int count, Intersection *closest) const;
+
+			/* Searches the objects without bounds, then the tree, for the closest intersection with the ray, narrowing CLOSEST
+			   as closer intersections are found. Objects farther away than CLOSEST may be skipped. */
+			void findClosest(const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* findClosest() for each of COUNT rays, tracing them through the tree together with traversePacket(). */
+			void findClosestInPacket(const Point3 *rayStartPoints, const Direction3 *rayDirections, unsigned int count, Intersection *closest) const;
+
+			/* Packs the triangles of the leaves reachable from the root for the SIMD kernel, with packTriangles(). Called
+			   whenever the leaves or the triangles in them change. */
+			void packLeaves(void);
+
+			/* Fills in the members used by update() if they haven't been since the last build. */
+			void prepareUpdate(void);
+
+			/* Returns the cost of visiting NODE, weighted by its surface area in AREA_COST. */
+			double getNodeCost(const BVHNode &node) const;
+
+			/* Sets the box of NODE_INDEX to BOUNDS, keeping AREA_COST up to date. */
+			void setNodeBounds(unsigned int nodeIndex, const BoundingBox &bounds);
+
+			/* Recomputes the boxes of the leaf holding the object at OBJECT_INDEX and of its ancestors, stopping once a box
+			   comes out unchanged. Appends every node whose box changed to RETURN_CHANGED_NODES. */
+			void refitObject(unsigned int objectIndex, vector <unsigned int> &returnChangedNodes);
+
+			/* Builds the subtree rooted at NODE_INDEX again from the objects it holds, in the nodes it occupies now. The indices
+			   of those nodes are placed into RETURN_OLD_NODES. If the new subtree doesn't fit in them, it is placed at the end of
+			   the node list instead, leaving the old nodes unused until the next full build. That is only possible for a right
+			   child, so for a left child false is returned, leaving the tree alone. */
+			bool rebuildSubtree(unsigned int nodeIndex, vector <unsigned int> &returnOldNodes);
+
+			/* Returns the number of nodes between NODE_INDEX and the root. */
+			unsigned int getDepth(unsigned int nodeIndex) const;
+
+		public:
+			/* Default constructor. The BVH is empty until build() is called. */
+			BVH (void);
+
+			/* Constructor for a BVH that also splits space, cutting through objects, where that is cheaper than splitting the
+			   objects into groups (an SBVH). Objects cut by a split are placed into both children, so the BVH may hold up to
+			   SPATIAL_SPLIT_BUDGET times as many extra copies of objects as there are objects. The BVH is empty until build()
+			   is called. */
+			BVH (double spatialSplitBudget);
+
+			/* Builds the BVH over OBJECTS, replacing anything built before. */
+			void build(const vector <SceneObject *> &objects);
+
+			/* Brings the BVH up to date after the objects at MOVED_INDICES have moved or changed shape. The boxes around
+			   them are refit bottom-up. If that raises the tree's estimated cost by too much, the largest subtree whose
+			   box grew a lot is built again, and if that isn't enough, or the subtree is the whole tree, the whole BVH is
+			   built again. A BVH with spatial splits is always built again. Returns what was done. */
+			AcceleratorUpdate update(const vector <unsigned int> &movedIndices);
+
+			/* Returns the estimated cost of tracing a ray through the BVH, relative to its cost right after it was
+			   last built. */
+			double getCostRatio(void) const;
+
+			/* Places the indices of the objects whose boxes contain POINT into RETURN_INDICES, replacing its contents.
+			   Objects without bounds are not included. Only the binary tree is searched, so a WideBVH, which frees it,
+			   finds nothing. */
+			void findObjectsContaining(const Point3 &point, vector <unsigned int> &returnIndices) const;
+
+			/* Returns the number of nodes in the tree. */
+			unsigned int getNodeCount(void) const;
+
+			/* Returns the number of bytes the BVH takes up, including what update() keeps. */
+			size_t getMemoryUsage(void) const;
+	};
+
+
+#endif
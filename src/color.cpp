@@ -10,7 +10,7 @@ using namespace std;
 
 /* Clamps each of the color's components so that they are in the inclusive range of [LOWER_BOUND, UPPER_BOUND]. 
    Modifies color and returns a reference to it. */
-Color& clamp(Color &color, double lowerBound, double upperBound) {
+Color& clamp(Color &color, Scalar lowerBound, Scalar upperBound) {
 	color.r = min(color.r, upperBound);
 	color.g = min(color.g, upperBound);
 	color.b = min(color.b, upperBound);
@@ -72,7 +72,7 @@ Color& operator-= (Color &color1, const Color &color2) {
 
 
 /* Multiplies all of COLOR's components against VALUE and returns a new color. */
-Color operator* (const Color &color, double value) {
+Color operator* (const Color &color, Scalar value) {
 	Color newColor;
 
 	newColor.r = color.r * value;
@@ -85,7 +85,7 @@ Color operator* (const Color &color, double value) {
 
 
 /* Multiplies all of COLOR's components against VALUE and returns a new color. */
-Color operator* (double value, const Color &color) {
+Color operator* (Scalar value, const Color &color) {
 	Color newColor;
 
 	newColor.r = color.r * value;
@@ -98,7 +98,7 @@ Color operator* (double value, const Color &color) {
 
 
 /* Multiplies all of COLOR's components against VALUE. Modifies COLOR and returns a reference to it. */
-Color& operator*= (Color &color, double value) {
+Color& operator*= (Color &color, Scalar value) {
 	color.r *= value;
 	color.g *= value;
 	color.b *= value;
@@ -109,7 +109,7 @@ Color& operator*= (Color &color, double value) {
 
 
 /* Divides all of COLOR's components against VALUE and returns a new color. */
-Color operator/ (const Color &color, double value) {
+Color operator/ (const Color &color, Scalar value) {
 	Color newColor;
 
 	newColor.r = color.r / value;
@@ -122,7 +122,7 @@ Color operator/ (const Color &color, double value) {
 
 
 /* Divides all of COLOR's components against VALUE and returns a new color. */
-Color operator/ (double value, const Color &color) {
+Color operator/ (Scalar value, const Color &color) {
 	Color newColor;
 
 	newColor.r = color.r / value;
@@ -135,7 +135,7 @@ Color operator/ (double value, const Color &color) {
 
 
 /* Divides all of COLOR's components against VALUE. Modifies COLOR and returns a reference to it. */
-Color& operator/= (Color &color, double value) {
+Color& operator/= (Color &color, Scalar value) {
 	color.r /= value;
 	color.g /= value;
 	color.b /= value;
@@ -5,22 +5,24 @@
 
 	#include <iostream>
 
+	#include "scalar.h"
+
 	using namespace std;
 
 
 	/* Defines a color with red, green, blue, and alpha component values. */
 	struct Color {
 	  /* Amount of red, green, blue, and alpha components. These should be between 0.0 and 1.0. */
-	  double r;
-	  double g;
-	  double b; 
-	  double a;
+	  Scalar r;
+	  Scalar g;
+	  Scalar b; 
+	  Scalar a;
 	};
 	
 
 	/* Clamps each of the color's components so that they are in the inclusive range of [LOWER_BOUND, UPPER_BOUND]. 
 	   Modifies color and returns a reference to it. */
-	Color& clamp(Color &color, double lowerBound, double upperBound);
+	Color& clamp(Color &color, Scalar lowerBound, Scalar upperBound);
 
 
 	/* Adds 2 colors together component-wise and returns a new color. */
@@ -40,24 +42,24 @@
 
 
 	/* Multiplies all of COLOR's components against VALUE and returns a new color. */
-	Color operator* (const Color &color, double value);
+	Color operator* (const Color &color, Scalar value);
 
 	/* Multiplies all of COLOR's components against VALUE and returns a new color. */
-	Color operator* (double value, const Color &color);
+	Color operator* (Scalar value, const Color &color);
 
 	/* Multiplies all of COLOR's components against VALUE. Modifies COLOR and returns a reference to it. */
-	Color& operator*= (Color &color, double value);
+	Color& operator*= (Color &color, Scalar value);
 
 
 
 	/* Divides all of COLOR's components against VALUE and returns a new color. */
-	Color operator/ (const Color &color, double value);
+	Color operator/ (const Color &color, Scalar value);
 
 	/* Divides all of COLOR's components against VALUE and returns a new color. */
-	Color operator/ (double value, const Color &color);
+	Color operator/ (Scalar value, const Color &color);
 
 	/* Divides all of COLOR's components against VALUE. Modifies COLOR and returns a reference to it. */
-	Color& operator/= (Color &color, double value);
+	Color& operator/= (Color &color, Scalar value);
 
 
 	/* Returns true if both COLOR_1 and COLOR_2 are equivalent. */
@@ -0,0 +1,496 @@
+/* Contains definitions for a compiled scene, which copies the spheres, planes and triangles of a list of SceneObjects
+   into contiguous arrays, one set per kind. */
+
+#include <vector> /* STL vector. */
+#include <typeinfo>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+#include "compiledscene.h"
+#include "geometry.h"
+#include "raytrace.h"
+#include "sceneobject.h"
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+#include "kernels.h"
+
+using namespace std;
+
+
+/* Number of spheres a search over the whole scene passes to the kernel at once. */
+#define SCENE_SPHERE_CHUNK 64
+
+
+/* Returns the PrimitiveRef for the primitive at INDEX among those of type TYPE. */
+PrimitiveRef makePrimitiveRef(PrimitiveType type, unsigned int index) {
+    return ((unsigned int)type << PRIMITIVE_TYPE_SHIFT) | index;
+}
+
+
+/* Returns the type of the primitive REF refers to. */
+PrimitiveType getPrimitiveType(PrimitiveRef ref) {
+    return (PrimitiveType)(ref >> PRIMITIVE_TYPE_SHIFT);
+}
+
+
+/* Returns the index of the primitive REF refers to among those of its type. */
+unsigned int getPrimitiveIndex(PrimitiveRef ref) {
+    return ref & PRIMITIVE_INDEX_MASK;
+}
+
+
+
+/*
+----------------------
+    Intersection tests.
+----------------------
+*/
+
+
+/* The tests below are those of Sphere, Plane and Triangle, written out over the components of the pools. They perform
+   the same operations in the same order, leaving out the terms of the fourth component, which are zero for points
+   and directions, so they give exactly the same results. */
+
+
+/* Tests the ray from START along DIRECTION against sphere I of SPHERES, as Sphere::intersect() does. */
+static bool intersectSphere(const SpherePool &spheres, unsigned int i, const Scalar start[3], const Scalar direction[3], HitRecord &returnHit) {
+
+    /* Transform the start point into the sphere's object coordinates. */
+    Scalar s [3] = {start[0] - spheres.centerX[i], start[1] - spheres.centerY[i], start[2] - spheres.centerZ[i]};
+
+    /* Coefficients of the quadratic formula. */
+    Scalar a = direction[0]*direction[0] + direction[1]*direction[1] + direction[2]*direction[2];
+    Scalar b = 2 * (s[0]*direction[0] + s[1]*direction[1] + s[2]*direction[2]);
+    Scalar c = (s[0]*s[0] + s[1]*s[1] + s[2]*s[2]) - (spheres.radius[i] * spheres.radius[i]);
+
+    Scalar discriminant = b*b - 4*a*c;
+
+    if (discriminant < 0) {
+        return false;
+    }
+
+    Scalar t = (-b - sqrt(discriminant)) / (2*a);
+
+    if (t < 0) {
+        return false;
+    }
+
+    CompiledScene::getSphereHit(t, start, direction, returnHit);
+    return true;
+}
+
+
+/* Tests the ray from START along DIRECTION against plane I of PLANES, as Plane::intersect() does. */
+static bool intersectPlane(const PlanePool &planes, unsigned int i, const Scalar start[3], const Scalar direction[3], HitRecord &returnHit) {
+
+    Scalar angleBetweenNormalAndRay = planes.normalX[i]*direction[0] + planes.normalY[i]*direction[1] + planes.normalZ[i]*direction[2];
+
+    /* Rays parallel to the plane don't intersect it. */
+    if (angleBetweenNormalAndRay <= Scalar(0.0001) && angleBetweenNormalAndRay >= Scalar(-0.0001)) {
+        return false;
+    }
+
+    Scalar t = ((planes.positionX[i] - start[0])*planes.normalX[i] +
+                (planes.positionY[i] - start[1])*planes.normalY[i] +
+                (planes.positionZ[i] - start[2])*planes.normalZ[i]) / angleBetweenNormalAndRay;
+
+    if (t < 0) {
+        return false;
+    }
+
+    CompiledScene::getSphereHit(t, start, direction, returnHit);
+    return true;
+}
+
+
+/* Fills in RETURN_HIT for a ray meeting triangle I of TRIANGLES at ray parameter T and barycentric coordinates U and V,
+   as Triangle::intersect() does. */
+static void setTriangleHit(const TrianglePool &triangles, unsigned int i, Scalar t, Scalar u, Scalar v, HitRecord &returnHit) {
+
+    /* The point from its barycentric coordinates. */
+    Scalar w = 1-u-v;
+
+    returnHit.t = t;
+    returnHit.point = Point3(w*triangles.vertices[0][i] + u*triangles.vertices[3][i] + v*triangles.vertices[6][i],
+                             w*triangles.vertices[1][i] + u*triangles.vertices[4][i] + v*triangles.vertices[7][i],
+                             w*triangles.vertices[2][i] + u*triangles.vertices[5][i] + v*triangles.vertices[8][i]);
+    returnHit.primitive = 0;
+    returnHit.u = u;
+    returnHit.v = v;
+}
+
+
+/* Tests the ray from START along DIRECTION against triangle I of TRIANGLES, as Triangle::intersect() does. */
+static bool intersectTriangle(const TrianglePool &triangles, unsigned int i, const Scalar start[3], const Scalar direction[3], HitRecord &returnHit) {
+
+    Scalar v0 [3] = {triangles.vertices[0][i], triangles.vertices[1][i], triangles.vertices[2][i]};
+    Scalar e1 [3] = {triangles.edges[0][i], triangles.edges[1][i], triangles.edges[2][i]};
+    Scalar e2 [3] = {triangles.edges[3][i], triangles.edges[4][i], triangles.edges[5][i]};
+
+    Scalar q [3] = {direction[1]*e2[2] - direction[2]*e2[1],
+                    direction[2]*e2[0] - direction[0]*e2[2],
+                    direction[0]*e2[1] - direction[1]*e2[0]};
+
+    Scalar a = e1[0]*q[0] + e1[1]*q[1] + e1[2]*q[2];
+
+    if (a > Scalar(-0.0001) && a < Scalar(0.0001)) {
+        return false;
+    }
+
+    Scalar f = 1/a;
+
+    Scalar s [3] = {start[0] - v0[0], start[1] - v0[1], start[2] - v0[2]};
+    Scalar u = f*(s[0]*q[0] + s[1]*q[1] + s[2]*q[2]);
+
+    if (u < 0.0) {
+        return false;
+    }
+
+    Scalar r [3] = {s[1]*e1[2] - s[2]*e1[1],
+                    s[2]*e1[0] - s[0]*e1[2],
+                    s[0]*e1[1] - s[1]*e1[0]};
+    Scalar v = f*(direction[0]*r[0] + direction[1]*r[1] + direction[2]*r[2]);
+
+    if (v < 0.0 || u+v > 1.0) {
+        return false;
+    }
+
+    Scalar t = f*(e2[0]*r[0] + e2[1]*r[1] + e2[2]*r[2]);
+
+    if (t < 0.0) {
+        return false;
+    }
+
+    setTriangleHit(triangles, i, t, u, v, returnHit);
+    return true;
+}
+
+
+
+/*
+----------------------
+    CompiledScene methods.
+----------------------
+*/
+
+
+/* Default constructor. The scene is empty until compile() is called. */
+CompiledScene::CompiledScene (void) {
+}
+
+
+/* Copies OBJECT into the place REF names in its pool, which must already exist. */
+void CompiledScene::store(PrimitiveRef ref, const SceneObject &object) {
+    unsigned int i = getPrimitiveIndex(ref);
+
+    switch (getPrimitiveType(ref)) {
+        case PRIMITIVE_SPHERE: {
+            const Sphere &sphere = static_cast<const Sphere &>(object);
+            spheres.centerX[i] = sphere.position.getEntry(0);
+            spheres.centerY[i] = sphere.position.getEntry(1);
+            spheres.centerZ[i] = sphere.position.getEntry(2);
+            spheres.radius[i] = sphere.radius;
+            break;
+        }
+        case PRIMITIVE_PLANE: {
+            const Plane &plane = static_cast<const Plane &>(object);
+            planes.positionX[i] = plane.position.getEntry(0);
+            planes.positionY[i] = plane.position.getEntry(1);
+            planes.positionZ[i] = plane.position.getEntry(2);
+            planes.normalX[i] = plane.normal.getEntry(0);
+            planes.normalY[i] = plane.normal.getEntry(1);
+            planes.normalZ[i] = plane.normal.getEntry(2);
+            break;
+        }
+        case PRIMITIVE_TRIANGLE: {
+            const Triangle &triangle = static_cast<const Triangle &>(object);
+            for (int axis = 0; axis < 3; axis++) {
+                for (int corner = 0; corner < 3; corner++) {
+                    triangles.vertices[3*corner + axis][i] = triangle.getVertex(corner).getEntry(axis);
+                }
+                triangles.edges[axis][i] = triangle.getEdge1().getEntry(axis);
+                triangles.edges[3 + axis][i] = triangle.getEdge2().getEntry(axis);
+            }
+            break;
+        }
+        case PRIMITIVE_OBJECT:
+            others.objects[i] = &object;
+            break;
+    }
+}
+
+
+/* Compiles OBJECTS, replacing anything compiled before. OBJECTS must outlive the scene. */
+void CompiledScene::compile(const vector <SceneObject *> &objects) {
+
+    /* Sort the objects into types first, so each pool is sized once. Only objects whose type is exactly one of the
+       pooled ones are pooled: a subclass may intersect differently. */
+    unsigned int counts [4] = {0, 0, 0, 0};
+    refs.resize(objects.size());
+
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        const type_info &type = typeid(*objects[i]);
+        PrimitiveType primitiveType = PRIMITIVE_OBJECT;
+
+        if (type == typeid(Sphere)) {
+            primitiveType = PRIMITIVE_SPHERE;
+        }
+        else if (type == typeid(Plane)) {
+            primitiveType = PRIMITIVE_PLANE;
+        }
+        else if (type == typeid(Triangle)) {
+            primitiveType = PRIMITIVE_TRIANGLE;
+        }
+
+        refs[i] = makePrimitiveRef(primitiveType, counts[primitiveType]++);
+    }
+
+    spheres.centerX.assign(counts[PRIMITIVE_SPHERE], 0.0);
+    spheres.centerY.assign(counts[PRIMITIVE_SPHERE], 0.0);
+    spheres.centerZ.assign(counts[PRIMITIVE_SPHERE], 0.0);
+    spheres.radius.assign(counts[PRIMITIVE_SPHERE], 0.0);
+    spheres.objectIndices.resize(counts[PRIMITIVE_SPHERE]);
+
+    planes.positionX.assign(counts[PRIMITIVE_PLANE], 0.0);
+    planes.positionY.assign(counts[PRIMITIVE_PLANE], 0.0);
+    planes.positionZ.assign(counts[PRIMITIVE_PLANE], 0.0);
+    planes.normalX.assign(counts[PRIMITIVE_PLANE], 0.0);
+    planes.normalY.assign(counts[PRIMITIVE_PLANE], 0.0);
+    planes.normalZ.assign(counts[PRIMITIVE_PLANE], 0.0);
+    planes.objectIndices.resize(counts[PRIMITIVE_PLANE]);
+
+    for (int j = 0; j < 9; j++) {
+        triangles.vertices[j].assign(counts[PRIMITIVE_TRIANGLE], 0.0);
+    }
+    for (int j = 0; j < 6; j++) {
+        triangles.edges[j].assign(counts[PRIMITIVE_TRIANGLE], 0.0);
+    }
+    triangles.objectIndices.resize(counts[PRIMITIVE_TRIANGLE]);
+
+    others.objects.assign(counts[PRIMITIVE_OBJECT], NULL);
+    others.objectIndices.resize(counts[PRIMITIVE_OBJECT]);
+
+    /* Then copy each object in. */
+    unsigned int *objectIndices [4] = {spheres.objectIndices.data(), planes.objectIndices.data(),
+                                       triangles.objectIndices.data(), others.objectIndices.data()};
+
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        objectIndices[getPrimitiveType(refs[i])][getPrimitiveIndex(refs[i])] = i;
+        store(refs[i], *objects[i]);
+    }
+}
+
+
+/* Copies the objects at MOVED_INDICES in OBJECTS, the list the scene was compiled from, into their pools again
+   after they have moved or changed shape. Objects must not be added, removed or replaced. */
+void CompiledScene::update(const vector <SceneObject *> &objects, const vector <unsigned int> &movedIndices) {
+    for (unsigned int i = 0; i < movedIndices.size(); i++) {
+        store(refs[movedIndices[i]], *objects[movedIndices[i]]);
+    }
+}
+
+
+/* Returns the PrimitiveRef of the object at OBJECT_INDEX in the list the scene was compiled from. */
+PrimitiveRef CompiledScene::getRef(unsigned int objectIndex) const {
+    return refs[objectIndex];
+}
+
+
+/* Returns the index in the list the scene was compiled from of the object REF refers to. */
+unsigned int CompiledScene::getObjectIndex(PrimitiveRef ref) const {
+    unsigned int i = getPrimitiveIndex(ref);
+
+    switch (getPrimitiveType(ref)) {
+        case PRIMITIVE_SPHERE:
+            return spheres.objectIndices[i];
+        case PRIMITIVE_PLANE:
+            return planes.objectIndices[i];
+        case PRIMITIVE_TRIANGLE:
+            return triangles.objectIndices[i];
+        default:
+            return others.objectIndices[i];
+    }
+}
+
+
+/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+   the primitive REF refers to. If it does, returns true and fills in RETURN_HIT the same way the object's own
+   intersect() would. Otherwise, returns false. */
+bool CompiledScene::intersect(PrimitiveRef ref, const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const {
+    unsigned int i = getPrimitiveIndex(ref);
+    PrimitiveType type = getPrimitiveType(ref);
+
+    if (type == PRIMITIVE_OBJECT) {
+        return others.objects[i]->intersect(point, direction, returnHit);
+    }
+
+    Scalar start [3] = {point.getEntry(0), point.getEntry(1), point.getEntry(2)};
+    Scalar rayDirection [3] = {direction.getEntry(0), direction.getEntry(1), direction.getEntry(2)};
+
+    switch (type) {
+        case PRIMITIVE_SPHERE:
+            return intersectSphere(spheres, i, start, rayDirection, returnHit);
+        case PRIMITIVE_PLANE:
+            return intersectPlane(planes, i, start, rayDirection, returnHit);
+        default:
+            return intersectTriangle(triangles, i, start, rayDirection, returnHit);
+    }
+}
+
+
+/* Takes a point, as START, and a direction from that point, and calculates the ray parameter at which the ray
+   defined by them meets each of the COUNT spheres REFS refers to, at most KERNEL_BATCH_SIZE of them, placing it
+   into RETURN_T[i], or KERNEL_MISS if the ray misses sphere i. The spheres are gathered from the pool, so the
+   kernel can load them side by side. */
+void CompiledScene::intersectSpheres(const PrimitiveRef *refs, unsigned int count, const Scalar start[3], const Scalar direction[3], Scalar *returnT) const {
+    Scalar centerX [KERNEL_BATCH_SIZE];
+    Scalar centerY [KERNEL_BATCH_SIZE];
+    Scalar centerZ [KERNEL_BATCH_SIZE];
+    Scalar radius [KERNEL_BATCH_SIZE];
+
+    for (unsigned int j = 0; j < count; j++) {
+        unsigned int i = getPrimitiveIndex(refs[j]);
+        centerX[j] = spheres.centerX[i];
+        centerY[j] = spheres.centerY[i];
+        centerZ[j] = spheres.centerZ[i];
+        radius[j] = spheres.radius[i];
+    }
+
+    ::intersectSpheres(start, direction, centerX, centerY, centerZ, radius, count, returnT, 0);
+}
+
+
+/* Fills in RETURN_HIT for the ray from START along DIRECTION meeting a sphere at ray parameter T, the same way
+   Sphere::intersect() does. */
+void CompiledScene::getSphereHit(Scalar t, const Scalar start[3], const Scalar direction[3], HitRecord &returnHit) {
+    returnHit.t = t;
+    returnHit.point = Point3(start[0] + t*direction[0], start[1] + t*direction[1], start[2] + t*direction[2]);
+    returnHit.primitive = 0;
+    returnHit.u = 0.0;
+    returnHit.v = 0.0;
+}
+
+
+/* Takes a point and a direction from that point to form a ray, and tests it against every primitive to find the
+   first one it intersects. The spheres come first, SCENE_SPHERE_CHUNK at a time straight from the pool, then the
+   rest one at a time. Since the pools are searched out of order, ties are broken by object index, which keeps the
+   object a search over the list in order would. */
+bool CompiledScene::findFirstIntersection(const Point3 &point, const Direction3 &direction, HitRecord &returnHit, unsigned int &returnIndex) const {
+    Scalar start [3] = {point.getEntry(0), point.getEntry(1), point.getEntry(2)};
+    Scalar rayDirection [3] = {direction.getEntry(0), direction.getEntry(1), direction.getEntry(2)};
+
+    returnIndex = UINT_MAX;
+    returnHit.t = HUGE_VAL;
+
+    Scalar t [SCENE_SPHERE_CHUNK];
+    unsigned int sphereCount = spheres.centerX.size();
+
+    for (unsigned int first = 0; first < sphereCount; first += SCENE_SPHERE_CHUNK) {
+        unsigned int count = min(sphereCount - first, (unsigned int)SCENE_SPHERE_CHUNK);
+
+        ::intersectSpheres(start, rayDirection, &spheres.centerX[first], &spheres.centerY[first], &spheres.centerZ[first],
+                           &spheres.radius[first], count, t, 0);
+
+        for (unsigned int i = 0; i < count; i++) {
+            /* Spheres are pooled in order, so an earlier one at the same distance has already won. */
+            if (t[i] < returnHit.t) {
+                getSphereHit(t[i], start, rayDirection, returnHit);
+                returnIndex = spheres.objectIndices[first + i];
+            }
+        }
+    }
+
+    HitRecord hit;
+    PrimitiveType types [3] = {PRIMITIVE_PLANE, PRIMITIVE_TRIANGLE, PRIMITIVE_OBJECT};
+    const vector <unsigned int> *objectIndices [3] = {&planes.objectIndices, &triangles.objectIndices, &others.objectIndices};
+
+    for (int type = 0; type < 3; type++) {
+        for (unsigned int i = 0; i < objectIndices[type]->size(); i++) {
+            unsigned int index = (*objectIndices[type])[i];
+
+            if (intersect(makePrimitiveRef(types[type], i), point, direction, hit) &&
+                (returnIndex == UINT_MAX || hit.t < returnHit.t || (hit.t == returnHit.t && index < returnIndex))) {
+                returnHit = hit;
+                returnIndex = index;
+            }
+        }
+    }
+
+    return returnIndex != UINT_MAX;
+}
+
+
+/* Takes a point and a direction from that point to form a ray, and returns true if the ray intersects any
+   primitive other than a light at a ray parameter less than MAX_T. Spheres are never lights. */
+bool CompiledScene::isOccluded(const Point3 &point, const Direction3 &direction, Scalar maxT) const {
+    Scalar start [3] = {point.getEntry(0), point.getEntry(1), point.getEntry(2)};
+    Scalar rayDirection [3] = {direction.getEntry(0), direction.getEntry(1), direction.getEntry(2)};
+
+    Scalar t [SCENE_SPHERE_CHUNK];
+    unsigned int sphereCount = spheres.centerX.size();
+
+    for (unsigned int first = 0; first < sphereCount; first += SCENE_SPHERE_CHUNK) {
+        unsigned int count = min(sphereCount - first, (unsigned int)SCENE_SPHERE_CHUNK);
+
+        ::intersectSpheres(start, rayDirection, &spheres.centerX[first], &spheres.centerY[first], &spheres.centerZ[first],
+                           &spheres.radius[first], count, t, 0);
+
+        for (unsigned int i = 0; i < count; i++) {
+            if (t[i] < maxT) {
+                return true;
+            }
+        }
+    }
+
+    HitRecord hit;
+
+    for (unsigned int i = 0; i < refs.size(); i++) {
+        if (getPrimitiveType(refs[i]) != PRIMITIVE_SPHERE && intersect(refs[i], point, direction, hit) &&
+            hit.t < maxT && !isLight(refs[i])) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/* Copies the triangle REF refers to into lane LANE of PACKET. */
+void CompiledScene::packTriangle(PrimitiveRef ref, TrianglePacket &packet, unsigned int lane) const {
+    unsigned int i = getPrimitiveIndex(ref);
+
+    for (int axis = 0; axis < 3; axis++) {
+        packet.vertex0[axis][lane] = triangles.vertices[axis][i];
+        packet.edge1[axis][lane] = triangles.edges[axis][i];
+        packet.edge2[axis][lane] = triangles.edges[3 + axis][i];
+    }
+}
+
+
+/* Fills in RETURN_HIT for a ray meeting the triangle REF refers to at ray parameter T and barycentric coordinates
+   U and V, the same way intersect() would. */
+void CompiledScene::getTriangleHit(PrimitiveRef ref, Scalar t, Scalar u, Scalar v, HitRecord &returnHit) const {
+    setTriangleHit(triangles, getPrimitiveIndex(ref), t, u, v, returnHit);
+}
+
+
+/* Returns the number of triangles in the triangle pool. */
+unsigned int CompiledScene::getTriangleCount(void) const {
+    return triangles.objectIndices.size();
+}
+
+
+/* Returns true if REF refers to a light. Lights are never pooled. */
+bool CompiledScene::isLight(PrimitiveRef ref) const {
+    return getPrimitiveType(ref) == PRIMITIVE_OBJECT && ::isLight(*others.objects[getPrimitiveIndex(ref)]);
+}
+
+
+/* Returns the number of bytes the pools take up. */
+size_t CompiledScene::getMemoryUsage(void) const {
+    size_t scalars = 4*spheres.centerX.capacity() + 6*planes.positionX.capacity() + 15*triangles.vertices[0].capacity();
+    size_t indices = spheres.objectIndices.capacity() + planes.objectIndices.capacity() +
+                     triangles.objectIndices.capacity() + others.objectIndices.capacity() + refs.capacity();
+
+    return scalars*sizeof(Scalar) + indices*sizeof(unsigned int) + others.objects.capacity()*sizeof(const SceneObject *);
+}
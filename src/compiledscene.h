@@ -0,0 +1,172 @@
+/* Contains declarations for a compiled scene, which copies the spheres, planes and triangles of a list of SceneObjects
+   into contiguous arrays, one set per kind, so that acceleration structures can test rays against them without
+   calling virtual functions or visiting the objects themselves. */
+
+#ifndef COMPILED_SCENE
+#define COMPILED_SCENE
+
+	#include <vector> /* STL vector. */
+	#include <cstddef>
+	#include "sceneobject.h"
+	#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+	#include "kernels.h"
+
+	using namespace std;
+
+
+	/* The kinds of primitive a compiled scene stores separately. Objects of any other kind, such as lights and mesh
+	   instances, are PRIMITIVE_OBJECTs, and are tested through their virtual functions as before. */
+	enum PrimitiveType {
+		PRIMITIVE_SPHERE,
+		PRIMITIVE_PLANE,
+		PRIMITIVE_TRIANGLE,
+		PRIMITIVE_OBJECT
+	};
+
+
+	/* A primitive of a compiled scene: its PrimitiveType in the top two bits, and its index among the primitives of
+	   that type in the rest. Acceleration structures keep these in their leaves rather than object indices. */
+	typedef unsigned int PrimitiveRef;
+
+	/* Where the PrimitiveType of a PrimitiveRef starts, and the bits holding its index. */
+	#define PRIMITIVE_TYPE_SHIFT 30
+	#define PRIMITIVE_INDEX_MASK 0x3fffffffu
+
+
+	/* The spheres of a compiled scene. Sphere i is centered at (centerX[i], centerY[i], centerZ[i]). */
+	struct SpherePool {
+		vector <Scalar> centerX;
+		vector <Scalar> centerY;
+		vector <Scalar> centerZ;
+		vector <Scalar> radius;
+
+		/* Index of each sphere in the list the scene was compiled from. */
+		vector <unsigned int> objectIndices;
+	};
+
+
+	/* The planes of a compiled scene. Plane i passes through (positionX[i], positionY[i], positionZ[i]). */
+	struct PlanePool {
+		vector <Scalar> positionX;
+		vector <Scalar> positionY;
+		vector <Scalar> positionZ;
+		vector <Scalar> normalX;
+		vector <Scalar> normalY;
+		vector <Scalar> normalZ;
+
+		/* Index of each plane in the list the scene was compiled from. */
+		vector <unsigned int> objectIndices;
+	};
+
+
+	/* The triangles of a compiled scene. vertices[3*corner + axis][i] is coordinate AXIS of corner CORNER of triangle i,
+	   and edges[3*edge + axis][i] coordinate AXIS of the edge from corner 0 to corner EDGE+1, as the Triangle worked it
+	   out. A ray is tested against corner 0 and the edges; the other corners are only read for the point of a hit. */
+	struct TrianglePool {
+		vector <Scalar> vertices [9];
+		vector <Scalar> edges [6];
+
+		/* Index of each triangle in the list the scene was compiled from. */
+		vector <unsigned int> objectIndices;
+	};
+
+
+	/* The objects of a compiled scene that aren't spheres, planes or triangles. */
+	struct ObjectPool {
+		vector <const SceneObject *> objects;
+
+		/* Index of each object in the list the scene was compiled from. */
+		vector <unsigned int> objectIndices;
+	};
+
+
+	/* A list of SceneObjects compiled for tracing. Objects whose type is exactly Sphere, Plane or Triangle are copied into
+	   a pool for their type, stored as a structure of arrays, and are tested by code picked with a switch on the type
+	   rather than a virtual call. Everything else is kept by pointer. The SceneObjects remain the way scenes are made
+	   and shaded; only intersection tests use the compiled form, and they give exactly the same results. */
+	class CompiledScene {
+
+		protected:
+			SpherePool spheres;
+			PlanePool planes;
+			TrianglePool triangles;
+			ObjectPool others;
+
+			/* The PrimitiveRef of each object in the list the scene was compiled from. */
+			vector <PrimitiveRef> refs;
+
+			/* Copies OBJECT into the place REF names in its pool, which must already exist. */
+			void store(PrimitiveRef ref, const SceneObject &object);
+
+		public:
+			/* Default constructor. The scene is empty until compile() is called. */
+			CompiledScene (void);
+
+			/* Compiles OBJECTS, replacing anything compiled before. OBJECTS must outlive the scene. */
+			void compile(const vector <SceneObject *> &objects);
+
+			/* Copies the objects at MOVED_INDICES in OBJECTS, the list the scene was compiled from, into their pools again
+			   after they have moved or changed shape. Objects must not be added, removed or replaced. */
+			void update(const vector <SceneObject *> &objects, const vector <unsigned int> &movedIndices);
+
+			/* Returns the PrimitiveRef of the object at OBJECT_INDEX in the list the scene was compiled from. */
+			PrimitiveRef getRef(unsigned int objectIndex) const;
+
+			/* Returns the index in the list the scene was compiled from of the object REF refers to. */
+			unsigned int getObjectIndex(PrimitiveRef ref) const;
+
+			/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+			   the primitive REF refers to. If it does, returns true and fills in RETURN_HIT the same way the object's own
+			   intersect() would. Otherwise, returns false. */
+			bool intersect(PrimitiveRef ref, const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const;
+
+			/* Takes a point, as START, and a direction from that point, and calculates the ray parameter at which the ray
+			   defined by them meets each of the COUNT spheres REFS refers to, at most KERNEL_BATCH_SIZE of them, placing it
+			   into RETURN_T[i], or KERNEL_MISS if the ray misses sphere i. The spheres are tested together by the SIMD kernel,
+			   and a ray parameter found is the one intersect() would find. */
+			void intersectSpheres(const PrimitiveRef *refs, unsigned int count, const Scalar start[3], const Scalar direction[3], Scalar *returnT) const;
+
+			/* Fills in RETURN_HIT for the ray from START along DIRECTION meeting a sphere at ray parameter T, the same way
+			   intersect() would. */
+			static void getSphereHit(Scalar t, const Scalar start[3], const Scalar direction[3], HitRecord &returnHit);
+
+			/* Copies the triangle REF refers to into lane LANE of PACKET. */
+			void packTriangle(PrimitiveRef ref, TrianglePacket &packet, unsigned int lane) const;
+
+			/* Fills in RETURN_HIT for a ray meeting the triangle REF refers to at ray parameter T and barycentric
+			   coordinates U and V, as intersectTrianglePacket() finds them, the same way intersect() would. */
+			void getTriangleHit(PrimitiveRef ref, Scalar t, Scalar u, Scalar v, HitRecord &returnHit) const;
+
+			/* Returns the number of triangles in the triangle pool. */
+			unsigned int getTriangleCount(void) const;
+
+			/* Takes a point and a direction from that point to form a ray, and tests it against every primitive to find the
+			   first one it intersects, testing the spheres a batch at a time. Upon success, returns true, places the
+			   intersection into RETURN_HIT, and places the index of the object in the list the scene was compiled from into
+			   RETURN_INDEX. Of two intersections at the same ray parameter, the object with the lower index is kept. Upon
+			   failure, false will simply be returned. */
+			bool findFirstIntersection(const Point3 &point, const Direction3 &direction, HitRecord &returnHit, unsigned int &returnIndex) const;
+
+			/* Takes a point and a direction from that point to form a ray, and returns true if the ray intersects any
+			   primitive other than a light at a ray parameter less than MAX_T. */
+			bool isOccluded(const Point3 &point, const Direction3 &direction, Scalar maxT) const;
+
+			/* Returns true if REF refers to a light. */
+			bool isLight(PrimitiveRef ref) const;
+
+			/* Returns the number of bytes the pools take up. */
+			size_t getMemoryUsage(void) const;
+	};
+
+
+	/* Returns the PrimitiveRef for the primitive at INDEX among those of type TYPE. */
+	PrimitiveRef makePrimitiveRef(PrimitiveType type, unsigned int index);
+
+	/* Returns the type of the primitive REF refers to. */
+	PrimitiveType getPrimitiveType(PrimitiveRef ref);
+
+	/* Returns the index of the primitive REF refers to among those of its type. */
+	unsigned int getPrimitiveIndex(PrimitiveRef ref);
+
+
+#endif
@@ -0,0 +1,118 @@
+/* Contains definitions for functions that tell which instruction sets the processor supports, and pick the one the
+   SIMD kernels use. */
+
+#include <cstdio>
+#include <cstring>
+
+#include "cpu.h"
+
+
+/* The instruction set the kernels use. Picked before main() runs. */
+static InstructionSet selectedInstructionSet = getBestInstructionSet();
+
+
+
+/* Returns true if the processor supports the AVX2 instruction set. */
+bool cpuSupportsAVX2(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	/* May run before the runtime has read cpuid itself, from the initializer above. */
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+
+
+/* Returns true if the processor supports the AVX-512 foundation instructions. */
+bool cpuSupportsAVX512(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f");
+#else
+	return false;
+#endif
+}
+
+
+
+/* Returns the widest instruction set the processor supports, as found with cpuid when the program starts. */
+InstructionSet getBestInstructionSet(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	if (cpuSupportsAVX512()) {
+		return INSTRUCTION_SET_AVX512;
+	}
+	if (cpuSupportsAVX2()) {
+		return INSTRUCTION_SET_AVX2;
+	}
+
+	/* Every x86-64 processor has SSE2, and the compiler already assumes it. */
+	return INSTRUCTION_SET_SSE2;
+#else
+	return INSTRUCTION_SET_SCALAR;
+#endif
+}
+
+
+
+/* Returns the instruction set the kernels use. */
+InstructionSet getInstructionSet(void) {
+	return selectedInstructionSet;
+}
+
+
+
+/* Makes the kernels use SET from now on. Returns false, and changes nothing, if the processor doesn't support SET. */
+bool setInstructionSet(InstructionSet set) {
+	if (set > getBestInstructionSet()) {
+		return false;
+	}
+
+	selectedInstructionSet = set;
+	return true;
+}
+
+
+
+/* Places the instruction set called NAME into RETURN_SET. Returns false if there is no such set. */
+bool parseInstructionSet(const char *name, InstructionSet &returnSet) {
+	InstructionSet sets [] = {INSTRUCTION_SET_SCALAR, INSTRUCTION_SET_SSE2, INSTRUCTION_SET_AVX2, INSTRUCTION_SET_AVX512};
+
+	for (unsigned int i = 0; i < sizeof(sets)/sizeof(sets[0]); i++) {
+		if (strcmp(name, getInstructionSetName(sets[i])) == 0) {
+			returnSet = sets[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+
+/* Returns the name of SET. */
+const char* getInstructionSetName(InstructionSet set) {
+	switch (set) {
+		case INSTRUCTION_SET_SSE2:   return "sse2";
+		case INSTRUCTION_SET_AVX2:   return "avx2";
+		case INSTRUCTION_SET_AVX512: return "avx512";
+		default:                     return "scalar";
+	}
+}
+
+
+
+/* Prints which instruction set the kernels use, and the best the processor supports. */
+void printInstructionSet(void) {
+	printf("Using %s kernels (processor supports up to %s)\n", getInstructionSetName(selectedInstructionSet),
+	       getInstructionSetName(getBestInstructionSet()));
+}
+
+
+
+/* Returns the number of lanes a kernel asked to work WIDTH lanes at a time actually uses. */
+int getKernelWidth(int width) {
+	int widest = (int)selectedInstructionSet;
+	return (width == 0 || width > widest) ? widest : width;
+}
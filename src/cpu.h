@@ -0,0 +1,56 @@
+/* Contains declarations for functions that tell which instruction sets the processor supports, and pick the one the
+   SIMD kernels use. */
+
+#ifndef CPU
+#define CPU
+
+
+	/* The instruction sets the kernels are compiled for, each given by the number of doubles its registers hold.
+	   Every kernel has a variant for each set it can use, built with that set enabled for just those functions, so a
+	   single binary runs on any x86 processor. A processor with SSE4 but not AVX2 gets the SSE2 variants, since nothing
+	   in the kernels gains from SSE4; one with AVX-512 gets 8 lanes from the kernels that test that many things at once,
+	   and the AVX2 variants from the rest. */
+	enum InstructionSet {
+		INSTRUCTION_SET_SCALAR = 1,
+		INSTRUCTION_SET_SSE2 = 2,
+		INSTRUCTION_SET_AVX2 = 4,
+		INSTRUCTION_SET_AVX512 = 8
+	};
+
+
+	/* Returns true if the processor supports the AVX2 instruction set. */
+	bool cpuSupportsAVX2(void);
+
+	/* Returns true if the processor supports the AVX-512 foundation instructions. */
+	bool cpuSupportsAVX512(void);
+
+	/* Returns the widest instruction set the processor supports, as found with cpuid when the program starts. */
+	InstructionSet getBestInstructionSet(void);
+
+
+	/* Returns the instruction set the kernels use: the best the processor supports, unless setInstructionSet() has
+	   picked another. */
+	InstructionSet getInstructionSet(void);
+
+	/* Makes the kernels use SET from now on, so that each can be timed against the others. Returns false, and changes
+	   nothing, if the processor doesn't support SET. */
+	bool setInstructionSet(InstructionSet set);
+
+	/* Places the instruction set called NAME, one of "scalar", "sse2", "avx2" and "avx512", into RETURN_SET. Returns
+	   false if there is no such set. */
+	bool parseInstructionSet(const char *name, InstructionSet &returnSet);
+
+	/* Returns the name of SET, as parseInstructionSet() reads it. */
+	const char* getInstructionSetName(InstructionSet set);
+
+
+	/* Prints which instruction set the kernels use, and the best the processor supports. */
+	void printInstructionSet(void);
+
+
+	/* Returns the number of lanes a kernel asked to work WIDTH lanes at a time actually uses: WIDTH, or the most the
+	   instruction set in use has if WIDTH is 0 or more than that. */
+	int getKernelWidth(int width);
+
+
+#endif
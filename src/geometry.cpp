@@ -9,7 +9,7 @@
 #include "common.h"
 #include "raytrace.h"
 #include "transform.h"
-#include "vector.h" /* My own implementation of a 4x1 vector. */
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
 #include "color.h"
 #include "material.h"
 
@@ -83,18 +83,32 @@ Sphere::Sphere(double radius, double x, double y, double z, Material material) {
 /* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects 
    this sphere. If it does, returns true and modifies RETURN_INTERSECTION_POINT with the point of intersection. 
    Otherwise, returns false. */
-bool Sphere::checkIntersection(const Vector &point, const Vector &direction, Vector &returnIntersectionPoint) const {
+bool Sphere::checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const {
+    HitRecord hit;
+
+    if (!intersect(point, direction, hit)) {
+        return false;
+    }
+
+    returnIntersectionPoint = hit.point;
+    return true;
+}
+
+
+/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+   this sphere. If it does, returns true and fills in RETURN_HIT. Otherwise, returns false. */
+bool Sphere::intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const {
 
     /* The following code takes the parametric form of the ray defined by POINT and DIRECTION, plugs it into
        the equation of a sphere, and attempts to solve for t to find out where the ray intersects the sphere 
        (if at all). */
 
     /* Coefficients of the quadratic formula. */
-    double a, b, c;
+    Scalar a, b, c;
 
     /* Transform POINT into the sphere's object coordinates. (Note: This sphere is at (0, 0, 0) in 
        its own coordinate space.) */
-    Vector s = point - position;
+    Vec3 s = point - position;
 
     /* Derive coefficients of the quadratic formula relating the ray to the sphere. */
     a = direction.dotProduct(direction);
@@ -102,7 +116,7 @@ bool Sphere::checkIntersection(const Vector &point, const Vector &direction, Vec
     c = s.dotProduct(s) - (radius * radius);
 
     /* Discriminant of the quadratic formula. We can use this to determine how many roots the quadratic formula has. */
-    double discriminant = b*b - 4*a*c;
+    Scalar discriminant = b*b - 4*a*c;
 
     /* If discriminant is less than 0, then there are no real roots, and thus there is no intersection. */
     if (discriminant < 0) {
@@ -110,7 +124,7 @@ bool Sphere::checkIntersection(const Vector &point, const Vector &direction, Vec
     }
    
    /* Solves for the value of t corresponding to the closest intersection point of the ray & sphere to the origin of the ray. */
-   double t = (-b - sqrt(discriminant)) / (2*a);
+   Scalar t = (-b - sqrt(discriminant)) / (2*a);
 
     /* If t is negative, then the intersection is behind the ray. */
     if (t < 0) {
@@ -118,15 +132,30 @@ bool Sphere::checkIntersection(const Vector &point, const Vector &direction, Vec
     }
 
     /* Calculate the intersection point of the ray and the sphere. */
-    returnIntersectionPoint[0] = point.getEntry(0) + t*direction.getEntry(0);
-    returnIntersectionPoint[1] = point.getEntry(1) + t*direction.getEntry(1);
-    returnIntersectionPoint[2] = point.getEntry(2) + t*direction.getEntry(2);
+    returnHit.t = t;
+    returnHit.point = Point3(point.getEntry(0) + t*direction.getEntry(0),
+                             point.getEntry(1) + t*direction.getEntry(1),
+                             point.getEntry(2) + t*direction.getEntry(2));
+    returnHit.primitive = 0;
+    returnHit.u = 0.0;
+    returnHit.v = 0.0;
 
     return true;
 
 }
 
 
+/* Places a box enclosing the sphere into RETURN_BOUNDS and returns true. */
+bool Sphere::getBounds(BoundingBox &returnBounds) const {
+    for (int i = 0; i < 3; i++) {
+        returnBounds.lower[i] = position.getEntry(i) - radius;
+        returnBounds.upper[i] = position.getEntry(i) + radius;
+    }
+
+    return true;
+}
+
+
 /* Sphere print member function. */
 void Sphere::print (ostream *os) const {
     printf("[Sphere with radius %.3f at (%5.3f, %5.3f, %5.3f)]", radius, position.getEntry(0), position.getEntry(1), position.getEntry(2));
@@ -147,7 +176,7 @@ void Sphere::print (ostream *os) const {
    Material is given default values. */
 Plane::Plane (void) {
 
-    this->normal = Vector (0.0, 1.0, 0.0, 0.0);
+    this->normal = Direction3 (0.0, 1.0, 0.0);
 
     this->position[0] = 0.0;
     this->position[1] = 0.0;
@@ -170,7 +199,7 @@ Plane::Plane (void) {
 
 /* Constructor. The plane's normal is set to NORMAL and position in space is set to (X, Y, Z). Material is given default values. 
    Normal will be converted into a unit vector. */
-Plane::Plane (const Vector &normal, double x, double y, double z) {
+Plane::Plane (const Direction3 &normal, double x, double y, double z) {
 
     this->normal = normal;
     this->normal.normalize();
@@ -196,7 +225,7 @@ Plane::Plane (const Vector &normal, double x, double y, double z) {
 
 /* Constructor. The plane's normal is set to NORMAL and position in space is set to (X, Y, Z). Material is set to MATERIAL. 
    Normal will be converted into a unit vector. */
-Plane::Plane (const Vector &normal, double x, double y, double z, Material material) {
+Plane::Plane (const Direction3 &normal, double x, double y, double z, Material material) {
     
     this->normal = normal;
     this->normal.normalize();
@@ -213,19 +242,15 @@ Plane::Plane (const Vector &normal, double x, double y, double z, Material mater
 
 
 /* Returns the color of the plane at POINT. */
-Color Plane::getColor(const Vector &point) const {
-    cout << "In Plane::getColor()!!!!" << endl;
-    Color returnColor = {0.0, 1.0, 0.0, this->material.color.a};
-    return returnColor;
-    if (((int)point.getEntry(0)) % 100 <= 50) {
-        returnColor.r = 1.0;
-        returnColor.g = 1.0;
-        returnColor.b = 1.0;
-        return returnColor;
-    } 
-    else {
-        return returnColor;
-    }
+Color Plane::getColor(const Point3 &point) const {
+    return material.color;
+}
+
+
+
+/* Returns the plane's normal, which is the same at every POINT on it. */
+Direction3 Plane::getNormal(const Point3 &point) const {
+    return normal;
 }
 
 
@@ -233,19 +258,33 @@ Color Plane::getColor(const Vector &point) const {
 /* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects 
    this plane. If it does, returns true and modifies RETURN_INTERSECTION_POINT with the point of intersection. 
    Otherwise, returns false. */
-bool Plane::checkIntersection(const Vector &point, const Vector &direction, Vector &returnIntersectionPoint) const {
+bool Plane::checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const {
+    HitRecord hit;
+
+    if (!intersect(point, direction, hit)) {
+        return false;
+    }
+
+    returnIntersectionPoint = hit.point;
+    return true;
+}
+
+
+/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+   this plane. If it does, returns true and fills in RETURN_HIT. Otherwise, returns false. */
+bool Plane::intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const {
 
-    double angleBetweenNormalAndRay = normal.dotProduct(direction);
+    Scalar angleBetweenNormalAndRay = normal.dotProduct(direction);
 
     /* If this angle is close to 0.0, then the ray travels parallel to the plane. We'll consider all parallel 
        rays as NOT intersecting the plane, including parallel rays that lay directly on the plane. */
-    if (angleBetweenNormalAndRay <= 0.0001 && angleBetweenNormalAndRay >= -0.0001) {
+    if (angleBetweenNormalAndRay <= Scalar(0.0001) && angleBetweenNormalAndRay >= Scalar(-0.0001)) {
         return false;
     }
     
 
     /* Solves for t where t is the intersection of the ray & the plane in the parametric equation of the ray. */
-    double t = (position-point).dotProduct(normal)/angleBetweenNormalAndRay;
+    Scalar t = (position-point).dotProduct(normal)/angleBetweenNormalAndRay;
 
     /* If t is negative, then the intersection is behind the ray. */
     if (t < 0) {
@@ -253,9 +292,13 @@ bool Plane::checkIntersection(const Vector &point, const Vector &direction, Vect
     }
 
     /* Calculate the intersection point of the ray and the plane based on t. */
-    returnIntersectionPoint[0] = point.getEntry(0) + t*direction.getEntry(0);
-    returnIntersectionPoint[1] = point.getEntry(1) + t*direction.getEntry(1);
-    returnIntersectionPoint[2] = point.getEntry(2) + t*direction.getEntry(2);
+    returnHit.t = t;
+    returnHit.point = Point3(point.getEntry(0) + t*direction.getEntry(0),
+                             point.getEntry(1) + t*direction.getEntry(1),
+                             point.getEntry(2) + t*direction.getEntry(2));
+    returnHit.primitive = 0;
+    returnHit.u = 0.0;
+    returnHit.v = 0.0;
 
     return true;
 }
@@ -286,10 +329,9 @@ Triangle::Triangle (void) {
     this->position[2] = 0.0;
     this->position[3] = 1.0;
 
-    this->vertex0 = Vector (-0.5, 1.0, 0.0, 1.0);
-    this->vertex1 = Vector ( 0.0, 1.0, 0.0, 1.0);
-    this->vertex2 = Vector ( 0.5, 0.0, 0.0, 1.0);
-
+    setVertices(Point3 (-0.5, 1.0, 0.0),
+                Point3 ( 0.0, 1.0, 0.0),
+                Point3 ( 0.5, 0.0, 0.0));
 
 
     this->material.color.r = 0.75;
@@ -305,45 +347,193 @@ Triangle::Triangle (void) {
 }   
 
 
-Vector Triangle::getNormal(const Vector &point) const {
-    Vector e1 = (vertex1-vertex0);
-    Vector e2 = (vertex2-vertex0);
-    return e1.crossProduct(e2).normalize();
+/* Works out the edges, normal and plane from the vertices. */
+void Triangle::precompute(void) {
+    edge1 = vertex1-vertex0;
+    edge2 = vertex2-vertex0;
+    unitNormal = edge1.crossProduct(edge2).normalize();
+    planeOffset = unitNormal.dotProduct(vertex0);
+}
+
+
+/* Sets the triangle's corners to VERTEX_0, VERTEX_1 and VERTEX_2, and works out its edges, normal and plane again. */
+void Triangle::setVertices(const Point3 &vertex0, const Point3 &vertex1, const Point3 &vertex2) {
+    this->vertex0 = vertex0;
+    this->vertex1 = vertex1;
+    this->vertex2 = vertex2;
+
+    precompute();
+}
+
+
+/* Returns corner I of the triangle, which is 0, 1 or 2. */
+const Point3& Triangle::getVertex(int i) const {
+    assert(i >= 0 && i <= 2);
+    return (i == 0) ? vertex0 : (i == 1) ? vertex1 : vertex2;
+}
+
+
+/* Returns the edge from corner 0 to corner 1. */
+const Direction3& Triangle::getEdge1(void) const {
+    return edge1;
+}
+
+
+/* Returns the edge from corner 0 to corner 2. */
+const Direction3& Triangle::getEdge2(void) const {
+    return edge2;
+}
+
+
+/* Returns the distance from POINT to the plane the triangle lies in. */
+double Triangle::getPlaneDistance(const Point3 &point) const {
+    return fabs(unitNormal.dotProduct(point) - planeOffset);
+}
+
+
+/* Returns the triangle's unit normal, which is the same at every POINT on it. */
+Direction3 Triangle::getNormal(const Point3 &point) const {
+    return unitNormal;
 }
 
 
 /* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects 
    this triangle. If it does, returns true and modifies RETURN_INTERSECTION_POINT with the point of intersection. 
    Otherwise, returns false. */
-bool Triangle::checkIntersection(const Vector &point, const Vector &direction, Vector &returnIntersectionPoint) const {
-    Vector e1 = (vertex1-vertex0);
-    Vector e2 = (vertex2-vertex0);
-    Vector q = direction.crossProduct(e2);
+bool Triangle::checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const {
+    HitRecord hit;
+
+    if (!intersect(point, direction, hit)) {
+        return false;
+    }
+
+    returnIntersectionPoint = hit.point;
+    return true;
+}
 
-    double a = e1.dotProduct(q);
 
-    if (a > -0.0001 && a < 0.0001) {
+/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+   this triangle. If it does, returns true and fills in RETURN_HIT. U and V are the barycentric coordinates of the
+   point. Otherwise, returns false. */
+bool Triangle::intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const {
+    const Vec3 &e1 = edge1;
+    const Vec3 &e2 = edge2;
+    Vec3 q = direction.crossProduct(e2);
+
+    Scalar a = e1.dotProduct(q);
+
+    if (a > Scalar(-0.0001) && a < Scalar(0.0001)) {
         return false;
     }
 
-    double f = 1.0/a;
+    Scalar f = 1/a;
 
-    Vector s = point-vertex0;
-    double u = f*(s.dotProduct(q));
+    Vec3 s = point-vertex0;
+    Scalar u = f*(s.dotProduct(q));
 
     if (u < 0.0) {
         return false;
     }
 
-    Vector r = s.crossProduct(e1);
-    double v = f*(direction.dotProduct(r));
+    Vec3 r = s.crossProduct(e1);
+    Scalar v = f*(direction.dotProduct(r));
 
     if (v < 0.0 || u+v > 1.0) {
         return false;
     }
 
+    /* If t is negative, then the intersection is behind the ray. */
+    Scalar t = f*(e2.dotProduct(r));
+
+    if (t < 0.0) {
+        return false;
+    }
+
     /* Calculate intersection point using barycentric coordinates. */
-    returnIntersectionPoint = (1-u-v)*vertex0 + u*vertex1 + v*vertex2;
+    returnHit.t = t;
+    returnHit.point = (1-u-v)*vertex0 + u*vertex1 + v*vertex2;
+    returnHit.primitive = 0;
+    returnHit.u = u;
+    returnHit.v = v;
+
+    return true;
+}
+
+
+/* Places a box enclosing the triangle's vertices into RETURN_BOUNDS and returns true. */
+bool Triangle::getBounds(BoundingBox &returnBounds) const {
+    returnBounds = getEmptyBoundingBox();
+
+    expand(returnBounds, vertex0);
+    expand(returnBounds, vertex1);
+    expand(returnBounds, vertex2);
+
+    return true;
+}
+
+
+/* Clips the triangle to BOX, places a box enclosing what is left into RETURN_BOUNDS, and returns true if
+   anything is left. Much tighter than the overlap of the boxes for long triangles lying across BOX. */
+bool Triangle::getClippedBounds(const BoundingBox &box, BoundingBox &returnBounds) const {
+
+    /* Clip the polygon against each side of the box in turn (Sutherland-Hodgman). Each side adds at most one
+       corner, so 9 is enough. */
+    double polygon [9][3];
+    double clipped [9][3];
+    int count = 3;
+
+    for (int i = 0; i < 3; i++) {
+        polygon[0][i] = vertex0.getEntry(i);
+        polygon[1][i] = vertex1.getEntry(i);
+        polygon[2][i] = vertex2.getEntry(i);
+    }
+
+    for (int side = 0; side < 6 && count > 0; side++) {
+        int axis = side / 2;
+        bool upper = (side % 2) == 1;
+        double plane = upper ? box.upper[axis] : box.lower[axis];
+        int clippedCount = 0;
+
+        for (int i = 0; i < count; i++) {
+            const double *current = polygon[i];
+            const double *next = polygon[(i+1) % count];
+
+            bool currentInside = upper ? (current[axis] <= plane) : (current[axis] >= plane);
+            bool nextInside = upper ? (next[axis] <= plane) : (next[axis] >= plane);
+
+            if (currentInside) {
+                for (int j = 0; j < 3; j++) {
+                    clipped[clippedCount][j] = current[j];
+                }
+                clippedCount++;
+            }
+
+            /* Add the point where the edge crosses the plane, placed exactly on it. */
+            if (currentInside != nextInside) {
+                double t = (plane - current[axis]) / (next[axis] - current[axis]);
+
+                for (int j = 0; j < 3; j++) {
+                    clipped[clippedCount][j] = current[j] + t*(next[j] - current[j]);
+                }
+                clipped[clippedCount][axis] = plane;
+                clippedCount++;
+            }
+        }
+
+        count = clippedCount;
+        memcpy(polygon, clipped, sizeof(polygon));
+    }
+
+    if (count == 0) {
+        return false;
+    }
+
+    returnBounds = getEmptyBoundingBox();
+
+    for (int i = 0; i < count; i++) {
+        expand(returnBounds, Point3(polygon[i][0], polygon[i][1], polygon[i][2]));
+    }
+
     return true;
 }
 
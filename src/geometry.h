@@ -14,7 +14,7 @@
 		public:
 
 			/* A sphere has a radius from its center point. */
-			double radius;
+			Scalar radius;
 
 			/* Default constructor. The sphere is given a radius of 1.0 and a position in space of (0.0, 0.0, 0.0). 
 			   Material is given default values. */
@@ -32,7 +32,14 @@
 			/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects 
 	  		   this sphere. If it does, returns true and modifies RETURN_INTERSECTION_POINT with the point of intersection. 
 	   		   Otherwise, returns false. */
-			bool checkIntersection(const Vector &point, const Vector &direction, Vector &returnIntersectionPoint) const;
+			bool checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const;
+
+			/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+			   this sphere. If it does, returns true and fills in RETURN_HIT. Otherwise, returns false. */
+			bool intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const;
+
+			/* Places a box enclosing the sphere into RETURN_BOUNDS and returns true. */
+			bool getBounds(BoundingBox &returnBounds) const;
 
 
 			/* Print member function. */
@@ -49,25 +56,32 @@
 		public:
 
 			/* A plane is defined by its position and a normal which defines its orientation. */
-			Vector normal;
+			Direction3 normal;
 
 			/* Default constructor. The plane is given a position in space of (0.0, 0.0, 0.0). 
 			   Material is given default values. */
 			Plane (void);
 
 			/* Constructor. The plane's normal is set to NORMAL and position in space is set to (X, Y, Z). Material is given default values. */
-			Plane (const Vector &normal, double x, double y, double z);
+			Plane (const Direction3 &normal, double x, double y, double z);
 
 			/* Constructor. The plane's normal is set to NORMAL and position in space is set to (X, Y, Z). Material is set to MATERIAL. */
-			Plane (const Vector &normal, double x, double y, double z, Material material);
+			Plane (const Direction3 &normal, double x, double y, double z, Material material);
 
 			/* Returns the color of the plane at POINT. */
-			Color getColor(const Vector &point) const;
+			Color getColor(const Point3 &point) const;
+
+			/* Returns the plane's normal, which is the same at every POINT on it. */
+			Direction3 getNormal(const Point3 &point) const;
 
 			/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects 
 	  		   this plane. If it does, returns true and modifies RETURN_INTERSECTION_POINT with the point of intersection. 
 	   		   Otherwise, returns false. */
-			bool checkIntersection(const Vector &point, const Vector &direction, Vector &returnIntersectionPoint) const;
+			bool checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const;
+
+			/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+			   this plane. If it does, returns true and fills in RETURN_HIT. Otherwise, returns false. */
+			bool intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const;
 
 
 			/* Print member function. */
@@ -79,23 +93,63 @@
 
 	/* A triangle. Member functions are defined in geometry.cpp. */
 	class Triangle : public SceneObject {
-	
-		public:
 
-			/* A triangle has 3 vertices. */
-			Vector vertex0;
-			Vector vertex1;
-			Vector vertex2;
+		protected:
+
+			/* A triangle has 3 vertices. They are only changed through setVertices(), so that what is worked out
+			   from them below is never out of date. */
+			Point3 vertex0;
+			Point3 vertex1;
+			Point3 vertex2;
+
+			/* Edges from vertex0 to the other two corners, which every intersection test needs. */
+			Direction3 edge1;
+			Direction3 edge2;
+
+			/* Unit normal, the normalized cross product of the edges, and the plane the triangle lies in: the points
+			   whose dot product with the unit normal is PLANE_OFFSET. */
+			Direction3 unitNormal;
+			Scalar planeOffset;
+
+			/* Works out the edges, normal and plane from the vertices. */
+			void precompute(void);
+
+		public:
 
 			/* Default constructor. */
 			Triangle (void);
 
+			/* Sets the triangle's corners to VERTEX_0, VERTEX_1 and VERTEX_2, and works out its edges, normal and plane again. */
+			void setVertices(const Point3 &vertex0, const Point3 &vertex1, const Point3 &vertex2);
+
+			/* Returns corner I of the triangle, which is 0, 1 or 2. */
+			const Point3& getVertex(int i) const;
+
+			/* Returns the edge from corner 0 to corner 1, or to corner 2. */
+			const Direction3& getEdge1(void) const;
+			const Direction3& getEdge2(void) const;
+
+			/* Returns the distance from POINT to the plane the triangle lies in. */
+			double getPlaneDistance(const Point3 &point) const;
+
 			/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects 
 	  		   this triangle. If it does, returns true and modifies RETURN_INTERSECTION_POINT with the point of intersection. 
 	   		   Otherwise, returns false. */
-			bool checkIntersection(const Vector &point, const Vector &direction, Vector &returnIntersectionPoint) const;
+			bool checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const;
+
+			/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+			   this triangle. If it does, returns true and fills in RETURN_HIT. U and V are the barycentric coordinates of the point. Otherwise, returns false. */
+			bool intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const;
+
+			/* Returns the triangle's unit normal, which is the same at every POINT on it. */
+			Direction3 getNormal(const Point3 &point) const;
+
+			/* Places a box enclosing the triangle's vertices into RETURN_BOUNDS and returns true. */
+			bool getBounds(BoundingBox &returnBounds) const;
 
-			Vector getNormal(const Vector &point) const;
+			/* Clips the triangle to BOX, places a box enclosing what is left into RETURN_BOUNDS, and returns true if
+			   anything is left. Much tighter than the overlap of the boxes for long triangles lying across BOX. */
+			bool getClippedBounds(const BoundingBox &box, BoundingBox &returnBounds) const;
 
 			/* Print member function. */
 			void print (ostream *os) const;
@@ -0,0 +1,484 @@
+/* Contains definitions for uniform and two-level grids, walked by a ray with a 3D digital differential analyzer (DDA)
+   following Amanatides and Woo, "A Fast Voxel Traversal Algorithm for Ray Tracing". */
+
+#include <vector> /* STL vector. */
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cfloat>
+#include <cmath>
+
+#include "grid.h"
+#include "accelerator.h"
+#include "boundingbox.h"
+#include "parallel.h"
+#include "sceneobject.h"
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+using namespace std;
+
+
+/* Cells per object in a single grid, and in each grid dividing a cell of a two-level grid. */
+#define GRID_DENSITY 2.0
+
+/* Cells per object in the top level of a two-level grid. */
+#define GRID_TOP_DENSITY 0.125
+
+/* Cells of a two-level grid's top level holding more objects than this are divided by a grid of their own. */
+#define GRID_SUBGRID_THRESHOLD 8
+
+/* Most cells along any axis of one level. */
+#define GRID_MAX_RESOLUTION 512
+
+
+
+/*
+----------------------
+    Building.
+----------------------
+*/
+
+
+/* Sets up the bounds and resolution of LEVEL to divide BOUNDS into about DENSITY cells for each of OBJECT_COUNT objects.
+   The cells are as close to cubes as the box allows. */
+static void initLevel(GridLevel &level, const BoundingBox &bounds, unsigned int objectCount, double density) {
+    level.bounds = bounds;
+
+    double maxExtent = 0.0;
+    for (int axis = 0; axis < 3; axis++) {
+        maxExtent = max(maxExtent, bounds.upper[axis] - bounds.lower[axis]);
+    }
+
+    /* Cells along the longest axis for cubic cells, if the box were a cube. */
+    double cellsPerUnit = cbrt(density * objectCount) / maxExtent;
+
+    for (int axis = 0; axis < 3; axis++) {
+        double extent = bounds.upper[axis] - bounds.lower[axis];
+        int resolution = (int)floor(extent * cellsPerUnit + 0.5);
+
+        level.resolution[axis] = min(max(resolution, 1), GRID_MAX_RESOLUTION);
+        level.cellSize[axis] = extent / level.resolution[axis];
+    }
+
+    level.subgrids.clear();
+}
+
+
+/* Returns the number of cells in LEVEL. */
+static unsigned int getLevelCellCount(const GridLevel &level) {
+    return level.resolution[0] * level.resolution[1] * level.resolution[2];
+}
+
+
+/* Finds the range of cells of LEVEL that BOX overlaps, as the lowest cell LOWER and the highest cell UPPER along each axis. */
+static void findCellRange(const GridLevel &level, const BoundingBox &box, int lower[3], int upper[3]) {
+    for (int axis = 0; axis < 3; axis++) {
+        int last = level.resolution[axis] - 1;
+
+        int low = (int)floor((box.lower[axis] - level.bounds.lower[axis]) / level.cellSize[axis]);
+        int high = (int)floor((box.upper[axis] - level.bounds.lower[axis]) / level.cellSize[axis]);
+
+        lower[axis] = min(max(low, 0), last);
+        upper[axis] = min(max(high, 0), last);
+    }
+}
+
+
+/* Everything the parallel stages of building a grid level read and write. */
+struct GridBuild {
+    GridLevel *level;
+
+    /* Padded box of every object in the scene, and the indices of the objects to place in the level. */
+    const vector <BoundingBox> *boxes;
+    const vector <unsigned int> *indices;
+
+    /* Number of objects in each cell, then the next free place in cellObjects for each cell. */
+    atomic <unsigned int> *cellCounts;
+};
+
+
+/* Counts the objects overlapping each cell. */
+static void countCellObjects(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    GridBuild &build = *(GridBuild *)context;
+    const GridLevel &level = *build.level;
+
+    for (unsigned int i = begin; i < end; i++) {
+        int lower [3], upper [3];
+        findCellRange(level, (*build.boxes)[(*build.indices)[i]], lower, upper);
+
+        for (int z = lower[2]; z <= upper[2]; z++) {
+            for (int y = lower[1]; y <= upper[1]; y++) {
+                for (int x = lower[0]; x <= upper[0]; x++) {
+                    unsigned int cell = x + level.resolution[0]*(y + level.resolution[1]*z);
+                    build.cellCounts[cell].fetch_add(1, memory_order_relaxed);
+                }
+            }
+        }
+    }
+}
+
+
+/* Writes each object into the list of every cell it overlaps. */
+static void fillCells(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    GridBuild &build = *(GridBuild *)context;
+    GridLevel &level = *build.level;
+
+    for (unsigned int i = begin; i < end; i++) {
+        unsigned int index = (*build.indices)[i];
+
+        int lower [3], upper [3];
+        findCellRange(level, (*build.boxes)[index], lower, upper);
+
+        for (int z = lower[2]; z <= upper[2]; z++) {
+            for (int y = lower[1]; y <= upper[1]; y++) {
+                for (int x = lower[0]; x <= upper[0]; x++) {
+                    unsigned int cell = x + level.resolution[0]*(y + level.resolution[1]*z);
+                    level.cellObjects[build.cellCounts[cell].fetch_add(1, memory_order_relaxed)] = index;
+                }
+            }
+        }
+    }
+}
+
+
+/* Sorts the objects of each cell, since threads write them in no particular order. */
+static void sortCells(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    GridBuild &build = *(GridBuild *)context;
+    GridLevel &level = *build.level;
+
+    for (unsigned int cell = begin; cell < end; cell++) {
+        sort(level.cellObjects.begin() + level.cellStarts[cell], level.cellObjects.begin() + level.cellStarts[cell+1]);
+    }
+}
+
+
+/* Places the objects at INDICES into the cells of LEVEL they overlap, in parallel if PARALLEL is true.
+   BOXES holds the padded box of every object in the scene. */
+static void fillLevel(GridLevel &level, const vector <BoundingBox> &boxes, const vector <unsigned int> &indices, bool parallel) {
+    unsigned int cellCount = getLevelCellCount(level);
+
+    GridBuild build;
+    build.level = &level;
+    build.boxes = &boxes;
+    build.indices = &indices;
+    build.cellCounts = new atomic <unsigned int> [cellCount];
+
+    for (unsigned int i = 0; i < cellCount; i++) {
+        build.cellCounts[i].store(0, memory_order_relaxed);
+    }
+
+    if (parallel) {
+        parallelFor(indices.size(), countCellObjects, &build);
+    }
+    else {
+        countCellObjects(&build, 0, 0, indices.size());
+    }
+
+    /* Turn the counts into the place each cell's list starts. */
+    level.cellStarts.resize(cellCount + 1);
+
+    unsigned int total = 0;
+    for (unsigned int i = 0; i < cellCount; i++) {
+        level.cellStarts[i] = total;
+        total += build.cellCounts[i].load(memory_order_relaxed);
+        build.cellCounts[i].store(level.cellStarts[i], memory_order_relaxed);
+    }
+    level.cellStarts[cellCount] = total;
+
+    level.cellObjects.resize(total);
+
+    if (parallel) {
+        parallelFor(indices.size(), fillCells, &build);
+        parallelFor(cellCount, sortCells, &build);
+    }
+    else {
+        fillCells(&build, 0, 0, indices.size());
+        sortCells(&build, 0, 0, cellCount);
+    }
+
+    delete [] build.cellCounts;
+}
+
+
+/* Everything needed to divide the crowded cells of a two-level grid in parallel. */
+struct SubgridBuild {
+    const GridLevel *top;
+    const vector <BoundingBox> *boxes;
+
+    /* The top-level cell each subgrid divides, and the subgrids. */
+    vector <unsigned int> cells;
+    vector <GridLevel> *subgrids;
+};
+
+
+/* Builds the grid dividing each crowded cell over the cell's objects. */
+static void buildSubgrids(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    SubgridBuild &build = *(SubgridBuild *)context;
+    const GridLevel &top = *build.top;
+
+    for (unsigned int i = begin; i < end; i++) {
+        unsigned int cell = build.cells[i];
+        int x = cell % top.resolution[0];
+        int y = (cell / top.resolution[0]) % top.resolution[1];
+        int z = cell / (top.resolution[0] * top.resolution[1]);
+
+        vector <unsigned int> indices (top.cellObjects.begin() + top.cellStarts[cell], top.cellObjects.begin() + top.cellStarts[cell+1]);
+
+        /* The subgrid only needs to cover the part of the cell its objects reach. */
+        BoundingBox objectBounds = getEmptyBoundingBox();
+        for (unsigned int j = 0; j < indices.size(); j++) {
+            expand(objectBounds, (*build.boxes)[indices[j]]);
+        }
+
+        BoundingBox bounds;
+        int position [3] = {x, y, z};
+
+        for (int axis = 0; axis < 3; axis++) {
+            double cellLower = top.bounds.lower[axis] + position[axis] * top.cellSize[axis];
+            double cellUpper = (position[axis] == top.resolution[axis] - 1) ? top.bounds.upper[axis] : cellLower + top.cellSize[axis];
+
+            bounds.lower[axis] = max(cellLower, objectBounds.lower[axis]);
+            bounds.upper[axis] = min(cellUpper, objectBounds.upper[axis]);
+        }
+
+        GridLevel &subgrid = (*build.subgrids)[i];
+        initLevel(subgrid, bounds, indices.size(), GRID_DENSITY);
+        fillLevel(subgrid, *build.boxes, indices, false);
+    }
+}
+
+
+
+/*
+----------------------
+    Grid methods.
+----------------------
+*/
+
+
+/* Constructor. Makes a two-level grid if TWO_LEVEL is true, and a single grid otherwise. The grid is empty
+   until build() is called. */
+Grid::Grid (bool twoLevel) {
+    this->twoLevel = twoLevel;
+
+    top.resolution[0] = top.resolution[1] = top.resolution[2] = 0;
+}
+
+
+/* Builds the grid over OBJECTS, replacing anything built before. */
+void Grid::build(const vector <SceneObject *> &objects) {
+
+    setObjects(objects);
+
+    top.cellStarts.clear();
+    top.cellObjects.clear();
+    top.subgrids.clear();
+    top.resolution[0] = top.resolution[1] = top.resolution[2] = 0;
+    subgrids.clear();
+    unboundedIndices.clear();
+
+    /* Gather the boxes of the objects with bounds, and set aside those without. */
+    vector <BoundingBox> boxes (objects.size());
+    vector <unsigned int> indices;
+    BoundingBox bounds = getEmptyBoundingBox();
+
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        if (!objects[i]->getBounds(boxes[i])) {
+            unboundedIndices.push_back(scene.getRef(i));
+            continue;
+        }
+
+        pad(boxes[i]);
+        expand(bounds, boxes[i]);
+        indices.push_back(i);
+    }
+
+    if (indices.empty()) {
+        return;
+    }
+
+    initLevel(top, bounds, indices.size(), twoLevel ? GRID_TOP_DENSITY : GRID_DENSITY);
+    fillLevel(top, boxes, indices, true);
+
+    if (!twoLevel) {
+        compileIndices(top.cellObjects);
+        return;
+    }
+
+    /* Divide the crowded cells further. */
+    unsigned int cellCount = getLevelCellCount(top);
+    top.subgrids.resize(cellCount, -1);
+
+    SubgridBuild build;
+    build.top = &top;
+    build.boxes = &boxes;
+    build.subgrids = &subgrids;
+
+    for (unsigned int cell = 0; cell < cellCount; cell++) {
+        if (top.cellStarts[cell+1] - top.cellStarts[cell] > GRID_SUBGRID_THRESHOLD) {
+            top.subgrids[cell] = build.cells.size();
+            build.cells.push_back(cell);
+        }
+    }
+
+    subgrids.resize(build.cells.size());
+    parallelFor(build.cells.size(), buildSubgrids, &build);
+
+    compileIndices(top.cellObjects);
+    for (unsigned int i = 0; i < subgrids.size(); i++) {
+        compileIndices(subgrids[i].cellObjects);
+    }
+}
+
+
+/* Searches the objects without bounds, then the grid, for the closest intersection with the ray, narrowing CLOSEST
+   as closer intersections are found. Objects farther away than CLOSEST may be skipped. */
+void Grid::findClosest(const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+
+    for (unsigned int i = 0; i < unboundedIndices.size(); i++) {
+        testPrimitive(unboundedIndices[i], rayStartPoint, rayDirection, closest);
+    }
+
+    if (!top.cellStarts.empty()) {
+        traverseLevel(top, rayStartPoint, rayDirection, 0.0, DBL_MAX, closest);
+    }
+}
+
+
+/* Walks the ray through the cells of LEVEL between ray parameters T_START and T_END, narrowing CLOSEST as
+   closer intersections are found. Stops once no object in a cell still to come could be closer than CLOSEST. */
+void Grid::traverseLevel(const GridLevel &level, const Point3 &rayStartPoint, const Direction3 &rayDirection,
+                         double tStart, double tEnd, Intersection &closest) const {
+
+    double origin [3];
+    double direction [3];
+
+    for (int axis = 0; axis < 3; axis++) {
+        origin[axis] = rayStartPoint.getEntry(axis);
+        direction[axis] = rayDirection.getEntry(axis);
+    }
+
+    /* Clip the ray to the level's box. */
+    for (int axis = 0; axis < 3; axis++) {
+        if (direction[axis] == 0.0) {
+            if (origin[axis] < level.bounds.lower[axis] || origin[axis] > level.bounds.upper[axis]) {
+                return;
+            }
+            continue;
+        }
+
+        double t0 = (level.bounds.lower[axis] - origin[axis]) / direction[axis];
+        double t1 = (level.bounds.upper[axis] - origin[axis]) / direction[axis];
+
+        if (t0 > t1) {
+            double temp = t0; t0 = t1; t1 = temp;
+        }
+
+        tStart = max(tStart, t0);
+        tEnd = min(tEnd, t1);
+    }
+
+    if (tStart > tEnd || tStart > getMaxT(closest)) {
+        return;
+    }
+
+    /* Find the cell the ray starts in, and the parameter at which it crosses into the next cell along each axis. */
+    int cell [3];
+    int step [3];
+    double tNext [3];
+
+    for (int axis = 0; axis < 3; axis++) {
+        double position = origin[axis] + direction[axis] * tStart;
+        int index = (int)floor((position - level.bounds.lower[axis]) / level.cellSize[axis]);
+
+        cell[axis] = min(max(index, 0), level.resolution[axis] - 1);
+
+        if (direction[axis] > 0.0) {
+            step[axis] = 1;
+            tNext[axis] = (level.bounds.lower[axis] + (cell[axis] + 1) * level.cellSize[axis] - origin[axis]) / direction[axis];
+        }
+        else if (direction[axis] < 0.0) {
+            step[axis] = -1;
+            tNext[axis] = (level.bounds.lower[axis] + cell[axis] * level.cellSize[axis] - origin[axis]) / direction[axis];
+        }
+        else {
+            step[axis] = 0;
+            tNext[axis] = DBL_MAX;
+        }
+    }
+
+    double tCellStart = tStart;
+
+    while (true) {
+        /* The axis along which the ray leaves the cell first. */
+        int exitAxis = 0;
+        if (tNext[1] < tNext[exitAxis]) {
+            exitAxis = 1;
+        }
+        if (tNext[2] < tNext[exitAxis]) {
+            exitAxis = 2;
+        }
+
+        double tCellEnd = min(tNext[exitAxis], tEnd);
+        unsigned int index = cell[0] + level.resolution[0]*(cell[1] + level.resolution[1]*cell[2]);
+
+        if (!level.subgrids.empty() && level.subgrids[index] >= 0) {
+            traverseLevel(subgrids[level.subgrids[index]], rayStartPoint, rayDirection, tCellStart, tCellEnd, closest);
+        }
+        else {
+            testPrimitives(level.cellObjects.data() + level.cellStarts[index], level.cellStarts[index+1] - level.cellStarts[index],
+                           rayStartPoint, rayDirection, closest);
+        }
+
+        /* An object in a later cell could only be closer if the closest one found so far is past this cell. Every
+           object overlapping this cell or an earlier one has been tested already, and the hit lies inside the object's box. */
+        if (getMaxT(closest) < tCellEnd || tCellEnd >= tEnd) {
+            return;
+        }
+
+        cell[exitAxis] += step[exitAxis];
+        if (cell[exitAxis] < 0 || cell[exitAxis] >= level.resolution[exitAxis]) {
+            return;
+        }
+
+        tCellStart = tCellEnd;
+        tNext[exitAxis] = (level.bounds.lower[exitAxis] + (cell[exitAxis] + (step[exitAxis] > 0 ? 1 : 0)) * level.cellSize[exitAxis] - origin[exitAxis]) /
+                          direction[exitAxis];
+    }
+}
+
+
+/* Returns the number of bytes taken up by the cells of LEVEL. */
+static size_t getLevelMemoryUsage(const GridLevel &level) {
+    return sizeof(GridLevel) + (level.cellStarts.capacity() + level.cellObjects.capacity())*sizeof(unsigned int) +
+           level.subgrids.capacity()*sizeof(int);
+}
+
+
+/* Returns the number of bytes the grid takes up. */
+size_t Grid::getMemoryUsage(void) const {
+    size_t bytes = sizeof(Grid) - sizeof(GridLevel) + scene.getMemoryUsage() + getLevelMemoryUsage(top) +
+                   unboundedIndices.capacity()*sizeof(unsigned int);
+
+    for (unsigned int i = 0; i < subgrids.size(); i++) {
+        bytes += getLevelMemoryUsage(subgrids[i]);
+    }
+
+    return bytes + (subgrids.capacity() - subgrids.size())*sizeof(GridLevel);
+}
+
+
+/* Returns the number of cells in the grid, counting those of the second level of a two-level grid. */
+unsigned int Grid::getCellCount(void) const {
+    if (top.cellStarts.empty()) {
+        return 0;
+    }
+
+    unsigned int count = getLevelCellCount(top);
+
+    for (unsigned int i = 0; i < subgrids.size(); i++) {
+        count += getLevelCellCount(subgrids[i]);
+    }
+
+    return count;
+}
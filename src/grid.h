@@ -0,0 +1,85 @@
+/* Contains declarations for uniform grids, Accelerators that divide the scene into equally sized cells and walk a ray
+   through the cells it passes, in order, testing only the objects that overlap them. */
+
+#ifndef GRID
+#define GRID
+
+	#include <vector> /* STL vector. */
+	#include "accelerator.h"
+	#include "boundingbox.h"
+	#include "sceneobject.h"
+	#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+	using namespace std;
+
+
+	/* One level of a grid: a box divided into resolution[0] x resolution[1] x resolution[2] cells, each with a list of
+	   the objects overlapping it. Cell (x, y, z) is number x + resolution[0]*(y + resolution[1]*z). */
+	struct GridLevel {
+		/* Box the cells divide up. */
+		BoundingBox bounds;
+
+		/* Number of cells along each axis, and the size of a cell along each axis. */
+		int resolution [3];
+		double cellSize [3];
+
+		/* The objects overlapping cell i are cellObjects[cellStarts[i]] up to, but not including, cellObjects[cellStarts[i+1]],
+		   by their PrimitiveRef, in increasing order of their index in the list the grid was built over. They are object
+		   indices until the build is done. */
+		vector <unsigned int> cellStarts;
+		vector <PrimitiveRef> cellObjects;
+
+		/* For a two-level grid's top level, the index in subgrids of the grid dividing each cell further, or -1 if the
+		   cell's objects are tested directly. Empty otherwise. */
+		vector <int> subgrids;
+	};
+
+
+	/* A uniform grid, with about two cells for every object, so that each cell only holds a few. Building one is a
+	   couple of passes over the objects, all in parallel, which is much faster than building a BVH. It works best for
+	   objects of similar size spread evenly through the scene, such as particles.
+
+	   A two-level grid has a coarse top level with a few objects per cell, and divides each crowded cell with a grid of
+	   its own, so that scenes with dense clusters and empty space don't need fine cells everywhere. */
+	class Grid : public Accelerator {
+
+		protected:
+			/* True for a two-level grid. */
+			bool twoLevel;
+
+			/* The grid, or the top level of a two-level grid. */
+			GridLevel top;
+
+			/* Grids dividing the crowded cells of a two-level grid's top level. */
+			vector <GridLevel> subgrids;
+
+			/* PrimitiveRefs of the objects without bounds, which are tested against every ray. */
+			vector <PrimitiveRef> unboundedIndices;
+
+
+			/* Walks the ray through the cells of LEVEL between ray parameters T_START and T_END, narrowing CLOSEST as
+			   closer intersections are found. Stops once no object in a cell still to come could be closer than CLOSEST. */
+			void traverseLevel(const GridLevel &level, const Point3 &rayStartPoint, const Direction3 &rayDirection,
+			                   double tStart, double tEnd, Intersection &closest) const;
+
+			/* Searches the objects without bounds, then the grid, for the closest intersection with the ray, narrowing CLOSEST
+			   as closer intersections are found. Objects farther away than CLOSEST may be skipped. */
+			void findClosest(const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+		public:
+			/* Constructor. Makes a two-level grid if TWO_LEVEL is true, and a single grid otherwise. The grid is empty
+			   until build() is called. */
+			Grid (bool twoLevel);
+
+			/* Builds the grid over OBJECTS, replacing anything built before. */
+			void build(const vector <SceneObject *> &objects);
+
+			/* Returns the number of bytes the grid takes up. */
+			size_t getMemoryUsage(void) const;
+
+			/* Returns the number of cells in the grid, counting those of the second level of a two-level grid. */
+			unsigned int getCellCount(void) const;
+	};
+
+
+#endif
@@ -0,0 +1,436 @@
+/* Contains definitions for a kd-tree built with the surface area heuristic, traversed without a stack by following
+   ropes between neighboring leaves, following Havran, "Heuristic Ray Shooting Algorithms", and Popov et al.,
+   "Stackless KD-Tree Traversal for High Performance GPU Ray Tracing". */
+
+#include <vector> /* STL vector. */
+#include <algorithm>
+#include <climits>
+#include <cfloat>
+#include <cmath>
+
+#include "kdtree.h"
+#include "accelerator.h"
+#include "boundingbox.h"
+#include "sceneobject.h"
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+using namespace std;
+
+
+/* Cost of stepping through a node, and of testing a ray against an object, for the surface area heuristic. */
+#define KD_TRAVERSAL_COST 1.0
+#define KD_INTERSECTION_COST 1.5
+
+/* Fraction taken off the cost of a split that cuts off empty space, since rays cross empty leaves cheaply. */
+#define KD_EMPTY_BONUS 0.2
+
+/* Nodes over this many objects or fewer are always made leaves. */
+#define KD_MAX_LEAF_SIZE 1
+
+/* Marks a leaf in KDNode::axis. */
+#define KD_LEAF_AXIS 3
+
+
+
+/*
+----------------------
+    Building.
+----------------------
+*/
+
+
+/* A side of an object's box, clipped to a node's space, along the axis a split is being looked for on. */
+struct KDEvent {
+    double position;
+
+    /* 0 where the box ends, 1 where it starts, so that ends sort first at the same position. */
+    int start;
+
+    bool operator< (const KDEvent &other) const {
+        return (position < other.position) || (position == other.position && start < other.start);
+    }
+};
+
+
+/* Builds the subtree over the objects at INDICES, whose boxes are in BOXES, covering the space BOUNDS,
+   and appends its nodes to the node list. DEPTH is the number of nodes above it, and the subtree is made
+   a leaf once it reaches MAX_DEPTH. */
+void KDTree::buildNode(const vector <BoundingBox> &boxes, vector <unsigned int> &indices, const BoundingBox &bounds, int depth, int maxDepth) {
+
+    unsigned int nodeIndex = nodes.size();
+    unsigned int count = indices.size();
+
+    nodes.push_back(KDNode());
+
+    /* Look for the plane with the lowest cost along every axis. */
+    double bestCost = HUGE_VAL;
+    double bestSplit = 0.0;
+    int bestAxis = -1;
+
+    if (count > KD_MAX_LEAF_SIZE && depth < maxDepth) {
+        double area = surfaceArea(bounds);
+        vector <KDEvent> events (2*count);
+
+        for (int axis = 0; axis < 3; axis++) {
+            if (bounds.upper[axis] <= bounds.lower[axis]) {
+                continue;
+            }
+
+            for (unsigned int i = 0; i < count; i++) {
+                const BoundingBox &box = boxes[indices[i]];
+
+                events[2*i].position = max(box.lower[axis], bounds.lower[axis]);
+                events[2*i].start = 1;
+                events[2*i + 1].position = min(box.upper[axis], bounds.upper[axis]);
+                events[2*i + 1].start = 0;
+            }
+
+            sort(events.begin(), events.end());
+
+            /* Sweep a plane across, keeping count of the objects on each side. */
+            unsigned int leftCount = 0;
+            unsigned int rightCount = count;
+            unsigned int i = 0;
+
+            while (i < events.size()) {
+                double position = events[i].position;
+                unsigned int ending = 0;
+                unsigned int starting = 0;
+
+                while (i < events.size() && events[i].position == position && !events[i].start) {
+                    ending++;
+                    i++;
+                }
+                while (i < events.size() && events[i].position == position) {
+                    starting++;
+                    i++;
+                }
+
+                /* Boxes ending at the plane only go left, and boxes starting at it only go right. */
+                rightCount -= ending;
+
+                if (position > bounds.lower[axis] && position < bounds.upper[axis]) {
+                    BoundingBox left = bounds;
+                    BoundingBox right = bounds;
+                    left.upper[axis] = position;
+                    right.lower[axis] = position;
+
+                    double cost = KD_TRAVERSAL_COST + KD_INTERSECTION_COST * (surfaceArea(left)*leftCount + surfaceArea(right)*rightCount) / area;
+                    if (leftCount == 0 || rightCount == 0) {
+                        cost *= 1.0 - KD_EMPTY_BONUS;
+                    }
+
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestSplit = position;
+                        bestAxis = axis;
+                    }
+                }
+
+                leftCount += starting;
+            }
+        }
+    }
+
+    /* Make a leaf if no split is cheaper than testing every object. */
+    if (bestAxis < 0 || bestCost >= KD_INTERSECTION_COST * count) {
+        KDLeaf leaf;
+        leaf.bounds = bounds;
+        leaf.offset = primitiveIndices.size();
+        leaf.primitiveCount = count;
+
+        for (int i = 0; i < 6; i++) {
+            leaf.ropes[i] = KD_NO_NODE;
+        }
+
+        primitiveIndices.insert(primitiveIndices.end(), indices.begin(), indices.end());
+
+        nodes[nodeIndex].axis = KD_LEAF_AXIS;
+        nodes[nodeIndex].split = 0.0;
+        nodes[nodeIndex].leaf = leaves.size();
+        leaves.push_back(leaf);
+        return;
+    }
+
+    /* Objects crossing the plane go on both sides. */
+    vector <unsigned int> leftIndices, rightIndices;
+
+    for (unsigned int i = 0; i < count; i++) {
+        const BoundingBox &box = boxes[indices[i]];
+        double lower = max(box.lower[bestAxis], bounds.lower[bestAxis]);
+        double upper = min(box.upper[bestAxis], bounds.upper[bestAxis]);
+
+        if (lower < bestSplit || upper <= bestSplit) {
+            leftIndices.push_back(indices[i]);
+        }
+        if (upper > bestSplit) {
+            rightIndices.push_back(indices[i]);
+        }
+    }
+
+    /* The parent's list isn't needed any more, so free it before going deeper. */
+    vector <unsigned int>().swap(indices);
+
+    BoundingBox leftBounds = bounds;
+    BoundingBox rightBounds = bounds;
+    leftBounds.upper[bestAxis] = bestSplit;
+    rightBounds.lower[bestAxis] = bestSplit;
+
+    nodes[nodeIndex].axis = bestAxis;
+    nodes[nodeIndex].split = bestSplit;
+
+    buildNode(boxes, leftIndices, leftBounds, depth+1, maxDepth);
+    nodes[nodeIndex].right = nodes.size();
+    buildNode(boxes, rightIndices, rightBounds, depth+1, maxDepth);
+}
+
+
+/* Gives every leaf below NODE_INDEX, which covers the space BOUNDS, its ropes, given the ropes of NODE_INDEX
+   in ROPES. */
+void KDTree::setRopes(unsigned int nodeIndex, const BoundingBox &bounds, unsigned int ropes[6]) {
+
+    /* Point each rope at the smallest subtree that still covers everything across its side, so rays following
+       it have less far to walk down. */
+    for (int side = 0; side < 6; side++) {
+        int sideAxis = side / 2;
+        bool upperSide = (side % 2) == 1;
+
+        while (ropes[side] != KD_NO_NODE && nodes[ropes[side]].axis != KD_LEAF_AXIS) {
+            const KDNode &node = nodes[ropes[side]];
+            unsigned int left = ropes[side] + 1;
+
+            if ((int)node.axis == sideAxis) {
+                /* The plane is parallel to the side, so only the child next to the side touches it. */
+                if (upperSide) {
+                    ropes[side] = (node.split <= bounds.upper[sideAxis]) ? node.right : left;
+                }
+                else {
+                    ropes[side] = (node.split >= bounds.lower[sideAxis]) ? left : node.right;
+                }
+            }
+            else if (bounds.upper[node.axis] <= node.split) {
+                ropes[side] = left;
+            }
+            else if (bounds.lower[node.axis] >= node.split) {
+                ropes[side] = node.right;
+            }
+            else {
+                break;
+            }
+        }
+    }
+
+    const KDNode &node = nodes[nodeIndex];
+
+    if (node.axis == KD_LEAF_AXIS) {
+        for (int side = 0; side < 6; side++) {
+            leaves[node.leaf].ropes[side] = ropes[side];
+        }
+        return;
+    }
+
+    int axis = node.axis;
+    unsigned int left = nodeIndex + 1;
+    unsigned int right = node.right;
+
+    BoundingBox leftBounds = bounds;
+    BoundingBox rightBounds = bounds;
+    leftBounds.upper[axis] = node.split;
+    rightBounds.lower[axis] = node.split;
+
+    unsigned int leftRopes [6], rightRopes [6];
+    for (int side = 0; side < 6; side++) {
+        leftRopes[side] = ropes[side];
+        rightRopes[side] = ropes[side];
+    }
+    leftRopes[2*axis + 1] = right;
+    rightRopes[2*axis] = left;
+
+    setRopes(left, leftBounds, leftRopes);
+    setRopes(right, rightBounds, rightRopes);
+}
+
+
+
+/*
+----------------------
+    KDTree methods.
+----------------------
+*/
+
+
+/* Default constructor. The kd-tree is empty until build() is called. */
+KDTree::KDTree (void) {
+    bounds = getEmptyBoundingBox();
+}
+
+
+/* Builds the kd-tree over OBJECTS, replacing anything built before. */
+void KDTree::build(const vector <SceneObject *> &objects) {
+
+    setObjects(objects);
+
+    nodes.clear();
+    leaves.clear();
+    primitiveIndices.clear();
+    unboundedIndices.clear();
+    bounds = getEmptyBoundingBox();
+
+    /* Gather the boxes of the objects with bounds, and set aside those without. */
+    vector <BoundingBox> boxes (objects.size());
+    vector <unsigned int> indices;
+
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        if (!objects[i]->getBounds(boxes[i])) {
+            unboundedIndices.push_back(scene.getRef(i));
+            continue;
+        }
+
+        pad(boxes[i]);
+        expand(bounds, boxes[i]);
+        indices.push_back(i);
+    }
+
+    if (indices.empty()) {
+        return;
+    }
+
+    /* The usual depth limit for a kd-tree, from Pharr and Humphreys, "Physically Based Rendering". */
+    int maxDepth = (int)(8 + 1.3 * log2((double)indices.size()));
+
+    buildNode(boxes, indices, bounds, 0, maxDepth);
+    compileIndices(primitiveIndices);
+
+    unsigned int ropes [6];
+    for (int side = 0; side < 6; side++) {
+        ropes[side] = KD_NO_NODE;
+    }
+
+    setRopes(0, bounds, ropes);
+}
+
+
+/* Walks down from NODE_INDEX to the leaf holding POINT, and returns the leaf's node. Points on a split plane
+   go to the side DIRECTION points into. */
+unsigned int KDTree::findLeaf(unsigned int nodeIndex, const double point[3], const double direction[3]) const {
+
+    while (nodes[nodeIndex].axis != KD_LEAF_AXIS) {
+        const KDNode &node = nodes[nodeIndex];
+        double coordinate = point[node.axis];
+
+        if (coordinate < node.split || (coordinate == node.split && direction[node.axis] <= 0.0)) {
+            nodeIndex = nodeIndex + 1;
+        }
+        else {
+            nodeIndex = node.right;
+        }
+    }
+
+    return nodeIndex;
+}
+
+
+/* Searches the objects without bounds, then the leaves the ray passes, in order, for the closest intersection with
+   the ray, narrowing CLOSEST as closer intersections are found. Objects farther away than CLOSEST may be skipped. */
+void KDTree::findClosest(const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+
+    for (unsigned int i = 0; i < unboundedIndices.size(); i++) {
+        testPrimitive(unboundedIndices[i], rayStartPoint, rayDirection, closest);
+    }
+
+    double origin [3];
+    double direction [3];
+
+    for (int axis = 0; axis < 3; axis++) {
+        origin[axis] = rayStartPoint.getEntry(axis);
+        direction[axis] = rayDirection.getEntry(axis);
+    }
+
+    /* Clip the ray to the tree's box. */
+    double tStart = 0.0;
+    double tEnd = DBL_MAX;
+    bool inside = !nodes.empty() && (direction[0] != 0.0 || direction[1] != 0.0 || direction[2] != 0.0);
+
+    for (int axis = 0; axis < 3 && inside; axis++) {
+        if (direction[axis] == 0.0) {
+            inside = (origin[axis] >= bounds.lower[axis] && origin[axis] <= bounds.upper[axis]);
+            continue;
+        }
+
+        double t0 = (bounds.lower[axis] - origin[axis]) / direction[axis];
+        double t1 = (bounds.upper[axis] - origin[axis]) / direction[axis];
+
+        if (t0 > t1) {
+            double temp = t0; t0 = t1; t1 = temp;
+        }
+
+        tStart = max(tStart, t0);
+        tEnd = min(tEnd, t1);
+    }
+
+    if (inside && tStart <= tEnd && tStart <= getMaxT(closest)) {
+        double point [3];
+
+        for (int axis = 0; axis < 3; axis++) {
+            point[axis] = min(max(origin[axis] + direction[axis] * tStart, bounds.lower[axis]), bounds.upper[axis]);
+        }
+
+        unsigned int nodeIndex = findLeaf(0, point, direction);
+
+        while (true) {
+            const KDLeaf &leaf = leaves[nodes[nodeIndex].leaf];
+
+            testPrimitives(primitiveIndices.data() + leaf.offset, leaf.primitiveCount, rayStartPoint, rayDirection, closest);
+
+            /* Find the side the ray leaves the leaf by. */
+            double tExit = DBL_MAX;
+            int exitAxis = -1;
+
+            for (int axis = 0; axis < 3; axis++) {
+                if (direction[axis] == 0.0) {
+                    continue;
+                }
+
+                double side = (direction[axis] > 0.0) ? leaf.bounds.upper[axis] : leaf.bounds.lower[axis];
+                double t = (side - origin[axis]) / direction[axis];
+
+                if (t < tExit) {
+                    tExit = t;
+                    exitAxis = axis;
+                }
+            }
+
+            /* Every object overlapping this leaf or an earlier one has been tested, and a hit lies inside the
+               object's box, so an object in a later leaf could only be closer if the closest one is past this leaf. */
+            if (exitAxis < 0 || tExit >= tEnd || getMaxT(closest) < tExit) {
+                break;
+            }
+
+            int exitSide = 2*exitAxis + ((direction[exitAxis] > 0.0) ? 1 : 0);
+            if (leaf.ropes[exitSide] == KD_NO_NODE) {
+                break;
+            }
+
+            /* Put the point exactly on the side so it lands across it. */
+            for (int axis = 0; axis < 3; axis++) {
+                point[axis] = origin[axis] + direction[axis] * tExit;
+            }
+            point[exitAxis] = (exitSide % 2 == 1) ? leaf.bounds.upper[exitAxis] : leaf.bounds.lower[exitAxis];
+
+            nodeIndex = findLeaf(leaf.ropes[exitSide], point, direction);
+        }
+    }
+}
+
+
+/* Returns the number of bytes the kd-tree takes up. */
+size_t KDTree::getMemoryUsage(void) const {
+    return sizeof(KDTree) + scene.getMemoryUsage() + nodes.capacity()*sizeof(KDNode) + leaves.capacity()*sizeof(KDLeaf) +
+           (primitiveIndices.capacity() + unboundedIndices.capacity())*sizeof(unsigned int);
+}
+
+
+/* Returns the number of leaves in the tree. */
+unsigned int KDTree::getLeafCount(void) const {
+    return leaves.size();
+}
@@ -0,0 +1,1205 @@
+/* Contains definitions for kernels that test rays against batches of primitives with SIMD instructions.
+
+   Each kernel follows the steps of the scalar code it stands in for, operation for operation and in the same order,
+   so that every lane rounds exactly as the scalar code would and the results are the same to the last bit. Neither
+   path may use fused multiply-adds, which round once where the scalar code rounds twice. */
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "kernels.h"
+#include "cpu.h"
+
+using namespace std;
+
+
+
+/*
+----------------------
+    Spheres.
+----------------------
+*/
+
+
+/* Returns the ray parameter at which the ray along (DIRECTION_X, DIRECTION_Y, DIRECTION_Z) meets the sphere of radius
+   RADIUS, where (S_X, S_Y, S_Z) is the ray's start relative to the sphere's center, or KERNEL_MISS if it doesn't. These
+   are the steps of Sphere::intersect(): only the nearer root is used, so a ray starting inside the sphere misses it. */
+static Scalar solveSphere(Scalar sX, Scalar sY, Scalar sZ, Scalar directionX, Scalar directionY, Scalar directionZ, Scalar radius) {
+
+    /* Coefficients of the quadratic formula. */
+    Scalar a = directionX*directionX + directionY*directionY + directionZ*directionZ;
+    Scalar b = 2 * (sX*directionX + sY*directionY + sZ*directionZ);
+    Scalar c = (sX*sX + sY*sY + sZ*sZ) - (radius * radius);
+
+    Scalar discriminant = b*b - 4*a*c;
+
+    if (discriminant < 0) {
+        return KERNEL_MISS;
+    }
+
+    Scalar t = (-b - sqrt(discriminant)) / (2*a);
+
+    /* A NaN root, from a zero direction, misses too. */
+    return (t >= 0) ? t : KERNEL_MISS;
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* Returns a mask for loading and storing the first COUNT of four doubles, for COUNT from 0 to 4. */
+__attribute__((target("avx2")))
+static inline __m256i getLaneMask(unsigned int count) {
+    return _mm256_cmpgt_epi64(_mm256_set1_epi64x(count), _mm256_setr_epi64x(0, 1, 2, 3));
+}
+
+
+/* Returns a mask for the first COUNT of eight doubles, for COUNT from 0 to 8. */
+static inline unsigned char getLaneMask8(unsigned int count) {
+    return (unsigned char)((1u << count) - 1);
+}
+
+#endif
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(SINGLE_PRECISION)
+
+/* solveSphere() for four spheres, or four rays, at once. The square root of a negative discriminant is NaN, and so
+   is the root, which fails the final comparison just as a root behind the start does. */
+__attribute__((target("avx2")))
+static inline __m256d solveSpheres(__m256d sX, __m256d sY, __m256d sZ, __m256d directionX, __m256d directionY, __m256d directionZ, __m256d radius) {
+    __m256d a = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(directionX, directionX), _mm256_mul_pd(directionY, directionY)), _mm256_mul_pd(directionZ, directionZ));
+    __m256d b = _mm256_mul_pd(_mm256_set1_pd(2.0), _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(sX, directionX), _mm256_mul_pd(sY, directionY)), _mm256_mul_pd(sZ, directionZ)));
+    __m256d c = _mm256_sub_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(sX, sX), _mm256_mul_pd(sY, sY)), _mm256_mul_pd(sZ, sZ)), _mm256_mul_pd(radius, radius));
+
+    __m256d discriminant = _mm256_sub_pd(_mm256_mul_pd(b, b), _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(4.0), a), c));
+
+    /* Flipping the sign bit negates B exactly as the scalar code does, zeros included. */
+    __m256d negativeB = _mm256_xor_pd(b, _mm256_set1_pd(-0.0));
+    __m256d t = _mm256_div_pd(_mm256_sub_pd(negativeB, _mm256_sqrt_pd(discriminant)), _mm256_mul_pd(_mm256_set1_pd(2.0), a));
+
+    return _mm256_blendv_pd(_mm256_set1_pd(KERNEL_MISS), t, _mm256_cmp_pd(t, _mm256_setzero_pd(), _CMP_GE_OQ));
+}
+
+
+/* solveSphere() for two spheres, or two rays, at once. */
+static inline __m128d solveSpheres(__m128d sX, __m128d sY, __m128d sZ, __m128d directionX, __m128d directionY, __m128d directionZ, __m128d radius) {
+    __m128d a = _mm_add_pd(_mm_add_pd(_mm_mul_pd(directionX, directionX), _mm_mul_pd(directionY, directionY)), _mm_mul_pd(directionZ, directionZ));
+    __m128d b = _mm_mul_pd(_mm_set1_pd(2.0), _mm_add_pd(_mm_add_pd(_mm_mul_pd(sX, directionX), _mm_mul_pd(sY, directionY)), _mm_mul_pd(sZ, directionZ)));
+    __m128d c = _mm_sub_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(sX, sX), _mm_mul_pd(sY, sY)), _mm_mul_pd(sZ, sZ)), _mm_mul_pd(radius, radius));
+
+    __m128d discriminant = _mm_sub_pd(_mm_mul_pd(b, b), _mm_mul_pd(_mm_mul_pd(_mm_set1_pd(4.0), a), c));
+
+    __m128d negativeB = _mm_xor_pd(b, _mm_set1_pd(-0.0));
+    __m128d t = _mm_div_pd(_mm_sub_pd(negativeB, _mm_sqrt_pd(discriminant)), _mm_mul_pd(_mm_set1_pd(2.0), a));
+
+    /* SSE2 has no blend, so select with masks. */
+    __m128d hit = _mm_cmpge_pd(t, _mm_setzero_pd());
+    return _mm_or_pd(_mm_and_pd(hit, t), _mm_andnot_pd(hit, _mm_set1_pd(KERNEL_MISS)));
+}
+
+
+/* intersectSpheres() with AVX2, four spheres at a time. The last few are loaded and stored with a mask, and the
+   lanes left over hold a sphere of radius zero at the origin, whose result is thrown away. */
+__attribute__((target("avx2")))
+static void intersectSpheresAVX2(const double rayStart[3], const double rayDirection[3], const double *centerX, const double *centerY,
+                                 const double *centerZ, const double *radius, unsigned int count, double *returnT) {
+    __m256d startX = _mm256_set1_pd(rayStart[0]);
+    __m256d startY = _mm256_set1_pd(rayStart[1]);
+    __m256d startZ = _mm256_set1_pd(rayStart[2]);
+    __m256d directionX = _mm256_set1_pd(rayDirection[0]);
+    __m256d directionY = _mm256_set1_pd(rayDirection[1]);
+    __m256d directionZ = _mm256_set1_pd(rayDirection[2]);
+
+    for (unsigned int i = 0; i < count; i += 4) {
+        __m256i mask = getLaneMask(count - i < 4 ? count - i : 4);
+
+        __m256d sX = _mm256_sub_pd(startX, _mm256_maskload_pd(centerX + i, mask));
+        __m256d sY = _mm256_sub_pd(startY, _mm256_maskload_pd(centerY + i, mask));
+        __m256d sZ = _mm256_sub_pd(startZ, _mm256_maskload_pd(centerZ + i, mask));
+
+        __m256d t = solveSpheres(sX, sY, sZ, directionX, directionY, directionZ, _mm256_maskload_pd(radius + i, mask));
+        _mm256_maskstore_pd(returnT + i, mask, t);
+    }
+}
+
+
+/* intersectSpheres() with SSE2, two spheres at a time. An odd one out is tested on its own. */
+static void intersectSpheresSSE2(const double rayStart[3], const double rayDirection[3], const double *centerX, const double *centerY,
+                                 const double *centerZ, const double *radius, unsigned int count, double *returnT) {
+    __m128d startX = _mm_set1_pd(rayStart[0]);
+    __m128d startY = _mm_set1_pd(rayStart[1]);
+    __m128d startZ = _mm_set1_pd(rayStart[2]);
+    __m128d directionX = _mm_set1_pd(rayDirection[0]);
+    __m128d directionY = _mm_set1_pd(rayDirection[1]);
+    __m128d directionZ = _mm_set1_pd(rayDirection[2]);
+
+    unsigned int i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m128d sX = _mm_sub_pd(startX, _mm_loadu_pd(centerX + i));
+        __m128d sY = _mm_sub_pd(startY, _mm_loadu_pd(centerY + i));
+        __m128d sZ = _mm_sub_pd(startZ, _mm_loadu_pd(centerZ + i));
+
+        _mm_storeu_pd(returnT + i, solveSpheres(sX, sY, sZ, directionX, directionY, directionZ, _mm_loadu_pd(radius + i)));
+    }
+
+    if (i < count) {
+        returnT[i] = solveSphere(rayStart[0] - centerX[i], rayStart[1] - centerY[i], rayStart[2] - centerZ[i],
+                                 rayDirection[0], rayDirection[1], rayDirection[2], radius[i]);
+    }
+}
+
+
+/* intersectRaysWithSphere() with AVX2, four rays at a time, masking the last few as intersectSpheresAVX2() does.
+   The rays left over have a zero direction, which misses. */
+__attribute__((target("avx2")))
+static void intersectRaysWithSphereAVX2(const double *startX, const double *startY, const double *startZ, const double *directionX,
+                                        const double *directionY, const double *directionZ, unsigned int count, const double center[3],
+                                        double radius, double *returnT) {
+    __m256d centerX = _mm256_set1_pd(center[0]);
+    __m256d centerY = _mm256_set1_pd(center[1]);
+    __m256d centerZ = _mm256_set1_pd(center[2]);
+    __m256d sphereRadius = _mm256_set1_pd(radius);
+
+    for (unsigned int i = 0; i < count; i += 4) {
+        __m256i mask = getLaneMask(count - i < 4 ? count - i : 4);
+
+        __m256d sX = _mm256_sub_pd(_mm256_maskload_pd(startX + i, mask), centerX);
+        __m256d sY = _mm256_sub_pd(_mm256_maskload_pd(startY + i, mask), centerY);
+        __m256d sZ = _mm256_sub_pd(_mm256_maskload_pd(startZ + i, mask), centerZ);
+
+        __m256d t = solveSpheres(sX, sY, sZ, _mm256_maskload_pd(directionX + i, mask), _mm256_maskload_pd(directionY + i, mask),
+                                 _mm256_maskload_pd(directionZ + i, mask), sphereRadius);
+        _mm256_maskstore_pd(returnT + i, mask, t);
+    }
+}
+
+
+/* intersectRaysWithSphere() with SSE2, two rays at a time. An odd one out is tested on its own. */
+static void intersectRaysWithSphereSSE2(const double *startX, const double *startY, const double *startZ, const double *directionX,
+                                        const double *directionY, const double *directionZ, unsigned int count, const double center[3],
+                                        double radius, double *returnT) {
+    __m128d centerX = _mm_set1_pd(center[0]);
+    __m128d centerY = _mm_set1_pd(center[1]);
+    __m128d centerZ = _mm_set1_pd(center[2]);
+    __m128d sphereRadius = _mm_set1_pd(radius);
+
+    unsigned int i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m128d sX = _mm_sub_pd(_mm_loadu_pd(startX + i), centerX);
+        __m128d sY = _mm_sub_pd(_mm_loadu_pd(startY + i), centerY);
+        __m128d sZ = _mm_sub_pd(_mm_loadu_pd(startZ + i), centerZ);
+
+        _mm_storeu_pd(returnT + i, solveSpheres(sX, sY, sZ, _mm_loadu_pd(directionX + i), _mm_loadu_pd(directionY + i),
+                                                _mm_loadu_pd(directionZ + i), sphereRadius));
+    }
+
+    if (i < count) {
+        returnT[i] = solveSphere(startX[i] - center[0], startY[i] - center[1], startZ[i] - center[2],
+                                 directionX[i], directionY[i], directionZ[i], radius);
+    }
+}
+
+
+/* solveSphere() for eight spheres, or eight rays, at once, as the AVX2 version does it. Enabling AVX-512 enables fused
+   multiply-adds along with it, which GCC would fuse the multiplies and adds into, so every AVX-512 function turns off
+   floating point contraction. */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static inline __m512d solveSpheres(__m512d sX, __m512d sY, __m512d sZ, __m512d directionX, __m512d directionY, __m512d directionZ, __m512d radius) {
+    __m512d a = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(directionX, directionX), _mm512_mul_pd(directionY, directionY)), _mm512_mul_pd(directionZ, directionZ));
+    __m512d b = _mm512_mul_pd(_mm512_set1_pd(2.0), _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(sX, directionX), _mm512_mul_pd(sY, directionY)), _mm512_mul_pd(sZ, directionZ)));
+    __m512d c = _mm512_sub_pd(_mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(sX, sX), _mm512_mul_pd(sY, sY)), _mm512_mul_pd(sZ, sZ)), _mm512_mul_pd(radius, radius));
+
+    __m512d discriminant = _mm512_sub_pd(_mm512_mul_pd(b, b), _mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(4.0), a), c));
+
+    /* The foundation instructions have no floating point XOR, so flip the sign bit as an integer. */
+    __m512d negativeB = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(b), _mm512_set1_epi64(0x8000000000000000ll)));
+    /* The zero-masking square root, with every lane kept, is the plain one without GCC warning about its unset input. */
+    __m512d root = _mm512_maskz_sqrt_pd((__mmask8)0xff, discriminant);
+    __m512d t = _mm512_div_pd(_mm512_sub_pd(negativeB, root), _mm512_mul_pd(_mm512_set1_pd(2.0), a));
+
+    return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(t, _mm512_setzero_pd(), _CMP_GE_OQ), _mm512_set1_pd(KERNEL_MISS), t);
+}
+
+
+/* intersectSpheres() with AVX-512, eight spheres at a time, masking the last few as intersectSpheresAVX2() does. */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void intersectSpheresAVX512(const double rayStart[3], const double rayDirection[3], const double *centerX, const double *centerY,
+                                   const double *centerZ, const double *radius, unsigned int count, double *returnT) {
+    __m512d startX = _mm512_set1_pd(rayStart[0]);
+    __m512d startY = _mm512_set1_pd(rayStart[1]);
+    __m512d startZ = _mm512_set1_pd(rayStart[2]);
+    __m512d directionX = _mm512_set1_pd(rayDirection[0]);
+    __m512d directionY = _mm512_set1_pd(rayDirection[1]);
+    __m512d directionZ = _mm512_set1_pd(rayDirection[2]);
+
+    for (unsigned int i = 0; i < count; i += 8) {
+        __mmask8 mask = getLaneMask8(count - i < 8 ? count - i : 8);
+
+        __m512d sX = _mm512_sub_pd(startX, _mm512_maskz_loadu_pd(mask, centerX + i));
+        __m512d sY = _mm512_sub_pd(startY, _mm512_maskz_loadu_pd(mask, centerY + i));
+        __m512d sZ = _mm512_sub_pd(startZ, _mm512_maskz_loadu_pd(mask, centerZ + i));
+
+        __m512d t = solveSpheres(sX, sY, sZ, directionX, directionY, directionZ, _mm512_maskz_loadu_pd(mask, radius + i));
+        _mm512_mask_storeu_pd(returnT + i, mask, t);
+    }
+}
+
+
+/* intersectRaysWithSphere() with AVX-512, eight rays at a time, masking the last few as intersectSpheresAVX2() does. */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void intersectRaysWithSphereAVX512(const double *startX, const double *startY, const double *startZ, const double *directionX,
+                                          const double *directionY, const double *directionZ, unsigned int count, const double center[3],
+                                          double radius, double *returnT) {
+    __m512d centerX = _mm512_set1_pd(center[0]);
+    __m512d centerY = _mm512_set1_pd(center[1]);
+    __m512d centerZ = _mm512_set1_pd(center[2]);
+    __m512d sphereRadius = _mm512_set1_pd(radius);
+
+    for (unsigned int i = 0; i < count; i += 8) {
+        __mmask8 mask = getLaneMask8(count - i < 8 ? count - i : 8);
+
+        __m512d sX = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, startX + i), centerX);
+        __m512d sY = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, startY + i), centerY);
+        __m512d sZ = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, startZ + i), centerZ);
+
+        __m512d t = solveSpheres(sX, sY, sZ, _mm512_maskz_loadu_pd(mask, directionX + i), _mm512_maskz_loadu_pd(mask, directionY + i),
+                                 _mm512_maskz_loadu_pd(mask, directionZ + i), sphereRadius);
+        _mm512_mask_storeu_pd(returnT + i, mask, t);
+    }
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+/* In single precision, each register holds twice as many lanes as in double precision, and the same steps run on
+   floats: four spheres or rays at once with SSE2, eight with AVX2, and sixteen with AVX-512. */
+
+
+/* solveSphere() for eight spheres, or eight rays, at once. The square root of a negative discriminant is NaN, and so
+   is the root, which fails the final comparison just as a root behind the start does. */
+__attribute__((target("avx2")))
+static inline __m256 solveSpheres(__m256 sX, __m256 sY, __m256 sZ, __m256 directionX, __m256 directionY, __m256 directionZ, __m256 radius) {
+    __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(directionX, directionX), _mm256_mul_ps(directionY, directionY)), _mm256_mul_ps(directionZ, directionZ));
+    __m256 b = _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sX, directionX), _mm256_mul_ps(sY, directionY)), _mm256_mul_ps(sZ, directionZ)));
+    __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sX, sX), _mm256_mul_ps(sY, sY)), _mm256_mul_ps(sZ, sZ)), _mm256_mul_ps(radius, radius));
+
+    __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(4.0f), a), c));
+
+    /* Flipping the sign bit negates B exactly as the scalar code does, zeros included. */
+    __m256 negativeB = _mm256_xor_ps(b, _mm256_set1_ps(-0.0f));
+    __m256 t = _mm256_div_ps(_mm256_sub_ps(negativeB, _mm256_sqrt_ps(discriminant)), _mm256_mul_ps(_mm256_set1_ps(2.0f), a));
+
+    return _mm256_blendv_ps(_mm256_set1_ps(KERNEL_MISS), t, _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ));
+}
+
+
+/* solveSphere() for four spheres, or four rays, at once. */
+static inline __m128 solveSpheres(__m128 sX, __m128 sY, __m128 sZ, __m128 directionX, __m128 directionY, __m128 directionZ, __m128 radius) {
+    __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, directionX), _mm_mul_ps(directionY, directionY)), _mm_mul_ps(directionZ, directionZ));
+    __m128 b = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, directionX), _mm_mul_ps(sY, directionY)), _mm_mul_ps(sZ, directionZ)));
+    __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, sX), _mm_mul_ps(sY, sY)), _mm_mul_ps(sZ, sZ)), _mm_mul_ps(radius, radius));
+
+    __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4.0f), a), c));
+
+    __m128 negativeB = _mm_xor_ps(b, _mm_set1_ps(-0.0f));
+    __m128 t = _mm_div_ps(_mm_sub_ps(negativeB, _mm_sqrt_ps(discriminant)), _mm_mul_ps(_mm_set1_ps(2.0f), a));
+
+    /* SSE2 has no blend, so select with masks. */
+    __m128 hit = _mm_cmpge_ps(t, _mm_setzero_ps());
+    return _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, _mm_set1_ps(KERNEL_MISS)));
+}
+
+
+/* Returns a mask for loading and storing the first COUNT of eight floats, for COUNT from 0 to 8. */
+__attribute__((target("avx2")))
+static inline __m256i getFloatLaneMask(unsigned int count) {
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+
+/* intersectSpheres() with AVX2, eight spheres at a time. The last few are loaded and stored with a mask, and the
+   lanes left over hold a sphere of radius zero at the origin, whose result is thrown away. */
+__attribute__((target("avx2")))
+static void intersectSpheresAVX2(const float rayStart[3], const float rayDirection[3], const float *centerX, const float *centerY,
+                                 const float *centerZ, const float *radius, unsigned int count, float *returnT) {
+    __m256 startX = _mm256_set1_ps(rayStart[0]);
+    __m256 startY = _mm256_set1_ps(rayStart[1]);
+    __m256 startZ = _mm256_set1_ps(rayStart[2]);
+    __m256 directionX = _mm256_set1_ps(rayDirection[0]);
+    __m256 directionY = _mm256_set1_ps(rayDirection[1]);
+    __m256 directionZ = _mm256_set1_ps(rayDirection[2]);
+
+    for (unsigned int i = 0; i < count; i += 8) {
+        __m256i mask = getFloatLaneMask(count - i < 8 ? count - i : 8);
+
+        __m256 sX = _mm256_sub_ps(startX, _mm256_maskload_ps(centerX + i, mask));
+        __m256 sY = _mm256_sub_ps(startY, _mm256_maskload_ps(centerY + i, mask));
+        __m256 sZ = _mm256_sub_ps(startZ, _mm256_maskload_ps(centerZ + i, mask));
+
+        __m256 t = solveSpheres(sX, sY, sZ, directionX, directionY, directionZ, _mm256_maskload_ps(radius + i, mask));
+        _mm256_maskstore_ps(returnT + i, mask, t);
+    }
+}
+
+
+/* intersectSpheres() with SSE2, four spheres at a time. The few left over are tested on their own. */
+static void intersectSpheresSSE2(const float rayStart[3], const float rayDirection[3], const float *centerX, const float *centerY,
+                                 const float *centerZ, const float *radius, unsigned int count, float *returnT) {
+    __m128 startX = _mm_set1_ps(rayStart[0]);
+    __m128 startY = _mm_set1_ps(rayStart[1]);
+    __m128 startZ = _mm_set1_ps(rayStart[2]);
+    __m128 directionX = _mm_set1_ps(rayDirection[0]);
+    __m128 directionY = _mm_set1_ps(rayDirection[1]);
+    __m128 directionZ = _mm_set1_ps(rayDirection[2]);
+
+    unsigned int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 sX = _mm_sub_ps(startX, _mm_loadu_ps(centerX + i));
+        __m128 sY = _mm_sub_ps(startY, _mm_loadu_ps(centerY + i));
+        __m128 sZ = _mm_sub_ps(startZ, _mm_loadu_ps(centerZ + i));
+
+        _mm_storeu_ps(returnT + i, solveSpheres(sX, sY, sZ, directionX, directionY, directionZ, _mm_loadu_ps(radius + i)));
+    }
+
+    for (; i < count; i++) {
+        returnT[i] = solveSphere(rayStart[0] - centerX[i], rayStart[1] - centerY[i], rayStart[2] - centerZ[i],
+                                 rayDirection[0], rayDirection[1], rayDirection[2], radius[i]);
+    }
+}
+
+
+/* intersectRaysWithSphere() with AVX2, eight rays at a time, masking the last few as intersectSpheresAVX2() does.
+   The rays left over have a zero direction, which misses. */
+__attribute__((target("avx2")))
+static void intersectRaysWithSphereAVX2(const float *startX, const float *startY, const float *startZ, const float *directionX,
+                                        const float *directionY, const float *directionZ, unsigned int count, const float center[3],
+                                        float radius, float *returnT) {
+    __m256 centerX = _mm256_set1_ps(center[0]);
+    __m256 centerY = _mm256_set1_ps(center[1]);
+    __m256 centerZ = _mm256_set1_ps(center[2]);
+    __m256 sphereRadius = _mm256_set1_ps(radius);
+
+    for (unsigned int i = 0; i < count; i += 8) {
+        __m256i mask = getFloatLaneMask(count - i < 8 ? count - i : 8);
+
+        __m256 sX = _mm256_sub_ps(_mm256_maskload_ps(startX + i, mask), centerX);
+        __m256 sY = _mm256_sub_ps(_mm256_maskload_ps(startY + i, mask), centerY);
+        __m256 sZ = _mm256_sub_ps(_mm256_maskload_ps(startZ + i, mask), centerZ);
+
+        __m256 t = solveSpheres(sX, sY, sZ, _mm256_maskload_ps(directionX + i, mask), _mm256_maskload_ps(directionY + i, mask),
+                                _mm256_maskload_ps(directionZ + i, mask), sphereRadius);
+        _mm256_maskstore_ps(returnT + i, mask, t);
+    }
+}
+
+
+/* intersectRaysWithSphere() with SSE2, four rays at a time. The few left over are tested on their own. */
+static void intersectRaysWithSphereSSE2(const float *startX, const float *startY, const float *startZ, const float *directionX,
+                                        const float *directionY, const float *directionZ, unsigned int count, const float center[3],
+                                        float radius, float *returnT) {
+    __m128 centerX = _mm_set1_ps(center[0]);
+    __m128 centerY = _mm_set1_ps(center[1]);
+    __m128 centerZ = _mm_set1_ps(center[2]);
+    __m128 sphereRadius = _mm_set1_ps(radius);
+
+    unsigned int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 sX = _mm_sub_ps(_mm_loadu_ps(startX + i), centerX);
+        __m128 sY = _mm_sub_ps(_mm_loadu_ps(startY + i), centerY);
+        __m128 sZ = _mm_sub_ps(_mm_loadu_ps(startZ + i), centerZ);
+
+        _mm_storeu_ps(returnT + i, solveSpheres(sX, sY, sZ, _mm_loadu_ps(directionX + i), _mm_loadu_ps(directionY + i),
+                                                _mm_loadu_ps(directionZ + i), sphereRadius));
+    }
+
+    for (; i < count; i++) {
+        returnT[i] = solveSphere(startX[i] - center[0], startY[i] - center[1], startZ[i] - center[2],
+                                 directionX[i], directionY[i], directionZ[i], radius);
+    }
+}
+
+
+/* solveSphere() for sixteen spheres, or sixteen rays, at once, as the AVX2 version does it, with floating point
+   contraction turned off as in the double precision build. */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static inline __m512 solveSpheres(__m512 sX, __m512 sY, __m512 sZ, __m512 directionX, __m512 directionY, __m512 directionZ, __m512 radius) {
+    __m512 a = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(directionX, directionX), _mm512_mul_ps(directionY, directionY)), _mm512_mul_ps(directionZ, directionZ));
+    __m512 b = _mm512_mul_ps(_mm512_set1_ps(2.0f), _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(sX, directionX), _mm512_mul_ps(sY, directionY)), _mm512_mul_ps(sZ, directionZ)));
+    __m512 c = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(sX, sX), _mm512_mul_ps(sY, sY)), _mm512_mul_ps(sZ, sZ)), _mm512_mul_ps(radius, radius));
+
+    __m512 discriminant = _mm512_sub_ps(_mm512_mul_ps(b, b), _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(4.0f), a), c));
+
+    /* The foundation instructions have no floating point XOR, so flip the sign bit as an integer. */
+    __m512 negativeB = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(b), _mm512_set1_epi32(0x80000000)));
+    /* The zero-masking square root, with every lane kept, is the plain one without GCC warning about its unset input. */
+    __m512 root = _mm512_maskz_sqrt_ps((__mmask16)0xffff, discriminant);
+    __m512 t = _mm512_div_ps(_mm512_sub_ps(negativeB, root), _mm512_mul_ps(_mm512_set1_ps(2.0f), a));
+
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(t, _mm512_setzero_ps(), _CMP_GE_OQ), _mm512_set1_ps(KERNEL_MISS), t);
+}
+
+
+/* Returns a mask for the first COUNT of sixteen floats, for COUNT from 0 to 16. */
+static inline unsigned short getLaneMask16(unsigned int count) {
+    return (unsigned short)((1u << count) - 1);
+}
+
+
+/* intersectSpheres() with AVX-512, sixteen spheres at a time, masking the last few as intersectSpheresAVX2() does. */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void intersectSpheresAVX512(const float rayStart[3], const float rayDirection[3], const float *centerX, const float *centerY,
+                                   const float *centerZ, const float *radius, unsigned int count, float *returnT) {
+    __m512 startX = _mm512_set1_ps(rayStart[0]);
+    __m512 startY = _mm512_set1_ps(rayStart[1]);
+    __m512 startZ = _mm512_set1_ps(rayStart[2]);
+    __m512 directionX = _mm512_set1_ps(rayDirection[0]);
+    __m512 directionY = _mm512_set1_ps(rayDirection[1]);
+    __m512 directionZ = _mm512_set1_ps(rayDirection[2]);
+
+    for (unsigned int i = 0; i < count; i += 16) {
+        __mmask16 mask = getLaneMask16(count - i < 16 ? count - i : 16);
+
+        __m512 sX = _mm512_sub_ps(startX, _mm512_maskz_loadu_ps(mask, centerX + i));
+        __m512 sY = _mm512_sub_ps(startY, _mm512_maskz_loadu_ps(mask, centerY + i));
+        __m512 sZ = _mm512_sub_ps(startZ, _mm512_maskz_loadu_ps(mask, centerZ + i));
+
+        __m512 t = solveSpheres(sX, sY, sZ, directionX, directionY, directionZ, _mm512_maskz_loadu_ps(mask, radius + i));
+        _mm512_mask_storeu_ps(returnT + i, mask, t);
+    }
+}
+
+
+/* intersectRaysWithSphere() with AVX-512, sixteen rays at a time, masking the last few as intersectSpheresAVX2() does. */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void intersectRaysWithSphereAVX512(const float *startX, const float *startY, const float *startZ, const float *directionX,
+                                          const float *directionY, const float *directionZ, unsigned int count, const float center[3],
+                                          float radius, float *returnT) {
+    __m512 centerX = _mm512_set1_ps(center[0]);
+    __m512 centerY = _mm512_set1_ps(center[1]);
+    __m512 centerZ = _mm512_set1_ps(center[2]);
+    __m512 sphereRadius = _mm512_set1_ps(radius);
+
+    for (unsigned int i = 0; i < count; i += 16) {
+        __mmask16 mask = getLaneMask16(count - i < 16 ? count - i : 16);
+
+        __m512 sX = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, startX + i), centerX);
+        __m512 sY = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, startY + i), centerY);
+        __m512 sZ = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, startZ + i), centerZ);
+
+        __m512 t = solveSpheres(sX, sY, sZ, _mm512_maskz_loadu_ps(mask, directionX + i), _mm512_maskz_loadu_ps(mask, directionY + i),
+                                _mm512_maskz_loadu_ps(mask, directionZ + i), sphereRadius);
+        _mm512_mask_storeu_ps(returnT + i, mask, t);
+    }
+}
+
+#endif
+
+
+/* Tests the ray from RAY_START along RAY_DIRECTION against COUNT spheres, sphere i centered at (CENTER_X[i],
+   CENTER_Y[i], CENTER_Z[i]) with radius RADIUS[i], and places into RETURN_T[i] the ray parameter at which the ray
+   meets sphere i, or KERNEL_MISS if it doesn't. WIDTH is the number of spheres tested at once, 0 for the widest. */
+void intersectSpheres(const Scalar rayStart[3], const Scalar rayDirection[3], const Scalar *centerX, const Scalar *centerY,
+                      const Scalar *centerZ, const Scalar *radius, unsigned int count, Scalar *returnT, int width) {
+#if defined(__x86_64__) || defined(__i386__)
+    width = getKernelWidth(width);
+
+    if (width >= 8) {
+        intersectSpheresAVX512(rayStart, rayDirection, centerX, centerY, centerZ, radius, count, returnT);
+        return;
+    }
+    if (width >= 4) {
+        intersectSpheresAVX2(rayStart, rayDirection, centerX, centerY, centerZ, radius, count, returnT);
+        return;
+    }
+    if (width >= 2) {
+        intersectSpheresSSE2(rayStart, rayDirection, centerX, centerY, centerZ, radius, count, returnT);
+        return;
+    }
+#endif
+
+    for (unsigned int i = 0; i < count; i++) {
+        returnT[i] = solveSphere(rayStart[0] - centerX[i], rayStart[1] - centerY[i], rayStart[2] - centerZ[i],
+                                 rayDirection[0], rayDirection[1], rayDirection[2], radius[i]);
+    }
+}
+
+
+/* Tests COUNT rays, ray i from (START_X[i], START_Y[i], START_Z[i]) along (DIRECTION_X[i], DIRECTION_Y[i],
+   DIRECTION_Z[i]), against the sphere centered at CENTER with radius RADIUS, and places into RETURN_T[i] the ray
+   parameter at which ray i meets it, or KERNEL_MISS if it doesn't. WIDTH is the number of rays tested at once. */
+void intersectRaysWithSphere(const Scalar *startX, const Scalar *startY, const Scalar *startZ, const Scalar *directionX,
+                             const Scalar *directionY, const Scalar *directionZ, unsigned int count, const Scalar center[3],
+                             Scalar radius, Scalar *returnT, int width) {
+#if defined(__x86_64__) || defined(__i386__)
+    width = getKernelWidth(width);
+
+    if (width >= 8) {
+        intersectRaysWithSphereAVX512(startX, startY, startZ, directionX, directionY, directionZ, count, center, radius, returnT);
+        return;
+    }
+    if (width >= 4) {
+        intersectRaysWithSphereAVX2(startX, startY, startZ, directionX, directionY, directionZ, count, center, radius, returnT);
+        return;
+    }
+    if (width >= 2) {
+        intersectRaysWithSphereSSE2(startX, startY, startZ, directionX, directionY, directionZ, count, center, radius, returnT);
+        return;
+    }
+#endif
+
+    for (unsigned int i = 0; i < count; i++) {
+        returnT[i] = solveSphere(startX[i] - center[0], startY[i] - center[1], startZ[i] - center[2],
+                                 directionX[i], directionY[i], directionZ[i], radius);
+    }
+}
+
+
+
+/*
+----------------------
+    Triangles.
+----------------------
+*/
+
+
+/* Tests the ray from START along DIRECTION against triangle LANE of PACKET, following the steps of Triangle::intersect().
+   If the ray hits it, returns true and places the ray parameter and barycentric coordinates of the hit into RETURN_T,
+   RETURN_U and RETURN_V. A NaN ray parameter, from a ray or triangle with no extent, is taken as a miss. */
+static bool solveTriangle(const TrianglePacket &packet, unsigned int lane, const Scalar start[3], const Scalar direction[3],
+                          Scalar &returnT, Scalar &returnU, Scalar &returnV) {
+
+    Scalar e1 [3] = {packet.edge1[0][lane], packet.edge1[1][lane], packet.edge1[2][lane]};
+    Scalar e2 [3] = {packet.edge2[0][lane], packet.edge2[1][lane], packet.edge2[2][lane]};
+
+    Scalar q [3] = {direction[1]*e2[2] - direction[2]*e2[1],
+                    direction[2]*e2[0] - direction[0]*e2[2],
+                    direction[0]*e2[1] - direction[1]*e2[0]};
+
+    Scalar a = e1[0]*q[0] + e1[1]*q[1] + e1[2]*q[2];
+
+    if (a > Scalar(-0.0001) && a < Scalar(0.0001)) {
+        return false;
+    }
+
+    Scalar f = 1/a;
+
+    Scalar s [3] = {start[0] - packet.vertex0[0][lane], start[1] - packet.vertex0[1][lane], start[2] - packet.vertex0[2][lane]};
+    Scalar u = f*(s[0]*q[0] + s[1]*q[1] + s[2]*q[2]);
+
+    if (u < 0.0) {
+        return false;
+    }
+
+    Scalar r [3] = {s[1]*e1[2] - s[2]*e1[1],
+                    s[2]*e1[0] - s[0]*e1[2],
+                    s[0]*e1[1] - s[1]*e1[0]};
+    Scalar v = f*(direction[0]*r[0] + direction[1]*r[1] + direction[2]*r[2]);
+
+    if (v < 0.0 || u+v > 1.0) {
+        return false;
+    }
+
+    Scalar t = f*(e2[0]*r[0] + e2[1]*r[1] + e2[2]*r[2]);
+
+    if (!(t >= 0.0)) {
+        return false;
+    }
+
+    returnT = t;
+    returnU = u;
+    returnV = v;
+    return true;
+}
+
+
+/* Of the triangles in MASK, with ray parameters T, picks the closest, the first of those at the same distance, and
+   places its lane and its hit from T, U and V into the return values. Returns MASK. */
+static unsigned int pickClosest(unsigned int mask, const Scalar *t, const Scalar *u, const Scalar *v,
+                                unsigned int &returnLane, Scalar &returnT, Scalar &returnU, Scalar &returnV) {
+    bool found = false;
+
+    for (unsigned int lane = 0; lane < KERNEL_PACKET_WIDTH; lane++) {
+        if ((mask & (1u << lane)) && (!found || t[lane] < returnT)) {
+            found = true;
+            returnLane = lane;
+            returnT = t[lane];
+        }
+    }
+
+    if (found) {
+        returnU = u[returnLane];
+        returnV = v[returnLane];
+    }
+
+    return mask;
+}
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(SINGLE_PRECISION)
+
+/* intersectTrianglePacket() with AVX2, all four triangles at once. Every step of solveTriangle() is taken for every
+   triangle, and a triangle is hit if none of its tests rejected it. Comparisons are ordered, so a NaN fails them the
+   same way it fails the scalar code's, except for the last, which rejects a NaN ray parameter. */
+__attribute__((target("avx2")))
+static unsigned int intersectTrianglePacketAVX2(const TrianglePacket &packet, const double start[3], const double direction[3],
+                                                unsigned int &returnLane, double &returnT, double &returnU, double &returnV) {
+    __m256d directionX = _mm256_set1_pd(direction[0]);
+    __m256d directionY = _mm256_set1_pd(direction[1]);
+    __m256d directionZ = _mm256_set1_pd(direction[2]);
+
+    __m256d e1X = _mm256_load_pd(packet.edge1[0]);
+    __m256d e1Y = _mm256_load_pd(packet.edge1[1]);
+    __m256d e1Z = _mm256_load_pd(packet.edge1[2]);
+    __m256d e2X = _mm256_load_pd(packet.edge2[0]);
+    __m256d e2Y = _mm256_load_pd(packet.edge2[1]);
+    __m256d e2Z = _mm256_load_pd(packet.edge2[2]);
+
+    __m256d qX = _mm256_sub_pd(_mm256_mul_pd(directionY, e2Z), _mm256_mul_pd(directionZ, e2Y));
+    __m256d qY = _mm256_sub_pd(_mm256_mul_pd(directionZ, e2X), _mm256_mul_pd(directionX, e2Z));
+    __m256d qZ = _mm256_sub_pd(_mm256_mul_pd(directionX, e2Y), _mm256_mul_pd(directionY, e2X));
+
+    __m256d a = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(e1X, qX), _mm256_mul_pd(e1Y, qY)), _mm256_mul_pd(e1Z, qZ));
+    __m256d rejected = _mm256_and_pd(_mm256_cmp_pd(a, _mm256_set1_pd(-0.0001), _CMP_GT_OQ), _mm256_cmp_pd(a, _mm256_set1_pd(0.0001), _CMP_LT_OQ));
+
+    __m256d f = _mm256_div_pd(_mm256_set1_pd(1.0), a);
+
+    __m256d sX = _mm256_sub_pd(_mm256_set1_pd(start[0]), _mm256_load_pd(packet.vertex0[0]));
+    __m256d sY = _mm256_sub_pd(_mm256_set1_pd(start[1]), _mm256_load_pd(packet.vertex0[1]));
+    __m256d sZ = _mm256_sub_pd(_mm256_set1_pd(start[2]), _mm256_load_pd(packet.vertex0[2]));
+
+    __m256d u = _mm256_mul_pd(f, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(sX, qX), _mm256_mul_pd(sY, qY)), _mm256_mul_pd(sZ, qZ)));
+    rejected = _mm256_or_pd(rejected, _mm256_cmp_pd(u, _mm256_setzero_pd(), _CMP_LT_OQ));
+
+    __m256d rX = _mm256_sub_pd(_mm256_mul_pd(sY, e1Z), _mm256_mul_pd(sZ, e1Y));
+    __m256d rY = _mm256_sub_pd(_mm256_mul_pd(sZ, e1X), _mm256_mul_pd(sX, e1Z));
+    __m256d rZ = _mm256_sub_pd(_mm256_mul_pd(sX, e1Y), _mm256_mul_pd(sY, e1X));
+
+    __m256d v = _mm256_mul_pd(f, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(directionX, rX), _mm256_mul_pd(directionY, rY)), _mm256_mul_pd(directionZ, rZ)));
+    rejected = _mm256_or_pd(rejected, _mm256_cmp_pd(v, _mm256_setzero_pd(), _CMP_LT_OQ));
+    rejected = _mm256_or_pd(rejected, _mm256_cmp_pd(_mm256_add_pd(u, v), _mm256_set1_pd(1.0), _CMP_GT_OQ));
+
+    __m256d t = _mm256_mul_pd(f, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(e2X, rX), _mm256_mul_pd(e2Y, rY)), _mm256_mul_pd(e2Z, rZ)));
+    __m256d hit = _mm256_andnot_pd(rejected, _mm256_cmp_pd(t, _mm256_setzero_pd(), _CMP_GE_OQ));
+
+    unsigned int mask = _mm256_movemask_pd(hit);
+
+    if (mask == 0) {
+        return 0;
+    }
+
+    double hitT [KERNEL_PACKET_WIDTH], hitU [KERNEL_PACKET_WIDTH], hitV [KERNEL_PACKET_WIDTH];
+    _mm256_storeu_pd(hitT, t);
+    _mm256_storeu_pd(hitU, u);
+    _mm256_storeu_pd(hitV, v);
+
+    return pickClosest(mask, hitT, hitU, hitV, returnLane, returnT, returnU, returnV);
+}
+
+
+/* intersectTrianglePacket() with SSE2, two triangles at a time, following the same steps. */
+static unsigned int intersectTrianglePacketSSE2(const TrianglePacket &packet, const double start[3], const double direction[3],
+                                                unsigned int &returnLane, double &returnT, double &returnU, double &returnV) {
+    __m128d directionX = _mm_set1_pd(direction[0]);
+    __m128d directionY = _mm_set1_pd(direction[1]);
+    __m128d directionZ = _mm_set1_pd(direction[2]);
+
+    double hitT [KERNEL_PACKET_WIDTH], hitU [KERNEL_PACKET_WIDTH], hitV [KERNEL_PACKET_WIDTH];
+    unsigned int mask = 0;
+
+    for (unsigned int lane = 0; lane < KERNEL_PACKET_WIDTH; lane += 2) {
+        __m128d e1X = _mm_load_pd(packet.edge1[0] + lane);
+        __m128d e1Y = _mm_load_pd(packet.edge1[1] + lane);
+        __m128d e1Z = _mm_load_pd(packet.edge1[2] + lane);
+        __m128d e2X = _mm_load_pd(packet.edge2[0] + lane);
+        __m128d e2Y = _mm_load_pd(packet.edge2[1] + lane);
+        __m128d e2Z = _mm_load_pd(packet.edge2[2] + lane);
+
+        __m128d qX = _mm_sub_pd(_mm_mul_pd(directionY, e2Z), _mm_mul_pd(directionZ, e2Y));
+        __m128d qY = _mm_sub_pd(_mm_mul_pd(directionZ, e2X), _mm_mul_pd(directionX, e2Z));
+        __m128d qZ = _mm_sub_pd(_mm_mul_pd(directionX, e2Y), _mm_mul_pd(directionY, e2X));
+
+        __m128d a = _mm_add_pd(_mm_add_pd(_mm_mul_pd(e1X, qX), _mm_mul_pd(e1Y, qY)), _mm_mul_pd(e1Z, qZ));
+        __m128d rejected = _mm_and_pd(_mm_cmpgt_pd(a, _mm_set1_pd(-0.0001)), _mm_cmplt_pd(a, _mm_set1_pd(0.0001)));
+
+        __m128d f = _mm_div_pd(_mm_set1_pd(1.0), a);
+
+        __m128d sX = _mm_sub_pd(_mm_set1_pd(start[0]), _mm_load_pd(packet.vertex0[0] + lane));
+        __m128d sY = _mm_sub_pd(_mm_set1_pd(start[1]), _mm_load_pd(packet.vertex0[1] + lane));
+        __m128d sZ = _mm_sub_pd(_mm_set1_pd(start[2]), _mm_load_pd(packet.vertex0[2] + lane));
+
+        __m128d u = _mm_mul_pd(f, _mm_add_pd(_mm_add_pd(_mm_mul_pd(sX, qX), _mm_mul_pd(sY, qY)), _mm_mul_pd(sZ, qZ)));
+        rejected = _mm_or_pd(rejected, _mm_cmplt_pd(u, _mm_setzero_pd()));
+
+        __m128d rX = _mm_sub_pd(_mm_mul_pd(sY, e1Z), _mm_mul_pd(sZ, e1Y));
+        __m128d rY = _mm_sub_pd(_mm_mul_pd(sZ, e1X), _mm_mul_pd(sX, e1Z));
+        __m128d rZ = _mm_sub_pd(_mm_mul_pd(sX, e1Y), _mm_mul_pd(sY, e1X));
+
+        __m128d v = _mm_mul_pd(f, _mm_add_pd(_mm_add_pd(_mm_mul_pd(directionX, rX), _mm_mul_pd(directionY, rY)), _mm_mul_pd(directionZ, rZ)));
+        rejected = _mm_or_pd(rejected, _mm_cmplt_pd(v, _mm_setzero_pd()));
+        rejected = _mm_or_pd(rejected, _mm_cmpgt_pd(_mm_add_pd(u, v), _mm_set1_pd(1.0)));
+
+        __m128d t = _mm_mul_pd(f, _mm_add_pd(_mm_add_pd(_mm_mul_pd(e2X, rX), _mm_mul_pd(e2Y, rY)), _mm_mul_pd(e2Z, rZ)));
+        __m128d hit = _mm_andnot_pd(rejected, _mm_cmpge_pd(t, _mm_setzero_pd()));
+
+        mask |= (unsigned int)_mm_movemask_pd(hit) << lane;
+
+        _mm_storeu_pd(hitT + lane, t);
+        _mm_storeu_pd(hitU + lane, u);
+        _mm_storeu_pd(hitV + lane, v);
+    }
+
+    return pickClosest(mask, hitT, hitU, hitV, returnLane, returnT, returnU, returnV);
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+/* intersectTrianglePacket() with SSE2 in single precision, where a packet's four triangles fill a single register and
+   all four are tested at once. Every step of solveTriangle() is taken for every triangle, and a triangle is hit if none
+   of its tests rejected it. Comparisons are ordered, so a NaN fails them the same way it fails the scalar code's, except
+   for the last, which rejects a NaN ray parameter. */
+static unsigned int intersectTrianglePacketSSE2(const TrianglePacket &packet, const float start[3], const float direction[3],
+                                                unsigned int &returnLane, float &returnT, float &returnU, float &returnV) {
+    __m128 directionX = _mm_set1_ps(direction[0]);
+    __m128 directionY = _mm_set1_ps(direction[1]);
+    __m128 directionZ = _mm_set1_ps(direction[2]);
+
+    __m128 e1X = _mm_load_ps(packet.edge1[0]);
+    __m128 e1Y = _mm_load_ps(packet.edge1[1]);
+    __m128 e1Z = _mm_load_ps(packet.edge1[2]);
+    __m128 e2X = _mm_load_ps(packet.edge2[0]);
+    __m128 e2Y = _mm_load_ps(packet.edge2[1]);
+    __m128 e2Z = _mm_load_ps(packet.edge2[2]);
+
+    __m128 qX = _mm_sub_ps(_mm_mul_ps(directionY, e2Z), _mm_mul_ps(directionZ, e2Y));
+    __m128 qY = _mm_sub_ps(_mm_mul_ps(directionZ, e2X), _mm_mul_ps(directionX, e2Z));
+    __m128 qZ = _mm_sub_ps(_mm_mul_ps(directionX, e2Y), _mm_mul_ps(directionY, e2X));
+
+    __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1X, qX), _mm_mul_ps(e1Y, qY)), _mm_mul_ps(e1Z, qZ));
+    __m128 rejected = _mm_and_ps(_mm_cmpgt_ps(a, _mm_set1_ps(-0.0001)), _mm_cmplt_ps(a, _mm_set1_ps(0.0001)));
+
+    __m128 f = _mm_div_ps(_mm_set1_ps(1.0f), a);
+
+    __m128 sX = _mm_sub_ps(_mm_set1_ps(start[0]), _mm_load_ps(packet.vertex0[0]));
+    __m128 sY = _mm_sub_ps(_mm_set1_ps(start[1]), _mm_load_ps(packet.vertex0[1]));
+    __m128 sZ = _mm_sub_ps(_mm_set1_ps(start[2]), _mm_load_ps(packet.vertex0[2]));
+
+    __m128 u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, qX), _mm_mul_ps(sY, qY)), _mm_mul_ps(sZ, qZ)));
+    rejected = _mm_or_ps(rejected, _mm_cmplt_ps(u, _mm_setzero_ps()));
+
+    __m128 rX = _mm_sub_ps(_mm_mul_ps(sY, e1Z), _mm_mul_ps(sZ, e1Y));
+    __m128 rY = _mm_sub_ps(_mm_mul_ps(sZ, e1X), _mm_mul_ps(sX, e1Z));
+    __m128 rZ = _mm_sub_ps(_mm_mul_ps(sX, e1Y), _mm_mul_ps(sY, e1X));
+
+    __m128 v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, rX), _mm_mul_ps(directionY, rY)), _mm_mul_ps(directionZ, rZ)));
+    rejected = _mm_or_ps(rejected, _mm_cmplt_ps(v, _mm_setzero_ps()));
+    rejected = _mm_or_ps(rejected, _mm_cmpgt_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+
+    __m128 t = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2X, rX), _mm_mul_ps(e2Y, rY)), _mm_mul_ps(e2Z, rZ)));
+    __m128 hit = _mm_andnot_ps(rejected, _mm_cmpge_ps(t, _mm_setzero_ps()));
+
+    unsigned int mask = _mm_movemask_ps(hit);
+
+    if (mask == 0) {
+        return 0;
+    }
+
+    float hitT [KERNEL_PACKET_WIDTH], hitU [KERNEL_PACKET_WIDTH], hitV [KERNEL_PACKET_WIDTH];
+    _mm_storeu_ps(hitT, t);
+    _mm_storeu_ps(hitU, u);
+    _mm_storeu_ps(hitV, v);
+
+    return pickClosest(mask, hitT, hitU, hitV, returnLane, returnT, returnU, returnV);
+}
+
+#endif
+
+
+/* Tests the ray from RAY_START along RAY_DIRECTION against every triangle of PACKET at once, and returns a mask with
+   bit i set if the ray hits triangle i. If it hits any, places the closest into RETURN_LANE, the first of those at
+   exactly the same distance, and the ray parameter and barycentric coordinates of the hit into RETURN_T, RETURN_U and
+   RETURN_V. WIDTH is the number of triangles tested at once, 0 for the widest. */
+unsigned int intersectTrianglePacket(const TrianglePacket &packet, const Scalar rayStart[3], const Scalar rayDirection[3],
+                                     unsigned int &returnLane, Scalar &returnT, Scalar &returnU, Scalar &returnV, int width) {
+#if defined(__x86_64__) || defined(__i386__)
+    width = getKernelWidth(width);
+
+#ifndef SINGLE_PRECISION
+    /* A packet holds only four triangles, so AVX-512 has nothing more to offer. */
+    if (width >= 4) {
+        return intersectTrianglePacketAVX2(packet, rayStart, rayDirection, returnLane, returnT, returnU, returnV);
+    }
+#endif
+    if (width >= 2) {
+        return intersectTrianglePacketSSE2(packet, rayStart, rayDirection, returnLane, returnT, returnU, returnV);
+    }
+#endif
+
+    Scalar hitT [KERNEL_PACKET_WIDTH], hitU [KERNEL_PACKET_WIDTH], hitV [KERNEL_PACKET_WIDTH];
+    unsigned int mask = 0;
+
+    for (unsigned int lane = 0; lane < KERNEL_PACKET_WIDTH; lane++) {
+        if (solveTriangle(packet, lane, rayStart, rayDirection, hitT[lane], hitU[lane], hitV[lane])) {
+            mask |= (1u << lane);
+        }
+    }
+
+    return pickClosest(mask, hitT, hitU, hitV, returnLane, returnT, returnU, returnV);
+}
+
+
+
+/*
+----------------------
+    Boxes.
+----------------------
+*/
+
+
+/* Returns true if the ray from START, with the reciprocals of its direction's components in INVERSE, enters the box
+   from LOWER to UPPER somewhere in [0, MAX_T], following the steps of intersectRay(). */
+static bool solveBox(const double lower[3], const double upper[3], const double start[3], const double inverse[3], double maxT) {
+    double tNear = 0.0;
+    double tFar = maxT;
+
+    for (int i = 0; i < 3; i++) {
+        double t0 = (lower[i] - start[i]) * inverse[i];
+        double t1 = (upper[i] - start[i]) * inverse[i];
+
+        if (t0 > t1) {
+            double temp = t0; t0 = t1; t1 = temp;
+        }
+
+        if (t0 > tNear) {
+            tNear = t0;
+        }
+        if (t1 < tFar) {
+            tFar = t1;
+        }
+    }
+
+    return !(tNear > tFar);
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* One axis of solveBox() for four rays at once. Ordered comparisons are false for NaN, just like the scalar ones, so a
+   NaN from a ray parallel to the slab changes nothing here either. */
+__attribute__((target("avx2")))
+static inline void clipToSlab(__m256d lower, __m256d upper, __m256d start, __m256d inverse, __m256d &tNear, __m256d &tFar) {
+    __m256d t0 = _mm256_mul_pd(_mm256_sub_pd(lower, start), inverse);
+    __m256d t1 = _mm256_mul_pd(_mm256_sub_pd(upper, start), inverse);
+
+    __m256d swap = _mm256_cmp_pd(t0, t1, _CMP_GT_OQ);
+    __m256d entry = _mm256_blendv_pd(t0, t1, swap);
+    __m256d exit = _mm256_blendv_pd(t1, t0, swap);
+
+    tNear = _mm256_blendv_pd(tNear, entry, _mm256_cmp_pd(entry, tNear, _CMP_GT_OQ));
+    tFar = _mm256_blendv_pd(tFar, exit, _mm256_cmp_pd(exit, tFar, _CMP_LT_OQ));
+}
+
+
+/* One axis of solveBox() for two rays at once. */
+static inline void clipToSlab(__m128d lower, __m128d upper, __m128d start, __m128d inverse, __m128d &tNear, __m128d &tFar) {
+    __m128d t0 = _mm_mul_pd(_mm_sub_pd(lower, start), inverse);
+    __m128d t1 = _mm_mul_pd(_mm_sub_pd(upper, start), inverse);
+
+    __m128d swap = _mm_cmpgt_pd(t0, t1);
+    __m128d entry = _mm_or_pd(_mm_and_pd(swap, t1), _mm_andnot_pd(swap, t0));
+    __m128d exit = _mm_or_pd(_mm_and_pd(swap, t0), _mm_andnot_pd(swap, t1));
+
+    __m128d closer = _mm_cmpgt_pd(entry, tNear);
+    tNear = _mm_or_pd(_mm_and_pd(closer, entry), _mm_andnot_pd(closer, tNear));
+
+    __m128d farther = _mm_cmplt_pd(exit, tFar);
+    tFar = _mm_or_pd(_mm_and_pd(farther, exit), _mm_andnot_pd(farther, tFar));
+}
+
+
+/* intersectRaysWithBox() with AVX2, four rays at a time, skipping groups of four with no active ray. The last few are
+   loaded with a mask, and the lanes left over are dropped from the result. */
+__attribute__((target("avx2")))
+static unsigned long long intersectRaysWithBoxAVX2(const double lower[3], const double upper[3], const double *startX, const double *startY,
+                                                   const double *startZ, const double *inverseX, const double *inverseY, const double *inverseZ,
+                                                   const double *maxT, unsigned int count, unsigned long long active) {
+    __m256d lowerX = _mm256_set1_pd(lower[0]), upperX = _mm256_set1_pd(upper[0]);
+    __m256d lowerY = _mm256_set1_pd(lower[1]), upperY = _mm256_set1_pd(upper[1]);
+    __m256d lowerZ = _mm256_set1_pd(lower[2]), upperZ = _mm256_set1_pd(upper[2]);
+
+    unsigned long long hits = 0;
+
+    for (unsigned int i = 0; i < count; i += 4) {
+        unsigned long long lanes = (active >> i) & 0xf;
+        if (lanes == 0) {
+            continue;
+        }
+
+        __m256i mask = getLaneMask(count - i < 4 ? count - i : 4);
+
+        __m256d tNear = _mm256_setzero_pd();
+        __m256d tFar = _mm256_maskload_pd(maxT + i, mask);
+
+        clipToSlab(lowerX, upperX, _mm256_maskload_pd(startX + i, mask), _mm256_maskload_pd(inverseX + i, mask), tNear, tFar);
+        clipToSlab(lowerY, upperY, _mm256_maskload_pd(startY + i, mask), _mm256_maskload_pd(inverseY + i, mask), tNear, tFar);
+        clipToSlab(lowerZ, upperZ, _mm256_maskload_pd(startZ + i, mask), _mm256_maskload_pd(inverseZ + i, mask), tNear, tFar);
+
+        /* Neither bound can be NaN, so this is the scalar !(tNear > tFar). */
+        unsigned long long hit = _mm256_movemask_pd(_mm256_cmp_pd(tNear, tFar, _CMP_LE_OQ));
+        hits |= (hit & lanes) << i;
+    }
+
+    return hits;
+}
+
+
+/* intersectRaysWithBox() with SSE2, two rays at a time. An odd one out is tested on its own. */
+static unsigned long long intersectRaysWithBoxSSE2(const double lower[3], const double upper[3], const double *startX, const double *startY,
+                                                   const double *startZ, const double *inverseX, const double *inverseY, const double *inverseZ,
+                                                   const double *maxT, unsigned int count, unsigned long long active) {
+    __m128d lowerX = _mm_set1_pd(lower[0]), upperX = _mm_set1_pd(upper[0]);
+    __m128d lowerY = _mm_set1_pd(lower[1]), upperY = _mm_set1_pd(upper[1]);
+    __m128d lowerZ = _mm_set1_pd(lower[2]), upperZ = _mm_set1_pd(upper[2]);
+
+    unsigned long long hits = 0;
+    unsigned int i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        unsigned long long lanes = (active >> i) & 0x3;
+        if (lanes == 0) {
+            continue;
+        }
+
+        __m128d tNear = _mm_setzero_pd();
+        __m128d tFar = _mm_loadu_pd(maxT + i);
+
+        clipToSlab(lowerX, upperX, _mm_loadu_pd(startX + i), _mm_loadu_pd(inverseX + i), tNear, tFar);
+        clipToSlab(lowerY, upperY, _mm_loadu_pd(startY + i), _mm_loadu_pd(inverseY + i), tNear, tFar);
+        clipToSlab(lowerZ, upperZ, _mm_loadu_pd(startZ + i), _mm_loadu_pd(inverseZ + i), tNear, tFar);
+
+        unsigned long long hit = _mm_movemask_pd(_mm_cmple_pd(tNear, tFar));
+        hits |= (hit & lanes) << i;
+    }
+
+    if (i < count && (active >> i) & 1) {
+        double start [3] = {startX[i], startY[i], startZ[i]};
+        double inverse [3] = {inverseX[i], inverseY[i], inverseZ[i]};
+
+        if (solveBox(lower, upper, start, inverse, maxT[i])) {
+            hits |= 1ull << i;
+        }
+    }
+
+    return hits;
+}
+
+
+/* One axis of solveBox() for eight rays at once, as the AVX2 version does it. */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static inline void clipToSlab(__m512d lower, __m512d upper, __m512d start, __m512d inverse, __m512d &tNear, __m512d &tFar) {
+    __m512d t0 = _mm512_mul_pd(_mm512_sub_pd(lower, start), inverse);
+    __m512d t1 = _mm512_mul_pd(_mm512_sub_pd(upper, start), inverse);
+
+    __mmask8 swap = _mm512_cmp_pd_mask(t0, t1, _CMP_GT_OQ);
+    __m512d entry = _mm512_mask_blend_pd(swap, t0, t1);
+    __m512d exit = _mm512_mask_blend_pd(swap, t1, t0);
+
+    tNear = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(entry, tNear, _CMP_GT_OQ), tNear, entry);
+    tFar = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(exit, tFar, _CMP_LT_OQ), tFar, exit);
+}
+
+
+/* intersectRaysWithBox() with AVX-512, eight rays at a time, skipping groups of eight with no active ray. Only the
+   active rays are loaded, and the rest are left out of the result. */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static unsigned long long intersectRaysWithBoxAVX512(const double lower[3], const double upper[3], const double *startX, const double *startY,
+                                                     const double *startZ, const double *inverseX, const double *inverseY, const double *inverseZ,
+                                                     const double *maxT, unsigned int count, unsigned long long active) {
+    __m512d lowerX = _mm512_set1_pd(lower[0]), upperX = _mm512_set1_pd(upper[0]);
+    __m512d lowerY = _mm512_set1_pd(lower[1]), upperY = _mm512_set1_pd(upper[1]);
+    __m512d lowerZ = _mm512_set1_pd(lower[2]), upperZ = _mm512_set1_pd(upper[2]);
+
+    unsigned long long hits = 0;
+
+    for (unsigned int i = 0; i < count; i += 8) {
+        __mmask8 lanes = (__mmask8)((active >> i) & getLaneMask8(count - i < 8 ? count - i : 8));
+        if (lanes == 0) {
+            continue;
+        }
+
+        __m512d tNear = _mm512_setzero_pd();
+        __m512d tFar = _mm512_maskz_loadu_pd(lanes, maxT + i);
+
+        clipToSlab(lowerX, upperX, _mm512_maskz_loadu_pd(lanes, startX + i), _mm512_maskz_loadu_pd(lanes, inverseX + i), tNear, tFar);
+        clipToSlab(lowerY, upperY, _mm512_maskz_loadu_pd(lanes, startY + i), _mm512_maskz_loadu_pd(lanes, inverseY + i), tNear, tFar);
+        clipToSlab(lowerZ, upperZ, _mm512_maskz_loadu_pd(lanes, startZ + i), _mm512_maskz_loadu_pd(lanes, inverseZ + i), tNear, tFar);
+
+        unsigned long long hit = _mm512_mask_cmp_pd_mask(lanes, tNear, tFar, _CMP_LE_OQ);
+        hits |= hit << i;
+    }
+
+    return hits;
+}
+
+#endif
+
+
+/* Tests COUNT rays against the box from LOWER to UPPER, ray i starting at (START_X[i], START_Y[i], START_Z[i]) with the
+   reciprocals of its direction's components in (INVERSE_X[i], INVERSE_Y[i], INVERSE_Z[i]), and returns a mask with bit
+   i set if ray i enters the box in [0, MAX_T[i]]. Only rays active in ACTIVE are tested. WIDTH is the number of rays
+   tested at once, 0 for the widest. */
+unsigned long long intersectRaysWithBox(const double lower[3], const double upper[3], const double *startX, const double *startY,
+                                        const double *startZ, const double *inverseX, const double *inverseY, const double *inverseZ,
+                                        const double *maxT, unsigned int count, unsigned long long active, int width) {
+#if defined(__x86_64__) || defined(__i386__)
+    width = getKernelWidth(width);
+
+    if (width >= 8) {
+        return intersectRaysWithBoxAVX512(lower, upper, startX, startY, startZ, inverseX, inverseY, inverseZ, maxT, count, active);
+    }
+    if (width >= 4) {
+        return intersectRaysWithBoxAVX2(lower, upper, startX, startY, startZ, inverseX, inverseY, inverseZ, maxT, count, active);
+    }
+    if (width >= 2) {
+        return intersectRaysWithBoxSSE2(lower, upper, startX, startY, startZ, inverseX, inverseY, inverseZ, maxT, count, active);
+    }
+#endif
+
+    unsigned long long hits = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (!((active >> i) & 1)) {
+            continue;
+        }
+
+        double start [3] = {startX[i], startY[i], startZ[i]};
+        double inverse [3] = {inverseX[i], inverseY[i], inverseZ[i]};
+
+        if (solveBox(lower, upper, start, inverse, maxT[i])) {
+            hits |= 1ull << i;
+        }
+    }
+
+    return hits;
+}
+
+
+
+/*
+----------------------
+    Colors.
+----------------------
+*/
+
+
+/* Places the bytes drawPixel() would draw COLOR as into RETURN_BYTES. A float converts to an integer with its fraction
+   cut off, and the integer's lowest byte is kept, which is what the conversion straight to a char does on x86. */
+static inline void convertColor(const Color &color, unsigned char *returnBytes) {
+    returnBytes[0] = (unsigned char)(int)((float)color.r * 255);
+    returnBytes[1] = (unsigned char)(int)((float)color.g * 255);
+    returnBytes[2] = (unsigned char)(int)((float)color.b * 255);
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* convertColors() with AVX2, four colors at a time. Each color, alpha and all, fills an AVX register, which narrows to
+   four floats, or in single precision loads as four floats to begin with. The four integer results of each keep only their lowest byte, so that packing them with saturation
+   keeps them whole, and a shuffle then drops the alpha bytes. A few colors left over are converted on their own. */
+__attribute__((target("avx2")))
+static void convertColorsAVX2(const Color *colors, unsigned int count, unsigned char *returnBytes) {
+    __m128 scale = _mm_set1_ps(255.0f);
+    __m128i lowestByte = _mm_set1_epi32(0xff);
+    __m128i dropAlpha = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    unsigned int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i components [4];
+
+        for (int k = 0; k < 4; k++) {
+#ifdef SINGLE_PRECISION
+            __m128 color = _mm_loadu_ps(&colors[i + k].r);
+#else
+            __m128 color = _mm256_cvtpd_ps(_mm256_loadu_pd(&colors[i + k].r));
+#endif
+            components[k] = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(color, scale)), lowestByte);
+        }
+
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(components[0], components[1]), _mm_packs_epi32(components[2], components[3]));
+        bytes = _mm_shuffle_epi8(bytes, dropAlpha);
+
+        _mm_storel_epi64((__m128i *)(returnBytes + 3*i), bytes);
+        int last = _mm_extract_epi32(bytes, 2);
+        memcpy(returnBytes + 3*i + 8, &last, 4);
+    }
+
+    for (; i < count; i++) {
+        convertColor(colors[i], returnBytes + 3*i);
+    }
+}
+
+
+/* convertColors() with SSE2, four colors at a time as the AVX2 version does them. Each color narrows to floats half at
+   a time, unless it is made of floats already, and without a byte shuffle the red, green and blue bytes are copied out one color at a time. */
+static void convertColorsSSE2(const Color *colors, unsigned int count, unsigned char *returnBytes) {
+    __m128 scale = _mm_set1_ps(255.0f);
+    __m128i lowestByte = _mm_set1_epi32(0xff);
+
+    unsigned int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i components [4];
+
+        for (int k = 0; k < 4; k++) {
+#ifdef SINGLE_PRECISION
+            __m128 color = _mm_loadu_ps(&colors[i + k].r);
+#else
+            __m128 color = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(&colors[i + k].r)), _mm_cvtpd_ps(_mm_loadu_pd(&colors[i + k].b)));
+#endif
+            components[k] = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(color, scale)), lowestByte);
+        }
+
+        alignas(16) unsigned char bytes [16];
+        _mm_store_si128((__m128i *)bytes, _mm_packus_epi16(_mm_packs_epi32(components[0], components[1]), _mm_packs_epi32(components[2], components[3])));
+
+        for (int k = 0; k < 4; k++) {
+            memcpy(returnBytes + 3*(i + k), bytes + 4*k, 3);
+        }
+    }
+
+    for (; i < count; i++) {
+        convertColor(colors[i], returnBytes + 3*i);
+    }
+}
+
+#endif
+
+
+/* Converts COUNT colors into three bytes each, red, green and blue, placed one color after another into RETURN_BYTES,
+   exactly as drawPixel() converts the color it is given. WIDTH is the number of colors converted at once, 0 for the
+   widest. */
+void convertColors(const Color *colors, unsigned int count, unsigned char *returnBytes, int width) {
+#if defined(__x86_64__) || defined(__i386__)
+    width = getKernelWidth(width);
+
+    if (width >= 4) {
+        convertColorsAVX2(colors, count, returnBytes);
+        return;
+    }
+    if (width >= 2) {
+        convertColorsSSE2(colors, count, returnBytes);
+        return;
+    }
+#endif
+
+    for (unsigned int i = 0; i < count; i++) {
+        convertColor(colors[i], returnBytes + 3*i);
+    }
+}
@@ -0,0 +1,89 @@
+/* Contains declarations for kernels that test rays against batches of primitives with SIMD instructions, several
+   primitives or several rays at a time, giving exactly the same results as testing them one at a time. */
+
+#ifndef KERNELS
+#define KERNELS
+
+	#include <cmath>
+
+	#include "color.h"
+
+
+	/* What the kernels place into their results for a ray that misses. Farther than any hit. */
+	#define KERNEL_MISS HUGE_VAL
+
+	/* Most primitives acceleration structures pass to a kernel at once. */
+	#define KERNEL_BATCH_SIZE 8
+
+
+	/* Most rays intersectRaysWithBox() tests at once: one per bit of the mask it returns. */
+	#define KERNEL_MAX_RAYS 64
+
+	/* Number of triangles in a TrianglePacket: as many doubles as an AVX2 register holds, or floats as an SSE one does. */
+	#define KERNEL_PACKET_WIDTH 4
+
+
+	/* Up to KERNEL_PACKET_WIDTH triangles stored side by side, for intersectTrianglePacket(). vertex0[axis][i] is coordinate
+	   AXIS of corner 0 of triangle I, and edge1[axis][i] and edge2[axis][i] the same coordinate of the edges from corner 0
+	   to corners 1 and 2, as the Triangle worked them out. Unused triangles are all zeros, which no ray hits. */
+	struct alignas(32) TrianglePacket {
+		Scalar vertex0 [3][KERNEL_PACKET_WIDTH];
+		Scalar edge1 [3][KERNEL_PACKET_WIDTH];
+		Scalar edge2 [3][KERNEL_PACKET_WIDTH];
+	};
+
+
+	/* Tests the ray from RAY_START along RAY_DIRECTION against COUNT spheres, sphere i centered at (CENTER_X[i],
+	   CENTER_Y[i], CENTER_Z[i]) with radius RADIUS[i], and places into RETURN_T[i] the ray parameter at which the ray
+	   meets sphere i, computed exactly as Sphere::intersect() does, or KERNEL_MISS if it doesn't.
+
+	   WIDTH is the number of spheres tested at once: 8 with AVX-512, 4 with AVX2, 2 with SSE2, or 1 without SIMD. 0
+	   picks the widest the instruction set in use allows, which is the best the processor supports unless cpu.h has
+	   been told otherwise, and a wider width falls back to that one. In single precision, the same widths pick the
+	   same instruction sets, whose registers hold, and test, twice as many. */
+	void intersectSpheres(const Scalar rayStart[3], const Scalar rayDirection[3], const Scalar *centerX, const Scalar *centerY,
+	                      const Scalar *centerZ, const Scalar *radius, unsigned int count, Scalar *returnT, int width);
+
+	/* Tests COUNT rays, ray i from (START_X[i], START_Y[i], START_Z[i]) along (DIRECTION_X[i], DIRECTION_Y[i],
+	   DIRECTION_Z[i]), against the sphere centered at CENTER with radius RADIUS, and places into RETURN_T[i] the ray
+	   parameter at which ray i meets it, computed exactly as Sphere::intersect() does, or KERNEL_MISS if it doesn't.
+	   WIDTH is the number of rays tested at once, as for intersectSpheres(). */
+	void intersectRaysWithSphere(const Scalar *startX, const Scalar *startY, const Scalar *startZ, const Scalar *directionX,
+	                             const Scalar *directionY, const Scalar *directionZ, unsigned int count, const Scalar center[3],
+	                             Scalar radius, Scalar *returnT, int width);
+
+
+	/* Tests the ray from RAY_START along RAY_DIRECTION against every triangle of PACKET at once, computing exactly what
+	   Triangle::intersect() does, and returns a mask with bit i set if the ray hits triangle i. If it hits any, places
+	   the closest into RETURN_LANE, the first of those at exactly the same distance, and the ray parameter and
+	   barycentric coordinates of the hit into RETURN_T, RETURN_U and RETURN_V.
+
+	   WIDTH is the number of triangles tested at once: 4 with AVX2, 2 with SSE2, or 1 without SIMD, as for
+	   intersectSpheres(). A packet holds no more than 4, so AVX-512 uses the AVX2 code. In single precision, the 4
+	   fit into one SSE register, and every width above 1 uses the SSE2 code. */
+	unsigned int intersectTrianglePacket(const TrianglePacket &packet, const Scalar rayStart[3], const Scalar rayDirection[3],
+	                                     unsigned int &returnLane, Scalar &returnT, Scalar &returnU, Scalar &returnV, int width);
+
+
+	/* Tests COUNT rays, at most KERNEL_MAX_RAYS of them, against the box from LOWER to UPPER, ray i starting at (START_X[i],
+	   START_Y[i], START_Z[i]) with the reciprocals of its direction's components in (INVERSE_X[i], INVERSE_Y[i],
+	   INVERSE_Z[i]), and returns a mask with bit i set if ray i enters the box somewhere in [0, MAX_T[i]], computed
+	   exactly as intersectRay() does. Only the rays whose bit is set in ACTIVE are tested; the rest are left clear.
+	   Boxes are kept in double precision in either build, so this kernel always works in doubles.
+
+	   WIDTH is the number of rays tested at once: 8 with AVX-512, 4 with AVX2, 2 with SSE2, or 1 without SIMD, as for
+	   intersectSpheres(). */
+	unsigned long long intersectRaysWithBox(const double lower[3], const double upper[3], const double *startX, const double *startY,
+	                                        const double *startZ, const double *inverseX, const double *inverseY, const double *inverseZ,
+	                                        const double *maxT, unsigned int count, unsigned long long active, int width);
+
+
+
+	/* Converts COUNT colors into three bytes each, red, green and blue, placed one color after another into RETURN_BYTES,
+	   exactly as drawPixel() converts the color it is given: each component is narrowed to a float, multiplied by 255,
+	   and cut down to the lowest byte of its integer part. WIDTH is the number of colors converted at once: 4 with AVX2,
+	   2 with SSE2, or 1 without SIMD, as for intersectSpheres(). */
+	void convertColors(const Color *colors, unsigned int count, unsigned char *returnBytes, int width);
+
+
+#endif
@@ -0,0 +1,522 @@
+/* Contains definitions for a linear bounding volume hierarchy (LBVH), built in parallel from sorted Morton codes.
+   The tree is built following Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees". */
+
+#include <vector> /* STL vector. */
+#include <atomic>
+#include <climits>
+
+#include "lbvh.h"
+#include "bvh.h"
+#include "boundingbox.h"
+#include "parallel.h"
+#include "sceneobject.h"
+#include "misc.h"
+
+using namespace std;
+
+
+/* Subtrees over this many objects or fewer are turned into a single leaf. */
+#define LBVH_MAX_LEAF_SIZE 4
+
+/* Scenes with at most this many objects use 30-bit Morton codes (10 bits per axis), which sort in 4 passes. Larger
+   scenes use 63-bit codes (21 bits per axis), which take 8 passes but keep distinct objects from sharing a code. */
+#define LBVH_SHORT_CODE_LIMIT (1 << 18)
+
+/* Number of bits sorted in each radix sort pass. */
+#define LBVH_RADIX_BITS 8
+#define LBVH_RADIX_SIZE (1 << LBVH_RADIX_BITS)
+
+/* Marks a child reference as referring to a single object rather than to a node of the radix tree. */
+#define LBVH_LEAF_FLAG 0x80000000u
+
+/* Marks the root of the radix tree, which has no parent. */
+#define LBVH_NO_PARENT UINT_MAX
+
+
+
+/*
+----------------------
+    Parallel stages.
+----------------------
+*/
+
+
+/* A node of the binary radix tree built from the sorted codes. Internal node i of n-1 always covers the
+   sorted objects [first, last] and has both children; a child is either another node or a single object. */
+struct RadixNode {
+    unsigned int left;
+    unsigned int right;
+    unsigned int parent;
+    unsigned int first;
+    unsigned int last;
+
+    /* Filled in bottom-up once both children are done. */
+    BoundingBox bounds;
+
+    /* Number of BVHNodes the subtree turns into once small subtrees are collapsed into leaves. */
+    unsigned int nodeCount;
+};
+
+
+/* Everything the parallel stages of the build read and write. */
+struct LBVHBuild {
+    const vector <BuildPrimitive> *primitives;
+
+    /* Box around every object's center, split into one box per chunk until they're merged. */
+    BoundingBox centerBounds;
+    vector <BoundingBox> chunkCenterBounds;
+
+    /* Bits per axis of the Morton codes. */
+    int bitsPerAxis;
+
+    /* Morton code of each object, and the index of the object in PRIMITIVES, sorted together by code. */
+    vector <unsigned long long> codes;
+    vector <unsigned int> order;
+
+    /* Buffers the radix sort scatters into, swapped with CODES and ORDER after every pass. */
+    vector <unsigned long long> codesBuffer;
+    vector <unsigned int> orderBuffer;
+
+    /* Radix sort state for the current pass: the bit where its digit starts, and per-chunk digit counts
+       that become per-chunk scatter offsets. */
+    int shift;
+    vector <unsigned int> histograms;
+
+    /* The radix tree, the parent of each object, and how many children of each node are done. */
+    vector <RadixNode> radixNodes;
+    vector <unsigned int> leafParents;
+    atomic <int> *visits;
+
+    /* Output of the build, and the compiled objects the leaves refer to. */
+    vector <BVHNode> *nodes;
+    vector <PrimitiveRef> *primitiveIndices;
+    const CompiledScene *scene;
+
+    /* Subtrees that are written out in parallel: each child reference and the node index its root goes to. */
+    vector <unsigned int> taskChildren;
+    vector <unsigned int> taskPositions;
+};
+
+
+/* Finds the box around the centers of each chunk of objects. */
+static void findCenterBounds(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    LBVHBuild &build = *(LBVHBuild *)context;
+    BoundingBox box = getEmptyBoundingBox();
+
+    for (unsigned int i = begin; i < end; i++) {
+        const BuildPrimitive &primitive = (*build.primitives)[i];
+
+        for (int axis = 0; axis < 3; axis++) {
+            if (primitive.center[axis] < box.lower[axis]) {
+                box.lower[axis] = primitive.center[axis];
+            }
+            if (primitive.center[axis] > box.upper[axis]) {
+                box.upper[axis] = primitive.center[axis];
+            }
+        }
+    }
+
+    build.chunkCenterBounds[chunk] = box;
+}
+
+
+/* Computes the Morton code of each object's center. */
+static void computeCodes(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    LBVHBuild &build = *(LBVHBuild *)context;
+    const BoundingBox &box = build.centerBounds;
+
+    for (unsigned int i = begin; i < end; i++) {
+        const double *center = (*build.primitives)[i].center;
+
+        unsigned long long x = quantize(center[0], box.lower[0], box.upper[0], build.bitsPerAxis);
+        unsigned long long y = quantize(center[1], box.lower[1], box.upper[1], build.bitsPerAxis);
+        unsigned long long z = quantize(center[2], box.lower[2], box.upper[2], build.bitsPerAxis);
+
+        if (build.bitsPerAxis == 10) {
+            build.codes[i] = (spreadBits10(x) << 2) | (spreadBits10(y) << 1) | spreadBits10(z);
+        }
+        else {
+            build.codes[i] = (spreadBits21(x) << 2) | (spreadBits21(y) << 1) | spreadBits21(z);
+        }
+        build.order[i] = i;
+    }
+}
+
+
+/* Counts how many codes in each chunk have each value of the current digit. */
+static void countDigits(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    LBVHBuild &build = *(LBVHBuild *)context;
+    unsigned int *histogram = &build.histograms[chunk * LBVH_RADIX_SIZE];
+
+    for (unsigned int digit = 0; digit < LBVH_RADIX_SIZE; digit++) {
+        histogram[digit] = 0;
+    }
+
+    for (unsigned int i = begin; i < end; i++) {
+        histogram[(build.codes[i] >> build.shift) & (LBVH_RADIX_SIZE-1)]++;
+    }
+}
+
+
+/* Moves each chunk's codes to their sorted place for the current digit, keeping equal digits in order. */
+static void scatterDigits(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    LBVHBuild &build = *(LBVHBuild *)context;
+    unsigned int *offsets = &build.histograms[chunk * LBVH_RADIX_SIZE];
+
+    for (unsigned int i = begin; i < end; i++) {
+        unsigned int digit = (build.codes[i] >> build.shift) & (LBVH_RADIX_SIZE-1);
+        unsigned int destination = offsets[digit]++;
+
+        build.codesBuffer[destination] = build.codes[i];
+        build.orderBuffer[destination] = build.order[i];
+    }
+}
+
+
+/* Returns the length of the prefix the sorted codes at I and J share, or -1 if J is out of range.
+   Equal codes are told apart by their positions, so every pair of objects differs somewhere. */
+static int getCommonPrefix(const LBVHBuild &build, int i, int j) {
+    if (j < 0 || j >= (int)build.codes.size()) {
+        return -1;
+    }
+
+    unsigned long long difference = build.codes[i] ^ build.codes[j];
+
+    if (difference == 0) {
+        return 64 + __builtin_clz((unsigned int)(i ^ j));
+    }
+    return __builtin_clzll(difference);
+}
+
+
+/* Finds the range and children of each internal node of the radix tree. Each node is found independently. */
+static void buildRadixNodes(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    LBVHBuild &build = *(LBVHBuild *)context;
+
+    for (unsigned int node = begin; node < end; node++) {
+        int i = node;
+
+        /* The node's range extends from i in the direction of the neighbor sharing the longer prefix. */
+        int direction = (getCommonPrefix(build, i, i+1) - getCommonPrefix(build, i, i-1) >= 0) ? 1 : -1;
+        int minimumPrefix = getCommonPrefix(build, i, i-direction);
+
+        /* Find an upper bound on the length of the range, then binary search for the other end. */
+        int maximumLength = 2;
+        while (getCommonPrefix(build, i, i + maximumLength*direction) > minimumPrefix) {
+            maximumLength *= 2;
+        }
+
+        int length = 0;
+        for (int step = maximumLength/2; step >= 1; step /= 2) {
+            if (getCommonPrefix(build, i, i + (length+step)*direction) > minimumPrefix) {
+                length += step;
+            }
+        }
+
+        int j = i + length*direction;
+
+        /* Binary search for where the objects' shared prefix ends, which is where the range splits. */
+        int nodePrefix = getCommonPrefix(build, i, j);
+        int split = 0;
+        int divisor = 2;
+        int step;
+
+        do {
+            step = (length + divisor - 1) / divisor;
+            if (getCommonPrefix(build, i, i + (split+step)*direction) > nodePrefix) {
+                split += step;
+            }
+            divisor *= 2;
+        } while (step > 1);
+
+        int gamma = i + split*direction + ((direction < 0) ? -1 : 0);
+
+        RadixNode &radixNode = build.radixNodes[node];
+        radixNode.first = (i < j) ? i : j;
+        radixNode.last = (i < j) ? j : i;
+
+        if ((int)radixNode.first == gamma) {
+            radixNode.left = gamma | LBVH_LEAF_FLAG;
+            build.leafParents[gamma] = node;
+        }
+        else {
+            radixNode.left = gamma;
+            build.radixNodes[gamma].parent = node;
+        }
+
+        if ((int)radixNode.last == gamma+1) {
+            radixNode.right = (gamma+1) | LBVH_LEAF_FLAG;
+            build.leafParents[gamma+1] = node;
+        }
+        else {
+            radixNode.right = gamma+1;
+            build.radixNodes[gamma+1].parent = node;
+        }
+    }
+}
+
+
+/* Returns the box around the child referred to by CHILD. */
+static const BoundingBox& getChildBounds(const LBVHBuild &build, unsigned int child) {
+    if (child & LBVH_LEAF_FLAG) {
+        return (*build.primitives)[build.order[child & ~LBVH_LEAF_FLAG]].bounds;
+    }
+    return build.radixNodes[child].bounds;
+}
+
+
+/* Returns the number of BVHNodes the child referred to by CHILD turns into. */
+static unsigned int getChildNodeCount(const LBVHBuild &build, unsigned int child) {
+    if (child & LBVH_LEAF_FLAG) {
+        return 1;
+    }
+    return build.radixNodes[child].nodeCount;
+}
+
+
+/* Returns true if the child referred to by CHILD becomes a leaf of the BVH. */
+static bool isLeaf(const LBVHBuild &build, unsigned int child) {
+    if (child & LBVH_LEAF_FLAG) {
+        return true;
+    }
+    return build.radixNodes[child].last - build.radixNodes[child].first + 1 <= LBVH_MAX_LEAF_SIZE;
+}
+
+
+/* Walks up from each object, finishing every node whose other child is already done. Whichever of a node's two
+   children finishes second computes the node, so each node is computed exactly once, after both of its children. */
+static void propagateBounds(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    LBVHBuild &build = *(LBVHBuild *)context;
+
+    for (unsigned int leaf = begin; leaf < end; leaf++) {
+        unsigned int node = build.leafParents[leaf];
+
+        while (node != LBVH_NO_PARENT) {
+            if (build.visits[node].fetch_add(1, memory_order_acq_rel) == 0) {
+                break;
+            }
+
+            RadixNode &radixNode = build.radixNodes[node];
+
+            radixNode.bounds = getChildBounds(build, radixNode.left);
+            expand(radixNode.bounds, getChildBounds(build, radixNode.right));
+
+            if (isLeaf(build, node)) {
+                radixNode.nodeCount = 1;
+            }
+            else {
+                radixNode.nodeCount = 1 + getChildNodeCount(build, radixNode.left) + getChildNodeCount(build, radixNode.right);
+            }
+
+            node = radixNode.parent;
+        }
+    }
+}
+
+
+/* Writes the BVHNode for the child referred to by CHILD into POSITION. If the child isn't a leaf, appends its own
+   children and their positions to CHILDREN and POSITIONS; the left child directly follows its parent. */
+static void writeNode(LBVHBuild &build, unsigned int child, unsigned int position, vector <unsigned int> &children, vector <unsigned int> &positions) {
+    BVHNode &node = (*build.nodes)[position];
+    node.bounds = getChildBounds(build, child);
+
+    if (child & LBVH_LEAF_FLAG) {
+        node.offset = child & ~LBVH_LEAF_FLAG;
+        node.primitiveCount = 1;
+        return;
+    }
+
+    const RadixNode &radixNode = build.radixNodes[child];
+
+    if (isLeaf(build, child)) {
+        node.offset = radixNode.first;
+        node.primitiveCount = radixNode.last - radixNode.first + 1;
+        return;
+    }
+
+    unsigned int rightPosition = position + 1 + getChildNodeCount(build, radixNode.left);
+
+    node.offset = rightPosition;
+    node.primitiveCount = 0;
+
+    children.push_back(radixNode.left);
+    positions.push_back(position + 1);
+    children.push_back(radixNode.right);
+    positions.push_back(rightPosition);
+}
+
+
+/* Writes out each chunk of subtrees depth-first. */
+static void writeSubtrees(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    LBVHBuild &build = *(LBVHBuild *)context;
+    vector <unsigned int> children;
+    vector <unsigned int> positions;
+
+    for (unsigned int task = begin; task < end; task++) {
+        children.push_back(build.taskChildren[task]);
+        positions.push_back(build.taskPositions[task]);
+
+        while (!children.empty()) {
+            unsigned int child = children.back();
+            unsigned int position = positions.back();
+            children.pop_back();
+            positions.pop_back();
+
+            writeNode(build, child, position, children, positions);
+        }
+    }
+}
+
+
+/* Replaces each leaf's position in the sorted order with the PrimitiveRef of its object. */
+static void writePrimitiveIndices(void *context, unsigned int chunk, unsigned int begin, unsigned int end) {
+    LBVHBuild &build = *(LBVHBuild *)context;
+
+    for (unsigned int i = begin; i < end; i++) {
+        (*build.primitiveIndices)[i] = build.scene->getRef((*build.primitives)[build.order[i]].index);
+    }
+}
+
+
+
+/*
+----------------------
+    LBVH methods.
+----------------------
+*/
+
+
+/* Default constructor. The LBVH is empty until build() is called. */
+LBVH::LBVH (void) {
+}
+
+
+/* Builds the LBVH over OBJECTS, replacing anything built before. */
+void LBVH::build(const vector <SceneObject *> &objects) {
+
+    vector <BuildPrimitive> primitives;
+    gatherPrimitives(objects, primitives);
+
+    unsigned int count = primitives.size();
+
+    if (count == 0) {
+        packLeaves();
+        return;
+    }
+
+    LBVHBuild build;
+    build.primitives = &primitives;
+    build.nodes = &nodes;
+    build.primitiveIndices = &primitiveIndices;
+    build.scene = &scene;
+    build.bitsPerAxis = (count <= LBVH_SHORT_CODE_LIMIT) ? 10 : 21;
+
+    unsigned int chunkCount = getThreadCount();
+
+    /* Find the box the codes are quantized within. */
+    build.chunkCenterBounds.resize(chunkCount, getEmptyBoundingBox());
+    parallelFor(count, findCenterBounds, &build);
+
+    build.centerBounds = getEmptyBoundingBox();
+    for (unsigned int i = 0; i < chunkCount; i++) {
+        expand(build.centerBounds, build.chunkCenterBounds[i]);
+    }
+
+    /* Compute the codes and sort the objects by them, one digit at a time starting from the lowest. */
+    build.codes.resize(count);
+    build.order.resize(count);
+    build.codesBuffer.resize(count);
+    build.orderBuffer.resize(count);
+    build.histograms.resize(chunkCount * LBVH_RADIX_SIZE);
+
+    parallelFor(count, computeCodes, &build);
+
+    for (build.shift = 0; build.shift < 3*build.bitsPerAxis; build.shift += LBVH_RADIX_BITS) {
+        parallelFor(count, countDigits, &build);
+
+        /* Turn the counts into the place each chunk starts writing each digit: all smaller digits come first,
+           then the same digit from earlier chunks. */
+        unsigned int offset = 0;
+        for (unsigned int digit = 0; digit < LBVH_RADIX_SIZE; digit++) {
+            for (unsigned int chunk = 0; chunk < chunkCount; chunk++) {
+                unsigned int digitCount = build.histograms[chunk*LBVH_RADIX_SIZE + digit];
+                build.histograms[chunk*LBVH_RADIX_SIZE + digit] = offset;
+                offset += digitCount;
+            }
+        }
+
+        parallelFor(count, scatterDigits, &build);
+
+        build.codes.swap(build.codesBuffer);
+        build.order.swap(build.orderBuffer);
+    }
+
+    nodes.resize(1);
+    primitiveIndices.resize(count);
+    parallelFor(count, writePrimitiveIndices, &build);
+
+    /* A single object needs no tree. */
+    if (count == 1) {
+        nodes[0].bounds = primitives[0].bounds;
+        nodes[0].offset = 0;
+        nodes[0].primitiveCount = 1;
+        packLeaves();
+        return;
+    }
+
+    /* Build the radix tree, then fill in its boxes from the bottom up. */
+    build.radixNodes.resize(count-1);
+    build.leafParents.resize(count);
+    build.radixNodes[0].parent = LBVH_NO_PARENT;
+
+    parallelFor(count-1, buildRadixNodes, &build);
+
+    build.visits = new atomic <int> [count-1];
+    for (unsigned int i = 0; i < count-1; i++) {
+        build.visits[i].store(0, memory_order_relaxed);
+    }
+
+    parallelFor(count, propagateBounds, &build);
+
+    delete [] build.visits;
+
+    /* Write out the top of the tree until there are enough subtrees to keep every core busy, then write
+       the subtrees in parallel. Each subtree's size is known, so each knows where its nodes go. */
+    nodes.resize(build.radixNodes[0].nodeCount);
+
+    vector <unsigned int> children;
+    vector <unsigned int> positions;
+    children.push_back(0);
+    positions.push_back(0);
+
+    while (children.size() < 4*chunkCount) {
+        vector <unsigned int> nextChildren;
+        vector <unsigned int> nextPositions;
+        bool split = false;
+
+        for (unsigned int i = 0; i < children.size(); i++) {
+            if (isLeaf(build, children[i])) {
+                nextChildren.push_back(children[i]);
+                nextPositions.push_back(positions[i]);
+            }
+            else {
+                writeNode(build, children[i], positions[i], nextChildren, nextPositions);
+                split = true;
+            }
+        }
+
+        children.swap(nextChildren);
+        positions.swap(nextPositions);
+
+        if (!split) {
+            break;
+        }
+    }
+
+    build.taskChildren = children;
+    build.taskPositions = positions;
+
+    parallelFor(children.size(), writeSubtrees, &build);
+
+    packLeaves();
+}
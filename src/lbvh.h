@@ -0,0 +1,29 @@
+/* Contains declarations for a linear bounding volume hierarchy (LBVH), a BVH that is built quickly in parallel
+   by sorting objects along a space-filling curve. */
+
+#ifndef LBVH_HEADER
+#define LBVH_HEADER
+
+	#include <vector> /* STL vector. */
+	#include "bvh.h"
+	#include "sceneobject.h"
+
+	using namespace std;
+
+
+	/* A BVH whose tree is built from the Morton codes of the objects' centers rather than by weighing split
+	   costs. Morton codes interleave the bits of the x, y, and z coordinates, so sorting by them groups nearby
+	   objects together, and the tree falls out of the bits the sorted codes share. Every step runs on all cores.
+	   It builds far faster than the BVH's SAH builder, at the cost of a tree that is somewhat slower to trace. */
+	class LBVH : public BVH {
+
+		public:
+			/* Default constructor. The LBVH is empty until build() is called. */
+			LBVH (void);
+
+			/* Builds the LBVH over OBJECTS, replacing anything built before. */
+			void build(const vector <SceneObject *> &objects);
+	};
+
+
+#endif
@@ -74,7 +74,7 @@ PointLight::PointLight(double intensity, double falloff, double x, double y, dou
 
 
 /* Returns the color of the light at POINT. */
-Color PointLight::getColor(const Vector &point) const {
+Color PointLight::getColor(const Point3 &point) const {
     double distance = (point - this->position).magnitude();
 
     /* intensity/attenuation */
@@ -84,7 +84,7 @@ Color PointLight::getColor(const Vector &point) const {
 
 
 /* Returns the intensity of the light at POINT. */
-double PointLight::getIntensity(const Vector &point) const {
+double PointLight::getIntensity(const Point3 &point) const {
     double distance = (point - this->position).magnitude();
 
     /* intensity/attenuation */
@@ -95,14 +95,33 @@ double PointLight::getIntensity(const Vector &point) const {
 /* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects 
      this light. If it does, returns true and modifies RETURN_INTERSECTION_POINT with the point of intersection. 
      Otherwise, returns false. */
-bool PointLight::checkIntersection(const Vector &point, const Vector &direction, Vector &returnIntersectionPoint) const {
+bool PointLight::checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const {
+    HitRecord hit;
+
+    if (!intersect(point, direction, hit)) {
+        return false;
+    }
+
+    returnIntersectionPoint = hit.point;
+    return true;
+}
+
+
+/* Takes a point and a direction from that point, and calculates whether the ray defined by them points at
+   this light. If it does, returns true and fills in RETURN_HIT, whose point is the light's position and whose
+   T is the light's distance over the length of DIRECTION. Otherwise, returns false. */
+bool PointLight::intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const {
 
     /* Angle between the ray's direction vector and the vector from the ray's origin to the light position. */
     double angle = direction.dotProduct((this->position - point).normalize());
 
     /* If this angle is close to 1.0, then the vectors point the same way and the ray is considered to hit the light source. */
     if (angle >= 0.999 && angle <= 1.001) {
-        returnIntersectionPoint = this->position;
+        returnHit.t = point.distance(this->position) / direction.magnitude();
+        returnHit.point = this->position;
+        returnHit.primitive = 0;
+        returnHit.u = 0.0;
+        returnHit.v = 0.0;
         return true;
     }
     
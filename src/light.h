@@ -6,7 +6,7 @@
 	#include "sceneobject.h"
 	#include "material.h"
 	#include "geometry.h"
-	#include "vector.h" /* My own implementation of a 4x1 vector. */
+	#include "vec3.h" /* Header-only 3 component vector for points and directions. */
 	#include "color.h"
 	
 
@@ -35,16 +35,21 @@
 
 
 			/* Returns the color of the light at POINT. */
-			Color getColor(const Vector &point) const;
+			Color getColor(const Point3 &point) const;
 
 			/* Returns the intensity of the light at POINT. */
-			double getIntensity(const Vector &point) const;
+			double getIntensity(const Point3 &point) const;
 
 
 			/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects 
 	  		   this sphere. If it does, returns true and modifies RETURN_INTERSECTION_POINT with the point of intersection. 
 	   		   Otherwise, returns false. */
-			bool checkIntersection(const Vector &point, const Vector &direction, Vector &returnIntersectionPoint) const;
+			bool checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const;
+
+			/* Takes a point and a direction from that point, and calculates whether the ray defined by them points at
+			   this light. If it does, returns true and fills in RETURN_HIT, whose point is the light's position and whose
+			   T is the light's distance over the length of DIRECTION. Otherwise, returns false. */
+			bool intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const;
 
 
 			/* Print member function. */
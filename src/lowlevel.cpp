@@ -47,6 +47,19 @@ void drawPixel(int x, int y, GLfloat r, GLfloat g, GLfloat b) {
   canvas[3*CANVAS_WIDTH*(y)+3*(x)+BLUE] = (char)(b*255);
 }
 
+/* draw COUNT pixels up column X from row Y, given as 3 bytes each of red, green and blue in RGB,
+   such as convertColors() makes */
+void drawPixels(int x, int y, int count, const GLubyte *rgb) {
+  int k;
+
+  for (k = 0; k < count; k++) {
+    if ((x < 0) || (x >= CANVAS_WIDTH) || (y+k < 0) || (y+k >= CANVAS_HEIGHT)) continue;
+    canvas[3*CANVAS_WIDTH*(y+k)+3*(x)+RED] = rgb[3*k+RED];
+    canvas[3*CANVAS_WIDTH*(y+k)+3*(x)+GREEN] = rgb[3*k+GREEN];
+    canvas[3*CANVAS_WIDTH*(y+k)+3*(x)+BLUE] = rgb[3*k+BLUE];
+  }
+}
+
 /* draw the canvas array on the screen */
 void flushCanvas() {
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
@@ -54,3 +67,22 @@ void flushCanvas() {
   glDrawPixels(CANVAS_WIDTH,CANVAS_HEIGHT,GL_RGB,GL_UNSIGNED_BYTE,canvas);
 }
 
+/* write the canvas to a binary PPM image file, top row first.
+   returns 0 on success and -1 if the file can't be written */
+int writeCanvas(const char *filename) {
+  FILE *file;
+  int y;
+
+  file = fopen(filename, "wb");
+  if (file == NULL) return -1;
+  fprintf(file, "P6\n%d %d\n255\n", CANVAS_WIDTH, CANVAS_HEIGHT);
+  for (y = CANVAS_HEIGHT-1; y >= 0; y--) {
+    fwrite(&canvas[3*CANVAS_WIDTH*y], sizeof(GLubyte), 3*CANVAS_WIDTH, file);
+  }
+  return (fclose(file) == 0) ? 0 : -1;
+}
+
+/* return the canvas array, 3 bytes per pixel from the bottom row up */
+const GLubyte *getCanvas(void) {
+  return canvas;
+}
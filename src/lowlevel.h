@@ -9,6 +9,9 @@
 /* lowlevel drawing funtions */
 void initCanvas(int, int);
 void drawPixel(int, int, GLfloat, GLfloat, GLfloat);
+void drawPixels(int, int, int, const GLubyte *);
 void flushCanvas(void);
+int writeCanvas(const char *);
+const GLubyte *getCanvas(void);
 
 #endif	/* _LOWLEVEL_H_ */
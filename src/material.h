@@ -4,6 +4,8 @@
 #define MATERIAL
 
 	#include <iostream>
+
+	#include "scalar.h"
 	#include <cstdio>
 
 	#include "color.h"
@@ -16,17 +18,17 @@
 		struct Color color;
 
 		/* Components of the Phong Lighting Model. Should be between 0.0 and 1.0. */
-		double ambient; 
-		double specular;
-		double diffuse;
+		Scalar ambient; 
+		Scalar specular;
+		Scalar diffuse;
 
 
 		/* Should be between 0.0 and 500.0. Used with specular highlights; determines how mirror-like the surface is. */
-		double shininess; 
+		Scalar shininess; 
 
 		/* Should be between 0.0 and 3.0. The refraction index of the material; determines how light bends through the object.
 		   A value of 1.0 gives no bending (like air). Refraction is only used if the object is translucent. */
-		double refraction; 
+		Scalar refraction; 
 	};
 
 
@@ -4,9 +4,15 @@
 #include <iostream>
 #include <cstdio>
 #include <cassert>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #include "vector.h"
 #include "matrix.h"
+#include "cpu.h"
 
 
 using namespace std;
@@ -19,152 +25,43 @@ using namespace std;
 
 /* Default contructor. Initializes a 4x4 matrix with zeroes for all entries. */
 Matrix::Matrix () {
-	m00 = 0; m01 = 0; m02 = 0; m03 = 0;
-	m10 = 0; m11 = 0; m12 = 0; m13 = 0;
-	m20 = 0; m21 = 0; m22 = 0; m23 = 0;
-	m30 = 0; m31 = 0; m32 = 0; m33 = 0;
-
-	/* Initialize elements of entry pointer array. */
-
-	/* Row 1. */
-	entryPointers[0] = &m00; 
-	entryPointers[1] = &m01; 
-	entryPointers[2] = &m02; 
-	entryPointers[3] = &m03;
-
-	/* Row 2. */
-	entryPointers[4] = &m10,
-	entryPointers[5] = &m11; 
-	entryPointers[6] = &m12; 
-	entryPointers[7] = &m13;
-
-	/* Row 3. */
-	entryPointers[8] =  &m20,
-	entryPointers[9] =  &m21; 
-	entryPointers[10] = &m22; 
-	entryPointers[11] = &m23;
-
-	/* Row 4. */
-	entryPointers[12] =	&m30;
-	entryPointers[13] = &m31;
-	entryPointers[14] = &m32;
-	entryPointers[15] = &m33;
-	
+	for (int i = 0; i < 16; i++) {
+		entries[i] = 0;
+	}
 }
 
 
 
 /* Constructor that initializes matrix entries with the supplied values. */
-Matrix::Matrix ( double value00, double value01, double value02, double value03,
-				 double value10, double value11, double value12, double value13,
-				 double value20, double value21, double value22, double value23,
-				 double value30, double value31, double value32, double value33 ) {
-
-	m00 = value00; m01 = value01; m02 = value02; m03 = value03;
-	m10 = value10; m11 = value11; m12 = value12; m13 = value13;
-	m20 = value20; m21 = value21; m22 = value22; m23 = value23;
-	m30 = value30; m31 = value31; m32 = value32; m33 = value33;
-
-	/* Initialize elements of entry pointer array. */
-
-	/* Row 1. */
-	entryPointers[0] = &m00; 
-	entryPointers[1] = &m01; 
-	entryPointers[2] = &m02; 
-	entryPointers[3] = &m03;
-
-	/* Row 2. */
-	entryPointers[4] = &m10,
-	entryPointers[5] = &m11; 
-	entryPointers[6] = &m12; 
-	entryPointers[7] = &m13;
-
-	/* Row 3. */
-	entryPointers[8] =  &m20,
-	entryPointers[9] =  &m21; 
-	entryPointers[10] = &m22; 
-	entryPointers[11] = &m23;
-
-	/* Row 4. */
-	entryPointers[12] =	&m30;
-	entryPointers[13] = &m31;
-	entryPointers[14] = &m32;
-	entryPointers[15] = &m33;
-
-}
-
-
-
-/* Copy constructor. */
-Matrix::Matrix (const Matrix &source) {
-	*this = source;
-}
-
-
-
-/* Assignment operator. */
-void Matrix::operator= (const Matrix &source) {
-
-	/* If assigning matrix to itself, terminate early. Nothing to be done. */
-	if (this == &source) {
-		return;
-	}
-
-	/* Copy all entries to SOURCE. */
-	m00 = source.m00; m01 = source.m01; m02 = source.m02; m03 = source.m03;
-	m10 = source.m10; m11 = source.m11; m12 = source.m12; m13 = source.m13;
-	m20 = source.m20; m21 = source.m21; m22 = source.m22; m23 = source.m23;
-	m30 = source.m30; m31 = source.m31; m32 = source.m32; m33 = source.m33;
-
-
-	/* Initialize elements of entry pointer array for newly assigned matrix. */
-
-	/* Row 1. */
-	entryPointers[0] = &m00; 
-	entryPointers[1] = &m01; 
-	entryPointers[2] = &m02; 
-	entryPointers[3] = &m03;
-
-	/* Row 2. */
-	entryPointers[4] = &m10;
-	entryPointers[5] = &m11; 
-	entryPointers[6] = &m12; 
-	entryPointers[7] = &m13;
-
-	/* Row 3. */
-	entryPointers[8] =  &m20;
-	entryPointers[9] =  &m21; 
-	entryPointers[10] = &m22; 
-	entryPointers[11] = &m23;
-
-	/* Row 4. */
-	entryPointers[12] =	&m30;
-	entryPointers[13] = &m31;
-	entryPointers[14] = &m32;
-	entryPointers[15] = &m33;
-
+Matrix::Matrix ( Scalar value00, Scalar value01, Scalar value02, Scalar value03,
+				 Scalar value10, Scalar value11, Scalar value12, Scalar value13,
+				 Scalar value20, Scalar value21, Scalar value22, Scalar value23,
+				 Scalar value30, Scalar value31, Scalar value32, Scalar value33 ) {
+
+	entries[0] =  value00; entries[1] =  value01; entries[2] =  value02; entries[3] =  value03;
+	entries[4] =  value10; entries[5] =  value11; entries[6] =  value12; entries[7] =  value13;
+	entries[8] =  value20; entries[9] =  value21; entries[10] = value22; entries[11] = value23;
+	entries[12] = value30; entries[13] = value31; entries[14] = value32; entries[15] = value33;
 }
 
 
 
 /* Performs matrix addition with M and returns a new matrix. */
 Matrix Matrix::operator+ (const Matrix &m) const {
-	return Matrix (
-		m00+m.m00, m01+m.m01, m02+m.m02, m03+m.m03,
-		m10+m.m10, m11+m.m11, m12+m.m12, m13+m.m13,
-		m20+m.m20, m21+m.m21, m22+m.m22, m23+m.m23,
-		m30+m.m30, m31+m.m31, m32+m.m32, m33+m.m33
-	);
+	Matrix result;
+	for (int i = 0; i < 16; i++) {
+		result.entries[i] = entries[i] + m.entries[i];
+	}
+	return result;
 }
 
 
 
 /* Performs matrix addition with M in place and returns a reference to this matrix. Modifies this matrix. */
 Matrix& Matrix::operator+= (const Matrix &m) {
-		m00+=m.m00; m01+=m.m01; m02+=m.m02; m03+=m.m03;
-		m10+=m.m10; m11+=m.m11; m12+=m.m12; m13+=m.m13;
-		m20+=m.m20; m21+=m.m21; m22+=m.m22; m23+=m.m23;
-		m30+=m.m30; m31+=m.m31; m32+=m.m32; m33+=m.m33;
+	for (int i = 0; i < 16; i++) {
+		entries[i] += m.entries[i];
+	}
 	return *this;
 }
 
@@ -172,118 +69,187 @@ Matrix& Matrix::operator+= (const Matrix &m) {
 
 /* Performs matrix subtraction with M and returns a new matrix. */
 Matrix Matrix::operator- (const Matrix &m) const {
-	return Matrix (
-		m00-m.m00, m01-m.m01, m02-m.m02, m03-m.m03,
-		m10-m.m10, m11-m.m11, m12-m.m12, m13-m.m13,
-		m20-m.m20, m21-m.m21, m22-m.m22, m23-m.m23,
-		m30-m.m30, m31-m.m31, m32-m.m32, m33-m.m33
-	);
+	Matrix result;
+	for (int i = 0; i < 16; i++) {
+		result.entries[i] = entries[i] - m.entries[i];
+	}
+	return result;
 }
 
 
 
 /* Performs matrix subtraction with M in place and returns a reference to this matrix. Modifies this matrix. */
 Matrix& Matrix::operator-= (const Matrix &m) {
-	m00-=m.m00; m01-=m.m01; m02-=m.m02; m03-=m.m03;
-	m10-=m.m10; m11-=m.m11; m12-=m.m12; m13-=m.m13;
-	m20-=m.m20; m21-=m.m21; m22-=m.m22; m23-=m.m23;
-	m30-=m.m30; m31-=m.m31; m32-=m.m32; m33-=m.m33;
-
+	for (int i = 0; i < 16; i++) {
+		entries[i] -= m.entries[i];
+	}
 	return *this;
 }
 
 
 
 /* Performs scalar multiplication with M in place and returns a reference to this matrix. Modifies this matrix. */
-Matrix& Matrix::operator*= (double value) {
-	m00*=value; m01*=value; m02*=value; m03*=value;
-	m10*=value; m11*=value; m12*=value; m13*=value;
-	m20*=value; m21*=value; m22*=value; m23*=value;
-	m30*=value; m31*=value; m32*=value; m33*=value;
-
+Matrix& Matrix::operator*= (Scalar value) {
+	for (int i = 0; i < 16; i++) {
+		entries[i] *= value;
+	}
 	return *this;
 }
 
 
 
+/* Places ROW, a row of 4 entries, times the matrix whose entries are M into RESULT. Each entry of RESULT is the sum of
+   the products of ROW with a column of M, added up from the first term to the last. Since every product is rounded
+   before it is added, working on whole rows of M at a time gives exactly the same sums. */
+static inline void multiplyRow (const Scalar *row, const Scalar *m, Scalar *result) {
+#if defined(__AVX__) && !defined(SINGLE_PRECISION)
+	__m256d sum = _mm256_mul_pd(_mm256_set1_pd(row[0]), _mm256_load_pd(m));
+	sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(row[1]), _mm256_load_pd(m + 4)));
+	sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(row[2]), _mm256_load_pd(m + 8)));
+	sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(row[3]), _mm256_load_pd(m + 12)));
+	_mm256_store_pd(result, sum);
+#elif defined(__SSE2__) && !defined(SINGLE_PRECISION)
+	for (int half = 0; half < 4; half += 2) {
+		__m128d sum = _mm_mul_pd(_mm_set1_pd(row[0]), _mm_load_pd(m + half));
+		sum = _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(row[1]), _mm_load_pd(m + 4 + half)));
+		sum = _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(row[2]), _mm_load_pd(m + 8 + half)));
+		sum = _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(row[3]), _mm_load_pd(m + 12 + half)));
+		_mm_store_pd(result + half, sum);
+	}
+#elif defined(__SSE2__)
+	__m128 sum = _mm_mul_ps(_mm_set1_ps(row[0]), _mm_load_ps(m));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[1]), _mm_load_ps(m + 4)));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[2]), _mm_load_ps(m + 8)));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[3]), _mm_load_ps(m + 12)));
+	_mm_store_ps(result, sum);
+#else
+	for (int j = 0; j < 4; j++) {
+		result[j] = row[0]*m[j] + row[1]*m[4+j] + row[2]*m[8+j] + row[3]*m[12+j];
+	}
+#endif
+}
+
+
+
 /* Performs matrix multiplication with M and returns a new matrix. Matrix multiplication IS NOT commutative. */
 Matrix Matrix::operator* (const Matrix &m) const {
-	return Matrix (
-		/* Row 1 of resultant matrix. */
-		m00*m.m00 + m01*m.m10 + m02*m.m20 + m03*m30, 
-		m00*m.m01 + m01*m.m11 + m02*m.m21 + m03*m31,
-		m00*m.m02 + m01*m.m12 + m02*m.m22 + m03*m32,
-		m00*m.m03 + m01*m.m13 + m02*m.m23 + m03*m33,
-
-		/* Row 2 of resultant matrix. */
-		m10*m.m00 + m11*m.m10 + m12*m.m20 + m13*m30, 
-		m10*m.m01 + m11*m.m11 + m12*m.m21 + m13*m31,
-		m10*m.m02 + m11*m.m12 + m12*m.m22 + m13*m32,
-		m10*m.m03 + m11*m.m13 + m12*m.m23 + m13*m33,
-
-		/* Row 3 of resultant matrix. */
-		m20*m.m00 + m21*m.m10 + m22*m.m20 + m23*m30, 
-		m20*m.m01 + m21*m.m11 + m22*m.m21 + m23*m31,
-		m20*m.m02 + m21*m.m12 + m22*m.m22 + m23*m32,
-		m20*m.m03 + m21*m.m13 + m22*m.m23 + m23*m33,
-
-		/* Row 4 of resultant matrix. */
-		m30*m.m00 + m31*m.m10 + m32*m.m20 + m33*m30, 
-		m30*m.m01 + m31*m.m11 + m32*m.m21 + m33*m31, 
-		m30*m.m02 + m31*m.m12 + m32*m.m22 + m33*m32, 
-		m30*m.m03 + m31*m.m13 + m32*m.m23 + m33*m33 
-	);
+	Matrix result;
+	for (int i = 0; i < 4; i++) {
+		multiplyRow(entries + 4*i, m.entries, result.entries + 4*i);
+	}
+	return result;
 }
 
 
 
 /* Transposes the matrix in place and returns a reference to this matrix. Modifies this matrix. */
 Matrix& Matrix::transpose (void) {
-	double temp;
-
-	temp = m10; m10 = m01; m01 = temp;
-	temp = m20; m20 = m02; m02 = temp;
-	temp = m30; m30 = m03; m03 = temp;
-	temp = m21; m21 = m12; m12 = temp;
-	temp = m31; m31 = m13; m13 = temp;
-	temp = m32; m32 = m23; m23 = temp;
+	for (int i = 0; i < 4; i++) {
+		for (int j = i+1; j < 4; j++) {
+			Scalar temp = entries[4*i + j];
+			entries[4*i + j] = entries[4*j + i];
+			entries[4*j + i] = temp;
+		}
+	}
 
 	return *this;
 }
 
 
 
+/* Returns the inverse of this matrix, which undoes the transformation it does. If the matrix has no inverse,
+   RETURN_INVERTIBLE is set to false and the zero matrix is returned. */
+Matrix Matrix::inverse (bool &returnInvertible) const {
+
+	/* Gauss-Jordan elimination on this matrix with the identity matrix beside it. Once the left half has been
+	   reduced to the identity, the right half holds the inverse. */
+	Scalar rows [4][8];
+
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			rows[i][j] = getEntry(i, j);
+			rows[i][j+4] = (i == j) ? 1.0 : 0.0;
+		}
+	}
+
+	for (int column = 0; column < 4; column++) {
+
+		/* Swap up the row with the largest entry in this column, which keeps rounding error small. */
+		int pivot = column;
+		for (int i = column+1; i < 4; i++) {
+			if (fabs(rows[i][column]) > fabs(rows[pivot][column])) {
+				pivot = i;
+			}
+		}
+
+		if (rows[pivot][column] == 0.0) {
+			returnInvertible = false;
+			return Matrix();
+		}
+
+		for (int j = 0; j < 8; j++) {
+			Scalar temp = rows[column][j]; rows[column][j] = rows[pivot][j]; rows[pivot][j] = temp;
+		}
+
+		Scalar scale = 1.0 / rows[column][column];
+		for (int j = 0; j < 8; j++) {
+			rows[column][j] *= scale;
+		}
+
+		/* Clear the column out of every other row. */
+		for (int i = 0; i < 4; i++) {
+			if (i == column || rows[i][column] == 0.0) {
+				continue;
+			}
+
+			Scalar factor = rows[i][column];
+			for (int j = 0; j < 8; j++) {
+				rows[i][j] -= factor * rows[column][j];
+			}
+		}
+	}
+
+	Matrix result;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			result.setEntry(i, j, rows[i][j+4]);
+		}
+	}
+
+	returnInvertible = true;
+	return result;
+}
+
+
+
 /* Sets entry at (i, j) to VALUE where i = row #, j = column #. WARNING: Aborts program if either i or j are out-of-bounds! */
-void Matrix::setEntry (int i, int j, double value) {
+void Matrix::setEntry (int i, int j, Scalar value) {
 	assert (i <= 3 && i >= 0); 
 	assert (j <= 3 && j >= 0);
 
-	/* Grab the corresponding memory location of the entry, then stick VALUE in that memory location. */
-	int index = (i != 0) ? (4*i + j) : j; // Get index of matrix entry at (i, j).
-	*entryPointers[index] = value;
+	entries[4*i + j] = value;
 }
 
 
 
 /* Gets value of entry at (i, j) where i = row #, j = column #. WARNING: Aborts program if either i or j are out-of-bounds! */
-double Matrix::getEntry (int i, int j) const {
+Scalar Matrix::getEntry (int i, int j) const {
 	assert (i <= 3 && i >= 0); 
 	assert (j <= 3 && j >= 0);
 
-	/* Grab the corresponding memory location of the entry, then return the value at that memory location. */
-	int index = (i != 0) ? (4*i + j) : j; // Get index of matrix entry at (i, j).
-	return *entryPointers[index];
+	return entries[4*i + j];
 }
 
 
 
 /* Print member function. */
 void Matrix::print (ostream *os) const {
+	const Scalar *e = entries;
 	printf("[%10f, %10f, %10f, %10f]\n[%10f, %10f, %10f, %10f]\n[%10f, %10f, %10f, %10f]\n[%10f, %10f, %10f, %10f]\n",
-		m00, m01, m02, m03, 
-		m10, m11, m12, m13, 
-		m20, m21, m22, m23, 
-		m30, m31, m32, m33);
+		e[0],  e[1],  e[2],  e[3], 
+		e[4],  e[5],  e[6],  e[7], 
+		e[8],  e[9],  e[10], e[11], 
+		e[12], e[13], e[14], e[15]);
 }
 
 
@@ -308,86 +274,88 @@ Matrix Matrix::getIdentity (void) {
 
 /* Returns true if the entries of M1 are the same as the entries of M2, false otherwise. */
 bool operator== (const Matrix& m1, const Matrix& m2) {
-	return (m1.m00 == m2.m00) &&
-	       (m1.m01 == m2.m01) &&
-		   (m1.m02 == m2.m02) &&
-		   (m1.m03 == m2.m03) &&
-
-		   (m1.m10 == m2.m10) &&
-	       (m1.m11 == m2.m11) &&
-		   (m1.m12 == m2.m12) &&
-		   (m1.m13 == m2.m13) &&
-
-		   (m1.m20 == m2.m20) &&
-	       (m1.m21 == m2.m21) &&
-		   (m1.m22 == m2.m22) &&
-		   (m1.m23 == m2.m23) &&
-
-		   (m1.m30 == m2.m30) &&
-	       (m1.m31 == m2.m31) &&
-		   (m1.m32 == m2.m32) &&
-		   (m1.m33 == m2.m33);
+	for (int i = 0; i < 16; i++) {
+		if (m1.entries[i] != m2.entries[i]) {
+			return false;
+		}
+	}
+	return true;
 }
 
 
 
 /* Returns true if the entries of M1 aren't exactly the same as the entries of M2, false otherwise. */
 bool operator!= (const Matrix& m1, const Matrix& m2) {
-	return (m1.m00 != m2.m00) ||
-	       (m1.m01 != m2.m01) ||
-		   (m1.m02 != m2.m02) ||
-		   (m1.m03 != m2.m03) ||
-
-		   (m1.m10 != m2.m10) ||
-	       (m1.m11 != m2.m11) ||
-		   (m1.m12 != m2.m12) ||
-		   (m1.m13 != m2.m13) ||
-
-		   (m1.m20 != m2.m20) ||
-	       (m1.m21 != m2.m21) ||
-		   (m1.m22 != m2.m22) ||
-		   (m1.m23 != m2.m23) ||
-
-		   (m1.m30 != m2.m30) ||
-	       (m1.m31 != m2.m31) ||
-		   (m1.m32 != m2.m32) ||
-		   (m1.m33 != m2.m33);
+	return !(m1 == m2);
 }
 
 
 
 /* Performs scalar multiplication with M and returns a new matrix. Scalar multiplication is commutative. */
-Matrix operator* (const Matrix& m, double value) {
-	return Matrix(
-		m.m00*value, m.m01*value, m.m02*value, m.m03*value,
-		m.m10*value, m.m11*value, m.m12*value, m.m13*value,
-		m.m20*value, m.m21*value, m.m22*value, m.m23*value,
-		m.m30*value, m.m31*value, m.m32*value, m.m33*value
-	);
+Matrix operator* (const Matrix& m, Scalar value) {
+	Matrix result;
+	for (int i = 0; i < 16; i++) {
+		result.entries[i] = m.entries[i]*value;
+	}
+	return result;
 }
 
 
 
 /* Performs scalar multiplication with M and returns a new matrix. Scalar multiplication is commutative. */
-Matrix operator* (double value, const Matrix& m) {
-	return Matrix(
-		m.m00*value, m.m01*value, m.m02*value, m.m03*value,
-		m.m10*value, m.m11*value, m.m12*value, m.m13*value,
-		m.m20*value, m.m21*value, m.m22*value, m.m23*value,
-		m.m30*value, m.m31*value, m.m32*value, m.m33*value
-	);
+Matrix operator* (Scalar value, const Matrix& m) {
+	return m * value;
 }
 
 
 
-/* Performs matrix/vector multiplication by multiplying M with V and returns a new vector. */
+/* Performs matrix/vector multiplication by multiplying M with V and returns a new vector. Each entry of the result
+   adds up the products of a row of M with V from the first term to the last, so working on two or four rows at a
+   time, as the sum of the columns of M times the entries of V, gives exactly the same sums. */
 Vector operator* (const Matrix& m, const Vector& v) {
+	const Scalar *e = m.entries;
+
+#if defined(__SSE2__) && !defined(SINGLE_PRECISION)
+	__m128d v0 = _mm_set1_pd(v.entries[0]);
+	__m128d v1 = _mm_set1_pd(v.entries[1]);
+	__m128d v2 = _mm_set1_pd(v.entries[2]);
+	__m128d v3 = _mm_set1_pd(v.entries[3]);
+	alignas(16) Scalar result [4];
+
+	/* Rows I and I+1 at a time: unpacking their halves gives two entries of each column. */
+	for (int i = 0; i < 4; i += 2) {
+		__m128d upperLeft = _mm_load_pd(e + 4*i), upperRight = _mm_load_pd(e + 4*i + 2);
+		__m128d lowerLeft = _mm_load_pd(e + 4*i + 4), lowerRight = _mm_load_pd(e + 4*i + 6);
+
+		__m128d sum = _mm_mul_pd(v0, _mm_unpacklo_pd(upperLeft, lowerLeft));
+		sum = _mm_add_pd(sum, _mm_mul_pd(v1, _mm_unpackhi_pd(upperLeft, lowerLeft)));
+		sum = _mm_add_pd(sum, _mm_mul_pd(v2, _mm_unpacklo_pd(upperRight, lowerRight)));
+		sum = _mm_add_pd(sum, _mm_mul_pd(v3, _mm_unpackhi_pd(upperRight, lowerRight)));
+		_mm_store_pd(result + i, sum);
+	}
+
+	return Vector(result[0], result[1], result[2], result[3]);
+#elif defined(__SSE2__)
+	__m128 row0 = _mm_load_ps(e), row1 = _mm_load_ps(e + 4), row2 = _mm_load_ps(e + 8), row3 = _mm_load_ps(e + 12);
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	alignas(16) Scalar result [4];
+
+	/* After transposing, each row holds a column of M. */
+	__m128 sum = _mm_mul_ps(_mm_set1_ps(v.entries[0]), row0);
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(v.entries[1]), row1));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(v.entries[2]), row2));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(v.entries[3]), row3));
+	_mm_store_ps(result, sum);
+
+	return Vector(result[0], result[1], result[2], result[3]);
+#else
 	return Vector(
-		v.entries[0]*m.m00 + v.entries[1]*m.m01 + v.entries[2]*m.m02 + v.entries[3]*m.m03,
-		v.entries[0]*m.m10 + v.entries[1]*m.m11 + v.entries[2]*m.m12 + v.entries[3]*m.m13,
-		v.entries[0]*m.m20 + v.entries[1]*m.m21 + v.entries[2]*m.m22 + v.entries[3]*m.m23,
-		v.entries[0]*m.m30 + v.entries[1]*m.m31 + v.entries[2]*m.m32 + v.entries[3]*m.m33
+		v.entries[0]*e[0]  + v.entries[1]*e[1]  + v.entries[2]*e[2]  + v.entries[3]*e[3],
+		v.entries[0]*e[4]  + v.entries[1]*e[5]  + v.entries[2]*e[6]  + v.entries[3]*e[7],
+		v.entries[0]*e[8]  + v.entries[1]*e[9]  + v.entries[2]*e[10] + v.entries[3]*e[11],
+		v.entries[0]*e[12] + v.entries[1]*e[13] + v.entries[2]*e[14] + v.entries[3]*e[15]
 	);
+#endif
 }
 
 
@@ -399,3 +367,257 @@ ostream& operator<< (ostream &os, const Matrix &m) {
 }
 
 
+
+
+
+/******************* 
+  Batch functions:  
+*********************/
+
+
+/* Transforms the point (X, Y, Z) by M, as M * Vector(X, Y, Z, 1) does, and places the result into (RETURN_X, RETURN_Y,
+   RETURN_Z). The last term of each sum is the entry of M itself, since multiplying it by 1 changes nothing. */
+static inline void transformPoint (const Matrix &m, Scalar x, Scalar y, Scalar z, Scalar &returnX, Scalar &returnY, Scalar &returnZ) {
+	returnX = x*m.getEntry(0, 0) + y*m.getEntry(0, 1) + z*m.getEntry(0, 2) + m.getEntry(0, 3);
+	returnY = x*m.getEntry(1, 0) + y*m.getEntry(1, 1) + z*m.getEntry(1, 2) + m.getEntry(1, 3);
+	returnZ = x*m.getEntry(2, 0) + y*m.getEntry(2, 1) + z*m.getEntry(2, 2) + m.getEntry(2, 3);
+}
+
+
+
+/* Transforms the normal (X, Y, Z) by the transpose of INVERSE, normalizes it, and places the result into (RETURN_X,
+   RETURN_Y, RETURN_Z). Each sum starts from zero and the magnitude is found and divided out just as Vec3 does it, so
+   the result is the one a Vec3 built up term by term and then normalized would hold. */
+static inline void transformNormal (const Matrix &inverse, Scalar x, Scalar y, Scalar z, Scalar &returnX, Scalar &returnY, Scalar &returnZ) {
+	Scalar normal [3] = {0, 0, 0};
+
+	for (int i = 0; i < 3; i++) {
+		normal[i] += inverse.getEntry(0, i) * x;
+		normal[i] += inverse.getEntry(1, i) * y;
+		normal[i] += inverse.getEntry(2, i) * z;
+	}
+
+	Scalar magnitude = sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+
+	if (magnitude != 0) {
+		normal[0] /= magnitude;
+		normal[1] /= magnitude;
+		normal[2] /= magnitude;
+	}
+
+	returnX = normal[0];
+	returnY = normal[1];
+	returnZ = normal[2];
+}
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(SINGLE_PRECISION)
+
+/* Returns a mask for loading and storing the first COUNT of four doubles, for COUNT from 0 to 4. */
+__attribute__((target("avx2")))
+static inline __m256i getLaneMask (unsigned int count) {
+	return _mm256_cmpgt_epi64(_mm256_set1_epi64x(count), _mm256_setr_epi64x(0, 1, 2, 3));
+}
+
+
+
+/* transformPoints() with AVX2, four points at a time. The last few are loaded and stored with a mask. */
+__attribute__((target("avx2")))
+static void transformPointsAVX2 (const Matrix &m, const double *x, const double *y, const double *z, unsigned int count,
+                                 double *returnX, double *returnY, double *returnZ) {
+	__m256d entries [3][4];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 4; j++) {
+			entries[i][j] = _mm256_set1_pd(m.getEntry(i, j));
+		}
+	}
+
+	for (unsigned int i = 0; i < count; i += 4) {
+		__m256i mask = getLaneMask(count - i < 4 ? count - i : 4);
+
+		__m256d pointX = _mm256_maskload_pd(x + i, mask);
+		__m256d pointY = _mm256_maskload_pd(y + i, mask);
+		__m256d pointZ = _mm256_maskload_pd(z + i, mask);
+
+		__m256d result [3];
+		for (int row = 0; row < 3; row++) {
+			result[row] = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(pointX, entries[row][0]), _mm256_mul_pd(pointY, entries[row][1])),
+			                                          _mm256_mul_pd(pointZ, entries[row][2])), entries[row][3]);
+		}
+
+		_mm256_maskstore_pd(returnX + i, mask, result[0]);
+		_mm256_maskstore_pd(returnY + i, mask, result[1]);
+		_mm256_maskstore_pd(returnZ + i, mask, result[2]);
+	}
+}
+
+
+
+/* transformPoints() with SSE2, two points at a time. An odd one out is transformed on its own. */
+static void transformPointsSSE2 (const Matrix &m, const double *x, const double *y, const double *z, unsigned int count,
+                                 double *returnX, double *returnY, double *returnZ) {
+	__m128d entries [3][4];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 4; j++) {
+			entries[i][j] = _mm_set1_pd(m.getEntry(i, j));
+		}
+	}
+
+	unsigned int i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128d pointX = _mm_loadu_pd(x + i);
+		__m128d pointY = _mm_loadu_pd(y + i);
+		__m128d pointZ = _mm_loadu_pd(z + i);
+
+		__m128d result [3];
+		for (int row = 0; row < 3; row++) {
+			result[row] = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(pointX, entries[row][0]), _mm_mul_pd(pointY, entries[row][1])),
+			                                    _mm_mul_pd(pointZ, entries[row][2])), entries[row][3]);
+		}
+
+		_mm_storeu_pd(returnX + i, result[0]);
+		_mm_storeu_pd(returnY + i, result[1]);
+		_mm_storeu_pd(returnZ + i, result[2]);
+	}
+
+	if (i < count) {
+		transformPoint(m, x[i], y[i], z[i], returnX[i], returnY[i], returnZ[i]);
+	}
+}
+
+
+
+/* transformNormals() with AVX2, four normals at a time. The last few are loaded and stored with a mask, and the lanes
+   left over hold zero normals, which are left alone. */
+__attribute__((target("avx2")))
+static void transformNormalsAVX2 (const Matrix &inverse, const double *x, const double *y, const double *z, unsigned int count,
+                                  double *returnX, double *returnY, double *returnZ) {
+	__m256d entries [3][3];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			entries[i][j] = _mm256_set1_pd(inverse.getEntry(i, j));
+		}
+	}
+
+	for (unsigned int i = 0; i < count; i += 4) {
+		__m256i mask = getLaneMask(count - i < 4 ? count - i : 4);
+
+		__m256d normalX = _mm256_maskload_pd(x + i, mask);
+		__m256d normalY = _mm256_maskload_pd(y + i, mask);
+		__m256d normalZ = _mm256_maskload_pd(z + i, mask);
+
+		/* Column J of INVERSE gives entry J of the result. */
+		__m256d result [3];
+		for (int j = 0; j < 3; j++) {
+			result[j] = _mm256_add_pd(_mm256_setzero_pd(), _mm256_mul_pd(entries[0][j], normalX));
+			result[j] = _mm256_add_pd(result[j], _mm256_mul_pd(entries[1][j], normalY));
+			result[j] = _mm256_add_pd(result[j], _mm256_mul_pd(entries[2][j], normalZ));
+		}
+
+		__m256d magnitude = _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(result[0], result[0]), _mm256_mul_pd(result[1], result[1])),
+		                                                 _mm256_mul_pd(result[2], result[2])));
+		__m256d nonzero = _mm256_cmp_pd(magnitude, _mm256_setzero_pd(), _CMP_NEQ_UQ);
+
+		for (int j = 0; j < 3; j++) {
+			result[j] = _mm256_blendv_pd(result[j], _mm256_div_pd(result[j], magnitude), nonzero);
+		}
+
+		_mm256_maskstore_pd(returnX + i, mask, result[0]);
+		_mm256_maskstore_pd(returnY + i, mask, result[1]);
+		_mm256_maskstore_pd(returnZ + i, mask, result[2]);
+	}
+}
+
+
+
+/* transformNormals() with SSE2, two normals at a time. An odd one out is transformed on its own. */
+static void transformNormalsSSE2 (const Matrix &inverse, const double *x, const double *y, const double *z, unsigned int count,
+                                  double *returnX, double *returnY, double *returnZ) {
+	__m128d entries [3][3];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			entries[i][j] = _mm_set1_pd(inverse.getEntry(i, j));
+		}
+	}
+
+	unsigned int i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128d normalX = _mm_loadu_pd(x + i);
+		__m128d normalY = _mm_loadu_pd(y + i);
+		__m128d normalZ = _mm_loadu_pd(z + i);
+
+		__m128d result [3];
+		for (int j = 0; j < 3; j++) {
+			result[j] = _mm_add_pd(_mm_setzero_pd(), _mm_mul_pd(entries[0][j], normalX));
+			result[j] = _mm_add_pd(result[j], _mm_mul_pd(entries[1][j], normalY));
+			result[j] = _mm_add_pd(result[j], _mm_mul_pd(entries[2][j], normalZ));
+		}
+
+		__m128d magnitude = _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(result[0], result[0]), _mm_mul_pd(result[1], result[1])),
+		                                           _mm_mul_pd(result[2], result[2])));
+		__m128d nonzero = _mm_cmpneq_pd(magnitude, _mm_setzero_pd());
+
+		/* SSE2 has no blend, so select with masks. */
+		for (int j = 0; j < 3; j++) {
+			result[j] = _mm_or_pd(_mm_and_pd(nonzero, _mm_div_pd(result[j], magnitude)), _mm_andnot_pd(nonzero, result[j]));
+		}
+
+		_mm_storeu_pd(returnX + i, result[0]);
+		_mm_storeu_pd(returnY + i, result[1]);
+		_mm_storeu_pd(returnZ + i, result[2]);
+	}
+
+	if (i < count) {
+		transformNormal(inverse, x[i], y[i], z[i], returnX[i], returnY[i], returnZ[i]);
+	}
+}
+
+#endif
+
+
+
+/* Transforms point i, (X[i], Y[i], Z[i]), by M, taking its homogeneous entry to be 1, and places the result into
+   (RETURN_X[i], RETURN_Y[i], RETURN_Z[i]). WIDTH is the number of points transformed at once, 0 for the widest. */
+void transformPoints (const Matrix &m, const Scalar *x, const Scalar *y, const Scalar *z, unsigned int count,
+                      Scalar *returnX, Scalar *returnY, Scalar *returnZ, int width) {
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(SINGLE_PRECISION)
+	width = getKernelWidth(width);
+
+	if (width >= 4) {
+		transformPointsAVX2(m, x, y, z, count, returnX, returnY, returnZ);
+		return;
+	}
+	if (width >= 2) {
+		transformPointsSSE2(m, x, y, z, count, returnX, returnY, returnZ);
+		return;
+	}
+#endif
+
+	for (unsigned int i = 0; i < count; i++) {
+		transformPoint(m, x[i], y[i], z[i], returnX[i], returnY[i], returnZ[i]);
+	}
+}
+
+
+
+/* Transforms normal i, (X[i], Y[i], Z[i]), by the transpose of INVERSE, and places the unit result into (RETURN_X[i],
+   RETURN_Y[i], RETURN_Z[i]). WIDTH is the number of normals transformed at once, 0 for the widest. */
+void transformNormals (const Matrix &inverse, const Scalar *x, const Scalar *y, const Scalar *z, unsigned int count,
+                       Scalar *returnX, Scalar *returnY, Scalar *returnZ, int width) {
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(SINGLE_PRECISION)
+	width = getKernelWidth(width);
+
+	if (width >= 4) {
+		transformNormalsAVX2(inverse, x, y, z, count, returnX, returnY, returnZ);
+		return;
+	}
+	if (width >= 2) {
+		transformNormalsSSE2(inverse, x, y, z, count, returnX, returnY, returnZ);
+		return;
+	}
+#endif
+
+	for (unsigned int i = 0; i < count; i++) {
+		transformNormal(inverse, x[i], y[i], z[i], returnX[i], returnY[i], returnZ[i]);
+	}
+}
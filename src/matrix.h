@@ -5,13 +5,15 @@
 
 	#include <iostream>
 
+	#include "scalar.h"
+
 	using namespace std;
 
 	/* Forward declaration of Vector class. */
 	class Vector;
 
 
-	/* A 4x4 matrix containing a double in each entry. The matrix is indexed ij, 
+	/* A 4x4 matrix containing a Scalar in each entry. The matrix is indexed ij, 
 	where i represents the row and j represents the column. The top-left corner is indexed ij = 00, 
 	and columns increase going right while rows increase going down. Thus, the matrix
 	entries are indexed as such:          
@@ -22,6 +24,10 @@
 	 |  [m20, m21, m22, m23]
 	 V  [m30, m31, m32, m33]
 
+	The entries are stored one row after another in a single aligned block, so that a row loads straight into SIMD
+	registers and a copy is a plain copy of the block. Matrix/matrix and matrix/vector products use those registers
+	when the compiler targets SSE2 or AVX, and add up their terms in the same order as the scalar code, so the results
+	are the same to the last bit.
 	*/
 	class Matrix {
 
@@ -29,8 +35,8 @@
 		/* Friend functions: */
 
 		/* Performs scalar multiplication with M and returns a new matrix. Scalar multiplication is commutative. */
-		friend Matrix operator* (const Matrix& m, double value);
-		friend Matrix operator* (double value, const Matrix& m);
+		friend Matrix operator* (const Matrix& m, Scalar value);
+		friend Matrix operator* (Scalar value, const Matrix& m);
 
 		/* Returns true if the entries of M1 are the same as the entries of M2, false otherwise. */
 		friend bool operator== (const Matrix& m1, const Matrix& m2);
@@ -43,26 +49,8 @@
 
 
 		private:
-			/* Each of the entries in the matrix. */
-			double m00, m01, m02, m03,
-				   m10, m11, m12, m13,
-				   m20, m21, m22, m23,
-				   m30, m31, m32, m33;
-
-			/* An array of pointers to each of the entries in the array. This is used to more 
-			   easily and cleanly access or change individuals elements in some methods. 
-			   The elements are organized one row at a time, with the entry at row 0, column 0 
-			   starting at element 0. 
-
-				A matrix entry can be obtained by...   
-
-					int index = (i != 0) ? (4*i + j) : j;
-					*entryPointers[index];
-
-				...where i is the row number and j is the column number.
-
-			   */
-			double* entryPointers [16];
+			/* The entries, row by row: the entry at row i, column j is entries[4*i + j]. */
+			alignas(4*sizeof(Scalar)) Scalar entries [16];
 
 
 		public:
@@ -70,18 +58,10 @@
 			Matrix ();
 
 			/* Constructor that initializes matrix entries with the supplied values. */
-			Matrix ( double value00, double value01, double value02, double value03,
-					 double value10, double value11, double value12, double value13,
-					 double value20, double value21, double value22, double value23,
-					 double value30, double value31, double value32, double value33 );
-
-			/* Copy constructor. */
-			Matrix (const Matrix &source);
-
-
-			/* Assignment operator. */
-			void operator= (const Matrix &source);
-
+			Matrix ( Scalar value00, Scalar value01, Scalar value02, Scalar value03,
+					 Scalar value10, Scalar value11, Scalar value12, Scalar value13,
+					 Scalar value20, Scalar value21, Scalar value22, Scalar value23,
+					 Scalar value30, Scalar value31, Scalar value32, Scalar value33 );
 
 			/* Performs matrix addition with M and returns a new matrix. */
 			Matrix operator+ (const Matrix &m) const;
@@ -96,7 +76,7 @@
 			Matrix& operator-= (const Matrix &m);
 
 			/* Performs scalar multiplication with M in place and returns a reference to this matrix. Modifies this matrix. */
-			Matrix& operator*= (double value);
+			Matrix& operator*= (Scalar value);
 
 			/* Performs matrix multiplication with M and returns a new matrix. Matrix multiplication IS NOT commutative. */
 			Matrix operator* (const Matrix &m) const;
@@ -105,11 +85,15 @@
 			/* Transposes the matrix in place and returns a reference to this matrix. Modifies this matrix. */
 			Matrix& transpose(void);
 
+			/* Returns the inverse of this matrix, which undoes the transformation it does. If the matrix has no inverse,
+			   RETURN_INVERTIBLE is set to false and the zero matrix is returned. */
+			Matrix inverse(bool &returnInvertible) const;
+
 			/* Sets entry at (i, j) to VALUE where i = row #, j = column #. WARNING: Aborts program if either i or j are out-of-bounds! */
-			void setEntry(int i, int j, double value);
+			void setEntry(int i, int j, Scalar value);
 
 			/* Gets value of entry at (i, j) where i = row #, j = column #. WARNING: Aborts program if either i or j are out-of-bounds! */
-			double getEntry(int i, int j) const;
+			Scalar getEntry(int i, int j) const;
 
 
 			/* Print member function. */
@@ -124,4 +108,34 @@
 	/* Printing operator for Matrix class. */
 	ostream& operator<< (ostream &os, const Matrix &m);
 
+
+
+	/*
+
+	Batch Functions:
+	================
+
+	These functions transform COUNT points or normals at once, stored as separate arrays of x, y and z coordinates,
+	such as the vertices of a mesh being loaded or the corners of an instance's bounding box. Each result is exactly
+	what transforming that one point or normal by itself gives. The returned arrays may be the arrays passed in.
+
+	WIDTH is the number of points or normals transformed at once: 4 with AVX2, 2 with SSE2, or 1 without SIMD. 0 picks
+	the widest the instruction set in use allows (see cpu.h), AVX-512 included, and a wider width falls back to that
+	one. Only the double precision build has SIMD paths.
+
+	*/
+
+
+	/* Transforms point i, (X[i], Y[i], Z[i]), by M, taking its homogeneous entry to be 1, and places the result into
+	   (RETURN_X[i], RETURN_Y[i], RETURN_Z[i]). The same as M * Vector(X[i], Y[i], Z[i], 1), for M that leaves the last
+	   entry of a homogeneous vector alone. */
+	void transformPoints(const Matrix &m, const Scalar *x, const Scalar *y, const Scalar *z, unsigned int count,
+	                     Scalar *returnX, Scalar *returnY, Scalar *returnZ, int width);
+
+	/* Transforms normal i, (X[i], Y[i], Z[i]), for a surface transformed by the matrix whose inverse is INVERSE, and
+	   places the unit result into (RETURN_X[i], RETURN_Y[i], RETURN_Z[i]). Normals are transformed by the transpose of
+	   the inverse, so they stay perpendicular to the surface. A normal that comes out as zero is left zero. */
+	void transformNormals(const Matrix &inverse, const Scalar *x, const Scalar *y, const Scalar *z, unsigned int count,
+	                      Scalar *returnX, Scalar *returnY, Scalar *returnZ, int width);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,280 @@
+/* Contains definitions for triangle meshes that are stored once and placed into the scene any number of times,
+   each copy with its own transformation. */
+
+#include <vector> /* STL vector. */
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "mesh.h"
+#include "sceneobject.h"
+#include "geometry.h"
+#include "boundingbox.h"
+#include "bvh.h"
+#include "matrix.h"
+#include "vector.h" /* My own implementation of a 4x1 vector. */
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+using namespace std;
+
+
+
+/* 
+----------------------
+    Mesh methods. 
+---------------------- 
+*/
+
+
+/* Default constructor. The mesh has no triangles. */
+Mesh::Mesh (void) {
+    bounds = getEmptyBoundingBox();
+}
+
+
+/* Destructor. Deletes the mesh's triangles. */
+Mesh::~Mesh (void) {
+    for (unsigned int i = 0; i < triangles.size(); i++) {
+        delete triangles[i];
+    }
+}
+
+
+/* Adds a triangle with corners VERTEX_0, VERTEX_1 and VERTEX_2 in object space. build() must be called
+   after the last triangle is added and before the mesh is used. */
+void Mesh::addTriangle(const Point3 &vertex0, const Point3 &vertex1, const Point3 &vertex2) {
+    Triangle *t = new Triangle;
+
+    t->setVertices(vertex0, vertex1, vertex2);
+
+    triangles.push_back(t);
+}
+
+
+/* Adds TRIANGLE_COUNT triangles at once from VERTEX_COUNT shared vertices in object space, vertex k at (X[k],
+   Y[k], Z[k]). Triangle i has the vertices at INDICES[3*i], INDICES[3*i + 1] and INDICES[3*i + 2] as its
+   corners. build() must be called after the last triangle is added and before the mesh is used. */
+void Mesh::addTriangles(const Scalar *x, const Scalar *y, const Scalar *z, unsigned int vertexCount,
+                        const unsigned int *indices, unsigned int triangleCount) {
+    triangles.reserve(triangles.size() + triangleCount);
+
+    for (unsigned int i = 0; i < triangleCount; i++) {
+        unsigned int corners [3] = {indices[3*i], indices[3*i + 1], indices[3*i + 2]};
+
+        if (corners[0] >= vertexCount || corners[1] >= vertexCount || corners[2] >= vertexCount) {
+            fprintf(stderr, "Mesh: triangle %u refers to a vertex that doesn't exist\n", i);
+            abort();
+        }
+
+        addTriangle(Point3(x[corners[0]], y[corners[0]], z[corners[0]]),
+                    Point3(x[corners[1]], y[corners[1]], z[corners[1]]),
+                    Point3(x[corners[2]], y[corners[2]], z[corners[2]]));
+    }
+}
+
+
+/* Adds triangles as above from vertices that are first transformed by TRANSFORM, all together, such as a
+   model placed into the mesh's object space at another size or turned another way. */
+void Mesh::addTriangles(const Matrix &transform, const Scalar *x, const Scalar *y, const Scalar *z, unsigned int vertexCount,
+                        const unsigned int *indices, unsigned int triangleCount) {
+    vector <Scalar> transformed [3];
+
+    for (int axis = 0; axis < 3; axis++) {
+        transformed[axis].resize(vertexCount);
+    }
+
+    transformPoints(transform, x, y, z, vertexCount, transformed[0].data(), transformed[1].data(), transformed[2].data(), 0);
+    addTriangles(transformed[0].data(), transformed[1].data(), transformed[2].data(), vertexCount, indices, triangleCount);
+}
+
+
+/* Builds the BVH over the mesh's triangles and computes its bounds. */
+void Mesh::build(void) {
+    bounds = getEmptyBoundingBox();
+
+    for (unsigned int i = 0; i < triangles.size(); i++) {
+        BoundingBox triangleBounds;
+        triangles[i]->getBounds(triangleBounds);
+        expand(bounds, triangleBounds);
+    }
+
+    hierarchy.build(triangles);
+}
+
+
+/* Takes a point and a direction from that point in object space to form a ray, and finds the first triangle
+   the ray intersects. Upon success, returns true and places the intersection in RETURN_HIT, with the triangle's
+   index as its primitive. Upon failure, false will simply be returned. */
+bool Mesh::findFirstIntersection(const Point3 &rayStartPoint, const Direction3 &rayDirection, HitRecord &returnHit) const {
+    return hierarchy.findFirstIntersection(rayStartPoint, rayDirection, returnHit, returnHit.primitive);
+}
+
+
+/* Returns the unit normal in object space of the triangle POINT lies on. */
+Direction3 Mesh::getNormal(const Point3 &point) const {
+    vector <unsigned int> candidates;
+    hierarchy.findObjectsContaining(point, candidates);
+
+    /* Of the triangles whose boxes hold POINT, the one it lies on has a plane passing through it. */
+    Direction3 normal (0.0, 0.0, 1.0);
+    double closestDistance = HUGE_VAL;
+
+    for (unsigned int i = 0; i < candidates.size(); i++) {
+        const Triangle *t = (const Triangle *)triangles[candidates[i]];
+        double distance = t->getPlaneDistance(point);
+
+        if (distance < closestDistance) {
+            closestDistance = distance;
+            normal = t->getNormal(point);
+        }
+    }
+
+    return normal;
+}
+
+
+/* Returns the unit normal in object space of the triangle at INDEX. */
+Direction3 Mesh::getTriangleNormal(unsigned int index) const {
+    /* A triangle's normal is the same at every point on it, so any point will do. */
+    const Triangle *t = (const Triangle *)triangles[index];
+    return t->getNormal(t->getVertex(0));
+}
+
+
+/* Returns a box enclosing every triangle in object space. */
+const BoundingBox& Mesh::getBounds(void) const {
+    return bounds;
+}
+
+
+/* Returns the number of triangles in the mesh. */
+unsigned int Mesh::getTriangleCount(void) const {
+    return triangles.size();
+}
+
+
+
+
+
+/* 
+----------------------
+    MeshInstance methods. 
+---------------------- 
+*/
+
+
+/* Constructor. Places MESH into the scene transformed by OBJECT_TO_WORLD, which must be invertible and
+   leave the last row of a homogeneous vector alone, as the matrices made by transform.h do. */
+MeshInstance::MeshInstance (const Mesh *mesh, const Matrix &objectToWorld) {
+    bool invertible;
+
+    this->mesh = mesh;
+    worldToObject = objectToWorld.inverse(invertible);
+
+    if (!invertible) {
+        fprintf(stderr, "MeshInstance: transformation has no inverse\n");
+        abort();
+    }
+
+    position = Point3(objectToWorld * Vector(0.0, 0.0, 0.0, 1.0));
+}
+
+
+/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+   this instance. If it does, returns true and modifies RETURN_INTERSECTION_POINT with the point of intersection.
+   Otherwise, returns false. */
+bool MeshInstance::checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const {
+    HitRecord hit;
+
+    if (!intersect(point, direction, hit)) {
+        return false;
+    }
+
+    returnIntersectionPoint = hit.point;
+    return true;
+}
+
+
+/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+   this instance. If it does, returns true and fills in RETURN_HIT, with the index in the mesh of the triangle
+   intersected as its primitive. Otherwise, returns false. */
+bool MeshInstance::intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const {
+    Point3 objectPoint (worldToObject * point.toVector(1.0));
+    Direction3 objectDirection (worldToObject * direction.toVector(0.0));
+
+    if (!mesh->findFirstIntersection(objectPoint, objectDirection, returnHit)) {
+        return false;
+    }
+
+    /* The transformation is affine, so the intersection is the same multiple of the direction along the ray in both
+       spaces. Stepping along the world ray avoids needing the forward transformation. */
+    returnHit.point = Point3(point.getEntry(0) + returnHit.t*direction.getEntry(0),
+                             point.getEntry(1) + returnHit.t*direction.getEntry(1),
+                             point.getEntry(2) + returnHit.t*direction.getEntry(2));
+
+    return true;
+}
+
+
+/* Returns the unit normal in world space of the surface whose normal in object space is OBJECT_NORMAL, for an
+   instance whose inverse transformation is WORLD_TO_OBJECT. */
+static Direction3 getWorldNormal(const Matrix &worldToObject, const Direction3 &objectNormal) {
+    Scalar x = objectNormal[0], y = objectNormal[1], z = objectNormal[2];
+
+    /* A single normal isn't worth the SIMD registers. */
+    transformNormals(worldToObject, &x, &y, &z, 1, &x, &y, &z, 1);
+    return Direction3(x, y, z);
+}
+
+
+/* Returns the unit normal at POINT, which must lie on the instance. */
+Direction3 MeshInstance::getNormal(const Point3 &point) const {
+    Direction3 objectNormal = mesh->getNormal(Point3(worldToObject * point.toVector(1.0)));
+    return getWorldNormal(worldToObject, objectNormal);
+}
+
+
+/* Returns the unit normal of the triangle HIT's primitive names, which is faster than searching for the
+   triangle HIT's point lies on. */
+Direction3 MeshInstance::getNormal(const HitRecord &hit) const {
+    return getWorldNormal(worldToObject, mesh->getTriangleNormal(hit.primitive));
+}
+
+
+/* Places a box enclosing the transformed mesh into RETURN_BOUNDS and returns true. */
+bool MeshInstance::getBounds(BoundingBox &returnBounds) const {
+    bool invertible;
+    Matrix objectToWorld = worldToObject.inverse(invertible);
+
+    const BoundingBox &meshBounds = mesh->getBounds();
+    returnBounds = getEmptyBoundingBox();
+
+    /* An empty mesh is never hit, but still gets a box, at the instance's position. */
+    if (isEmpty(meshBounds)) {
+        expand(returnBounds, position);
+        return true;
+    }
+
+    /* Transform all 8 corners of the mesh's box, since a rotated box's extent depends on every corner. */
+    Scalar corners [3][8];
+
+    for (int corner = 0; corner < 8; corner++) {
+        corners[0][corner] = (corner & 1) ? meshBounds.upper[0] : meshBounds.lower[0];
+        corners[1][corner] = (corner & 2) ? meshBounds.upper[1] : meshBounds.lower[1];
+        corners[2][corner] = (corner & 4) ? meshBounds.upper[2] : meshBounds.lower[2];
+    }
+
+    transformPoints(objectToWorld, corners[0], corners[1], corners[2], 8, corners[0], corners[1], corners[2], 0);
+
+    for (int corner = 0; corner < 8; corner++) {
+        expand(returnBounds, Point3(corners[0][corner], corners[1][corner], corners[2][corner]));
+    }
+
+    return true;
+}
+
+
+/* MeshInstance print member function. */
+void MeshInstance::print (ostream *os) const {
+    printf("[MeshInstance of %u triangles at (%5.3f, %5.3f, %5.3f)]", mesh->getTriangleCount(), position.getEntry(0), position.getEntry(1), position.getEntry(2));
+}
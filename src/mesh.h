@@ -0,0 +1,123 @@
+/* Contains declarations for triangle meshes that are stored once and placed into the scene any number of times,
+   each copy with its own transformation. */
+
+#ifndef MESH
+#define MESH
+
+	#include <vector> /* STL vector. */
+	#include "sceneobject.h"
+	#include "geometry.h"
+	#include "boundingbox.h"
+	#include "bvh.h"
+	#include "matrix.h"
+	#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+	using namespace std;
+
+
+	/* A set of triangles in their own object space, with a BVH over them. A Mesh isn't part of the scene itself;
+	   MeshInstances place it into the scene. Every instance shares the Mesh's triangles and BVH, so a mesh copied
+	   a million times only costs the memory of the copies' transformations. */
+	class Mesh {
+
+		protected:
+			/* The triangles of the mesh. Owned by the Mesh. */
+			vector <SceneObject *> triangles;
+
+			/* BVH over TRIANGLES, used to find intersections in object space. */
+			BVH hierarchy;
+
+			/* Box enclosing every triangle in object space. */
+			BoundingBox bounds;
+
+			/* Meshes are never copied, since HIERARCHY refers to TRIANGLES. Not defined. */
+			Mesh (const Mesh &source);
+			void operator= (const Mesh &source);
+
+		public:
+			/* Default constructor. The mesh has no triangles. */
+			Mesh (void);
+
+			/* Destructor. Deletes the mesh's triangles. */
+			~Mesh (void);
+
+			/* Adds a triangle with corners VERTEX_0, VERTEX_1 and VERTEX_2 in object space. build() must be called
+			   after the last triangle is added and before the mesh is used. */
+			void addTriangle(const Point3 &vertex0, const Point3 &vertex1, const Point3 &vertex2);
+
+			/* Adds TRIANGLE_COUNT triangles at once from VERTEX_COUNT shared vertices in object space, vertex k at (X[k],
+			   Y[k], Z[k]). Triangle i has the vertices at INDICES[3*i], INDICES[3*i + 1] and INDICES[3*i + 2] as its
+			   corners. build() must be called after the last triangle is added and before the mesh is used. */
+			void addTriangles(const Scalar *x, const Scalar *y, const Scalar *z, unsigned int vertexCount,
+			                  const unsigned int *indices, unsigned int triangleCount);
+
+			/* Adds triangles as above from vertices that are first transformed by TRANSFORM, all together, such as a
+			   model placed into the mesh's object space at another size or turned another way. */
+			void addTriangles(const Matrix &transform, const Scalar *x, const Scalar *y, const Scalar *z, unsigned int vertexCount,
+			                  const unsigned int *indices, unsigned int triangleCount);
+
+			/* Builds the BVH over the mesh's triangles and computes its bounds. */
+			void build(void);
+
+			/* Takes a point and a direction from that point in object space to form a ray, and finds the first triangle
+			   the ray intersects. Upon success, returns true and places the intersection in RETURN_HIT, with the triangle's
+			   index as its primitive. Upon failure, false will simply be returned. */
+			bool findFirstIntersection(const Point3 &rayStartPoint, const Direction3 &rayDirection, HitRecord &returnHit) const;
+
+			/* Returns the unit normal in object space of the triangle POINT lies on. */
+			Direction3 getNormal(const Point3 &point) const;
+
+			/* Returns the unit normal in object space of the triangle at INDEX. */
+			Direction3 getTriangleNormal(unsigned int index) const;
+
+			/* Returns a box enclosing every triangle in object space. */
+			const BoundingBox& getBounds(void) const;
+
+			/* Returns the number of triangles in the mesh. */
+			unsigned int getTriangleCount(void) const;
+	};
+
+
+	/* A copy of a Mesh placed into the scene by a transformation. Rays are transformed into the mesh's object space
+	   and traced through the mesh's own BVH, so the triangles are never copied. Only the inverse transformation is
+	   stored, since that is what rays need. Member functions are defined in mesh.cpp. */
+	class MeshInstance : public SceneObject {
+
+		protected:
+			/* The mesh this is a copy of. Must outlive the MeshInstance. */
+			const Mesh *mesh;
+
+			/* Transforms points and directions from world space into the mesh's object space. */
+			Matrix worldToObject;
+
+		public:
+			/* Constructor. Places MESH into the scene transformed by OBJECT_TO_WORLD, which must be invertible and
+			   leave the last row of a homogeneous vector alone, as the matrices made by transform.h do. */
+			MeshInstance (const Mesh *mesh, const Matrix &objectToWorld);
+
+			/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+			   this instance. If it does, returns true and modifies RETURN_INTERSECTION_POINT with the point of intersection.
+			   Otherwise, returns false. */
+			bool checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const;
+
+			/* Takes a point and a direction from that point, and calculates whether the ray defined by them intersects
+			   this instance. If it does, returns true and fills in RETURN_HIT, with the index in the mesh of the triangle
+			   intersected as its primitive. Otherwise, returns false. */
+			bool intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const;
+
+			/* Returns the unit normal at POINT, which must lie on the instance. */
+			Direction3 getNormal(const Point3 &point) const;
+
+			/* Returns the unit normal of the triangle HIT's primitive names, which is faster than searching for the
+			   triangle HIT's point lies on. */
+			Direction3 getNormal(const HitRecord &hit) const;
+
+			/* Places a box enclosing the transformed mesh into RETURN_BOUNDS and returns true. */
+			bool getBounds(BoundingBox &returnBounds) const;
+
+			/* Print member function. */
+			void print (ostream *os) const;
+	};
+
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <cstdlib>
 #include <cmath>
+#include <chrono>
 
 #include "common.h"
 #include "misc.h"
@@ -34,7 +35,9 @@ double log (double base, double argument) {
 
 
 
-/* Takes two doubles and produces a random double value between them. Assumes MAXIMUM > MINIMUM. */
+/* Takes two doubles and produces a random double value between them. Assumes MAXIMUM > MINIMUM. This draws from
+   rand(), one number after another, so it is only for setting up scenes and tests on one thread; rendering draws
+   from the random streams of random.h, which are the same whatever order they are drawn in. */
 double randomDouble (double minimum, double maximum) {
 
 	/* Generate a random integer and get the ratio of it out of all possible randomly generated integers. */
@@ -46,6 +49,59 @@ double randomDouble (double minimum, double maximum) {
 
 
 
+/* Returns the number of seconds since some fixed point in the past. Subtract two results to time part of the program. */
+double getTime (void) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+
+/* Spreads the low 10 bits of VALUE out so that there are two zero bits between each of them. */
+unsigned long long spreadBits10 (unsigned long long value) {
+	value &= 0x3ff;
+	value = (value | (value << 16)) & 0x30000ff;
+	value = (value | (value <<  8)) & 0x300f00f;
+	value = (value | (value <<  4)) & 0x30c30c3;
+	value = (value | (value <<  2)) & 0x9249249;
+	return value;
+}
+
+
+
+/* Spreads the low 21 bits of VALUE out so that there are two zero bits between each of them. */
+unsigned long long spreadBits21 (unsigned long long value) {
+	value &= 0x1fffff;
+	value = (value | (value << 32)) & 0x1f00000000ffffULL;
+	value = (value | (value << 16)) & 0x1f0000ff0000ffULL;
+	value = (value | (value <<  8)) & 0x100f00f00f00f00fULL;
+	value = (value | (value <<  4)) & 0x10c30c30c30c30c3ULL;
+	value = (value | (value <<  2)) & 0x1249249249249249ULL;
+	return value;
+}
+
+
+
+/* Maps COORDINATE from [LOWER, UPPER] onto an integer in [0, 2^BITS - 1]. */
+unsigned long long quantize (double coordinate, double lower, double upper, int bits) {
+	double maximum = (double)((1ULL << bits) - 1);
+
+	if (upper <= lower) {
+		return 0;
+	}
+
+	double scaled = (coordinate - lower) / (upper - lower) * maximum;
+
+	if (scaled <= 0.0) {
+		return 0;
+	}
+	if (scaled >= maximum) {
+		return (unsigned long long)maximum;
+	}
+	return (unsigned long long)scaled;
+}
+
+
+
 /* Takes a 4D matrix M in row-major order, and loads the 4D matrix which
    does the same trasformation into the OpenGL MODELVIEW matrix, in
    column-major order. */
@@ -30,10 +30,29 @@
 	double log (double base, double argument);
 
 
-	/* Takes two doubles and produces a random double value between them. Assumes MAXIMUM > MINIMUM. */
+	/* Takes two doubles and produces a random double value between them. Assumes MAXIMUM > MINIMUM. This draws from
+	   rand(), one number after another, so it is only for setting up scenes and tests on one thread; rendering draws
+	   from the random streams of random.h, which are the same whatever order they are drawn in. */
 	double randomDouble (double minimum, double maximum);
 
 
+	/* Returns the number of seconds since some fixed point in the past. Subtract two results to time part of the program. */
+	double getTime (void);
+
+
+	/* Spreads the low 10 bits of VALUE out so that there are two zero bits between each of them. Three spread values
+	   shifted by 2, 1 and 0 bits and or'ed together make a 30-bit Morton code. */
+	unsigned long long spreadBits10 (unsigned long long value);
+
+
+	/* Spreads the low 21 bits of VALUE out so that there are two zero bits between each of them, for 63-bit Morton codes. */
+	unsigned long long spreadBits21 (unsigned long long value);
+
+
+	/* Maps COORDINATE from [LOWER, UPPER] onto an integer in [0, 2^BITS - 1], clamping coordinates outside the range. */
+	unsigned long long quantize (double coordinate, double lower, double upper, int bits);
+
+
 	/* Takes a 4D matrix M in row-major order, and loads the 4D matrix which
 	   does the same trasformation into the OpenGL MODELVIEW matrix, in
 	   column-major order. */
@@ -0,0 +1,176 @@
+/* Contains definitions for functions that split work across the machine's cores. */
+
+#include <vector> /* STL vector. */
+#include <thread>
+#include <mutex>
+
+#include "parallel.h"
+
+using namespace std;
+
+
+/* Number of threads setThreadCount() asked for, or 0 for one per core. */
+static unsigned int selectedThreadCount = 0;
+
+
+/* The items a thread of parallelForEach() has left to run, [next, end). Its own thread takes them from the front,
+   and other threads steal from the back, each holding LOCK while it does. */
+struct ItemRange {
+	mutex lock;
+	unsigned int next;
+	unsigned int end;
+};
+
+
+/* Everything the threads of a call to parallelForEach() share. */
+struct ItemRun {
+	ParallelItemBody body;
+	void *context;
+
+	/* The items each thread has left, by thread. */
+	vector <ItemRange> ranges;
+
+	ItemRun (unsigned int threadCount) : ranges(threadCount) {
+	}
+};
+
+
+
+/* Returns the number of cores on the machine. */
+unsigned int getCoreCount(void) {
+	unsigned int count = thread::hardware_concurrency();
+
+	/* hardware_concurrency() returns 0 if it can't tell. */
+	return (count > 0) ? count : 1;
+}
+
+
+/* Returns the number of threads work is split across. This is the number of cores on the machine unless
+   setThreadCount() has been told otherwise. */
+unsigned int getThreadCount(void) {
+	return (selectedThreadCount > 0) ? selectedThreadCount : getCoreCount();
+}
+
+
+/* Makes work be split across COUNT threads from now on, or across one per core if COUNT is 0. */
+void setThreadCount(unsigned int count) {
+	selectedThreadCount = count;
+}
+
+
+/* Splits the items [0, COUNT) into getThreadCount() contiguous chunks of nearly equal size, some of which may be
+   empty, and runs BODY on each chunk on its own thread. Chunk i always covers items before chunk i+1.
+   Returns once every chunk is done. */
+void parallelFor(unsigned int count, ParallelBody body, void *context) {
+	unsigned int chunkCount = getThreadCount();
+	vector <thread> threads;
+
+	/* The calling thread takes chunk 0 itself rather than sitting idle. */
+	for (unsigned int chunk = 1; chunk < chunkCount; chunk++) {
+		unsigned int begin = (unsigned int)((unsigned long long)count * chunk / chunkCount);
+		unsigned int end = (unsigned int)((unsigned long long)count * (chunk+1) / chunkCount);
+
+		threads.push_back(thread(body, context, chunk, begin, end));
+	}
+
+	body(context, 0, 0, (unsigned int)((unsigned long long)count / chunkCount));
+
+	for (unsigned int i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+}
+
+
+
+/* Takes the item at the front of RANGE into RETURN_ITEM. Returns false if RANGE has none left. */
+static bool takeItem(ItemRange &range, unsigned int &returnItem) {
+	lock_guard <mutex> guard (range.lock);
+
+	if (range.next >= range.end) {
+		return false;
+	}
+
+	returnItem = range.next++;
+	return true;
+}
+
+
+/* Moves the back half of the items another thread of RUN has left, rounded up, into the range of THREAD, which must
+   be empty. Other threads are tried in turn, starting from the one after THREAD. Returns false if none had any left.
+   Only one lock is held at a time, so threads stealing from each other can't deadlock. */
+static bool stealItems(ItemRun &run, unsigned int thread) {
+	unsigned int threadCount = run.ranges.size();
+
+	for (unsigned int k = 1; k < threadCount; k++) {
+		ItemRange &victim = run.ranges[(thread + k) % threadCount];
+		unsigned int begin;
+		unsigned int end;
+
+		{
+			lock_guard <mutex> guard (victim.lock);
+
+			if (victim.next >= victim.end) {
+				continue;
+			}
+
+			end = victim.end;
+			begin = end - (end - victim.next + 1)/2;
+			victim.end = begin;
+		}
+
+		lock_guard <mutex> guard (run.ranges[thread].lock);
+		run.ranges[thread].next = begin;
+		run.ranges[thread].end = end;
+		return true;
+	}
+
+	return false;
+}
+
+
+/* Runs the items of RUN as thread THREAD: its own until they run out, then whatever it can steal, until no thread
+   has any left. */
+static void runItems(ItemRun *run, unsigned int thread) {
+	unsigned int item;
+
+	do {
+		while (takeItem(run->ranges[thread], item)) {
+			run->body(run->context, thread, item);
+		}
+	} while (stealItems(*run, thread));
+}
+
+
+/* Runs BODY once for each of the items [0, COUNT), on up to getThreadCount() threads, for work whose items take
+   very different amounts of time. Each thread starts with a contiguous share of the items and runs them from the
+   front; once it runs out, it steals the back half of what another thread has left. Which thread runs an item,
+   and when, changes from one call to the next. Returns once every item is done. */
+void parallelForEach(unsigned int count, ParallelItemBody body, void *context) {
+	unsigned int threadCount = getThreadCount();
+
+	/* A thread with nothing to start with would only steal. */
+	if (threadCount > count) {
+		threadCount = (count > 0) ? count : 1;
+	}
+
+	ItemRun run (threadCount);
+	run.body = body;
+	run.context = context;
+
+	for (unsigned int i = 0; i < threadCount; i++) {
+		run.ranges[i].next = (unsigned int)((unsigned long long)count * i / threadCount);
+		run.ranges[i].end = (unsigned int)((unsigned long long)count * (i+1) / threadCount);
+	}
+
+	/* The calling thread runs as thread 0 rather than sitting idle. */
+	vector <thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++) {
+		threads.push_back(thread(runItems, &run, i));
+	}
+
+	runItems(&run, 0);
+
+	for (unsigned int i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+}
@@ -0,0 +1,39 @@
+/* Contains declarations for functions that split work across the machine's cores. */
+
+#ifndef PARALLEL
+#define PARALLEL
+
+
+	/* A piece of work run by parallelFor(). CONTEXT is passed through from parallelFor(), CHUNK numbers the
+	   chunk from 0, and [BEGIN, END) is the range of items the chunk covers. */
+	typedef void (*ParallelBody)(void *context, unsigned int chunk, unsigned int begin, unsigned int end);
+
+	/* A piece of work run by parallelForEach() for a single item. CONTEXT is passed through from parallelForEach(),
+	   THREAD numbers the thread running it from 0, below getThreadCount(), and ITEM is the item to run it for. No two
+	   items run at the same time on the same THREAD, so it can pick out scratch space that thread alone uses. */
+	typedef void (*ParallelItemBody)(void *context, unsigned int thread, unsigned int item);
+
+
+	/* Returns the number of cores on the machine. */
+	unsigned int getCoreCount(void);
+
+	/* Returns the number of threads work is split across. This is the number of cores on the machine unless
+	   setThreadCount() has been told otherwise. */
+	unsigned int getThreadCount(void);
+
+	/* Makes work be split across COUNT threads from now on, or across one per core if COUNT is 0. */
+	void setThreadCount(unsigned int count);
+
+	/* Splits the items [0, COUNT) into getThreadCount() contiguous chunks of nearly equal size, some of which may be
+	   empty, and runs BODY on each chunk on its own thread. Chunk i always covers items before chunk i+1.
+	   Returns once every chunk is done. */
+	void parallelFor(unsigned int count, ParallelBody body, void *context);
+
+	/* Runs BODY once for each of the items [0, COUNT), on up to getThreadCount() threads, for work whose items take
+	   very different amounts of time. Each thread starts with a contiguous share of the items and runs them from the
+	   front; once it runs out, it steals the back half of what another thread has left. Which thread runs an item,
+	   and when, changes from one call to the next. Returns once every item is done. */
+	void parallelForEach(unsigned int count, ParallelItemBody body, void *context);
+
+
+#endif
@@ -0,0 +1,275 @@
+/* Contains definitions for counter-based random number streams.
+
+   A counter-based generator has no state to carry from one number to the next: each number is a fixed scrambling of
+   a counter naming it, here the pixel, the sample and the dimension it is for. Threads can draw numbers in any order,
+   and a render that uses them comes out the same on any number of threads, and from one run to the next. The SIMD
+   versions scramble several counters at once, one per 64-bit lane, with the same integer operations as the scalar
+   code, so the numbers they make are exactly the same. */
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "random.h"
+#include "cpu.h"
+
+using namespace std;
+
+
+/* Multipliers of the two halves of a Philox4x32 round, and the constants added to the two words of the key after each
+   round, as Salmon et al. give them. */
+#define PHILOX_MULTIPLIER_0 0xD2511F53u
+#define PHILOX_MULTIPLIER_1 0xCD9E8D57u
+#define PHILOX_KEY_STEP_0 0x9E3779B9u
+#define PHILOX_KEY_STEP_1 0xBB67AE85u
+
+/* Number of rounds Philox4x32-10 scrambles a counter through. */
+#define PHILOX_ROUNDS 10
+
+/* The bits of the double 1.0, whose exponent the random bits are placed under to make a number in [1, 2). */
+#define RANDOM_ONE_BITS 0x3FF0000000000000ull
+
+
+
+/* Places into RETURN_ROUND_KEYS[r] the two words of KEY the Philox round R uses. */
+static void getRoundKeys(const unsigned int key[2], unsigned int returnRoundKeys[PHILOX_ROUNDS][2]) {
+    returnRoundKeys[0][0] = key[0];
+    returnRoundKeys[0][1] = key[1];
+
+    for (int round = 1; round < PHILOX_ROUNDS; round++) {
+        returnRoundKeys[round][0] = returnRoundKeys[round-1][0] + PHILOX_KEY_STEP_0;
+        returnRoundKeys[round][1] = returnRoundKeys[round-1][1] + PHILOX_KEY_STEP_1;
+    }
+}
+
+
+/* Splits SEED into the two words of a Philox key, placed into RETURN_KEY. */
+static void getKey(unsigned long long seed, unsigned int returnKey[2]) {
+    returnKey[0] = (unsigned int)seed;
+    returnKey[1] = (unsigned int)(seed >> 32);
+}
+
+
+/* Returns the number in [0, 1) made of 52 random bits: the 32 bits of HIGH followed by the top 20 bits of LOW. They are
+   placed under the exponent of 1.0, which gives a number in [1, 2) with every step of 2^-52 equally likely, and 1.0 is
+   taken off exactly. */
+static double toUnitDouble(unsigned int high, unsigned int low) {
+    unsigned long long bits = RANDOM_ONE_BITS | ((unsigned long long)high << 20) | (low >> 12);
+    double value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value - 1.0;
+}
+
+
+
+/* Turns the four words of COUNTER into four random words, placed into RETURN_WORDS, with the Philox4x32-10 generator
+   of Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", keyed by the two words of KEY. The same counter
+   and key always give the same words, and different counters give unrelated ones. */
+void philox(const unsigned int counter[RANDOM_WORDS], const unsigned int key[2], unsigned int returnWords[RANDOM_WORDS]) {
+    unsigned int roundKeys [PHILOX_ROUNDS][2];
+    getRoundKeys(key, roundKeys);
+
+    unsigned int c0 = counter[0];
+    unsigned int c1 = counter[1];
+    unsigned int c2 = counter[2];
+    unsigned int c3 = counter[3];
+
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        unsigned long long product0 = (unsigned long long)PHILOX_MULTIPLIER_0 * c0;
+        unsigned long long product1 = (unsigned long long)PHILOX_MULTIPLIER_1 * c2;
+
+        c0 = (unsigned int)(product1 >> 32) ^ c1 ^ roundKeys[round][0];
+        c1 = (unsigned int)product1;
+        c2 = (unsigned int)(product0 >> 32) ^ c3 ^ roundKeys[round][1];
+        c3 = (unsigned int)product0;
+    }
+
+    returnWords[0] = c0;
+    returnWords[1] = c1;
+    returnWords[2] = c2;
+    returnWords[3] = c3;
+}
+
+
+/* Returns the random number in [0, 1) for dimension DIMENSION of sample SAMPLE of pixel PIXEL, out of the streams
+   picked by SEED. The counter is (PIXEL, SAMPLE, DIMENSION, 0), and the first two words Philox makes of it give the
+   52 bits of the number. */
+double getRandomDouble(unsigned long long seed, unsigned int pixel, unsigned int sample, unsigned int dimension) {
+    unsigned int key [2];
+    getKey(seed, key);
+
+    unsigned int counter [RANDOM_WORDS] = {pixel, sample, dimension, 0};
+    unsigned int words [RANDOM_WORDS];
+    philox(counter, key, words);
+
+    return toUnitDouble(words[0], words[1]);
+}
+
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* generateRandomDoubles() with AVX-512, eight counters at a time. Each word of a counter sits in the low half of a
+   64-bit lane, where the 32 by 32 bit multiply leaves the whole 64-bit product. The masked forms of the integer
+   instructions, with every lane set, keep GCC from warning about the undefined lanes the plain ones pass through. A
+   few counters left over are done on their own. */
+__attribute__((target("avx512f")))
+static void generateRandomDoublesAVX512(unsigned long long seed, const unsigned int *pixels, const unsigned int *samples,
+                                        const unsigned int *dimensions, unsigned int count, double *returnValues) {
+    unsigned int key [2];
+    unsigned int roundKeys [PHILOX_ROUNDS][2];
+    getKey(seed, key);
+    getRoundKeys(key, roundKeys);
+
+    __m512i multiplier0 = _mm512_set1_epi64(PHILOX_MULTIPLIER_0);
+    __m512i multiplier1 = _mm512_set1_epi64(PHILOX_MULTIPLIER_1);
+    __m512i lowWord = _mm512_set1_epi64(0xffffffffll);
+    __m512i oneBits = _mm512_set1_epi64(RANDOM_ONE_BITS);
+    __m512d one = _mm512_set1_pd(1.0);
+
+    unsigned int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m512i c0 = _mm512_maskz_cvtepu32_epi64(0xff, _mm256_loadu_si256((const __m256i *)(pixels + i)));
+        __m512i c1 = _mm512_maskz_cvtepu32_epi64(0xff, _mm256_loadu_si256((const __m256i *)(samples + i)));
+        __m512i c2 = _mm512_maskz_cvtepu32_epi64(0xff, _mm256_loadu_si256((const __m256i *)(dimensions + i)));
+        __m512i c3 = _mm512_setzero_si512();
+
+        for (int round = 0; round < PHILOX_ROUNDS; round++) {
+            __m512i product0 = _mm512_maskz_mul_epu32(0xff, c0, multiplier0);
+            __m512i product1 = _mm512_maskz_mul_epu32(0xff, c2, multiplier1);
+
+            c0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_maskz_srli_epi64(0xff, product1, 32), c1), _mm512_set1_epi64(roundKeys[round][0]));
+            c1 = _mm512_and_si512(product1, lowWord);
+            c2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_maskz_srli_epi64(0xff, product0, 32), c3), _mm512_set1_epi64(roundKeys[round][1]));
+            c3 = _mm512_and_si512(product0, lowWord);
+        }
+
+        __m512i bits = _mm512_or_si512(oneBits, _mm512_or_si512(_mm512_maskz_slli_epi64(0xff, c0, 20), _mm512_maskz_srli_epi64(0xff, c1, 12)));
+        _mm512_storeu_pd(returnValues + i, _mm512_sub_pd(_mm512_castsi512_pd(bits), one));
+    }
+
+    for (; i < count; i++) {
+        returnValues[i] = getRandomDouble(seed, pixels[i], samples[i], dimensions[i]);
+    }
+}
+
+
+/* generateRandomDoubles() with AVX2, four counters at a time, as the AVX-512 version does them. */
+__attribute__((target("avx2")))
+static void generateRandomDoublesAVX2(unsigned long long seed, const unsigned int *pixels, const unsigned int *samples,
+                                      const unsigned int *dimensions, unsigned int count, double *returnValues) {
+    unsigned int key [2];
+    unsigned int roundKeys [PHILOX_ROUNDS][2];
+    getKey(seed, key);
+    getRoundKeys(key, roundKeys);
+
+    __m256i multiplier0 = _mm256_set1_epi64x(PHILOX_MULTIPLIER_0);
+    __m256i multiplier1 = _mm256_set1_epi64x(PHILOX_MULTIPLIER_1);
+    __m256i lowWord = _mm256_set1_epi64x(0xffffffffll);
+    __m256i oneBits = _mm256_set1_epi64x(RANDOM_ONE_BITS);
+    __m256d one = _mm256_set1_pd(1.0);
+
+    unsigned int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256i c0 = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(pixels + i)));
+        __m256i c1 = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(samples + i)));
+        __m256i c2 = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(dimensions + i)));
+        __m256i c3 = _mm256_setzero_si256();
+
+        for (int round = 0; round < PHILOX_ROUNDS; round++) {
+            __m256i product0 = _mm256_mul_epu32(c0, multiplier0);
+            __m256i product1 = _mm256_mul_epu32(c2, multiplier1);
+
+            c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(product1, 32), c1), _mm256_set1_epi64x(roundKeys[round][0]));
+            c1 = _mm256_and_si256(product1, lowWord);
+            c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(product0, 32), c3), _mm256_set1_epi64x(roundKeys[round][1]));
+            c3 = _mm256_and_si256(product0, lowWord);
+        }
+
+        __m256i bits = _mm256_or_si256(oneBits, _mm256_or_si256(_mm256_slli_epi64(c0, 20), _mm256_srli_epi64(c1, 12)));
+        _mm256_storeu_pd(returnValues + i, _mm256_sub_pd(_mm256_castsi256_pd(bits), one));
+    }
+
+    for (; i < count; i++) {
+        returnValues[i] = getRandomDouble(seed, pixels[i], samples[i], dimensions[i]);
+    }
+}
+
+
+/* generateRandomDoubles() with SSE2, two counters at a time, as the AVX-512 version does them. SSE2 can't widen 32-bit
+   words to 64 bits in one instruction, so they are interleaved with zeros instead. */
+static void generateRandomDoublesSSE2(unsigned long long seed, const unsigned int *pixels, const unsigned int *samples,
+                                      const unsigned int *dimensions, unsigned int count, double *returnValues) {
+    unsigned int key [2];
+    unsigned int roundKeys [PHILOX_ROUNDS][2];
+    getKey(seed, key);
+    getRoundKeys(key, roundKeys);
+
+    __m128i zero = _mm_setzero_si128();
+    __m128i multiplier0 = _mm_set1_epi64x(PHILOX_MULTIPLIER_0);
+    __m128i multiplier1 = _mm_set1_epi64x(PHILOX_MULTIPLIER_1);
+    __m128i lowWord = _mm_set1_epi64x(0xffffffffll);
+    __m128i oneBits = _mm_set1_epi64x(RANDOM_ONE_BITS);
+    __m128d one = _mm_set1_pd(1.0);
+
+    unsigned int i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m128i c0 = _mm_unpacklo_epi32(_mm_loadl_epi64((const __m128i *)(pixels + i)), zero);
+        __m128i c1 = _mm_unpacklo_epi32(_mm_loadl_epi64((const __m128i *)(samples + i)), zero);
+        __m128i c2 = _mm_unpacklo_epi32(_mm_loadl_epi64((const __m128i *)(dimensions + i)), zero);
+        __m128i c3 = zero;
+
+        for (int round = 0; round < PHILOX_ROUNDS; round++) {
+            __m128i product0 = _mm_mul_epu32(c0, multiplier0);
+            __m128i product1 = _mm_mul_epu32(c2, multiplier1);
+
+            c0 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(product1, 32), c1), _mm_set1_epi64x(roundKeys[round][0]));
+            c1 = _mm_and_si128(product1, lowWord);
+            c2 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(product0, 32), c3), _mm_set1_epi64x(roundKeys[round][1]));
+            c3 = _mm_and_si128(product0, lowWord);
+        }
+
+        __m128i bits = _mm_or_si128(oneBits, _mm_or_si128(_mm_slli_epi64(c0, 20), _mm_srli_epi64(c1, 12)));
+        _mm_storeu_pd(returnValues + i, _mm_sub_pd(_mm_castsi128_pd(bits), one));
+    }
+
+    for (; i < count; i++) {
+        returnValues[i] = getRandomDouble(seed, pixels[i], samples[i], dimensions[i]);
+    }
+}
+
+#endif
+
+
+/* Places into RETURN_VALUES[i] the random number getRandomDouble() returns for SEED, PIXELS[i], SAMPLES[i] and
+   DIMENSIONS[i], for each of the COUNT counters, exactly as it would. WIDTH is the number of numbers made at once, 0
+   for the widest. */
+void generateRandomDoubles(unsigned long long seed, const unsigned int *pixels, const unsigned int *samples,
+                           const unsigned int *dimensions, unsigned int count, double *returnValues, int width) {
+#if defined(__x86_64__) || defined(__i386__)
+    width = getKernelWidth(width);
+
+    if (width >= 8) {
+        generateRandomDoublesAVX512(seed, pixels, samples, dimensions, count, returnValues);
+        return;
+    }
+    if (width >= 4) {
+        generateRandomDoublesAVX2(seed, pixels, samples, dimensions, count, returnValues);
+        return;
+    }
+    if (width >= 2) {
+        generateRandomDoublesSSE2(seed, pixels, samples, dimensions, count, returnValues);
+        return;
+    }
+#endif
+
+    for (unsigned int i = 0; i < count; i++) {
+        returnValues[i] = getRandomDouble(seed, pixels[i], samples[i], dimensions[i]);
+    }
+}
@@ -0,0 +1,32 @@
+/* Contains declarations for counter-based random number streams, which give every pixel, sample and dimension of a
+   sample its own random number, worked out from where it is rather than from the numbers drawn before it. */
+
+#ifndef RANDOM
+#define RANDOM
+
+
+	/* Number of 32-bit words the Philox4x32-10 generator turns each counter into. */
+	#define RANDOM_WORDS 4
+
+
+	/* Turns the four words of COUNTER into four random words, placed into RETURN_WORDS, with the Philox4x32-10 generator
+	   of Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", keyed by the two words of KEY. The same counter
+	   and key always give the same words, and different counters give unrelated ones. */
+	void philox(const unsigned int counter[RANDOM_WORDS], const unsigned int key[2], unsigned int returnWords[RANDOM_WORDS]);
+
+
+	/* Returns the random number in [0, 1) for dimension DIMENSION of sample SAMPLE of pixel PIXEL, such as the x or y
+	   offset of the sample within the pixel, out of the streams picked by SEED. It has 52 random bits, and depends on
+	   nothing else: not on which thread asks, nor on what was asked for before. */
+	double getRandomDouble(unsigned long long seed, unsigned int pixel, unsigned int sample, unsigned int dimension);
+
+
+	/* Places into RETURN_VALUES[i] the random number getRandomDouble() returns for SEED, PIXELS[i], SAMPLES[i] and
+	   DIMENSIONS[i], for each of the COUNT counters, exactly as it would. WIDTH is the number of numbers made at once:
+	   8 with AVX-512, 4 with AVX2, 2 with SSE2, or 1 without SIMD. 0 picks the widest the instruction set in use
+	   allows, as for the kernels of kernels.h. */
+	void generateRandomDoubles(unsigned long long seed, const unsigned int *pixels, const unsigned int *samples,
+	                           const unsigned int *dimensions, unsigned int count, double *returnValues, int width);
+
+
+#endif
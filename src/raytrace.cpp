@@ -9,6 +9,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <climits>
 #include <cmath>
 #include <list>
 #include <typeinfo>
@@ -16,14 +17,23 @@
 #include "common.h"
 #include "lowlevel.h"
 #include "raytrace.h"
-#include "vector.h" /* My own implementation of a 4x1 vector. */
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
 #include "color.h"
+#include "kernels.h"
+#include "cpu.h"
 #include "misc.h"
 #include "test.h"
 #include "sceneobject.h"
 #include "geometry.h"
 #include "light.h"
 #include "transform.h"
+#include "accelerator.h"
+#include "scenes.h"
+#include "benchmark.h"
+#include "animation.h"
+#include "wavefront.h"
+#include "tiles.h"
+#include "parallel.h"
 
 using namespace std;
 
@@ -32,6 +42,9 @@ using namespace std;
 void initCamera (int, int);
 void display(void);
 void init(int, int);
+void loadScene(void);
+void parseArguments(int&, char**);
+void printUsage(const char *);
 
 
 /* Viewing parameters: */
@@ -40,7 +53,7 @@ GLfloat FOV_X;  /* x-angle of view frustum */
 
 /* The center point where the camera is located. This is where the camera
    sits in relation to the scene. */
-Vector CAMERA_LOCATION;
+Point3 CAMERA_LOCATION;
 
 
 /* Scene parameters: */
@@ -50,6 +63,66 @@ vector <SceneObject *> *SCENE_OBJECTS;
 /* Pointer to a STL vector containing all the lights of the scene. */
 vector <PointLight *> *SCENE_LIGHTS;
 
+/* Acceleration structure over SCENE_OBJECTS used to find ray intersections. If NULL, every ray is
+   tested against every object in SCENE_OBJECTS. */
+Accelerator *SCENE_ACCELERATOR = NULL;
+
+/* SCENE_OBJECTS compiled into pools by type, which rays are tested against when SCENE_ACCELERATOR is NULL. The spheres
+   are tested a batch at a time. */
+CompiledScene SCENE_PRIMITIVES;
+
+/* Name of the kind of acceleration structure to build over the scene, such as "bvh" or "none", or "auto" to
+   pick one from the scene with chooseAccelerator(). */
+const char *ACCELERATOR_NAME = "bvh";
+
+/* If not NULL, the scene is rendered into this image file instead of an OpenGL window. */
+const char *OUTPUT_FILENAME = NULL;
+
+/* Name of the scene to render: "demo", or one of the generated "triangles", "spheres", "clusters", "walls" or
+   "instances" scenes. */
+const char *SCENE_NAME = "demo";
+
+/* Number of extra copies of objects an "sbvh" may make by splitting them, as a fraction of the number of objects. */
+double SPLIT_BUDGET = 1.0;
+
+/* Number of objects in a generated scene. */
+unsigned int SCENE_SIZE = 100000;
+
+/* If true, the acceleration structures are compared over the scene instead of rendering it. */
+bool RUN_BENCHMARK = false;
+
+/* If true, the scene is rendered on every number of threads from 1 up to getThreadCount() and the times compared,
+   instead of rendering it once. */
+bool RUN_SCALING = false;
+
+/* If greater than 0, this many frames of an animation are rendered, with some of the scene's spheres moving. */
+int FRAME_COUNT = 0;
+
+/* If greater than 1, primary rays are traced together through the acceleration structure in blocks of PACKET_SIZE by
+   PACKET_SIZE pixels. */
+int PACKET_SIZE = 0;
+
+/* Number of rays traced through each pixel, at random points within it drawn from the random streams of random.h, and
+   averaged. With 1, the ray goes through the pixel's corner as it always has. */
+int SAMPLE_COUNT = 1;
+
+/* Picks the random streams the sample points of every pixel are drawn from. The same seed always gives the same image. */
+unsigned long long SAMPLE_SEED = 0;
+
+/* If true, the scene is drawn by the wavefront renderer, drawSceneWavefront(), rather than one ray at a time. */
+bool RENDER_WAVEFRONT = false;
+
+/* If true, the wavefront renderer sorts each queue of secondary rays and shadow rays by where they start and which way
+   they point before tracing them. */
+bool SORT_SECONDARY_RAYS = false;
+
+/* How far offsetRayStart() moves rays off surfaces in single precision: coordinates closer to zero than
+   RAY_OFFSET_ORIGIN are moved RAY_OFFSET_FLOAT_SCALE along the normal, and the rest by RAY_OFFSET_INT_SCALE units in
+   the last place for each unit of the normal. */
+#define RAY_OFFSET_ORIGIN (1.0f/32.0f)
+#define RAY_OFFSET_FLOAT_SCALE (1.0f/65536.0f)
+#define RAY_OFFSET_INT_SCALE 256.0f
+
 /* Color of the background. */
 Color BG_COLOR = {0.10, 0.0, 0.10, 1.0};
 
@@ -63,14 +136,55 @@ int CANVAS_HEIGHT = 300;    /* CANVAS_HEIGHT of window in pixels */
 /* Rays will be shot until reaching this depth. */
 int MAX_TRACING_DEPTH = 6;
 
-/* The refraction index of the material the current ray is coming from. */
-double INCOMING_REFRACTION_INDEX = 1.0;
-
 
 
 int main (int argc, char** argv) {
   int win;
 
+  parseArguments(argc, argv);
+  printInstructionSet();
+
+  /* Compare the acceleration structures without opening a window. */
+  if (RUN_BENCHMARK) {
+    initCamera(CANVAS_WIDTH,CANVAS_HEIGHT);
+    loadScene();
+    benchmarkAccelerators();
+    benchmarkTriangleTests();
+    return 0;
+  }
+
+  /* Time the render on more and more threads without opening a window. */
+  if (RUN_SCALING) {
+    initCanvas(CANVAS_WIDTH,CANVAS_HEIGHT);
+    initCamera(CANVAS_WIDTH,CANVAS_HEIGHT);
+    loadScene();
+    benchmarkThreadScaling();
+    return 0;
+  }
+
+  /* Render an animation without opening a window. */
+  if (FRAME_COUNT > 0) {
+    initCanvas(CANVAS_WIDTH,CANVAS_HEIGHT);
+    initCamera(CANVAS_WIDTH,CANVAS_HEIGHT);
+    loadScene();
+    renderAnimation(FRAME_COUNT);
+    return 0;
+  }
+
+  /* Render straight into an image file without opening a window. */
+  if (OUTPUT_FILENAME != NULL) {
+    initCanvas(CANVAS_WIDTH,CANVAS_HEIGHT);
+    initCamera(CANVAS_WIDTH,CANVAS_HEIGHT);
+    loadScene();
+    drawScene();
+
+    if (writeCanvas(OUTPUT_FILENAME) != 0) {
+      fprintf(stderr, "Couldn't write image to %s\n", OUTPUT_FILENAME);
+      return 1;
+    }
+    return 0;
+  }
+
   glutInit(&argc,argv);
   glutInitWindowSize(CANVAS_WIDTH,CANVAS_HEIGHT);
   glutInitWindowPosition(100,100);
@@ -98,7 +212,181 @@ void init(int w, int h) {
   /* raytracer setup */
   initCamera(w,h);
 
-  initScene();
+  loadScene();
+}
+
+
+/* Sets up the scene named by SCENE_NAME and builds its acceleration structure. */
+void loadScene(void) {
+  if (strcmp(SCENE_NAME, "triangles") == 0) {
+    initTriangleScene(SCENE_SIZE);
+  }
+  else if (strcmp(SCENE_NAME, "spheres") == 0) {
+    initSphereScene(SCENE_SIZE);
+  }
+  else if (strcmp(SCENE_NAME, "clusters") == 0) {
+    initClusteredSphereScene(SCENE_SIZE);
+  }
+  else if (strcmp(SCENE_NAME, "walls") == 0) {
+    initWallScene(SCENE_SIZE);
+  }
+  else if (strcmp(SCENE_NAME, "instances") == 0) {
+    initInstanceScene(SCENE_SIZE);
+  }
+  else {
+    initScene();
+  }
+
+  buildAccelerator();
+}
+
+
+/* Reads the raytracer's own options out of ARGV, removing them and leaving the rest for GLUT. */
+void parseArguments(int &argc, char** argv) {
+  int remaining = 1;
+
+  for (int i = 1; i < argc; i++) {
+
+    if (strcmp(argv[i], "-accel") == 0 && i+1 < argc) {
+      ACCELERATOR_NAME = argv[++i];
+      if (!isAcceleratorName(ACCELERATOR_NAME)) {
+        fprintf(stderr, "Unknown acceleration structure: %s\n", ACCELERATOR_NAME);
+        printUsage(argv[0]);
+        exit(1);
+      }
+    }
+    else if (strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+      OUTPUT_FILENAME = argv[++i];
+    }
+    else if (strcmp(argv[i], "-scene") == 0 && i+1 < argc) {
+      SCENE_NAME = argv[++i];
+      if (strcmp(SCENE_NAME, "demo") != 0 && strcmp(SCENE_NAME, "triangles") != 0 && strcmp(SCENE_NAME, "spheres") != 0 &&
+          strcmp(SCENE_NAME, "clusters") != 0 && strcmp(SCENE_NAME, "walls") != 0 && strcmp(SCENE_NAME, "instances") != 0) {
+        fprintf(stderr, "Unknown scene: %s\n", SCENE_NAME);
+        printUsage(argv[0]);
+        exit(1);
+      }
+    }
+    else if (strcmp(argv[i], "-split-budget") == 0 && i+1 < argc) {
+      SPLIT_BUDGET = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-count") == 0 && i+1 < argc) {
+      SCENE_SIZE = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-frames") == 0 && i+1 < argc) {
+      FRAME_COUNT = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-packet") == 0 && i+1 < argc) {
+      PACKET_SIZE = atoi(argv[++i]);
+      if (PACKET_SIZE < 0 || PACKET_SIZE*PACKET_SIZE > MAX_PACKET_SIZE) {
+        fprintf(stderr, "Packets can be at most 8x8 pixels: %d\n", PACKET_SIZE);
+        printUsage(argv[0]);
+        exit(1);
+      }
+    }
+    else if (strcmp(argv[i], "-samples") == 0 && i+1 < argc) {
+      SAMPLE_COUNT = atoi(argv[++i]);
+      if (SAMPLE_COUNT < 1 || SAMPLE_COUNT > MAX_SAMPLE_COUNT) {
+        fprintf(stderr, "Pixels can have 1 to %d samples: %d\n", MAX_SAMPLE_COUNT, SAMPLE_COUNT);
+        printUsage(argv[0]);
+        exit(1);
+      }
+    }
+    else if (strcmp(argv[i], "-seed") == 0 && i+1 < argc) {
+      SAMPLE_SEED = strtoull(argv[++i], NULL, 0);
+    }
+    else if (strcmp(argv[i], "-wavefront") == 0) {
+      RENDER_WAVEFRONT = true;
+    }
+    else if (strcmp(argv[i], "-sort-rays") == 0) {
+      RENDER_WAVEFRONT = true;
+      SORT_SECONDARY_RAYS = true;
+    }
+    else if (strcmp(argv[i], "-bench") == 0) {
+      RUN_BENCHMARK = true;
+    }
+    else if (strcmp(argv[i], "-threads") == 0 && i+1 < argc) {
+      int count = atoi(argv[++i]);
+      if (count < 0) {
+        fprintf(stderr, "Can't render on %d threads\n", count);
+        printUsage(argv[0]);
+        exit(1);
+      }
+      setThreadCount(count);
+    }
+    else if (strcmp(argv[i], "-scaling") == 0) {
+      RUN_SCALING = true;
+    }
+    else if (strcmp(argv[i], "-isa") == 0 && i+1 < argc) {
+      InstructionSet set;
+      if (!parseInstructionSet(argv[++i], set)) {
+        fprintf(stderr, "Unknown instruction set: %s\n", argv[i]);
+        printUsage(argv[0]);
+        exit(1);
+      }
+      if (!setInstructionSet(set)) {
+        fprintf(stderr, "This processor doesn't support %s\n", argv[i]);
+        exit(1);
+      }
+    }
+    else if (strcmp(argv[i], "-psnr") == 0 && i + 2 < argc) {
+      exit(compareImages(argv[i+1], argv[i+2]) ? 0 : 1);
+    }
+    else if (strcmp(argv[i], "-test") == 0) {
+      printInstructionSet();
+      bool passed = testSphereKernel();
+      passed = testTrianglePacketKernel() && passed;
+      passed = testBoxKernel() && passed;
+      passed = testBatchTransforms() && passed;
+      passed = testColorKernel() && passed;
+      passed = testRandomStreams() && passed;
+      exit(passed ? 0 : 1);
+    }
+    else if (strcmp(argv[i], "-help") == 0) {
+      printUsage(argv[0]);
+      exit(0);
+    }
+    else {
+      argv[remaining++] = argv[i];
+    }
+  }
+
+  /* The wavefront renderer traces one ray through each pixel. */
+  if (RENDER_WAVEFRONT && SAMPLE_COUNT > 1) {
+    fprintf(stderr, "-samples can't be used with -wavefront\n");
+    exit(1);
+  }
+
+  /* Packets trace one ray through each pixel of a block. */
+  if (PACKET_SIZE > 1 && SAMPLE_COUNT > 1) {
+    fprintf(stderr, "-samples can't be used with -packet\n");
+    exit(1);
+  }
+
+  argc = remaining;
+}
+
+
+/* Prints the options the raytracer understands. */
+void printUsage(const char *programName) {
+  fprintf(stderr, "Usage: %s [options]\n", programName);
+  fprintf(stderr, "  -accel <bvh|sbvh|lbvh|bvh4|bvh8|cbvh|grid|grid2|kd|auto|none> acceleration structure to find intersections with (default: bvh)\n");
+  fprintf(stderr, "  -split-budget <f>             extra copies of objects an sbvh may make, per object (default: 1.0)\n");
+  fprintf(stderr, "  -o <file.ppm>                 render into a PPM image instead of a window\n");
+  fprintf(stderr, "  -scene <demo|triangles|spheres|clusters|walls|instances> scene to render (default: demo)\n");
+  fprintf(stderr, "  -count <n>                    number of objects in a generated scene (default: 100000)\n");
+  fprintf(stderr, "  -frames <n>                   render n frames with moving spheres, updating the acceleration structure\n");
+  fprintf(stderr, "  -packet <n>                   trace primary rays in blocks of n x n pixels together, up to 8 (default: off)\n");
+  fprintf(stderr, "  -samples <n>                  trace n rays through random points of each pixel and average them, up to %d, not with -packet or -wavefront (default: 1)\n", MAX_SAMPLE_COUNT);
+  fprintf(stderr, "  -seed <n>                     pick the random streams -samples draws its points from (default: 0)\n");
+  fprintf(stderr, "  -wavefront                    trace the rays in batches, one stage at a time, and time each stage\n");
+  fprintf(stderr, "  -sort-rays                    with -wavefront (which it turns on), sort secondary and shadow rays before tracing them\n");
+  fprintf(stderr, "  -bench                        compare build time and ray throughput of every acceleration structure\n");
+  fprintf(stderr, "  -threads <n>                  threads to render and build acceleration structures on, 0 for one per core (default: 0)\n");
+  fprintf(stderr, "  -scaling                      render on 1 thread up to the -threads count, printing the speedup over 1 thread\n");
+  fprintf(stderr, "  -isa <scalar|sse2|avx2|avx512> SIMD instructions for the kernels to use, before -test to test them (default: the best supported)\n");
+  fprintf(stderr, "  -psnr <a.ppm> <b.ppm>         print the PSNR between two images, such as single and double precision renders, then exit\n");
+  fprintf(stderr, "  -test                         check the SIMD kernels, batch transforms and random streams against the scalar code, then exit\n");
 }
 
 
@@ -114,7 +402,7 @@ void display() {
 void initCamera (int w, int h) {
   P_NEAR = 1.0;
   FOV_X = PI/6;
-  CAMERA_LOCATION = Vector(0, 0, 0, 1);
+  CAMERA_LOCATION = Point3(0, 0, 0);
 }
 
 
@@ -219,7 +507,7 @@ void initScene(void) {
 
     /* Create a background plane. */
     Plane *p1 = new Plane; {
-        p1->normal = Vector (0.0, 0.0, 1.0, 0.0);
+        p1->normal = Direction3 (0.0, 0.0, 1.0);
 
         p1->x() =  0;
         p1->y() =  0;
@@ -238,7 +526,7 @@ void initScene(void) {
 
     /* Create a background plane. */
     Plane *p2 = new Plane; {
-        p2->normal = Vector (0.0, 0.0, -1.0, 0.0);
+        p2->normal = Direction3 (0.0, 0.0, -1.0);
 
         p2->x() =  0;
         p2->y() =  0;
@@ -256,7 +544,7 @@ void initScene(void) {
     }
 
     Plane *p3 = new Plane; {
-        p3->normal = Vector (0.0, 1.0, 0.0, 0.0);
+        p3->normal = Direction3 (0.0, 1.0, 0.0);
 
         p3->x() =  0;
         p3->y() = -3.00;
@@ -276,9 +564,9 @@ void initScene(void) {
     /* Create a triangle. */
     Triangle *t0 = new Triangle; {
 
-        t0->vertex0 = Vector (-1.5+3 , 0, -5, 1);
-        t0->vertex1 = Vector (0+3    , 2, -5, 1);
-        t0->vertex2 = Vector (1.5+3  , 0, -5, 1);
+        t0->setVertices(Point3 (-1.5+3 , 0, -5),
+                        Point3 (0+3    , 2, -5),
+                        Point3 (1.5+3  , 0, -5));
 
         t0->material.color.r = 0.5;
         t0->material.color.g = 0.0;
@@ -294,9 +582,9 @@ void initScene(void) {
 
     Triangle *t1 = new Triangle; {
 
-        t1->vertex0 = Vector (-1.5+5 , 1, -8, 1);
-        t1->vertex1 = Vector (0+5    , 3, -8, 1);
-        t1->vertex2 = Vector (1.5+5  , 1, -8, 1);
+        t1->setVertices(Point3 (-1.5+5 , 1, -8),
+                        Point3 (0+5    , 3, -8),
+                        Point3 (1.5+5  , 1, -8));
 
         t1->material.color.r = 1.0;
         t1->material.color.g = 0.0;
@@ -312,14 +600,12 @@ void initScene(void) {
 
 
     /* Tetrahedron 0. */
-    Vector tetra0Vertex0 (-2-8.0,  0-4.0,  0-12.5, 1);
-    Vector tetra0Vertex1 ( 0.5-8.5,  1.25-3.5,  -3-12.5, 1);
-    Vector tetra0Vertex2 ( 1.75-8.5,  .25-3.5,  0-12.5, 1);
-    Vector tetra0Vertex3 ( 0-8.5,  2.5-3.5, -2-12.5, 1);
+    Point3 tetra0Vertex0 (-2-8.0,  0-4.0,  0-12.5);
+    Point3 tetra0Vertex1 ( 0.5-8.5,  1.25-3.5,  -3-12.5);
+    Point3 tetra0Vertex2 ( 1.75-8.5,  .25-3.5,  0-12.5);
+    Point3 tetra0Vertex3 ( 0-8.5,  2.5-3.5, -2-12.5);
     Triangle *tetra0T1 = new Triangle; {
-        tetra0T1->vertex0 = tetra0Vertex0;        
-        tetra0T1->vertex1 = tetra0Vertex1; 
-        tetra0T1->vertex2 = tetra0Vertex2;
+        tetra0T1->setVertices(tetra0Vertex0, tetra0Vertex1, tetra0Vertex2);
 
         tetra0T1->material.color.r = 0.8;
         tetra0T1->material.color.g = 0.8;
@@ -333,9 +619,7 @@ void initScene(void) {
         SCENE_OBJECTS->push_back(tetra0T1);
     } 
         Triangle *tetra0T2 = new Triangle; {
-        tetra0T2->vertex0 = tetra0Vertex0;        
-        tetra0T2->vertex1 = tetra0Vertex1; 
-        tetra0T2->vertex2 = tetra0Vertex3;
+        tetra0T2->setVertices(tetra0Vertex0, tetra0Vertex1, tetra0Vertex3);
 
         tetra0T2->material.color.r = 0.8;
         tetra0T2->material.color.g = 0.8;
@@ -349,9 +633,7 @@ void initScene(void) {
         SCENE_OBJECTS->push_back(tetra0T2);
     } 
         Triangle *tetra0T3 = new Triangle; {
-        tetra0T3->vertex0 = tetra0Vertex0;        
-        tetra0T3->vertex1 = tetra0Vertex2; 
-        tetra0T3->vertex2 = tetra0Vertex3;
+        tetra0T3->setVertices(tetra0Vertex0, tetra0Vertex2, tetra0Vertex3);
 
         tetra0T3->material.color.r = 0.8;
         tetra0T3->material.color.g = 0.8;
@@ -365,9 +647,7 @@ void initScene(void) {
         SCENE_OBJECTS->push_back(tetra0T3);
     } 
         Triangle *tetra0T4 = new Triangle; {
-        tetra0T4->vertex0 = tetra0Vertex1;        
-        tetra0T4->vertex1 = tetra0Vertex2; 
-        tetra0T4->vertex2 = tetra0Vertex3;
+        tetra0T4->setVertices(tetra0Vertex1, tetra0Vertex2, tetra0Vertex3);
 
         tetra0T4->material.color.r = 0.8;
         tetra0T4->material.color.g = 0.8;
@@ -383,15 +663,13 @@ void initScene(void) {
 
 
     /* Tetrahedron 1. */
-    Vector tetra1Vertex0 (-2+8.0,  0+4.0,  0-12.5, 1);
-    Vector tetra1Vertex1 ( -0.5+8.5,  1.25+3.5,  -3-12.5, 1);
-    Vector tetra1Vertex2 ( 1.75+8.5,  .25+3.5,  0-12.5, 1);
-    Vector tetra1Vertex3 ( 0+8.5,  3.0+3.5, -2-12.5, 1);
+    Point3 tetra1Vertex0 (-2+8.0,  0+4.0,  0-12.5);
+    Point3 tetra1Vertex1 ( -0.5+8.5,  1.25+3.5,  -3-12.5);
+    Point3 tetra1Vertex2 ( 1.75+8.5,  .25+3.5,  0-12.5);
+    Point3 tetra1Vertex3 ( 0+8.5,  3.0+3.5, -2-12.5);
 
     Triangle *tetra1T1 = new Triangle; {
-        tetra1T1->vertex0 = tetra1Vertex0;        
-        tetra1T1->vertex1 = tetra1Vertex1; 
-        tetra1T1->vertex2 = tetra1Vertex2;
+        tetra1T1->setVertices(tetra1Vertex0, tetra1Vertex1, tetra1Vertex2);
 
         tetra1T1->material.color.r = 0.5;
         tetra1T1->material.color.g = 1.0;
@@ -405,9 +683,7 @@ void initScene(void) {
         SCENE_OBJECTS->push_back(tetra1T1);
     } 
         Triangle *tetra1T2 = new Triangle; {
-        tetra1T2->vertex0 = tetra1Vertex0;        
-        tetra1T2->vertex1 = tetra1Vertex1; 
-        tetra1T2->vertex2 = tetra1Vertex3;
+        tetra1T2->setVertices(tetra1Vertex0, tetra1Vertex1, tetra1Vertex3);
 
         tetra1T2->material.color.r = 0.5;
         tetra1T2->material.color.g = 1.0;
@@ -421,9 +697,7 @@ void initScene(void) {
         SCENE_OBJECTS->push_back(tetra1T2);
     } 
         Triangle *tetra1T3 = new Triangle; {
-        tetra1T3->vertex0 = tetra1Vertex0;        
-        tetra1T3->vertex1 = tetra1Vertex2; 
-        tetra1T3->vertex2 = tetra1Vertex3;
+        tetra1T3->setVertices(tetra1Vertex0, tetra1Vertex2, tetra1Vertex3);
 
         tetra1T3->material.color.r = 0.5;
         tetra1T3->material.color.g = 1.0;
@@ -437,9 +711,7 @@ void initScene(void) {
         SCENE_OBJECTS->push_back(tetra1T3);
     } 
         Triangle *tetra1T4 = new Triangle; {
-        tetra1T4->vertex0 = tetra1Vertex1;        
-        tetra1T4->vertex1 = tetra1Vertex2; 
-        tetra1T4->vertex2 = tetra1Vertex3;
+        tetra1T4->setVertices(tetra1Vertex1, tetra1Vertex2, tetra1Vertex3);
 
         tetra1T4->material.color.r = 0.5;
         tetra1T4->material.color.g = 1.0;
@@ -461,82 +733,114 @@ void initScene(void) {
 
 
 
-void drawScene (void) {
+/* Builds the acceleration structure named by ACCELERATOR_NAME over SCENE_OBJECTS into SCENE_ACCELERATOR.
+   Must be called again whenever SCENE_OBJECTS changes. */
+void buildAccelerator(void) {
 
-    GLfloat imageWidth;
+    delete SCENE_ACCELERATOR;
+
+    const char *name = ACCELERATOR_NAME;
+    if (strcmp(name, "auto") == 0) {
+        name = chooseAccelerator(*SCENE_OBJECTS);
+    }
+
+    SCENE_ACCELERATOR = createAccelerator(name);
+
+    if (SCENE_ACCELERATOR != NULL) {
+        double startTime = getTime();
+        SCENE_ACCELERATOR->build(*SCENE_OBJECTS);
 
+        /* Build time is reported on its own so it can be weighed against render time. */
+        printf("Built %s over %u objects in %.3f ms\n", name, (unsigned int)SCENE_OBJECTS->size(), 1000.0*(getTime() - startTime));
+    }
+    else {
+        SCENE_PRIMITIVES.compile(*SCENE_OBJECTS);
+    }
+}
 
-    /* The current pixel to draw in world coordinates. */
-    Vector currentPixelWorldCoord (0, 0, -P_NEAR, 1.0);
 
-    /* A ray will be shot through the current pixel in this direction. */
-    Vector rayDirection;
 
-    /* Color of the pixel to draw. */
-    Color currentPixelColor;
+void drawScene (void) {
+
+    GLfloat imageWidth;
 
+    double startTime = getTime();
 
     /* FOV_X is the x angle of the view frustrum. */
     imageWidth = 2*P_NEAR*tan(FOV_X/2);
 
-    /* Trace a ray for every pixel in the canvas. */
-    for (int i = 0; i < CANVAS_WIDTH; i++) {
+    /* Trace the rays a wave at a time, stage by stage, if asked to. */
+    if (RENDER_WAVEFRONT) {
+        drawSceneWavefront(imageWidth);
+        printf("Rendered %dx%d pixels in %.3f ms\n", CANVAS_WIDTH, CANVAS_HEIGHT, 1000.0*(getTime() - startTime));
+        return;
+    }
 
-        for (int j = 0; j < CANVAS_HEIGHT; j++) {
+    /* Trace a ray for every pixel in the canvas, a tile at a time on every core, and neighboring primary rays
+       together if asked to and the acceleration structure can. */
+    drawSceneTiles(imageWidth);
 
-            /* Find position of the current pixel in world coordinates. */
-            
-            /* (i-(CANVAS_WIDTH/2)) creates an x-axis from -(CANVAS_WIDTH/2) to (CANVAS_WIDTH/2). 
-               imageWidth/CANVAS_WIDTH gives the ratio to convert to world coordinates. */
-            currentPixelWorldCoord[0] = (i-(CANVAS_WIDTH/2))*imageWidth/CANVAS_WIDTH;
+    printf("Rendered %dx%d pixels in %.3f ms\n", CANVAS_WIDTH, CANVAS_HEIGHT, 1000.0*(getTime() - startTime));
+}
 
-             /* (j-(CANVAS_HEIGHT/2)) creates an y-axis from -(CANVAS_HEIGHT/2) to (CANVAS_HEIGHT/2). 
-                imageWidth/CANVAS_WIDTH gives the ratio to convert to world coordinates. */
-            currentPixelWorldCoord[1] = (j-(CANVAS_HEIGHT/2))*imageWidth/CANVAS_WIDTH;
-            
 
-            /* rayDirection should the vector starting at the camera that passes directly through 
-               the current pixel to draw. */
-            rayDirection = (currentPixelWorldCoord - CAMERA_LOCATION).normalize();
 
-            
-            /* Trace the ray back from the pixel location and get the color to draw it as. */
-            currentPixelColor = traceRay(currentPixelWorldCoord, rayDirection, 0);
+/* Places into RETURN_PIXEL_WORLD_COORD the position in world coordinates of the pixel at column I and row J of the
+   canvas, and into RETURN_RAY_DIRECTION the unit vector from the camera through it. IMAGE_WIDTH is the width of the
+   image plane in world coordinates. */
+void getPrimaryRay(int i, int j, GLfloat imageWidth, Point3 &returnPixelWorldCoord, Direction3 &returnRayDirection) {
+    getSampleRay(i, j, 0.0f, 0.0f, imageWidth, returnPixelWorldCoord, returnRayDirection);
+}
 
-            /* Write the pixel back to the screen. */
-            drawPixel(i, j, currentPixelColor.r, currentPixelColor.g, currentPixelColor.b);
-        }
-    }
+
+
+/* Places into RETURN_PIXEL_WORLD_COORD the position in world coordinates of the point OFFSET_X pixels to the right of
+   and OFFSET_Y pixels above the pixel at column I and row J of the canvas, and into RETURN_RAY_DIRECTION the unit vector
+   from the camera through it. IMAGE_WIDTH is the width of the image plane in world coordinates. */
+void getSampleRay(int i, int j, GLfloat offsetX, GLfloat offsetY, GLfloat imageWidth, Point3 &returnPixelWorldCoord, Direction3 &returnRayDirection) {
+
+    returnPixelWorldCoord = Point3(0, 0, -P_NEAR);
+
+    /* Find position of the current pixel in world coordinates. */
+
+    /* (i-(CANVAS_WIDTH/2)) creates an x-axis from -(CANVAS_WIDTH/2) to (CANVAS_WIDTH/2).
+       imageWidth/CANVAS_WIDTH gives the ratio to convert to world coordinates. */
+    returnPixelWorldCoord[0] = ((i-(CANVAS_WIDTH/2)) + offsetX)*imageWidth/CANVAS_WIDTH;
+
+     /* (j-(CANVAS_HEIGHT/2)) creates an y-axis from -(CANVAS_HEIGHT/2) to (CANVAS_HEIGHT/2).
+        imageWidth/CANVAS_WIDTH gives the ratio to convert to world coordinates. */
+    returnPixelWorldCoord[1] = ((j-(CANVAS_HEIGHT/2)) + offsetY)*imageWidth/CANVAS_WIDTH;
+
+
+    /* rayDirection should the vector starting at the camera that passes directly through
+       the current pixel to draw. */
+    returnRayDirection = (returnPixelWorldCoord - CAMERA_LOCATION).normalize();
 }
 
 
 
 /* Takes a point and a direction that define a ray, then traces the ray for DEPTH 
    times to determine the color for the ray's start point. Returns the color. */
-Color traceRay(const Vector &rayStartPoint, const Vector &rayDirection, int depth) {
+Color traceRay(const Point3 &rayStartPoint, const Direction3 &rayDirection, int depth) {
 
     if (depth > MAX_TRACING_DEPTH) {
         /* Return background color. */
         return BG_COLOR;
     }
 
-    Color localColor = {0.0, 0.0, 0.0, 1.0};
-    Color reflectedColor = {0.0, 0.0, 0.0, 1.0};
-    Color transmittedColor = {0.0, 0.0, 0.0, 1.0};
-    Color finalColor = {0.0, 0.0, 0.0, 1.0};
-
-    Vector intersectionPoint (0.0, 0.0, 0.0, 1.0);
-    Vector intersectionPointNormal;
+    /* Where the ray hits. */
+    HitRecord hit;
 
-    SceneObject intersectionObject;
+    /* The object the ray hits. Only a pointer is kept, so the object is neither copied nor sliced down to a SceneObject. */
+    const SceneObject *intersectionObject = NULL;
 
     /* Takes a point and a direction from that point to form a ray, and a depth of raytracing recursion.
        This function will attempt to find the first object that intersects with the ray.
        Upon success, the function will return true, the first object that intersects with the ray will 
-       be placed into INTERSECTION_OBJECT, and the point of intersection will be placed in INTERSECTION_POINT. 
+       be placed into INTERSECTION_OBJECT, and the intersection will be placed in HIT. 
        Upon failure, false will simply be returned. */
     //bool intersection = findFirstIntersection(rayStartPoint, rayDirection, depth, intersectionPoint, intersectionObject);
-    bool intersection = findFirstIntersection(rayStartPoint, rayDirection, intersectionPoint, intersectionObject);
+    bool intersection = findFirstIntersection(rayStartPoint, rayDirection, hit, intersectionObject);
 
 
     /* If there was no intersection, then return the background color. */
@@ -545,34 +849,109 @@ Color traceRay(const Vector &rayStartPoint, const Vector &rayDirection, int dept
         return BG_COLOR;
     }
 
+    return shadeIntersection(rayStartPoint, rayDirection, hit, *intersectionObject, depth);
+}
+
+
+
+/* Takes a point and a direction that define a ray, which first hits OBJECT as described by HIT after DEPTH bounces,
+   and returns the color seen along the ray, tracing further rays for reflection and refraction. */
+Color shadeIntersection(const Point3 &rayStartPoint, const Direction3 &rayDirection, const HitRecord &hit, const SceneObject &object, int depth) {
+
+    Color localColor = {0.0, 0.0, 0.0, 1.0};
+    Color reflectedColor = {0.0, 0.0, 0.0, 1.0};
+    Color transmittedColor = {0.0, 0.0, 0.0, 1.0};
+    Color finalColor = {0.0, 0.0, 0.0, 1.0};
+
+    const SceneObject *intersectionObject = &object;
+
     /* If the ray intersected with the light, then return the light color, minus any attenuation. */
-    if (isLight(intersectionObject)) {
-        return intersectionObject.material.color;
+    if (isLight(*intersectionObject)) {
+        return intersectionObject->material.color;
     }
 
 
     /* Get base color for the point. */
-    localColor = getPhong(rayStartPoint, rayDirection, intersectionPoint, intersectionObject);
+    localColor = getPhong(rayStartPoint, rayDirection, hit, *intersectionObject);
     
     /* Get the color of any reflections on the point. */
-    Vector cameraToIntersectionPointUnitVector = (CAMERA_LOCATION - intersectionPoint).normalize();
-    Vector intersectionObjectUnitNormal = intersectionObject.getNormal(intersectionPoint).normalize();
-    Vector reflectionUnitVector = 2*cameraToIntersectionPointUnitVector.dotProduct(intersectionObjectUnitNormal)*intersectionObjectUnitNormal - cameraToIntersectionPointUnitVector;
+    Direction3 reflectionUnitVector = getReflectionDirection(hit, *intersectionObject);
 
-    reflectedColor = traceRay(intersectionPoint + 0.001*reflectionUnitVector, reflectionUnitVector, depth+1);
+    reflectedColor = traceRay(offsetRayStart(hit, *intersectionObject, reflectionUnitVector), reflectionUnitVector, depth+1);
 
     /* If the point is translucent, shoot a refraction/translucency ray to find the color behind the point. */
-    if (intersectionObject.material.color.a < 1.0)  {
-        transmittedColor = traceRay(intersectionPoint + 0.001*rayDirection, rayDirection, depth+1);
+    if (intersectionObject->material.color.a < 1.0)  {
+        transmittedColor = traceRay(offsetRayStart(hit, *intersectionObject, rayDirection), rayDirection, depth+1);
+    }
+
+
+    finalColor = combineColors(*intersectionObject, localColor, reflectedColor, transmittedColor);
+
+    return finalColor;
+}
+
+
+
+/* Returns the point a ray along DIRECTION leaving OBJECT at the point HIT describes should start from, so that it
+   doesn't hit the surface it leaves. In double precision, the point is moved a fixed 0.001 along DIRECTION, as it
+   always has been. A fixed distance is either too small to clear the rounding error of a point far from the origin or
+   large enough to skip thin geometry, which single precision makes much worse, so there the point is instead moved
+   off the surface along its normal by a number of units in the last place of each coordinate, or by a small fixed
+   distance for coordinates so close to zero that a few units in the last place would be nothing. */
+Point3 offsetRayStart(const HitRecord &hit, const SceneObject &object, const Direction3 &direction) {
+#ifdef SINGLE_PRECISION
+    Direction3 unitNormal = object.getNormal(hit).normalize();
+
+    /* Move toward the side of the surface the ray leaves through. */
+    if (unitNormal.dotProduct(direction) < 0.0) {
+        unitNormal *= -1.0;
     }
 
+    Point3 start = hit.point;
+    for (int axis = 0; axis < 3; axis++) {
+        float coordinate = hit.point.getEntry(axis);
+        float normal = unitNormal.getEntry(axis);
 
-    finalColor = intersectionObject.material.color.a*localColor + intersectionObject.material.specular*reflectedColor + (1-intersectionObject.material.color.a)*transmittedColor;
+        if (fabs(coordinate) < RAY_OFFSET_ORIGIN) {
+            start.setEntry(axis, coordinate + RAY_OFFSET_FLOAT_SCALE*normal);
+        }
+        else {
+            int offset = (int)(RAY_OFFSET_INT_SCALE*normal);
+            int bits;
+            memcpy(&bits, &coordinate, sizeof(bits));
+            bits += (coordinate < 0.0f) ? -offset : offset;
+            memcpy(&coordinate, &bits, sizeof(bits));
+            start.setEntry(axis, coordinate);
+        }
+    }
+
+    return start;
+#else
+    (void)object;
+    return hit.point + 0.001*direction;
+#endif
+}
+
+
+
+/* Returns the unit vector along which the camera sees the reflection in OBJECT at the point HIT describes. */
+Direction3 getReflectionDirection(const HitRecord &hit, const SceneObject &object) {
+    Direction3 cameraToIntersectionPointUnitVector = (CAMERA_LOCATION - hit.point).normalize();
+    Direction3 intersectionObjectUnitNormal = object.getNormal(hit).normalize();
+
+    return 2*cameraToIntersectionPointUnitVector.dotProduct(intersectionObjectUnitNormal)*intersectionObjectUnitNormal - cameraToIntersectionPointUnitVector;
+}
+
+
+
+/* Returns the color of a point on OBJECT whose own Phong shading is LOCAL_COLOR, which reflects REFLECTED_COLOR and
+   lets TRANSMITTED_COLOR through in proportion to its material. */
+Color combineColors(const SceneObject &object, const Color &localColor, const Color &reflectedColor, const Color &transmittedColor) {
+    Color finalColor = object.material.color.a*localColor + object.material.specular*reflectedColor + (1-object.material.color.a)*transmittedColor;
 
     /* Clamp the final color's values to be between 0.0 and 1.0 to prevent color distortion. */
     clamp(finalColor, 0.0, 1.0);
 
-
     return finalColor;
 }
 
@@ -582,78 +961,51 @@ Color traceRay(const Vector &rayStartPoint, const Vector &rayDirection, int dept
    This function will attempt to find the first object that intersects with the ray and return 
    a boolean indicating success/failure.
 
-   Upon success, the function will return true, the point of intersection will be placed in INTERSECTION_POINT,
-   and the intersecting object will be placed into INTERSECTION_OBJECT.
+   Upon success, the function will return true, the intersection will be placed in RETURN_HIT,
+   and a pointer to the intersecting object will be placed into INTERSECTION_OBJECT.
 
    Upon failure, false will simply be returned. 
 */
-bool findFirstIntersection(const Vector &rayStartPoint, const Vector &rayDirection, Vector &intersectionPoint, SceneObject &intersectionObject) {
-
-    /* List of pointers to all objects that intersect with the current ray. 
-       *** NOTE: *** intersectionPoints[i] corresponds to intersections[i]. */
-    vector <SceneObject *> intersections;
-
-    /* List of intersection points for the corresponding ray-intersecting objects in intersectionPoints. */
-    vector <Vector> intersectionPoints;
-
-    /* currentObjectPointer points to the current object we're testing intersection for in SCENE_OBJECTS. */
-    SceneObject *currentObjectPointer;
-
-
-    bool currentObjectIntersects;
-    Vector currentObjectIntersectionPoint (0.0, 0.0, 0.0, 1.0);
+bool findFirstIntersection(const Point3 &rayStartPoint, const Direction3 &rayDirection, HitRecord &returnHit, const SceneObject *&intersectionObject) {
 
-    /* Find all objects that intersect with ray. */
-    for (unsigned int i = 0; i < SCENE_OBJECTS->size(); i++) {
+    /* Let the acceleration structure find the closest object if there is one. It picks the same object as the
+       search over every object below. */
+    if (SCENE_ACCELERATOR != NULL) {
+        unsigned int closestIndex;
 
-        currentObjectPointer = (*SCENE_OBJECTS)[i];
-        currentObjectIntersects = currentObjectPointer->checkIntersection(rayStartPoint, rayDirection, currentObjectIntersectionPoint);
-        
-        if (currentObjectIntersects) {
-            intersections.push_back((*SCENE_OBJECTS)[i]);
-            intersectionPoints.push_back(currentObjectIntersectionPoint);
+        if (!SCENE_ACCELERATOR->findFirstIntersection(rayStartPoint, rayDirection, returnHit, closestIndex)) {
+            return false;
         }
+
+        intersectionObject = (*SCENE_OBJECTS)[closestIndex];
+        return true;
     }
 
+    /* Otherwise test every object. Of two intersections at the same distance along the ray, the first object wins. */
+    unsigned int closestIndex;
 
-    /* If no intersections were found, returns with failure. */
-    if (intersections.empty()) {
+    if (!SCENE_PRIMITIVES.findFirstIntersection(rayStartPoint, rayDirection, returnHit, closestIndex)) {
         return false;
-
     }
 
+    intersectionObject = (*SCENE_OBJECTS)[closestIndex];
+    return true;
+}
 
-    /* Go through all of the intersection points and find the one closest to the ray's start point. 
-       That intersection point is what will be returned. */
 
-    /* We save the index of the closest point and the closest point's distance. */
-    unsigned int closestSceneObject = 0;
-    unsigned int closestSceneObjectPoint = 0;
 
-    /* Closest distance found so far. */
-    double closestDistance = rayStartPoint.distance(intersectionPoints[0]);
 
-    /* Distance of the current iteration. */
-    double currentDistance;
 
-    /* Find the object closest to the starting point of the ray. */
-    for (unsigned int i = 0; i < intersections.size(); i++) {
+/* Takes a point and a direction from that point to form a ray, and returns true if the ray intersects any object
+   other than a light less than MAX_DISTANCE from the point. Stops at the first such object, since a shadow ray
+   only needs to know whether something blocks the light. */
+bool isOccluded(const Point3 &rayStartPoint, const Direction3 &rayDirection, double maxDistance) {
 
-        /* If we find a closer distance, store the information. */
-        if ((currentDistance = rayStartPoint.distance(intersectionPoints[i])) < closestDistance) {
-            closestDistance = currentDistance;
-            closestSceneObject = i;
-            closestSceneObjectPoint = i;
-        }
+    if (SCENE_ACCELERATOR != NULL) {
+        return SCENE_ACCELERATOR->isOccluded(rayStartPoint, rayDirection, maxDistance);
     }
 
-
-    /* Put the closest point and closest object into variables that will be returned to caller function. */
-    intersectionPoint = intersectionPoints[closestSceneObjectPoint];
-    intersectionObject = *intersections[closestSceneObject];
-
-
-    return true;
+    return SCENE_PRIMITIVES.isOccluded(rayStartPoint, rayDirection, maxDistance / rayDirection.magnitude());
 }
 
 
@@ -661,42 +1013,28 @@ bool findFirstIntersection(const Vector &rayStartPoint, const Vector &rayDirecti
 
 
 /* Takes a point and a direction from that point to form a ray.
-   This function will find the color of this ray at INTERSECTION_POINT on INTERSECTION_OBJECT using the phong reflection model.
+   This function will find the color of this ray where it hits INTERSECTION_OBJECT, as described by HIT, using the phong reflection model.
 */
-Color getPhong(const Vector &rayStartPoint, const Vector &rayDirection, const Vector &intersectionPoint, const SceneObject &intersectionObject) {
-
-    /* Coefficients for each component of Phong shading. Used to calculate the actual color of each Phong component. */
-    double diffuseCoefficient = 0;
-    double specularCoefficient = 0;
+Color getPhong(const Point3 &rayStartPoint, const Direction3 &rayDirection, const HitRecord &hit, const SceneObject &intersectionObject) {
 
-    Color diffuseColor;
-    Color specularColor;
+    const Point3 &intersectionPoint = hit.point;
 
     Color phong = {0.0, 0.0, 0.0, 1.0};
 
     
 
-    /* Unit vector orthagonal to the point where the ray intersects the object. */
-    Vector intersectionPointUnitNormal;
-
-    /* Unit vector from the intersection point to the current light source. */
-    Vector directionToLightUnitVector;
-
-    /* Unit vector representing the reflected ray from the intersection point. */
-    Vector reflectionUnitVector;
+    /* Unit vector orthagonal to the point where the ray intersects the object. The same for every light. */
+    Direction3 intersectionPointUnitNormal = intersectionObject.getNormal(hit).normalize();
 
     /* Unit vector in the direction of the ray. */
-    Vector rayDirectionUnitVector = rayDirection;
+    Direction3 rayDirectionUnitVector = rayDirection;
     rayDirectionUnitVector.normalize();
 
     /* Unit vector pointing to the camera. */
-    Vector cameraDirectionUnitVector = (CAMERA_LOCATION - intersectionPoint).normalize();
-
-    /* cos(angle between incoming light and direction to camera). Used for specular highlights. */
-    double angleBetweenCameraAndLight = 0.0;
+    Direction3 cameraDirectionUnitVector = (CAMERA_LOCATION - intersectionPoint).normalize();
 
-    /* Pointer to the current light that we are inspecting. */
-    PointLight *currentLightPointer;
+    /* The light the current light source sheds on the point, and the shadow ray towards it. */
+    LightSample sample;
 
 
 
@@ -704,47 +1042,69 @@ Color getPhong(const Vector &rayStartPoint, const Vector &rayDirection, const Ve
        Add together all these shadings for a final intersection point color. */
     for (unsigned int i = 0; i < SCENE_LIGHTS->size(); i++) {
 
-        currentLightPointer = (*SCENE_LIGHTS)[i];
+        sampleLight(*(*SCENE_LIGHTS)[i], hit, intersectionObject, intersectionPointUnitNormal, cameraDirectionUnitVector, sample);
 
-        intersectionPointUnitNormal = intersectionObject.getNormal(intersectionPoint).normalize();  
-        directionToLightUnitVector = (currentLightPointer->position - intersectionPoint).normalize();
-        reflectionUnitVector = (2*(directionToLightUnitVector.dotProduct(intersectionPointUnitNormal)*intersectionPointUnitNormal) - directionToLightUnitVector).normalize();
-        
+        /* The point is in shadow if anything lies between it and the light. */
+        if (isOccluded(sample.shadowRayStartPoint, sample.shadowRayDirection, sample.shadowRayLength)) {
+            shadowLight(*(*SCENE_LIGHTS)[i], intersectionPoint, sample);
+        }
+
+
+        /* Intersection point color composed of the phong shading from every light inspected so far. */
+        phong += sample.diffuseColor + sample.specularColor;
 
-        angleBetweenCameraAndLight = reflectionUnitVector.dotProduct(cameraDirectionUnitVector);
-        /* If the angle is negative, that means the reflected specular ray is facing away from camera and no specular highlight should occur. */
-        angleBetweenCameraAndLight = max(angleBetweenCameraAndLight, 0.0);
+    }
 
+    /* Assembled phong shading for the pixel. */
+    phong += AMBIENT_COLOR * intersectionObject.material.ambient;
 
-        /* Diffuse shading at intersection point. */
-        diffuseCoefficient = max(0.0, directionToLightUnitVector.dotProduct(intersectionPointUnitNormal));
-        diffuseColor = (diffuseCoefficient * intersectionObject.material.diffuse) * (currentLightPointer->getColor(intersectionPoint) + intersectionObject.getColor(intersectionPoint));
+    return phong;
+}
 
-        /* Specular shading at intersection point. */
-        specularCoefficient = pow(angleBetweenCameraAndLight, intersectionObject.material.shininess);
-        specularColor = (specularCoefficient * intersectionObject.material.specular) * (currentLightPointer->getColor(intersectionPoint) + intersectionObject.getColor(intersectionPoint));
 
 
-        /* Compute the shadow amount at intersection point. */
-        Vector shadowRayIntersectionPoint;
-        SceneObject shadowRayIntersectionObject;
+/* Works out the diffuse and specular light LIGHT sheds on INTERSECTION_OBJECT at the point HIT describes, whose unit
+   normal is UNIT_NORMAL and from which the camera lies along CAMERA_DIRECTION_UNIT_VECTOR, as if nothing blocked it,
+   along with the shadow ray from the point towards the light. Places them into RETURN_SAMPLE. */
+void sampleLight(const PointLight &light, const HitRecord &hit, const SceneObject &intersectionObject, const Direction3 &unitNormal,
+                 const Direction3 &cameraDirectionUnitVector, LightSample &returnSample) {
 
-        findFirstIntersection(intersectionPoint + 0.001*directionToLightUnitVector, directionToLightUnitVector, shadowRayIntersectionPoint, shadowRayIntersectionObject);
-        if (shadowRayIntersectionPoint != currentLightPointer->position) {
-            diffuseColor *= 0.25 * currentLightPointer->getIntensity(intersectionPoint);
-            specularColor *= currentLightPointer->getIntensity(intersectionPoint);
-        }
+    const Point3 &intersectionPoint = hit.point;
 
+    /* Unit vector from the intersection point to the light source. */
+    Direction3 directionToLightUnitVector = (light.position - intersectionPoint).normalize();
 
-        /* Intersection point color composed of the phong shading from every light inspected so far. */
-        phong += diffuseColor + specularColor;
+    /* Unit vector representing the reflected ray from the intersection point. */
+    Direction3 reflectionUnitVector = (2*(directionToLightUnitVector.dotProduct(unitNormal)*unitNormal) - directionToLightUnitVector).normalize();
 
-    }
 
-    /* Assembled phong shading for the pixel. */
-    phong += AMBIENT_COLOR * intersectionObject.material.ambient;
+    /* cos(angle between incoming light and direction to camera). Used for specular highlights. */
+    double angleBetweenCameraAndLight = reflectionUnitVector.dotProduct(cameraDirectionUnitVector);
+    /* If the angle is negative, that means the reflected specular ray is facing away from camera and no specular highlight should occur. */
+    angleBetweenCameraAndLight = max(angleBetweenCameraAndLight, 0.0);
 
-    return phong;
+
+    /* Diffuse shading at intersection point. */
+    double diffuseCoefficient = max(0.0, directionToLightUnitVector.dotProduct(unitNormal));
+    returnSample.diffuseColor = (diffuseCoefficient * intersectionObject.material.diffuse) * (light.getColor(intersectionPoint) + intersectionObject.getColor(intersectionPoint));
+
+    /* Specular shading at intersection point. */
+    double specularCoefficient = pow(angleBetweenCameraAndLight, intersectionObject.material.shininess);
+    returnSample.specularColor = (specularCoefficient * intersectionObject.material.specular) * (light.getColor(intersectionPoint) + intersectionObject.getColor(intersectionPoint));
+
+
+    /* The shadow ray starts just off the surface so that it doesn't hit the point itself. */
+    returnSample.shadowRayStartPoint = offsetRayStart(hit, intersectionObject, directionToLightUnitVector);
+    returnSample.shadowRayDirection = directionToLightUnitVector;
+    returnSample.shadowRayLength = returnSample.shadowRayStartPoint.distance(light.position);
+}
+
+
+
+/* Dims the light in SAMPLE, which LIGHT sheds on INTERSECTION_POINT, for a point its shadow ray found in shadow. */
+void shadowLight(const PointLight &light, const Point3 &intersectionPoint, LightSample &sample) {
+    sample.diffuseColor *= 0.25 * light.getIntensity(intersectionPoint);
+    sample.specularColor *= light.getIntensity(intersectionPoint);
 }
 
 
@@ -4,10 +4,11 @@
 
 
 #include <vector> /* STL vector. */
-#include "vector.h" /* My own implementation of a 4x1 vector. */
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
 #include "color.h"
 #include "sceneobject.h"
 #include "light.h"
+#include "accelerator.h"
 
   
 
@@ -24,7 +25,7 @@ extern int CANVAS_HEIGHT;
 
 /* The center point where the camera is located. This is where the camera
    sits in relation to the scene. */
-extern Vector CAMERA_LOCATION;
+extern Point3 CAMERA_LOCATION;
 
 /* Viewing parameters: */
 extern GLfloat P_NEAR;  /* Distance from viewpoint to image plane. */
@@ -36,6 +37,41 @@ extern vector <SceneObject *> *SCENE_OBJECTS;
 /* Pointer to a STL vector containing all the lights of the scene. */
 extern vector <PointLight *> *SCENE_LIGHTS;
 
+/* Acceleration structure over SCENE_OBJECTS used to find ray intersections. If NULL, every ray is
+   tested against every object in SCENE_OBJECTS. */
+extern Accelerator *SCENE_ACCELERATOR;
+
+/* SCENE_OBJECTS compiled into pools by type, which rays are tested against when SCENE_ACCELERATOR is NULL. */
+extern CompiledScene SCENE_PRIMITIVES;
+
+/* Name of the kind of acceleration structure to build over the scene, such as "bvh" or "none", or "auto" to
+   pick one from the scene with chooseAccelerator(). */
+extern const char *ACCELERATOR_NAME;
+
+/* If not NULL, the scene is rendered into this image file instead of an OpenGL window. */
+extern const char *OUTPUT_FILENAME;
+
+/* Number of extra copies of objects an "sbvh" may make by splitting them, as a fraction of the number of objects. */
+extern double SPLIT_BUDGET;
+
+/* If greater than 1, primary rays are traced together through the acceleration structure in blocks of PACKET_SIZE by
+   PACKET_SIZE pixels. */
+extern int PACKET_SIZE;
+
+/* Number of rays traced through each pixel, at random points within it drawn from the random streams of random.h, and
+   averaged. With 1, the ray goes through the pixel's corner as it always has. */
+extern int SAMPLE_COUNT;
+
+/* Picks the random streams the sample points of every pixel are drawn from. The same seed always gives the same image. */
+extern unsigned long long SAMPLE_SEED;
+
+/* If true, the scene is drawn by the wavefront renderer, drawSceneWavefront(), rather than one ray at a time. */
+extern bool RENDER_WAVEFRONT;
+
+/* If true, the wavefront renderer sorts each queue of secondary rays and shadow rays by where they start and which way
+   they point before tracing them. */
+extern bool SORT_SECONDARY_RAYS;
+
 /* Color of the background. */
 extern Color BG_COLOR;
 
@@ -45,8 +81,16 @@ extern Color AMBIENT_COLOR;
 /* Rays will be shot until reaching this depth. */
 extern int MAX_TRACING_DEPTH;
 
-/* The refraction index of the material the current ray is coming from. */
-extern double INCOMING_REFRACTION_INDEX;
+/* The light a PointLight sheds on a point, as getPhong() works it out before looking for shadows, and the shadow ray
+   from the point towards the light that decides whether something blocks it. */
+struct LightSample {
+  Color diffuseColor;
+  Color specularColor;
+
+  Point3 shadowRayStartPoint;
+  Direction3 shadowRayDirection;
+  double shadowRayLength;
+};
 
 /* 
   ----------------------
@@ -58,40 +102,94 @@ extern double INCOMING_REFRACTION_INDEX;
 void initScene(void);
 
 
+/* Builds the acceleration structure named by ACCELERATOR_NAME over SCENE_OBJECTS into SCENE_ACCELERATOR.
+   Must be called again whenever SCENE_OBJECTS changes. */
+void buildAccelerator(void);
+
+
 /* Main function that will draw the raytraced scene when called. */
 void drawScene(void);
 
 
-/* Takes a point in Vector form and a direction from the point in Vector form, then
+/* Takes a point and a direction from the point, then
    traces a ray for DEPTH times to sample the color for the point. Returns the color. */
-Color traceRay(const Vector &rayStartPoint, const Vector &rayDirection, int depth);
+Color traceRay(const Point3 &rayStartPoint, const Direction3 &rayDirection, int depth);
+
+
+/* Takes a point and a direction that define a ray, which first hits OBJECT as described by HIT after DEPTH bounces,
+   and returns the color seen along the ray, tracing further rays for reflection and refraction. traceRay() calls this
+   once it has found what its ray hits. */
+Color shadeIntersection(const Point3 &rayStartPoint, const Direction3 &rayDirection, const HitRecord &hit, const SceneObject &object, int depth);
 
 
 /* Takes a point and a direction from that point to form a ray.
    This function will attempt to find the first object that intersects with the ray and return 
    a boolean indicating success/failure.
 
-   Upon success, the function will return true, the point of intersection will be placed in INTERSECTION_POINT,
-   and the intersecting object will be placed into INTERSECTION_OBJECT.
+   Upon success, the function will return true, the intersection will be placed in RETURN_HIT,
+   and a pointer to the intersecting object will be placed into INTERSECTION_OBJECT.
 
    Upon failure, false will simply be returned. 
 */
-bool findFirstIntersection(const Vector &rayStartPoint, const Vector &rayDirection, Vector &intersectionPoint, SceneObject &intersectionObject);
+bool findFirstIntersection(const Point3 &rayStartPoint, const Direction3 &rayDirection, HitRecord &returnHit, const SceneObject *&intersectionObject);
+
 
+/* Takes a point and a direction from that point to form a ray, and returns true if the ray intersects any object
+   other than a light less than MAX_DISTANCE from the point. Stops at the first such object, since a shadow ray
+   only needs to know whether something blocks the light. */
+bool isOccluded(const Point3 &rayStartPoint, const Direction3 &rayDirection, double maxDistance);
 
-/* Takes a point in Vector form and a direction from the point in Vector form, then
+
+/* Takes a point and a direction from the point, then
    traces a ray for DEPTH times to sample the color for the point. Returns the color. */
-Color traceRay(const Vector &rayStartPoint, const Vector &rayDirection, int depth);
+Color traceRay(const Point3 &rayStartPoint, const Direction3 &rayDirection, int depth);
 
 
 /* Takes a point and a direction from that point to form a ray.
-   This function will find the color of this ray at INTERSECTION_POINT on INTERSECTION_OBJECT using the phong reflection model.
+   This function will find the color of this ray where it hits INTERSECTION_OBJECT, as described by HIT, using the phong reflection model.
 */
-Color getPhong(const Vector &rayStartPoint, const Vector &rayDirection, const Vector &intersectionPoint, const SceneObject &intersectionObject);
+Color getPhong(const Point3 &rayStartPoint, const Direction3 &rayDirection, const HitRecord &hit, const SceneObject &intersectionObject);
+
+
+/* Works out the diffuse and specular light LIGHT sheds on INTERSECTION_OBJECT at the point HIT describes, whose unit
+   normal is UNIT_NORMAL and from which the camera lies along CAMERA_DIRECTION_UNIT_VECTOR, as if nothing blocked it,
+   along with the shadow ray from the point towards the light. Places them into RETURN_SAMPLE. */
+void sampleLight(const PointLight &light, const HitRecord &hit, const SceneObject &intersectionObject, const Direction3 &unitNormal,
+                 const Direction3 &cameraDirectionUnitVector, LightSample &returnSample);
+
+
+/* Dims the light in SAMPLE, which LIGHT sheds on INTERSECTION_POINT, for a point its shadow ray found in shadow. */
+void shadowLight(const PointLight &light, const Point3 &intersectionPoint, LightSample &sample);
+
+
+/* Returns the point a ray along DIRECTION leaving OBJECT at the point HIT describes should start from, so that it
+   doesn't hit the surface it leaves. */
+Point3 offsetRayStart(const HitRecord &hit, const SceneObject &object, const Direction3 &direction);
+
+
+/* Returns the unit vector along which the camera sees the reflection in OBJECT at the point HIT describes. */
+Direction3 getReflectionDirection(const HitRecord &hit, const SceneObject &object);
+
+
+/* Returns the color of a point on OBJECT whose own Phong shading is LOCAL_COLOR, which reflects REFLECTED_COLOR and
+   lets TRANSMITTED_COLOR through in proportion to its material, clamped to [0.0, 1.0]. */
+Color combineColors(const SceneObject &object, const Color &localColor, const Color &reflectedColor, const Color &transmittedColor);
+
+
+/* Places into RETURN_PIXEL_WORLD_COORD the position in world coordinates of the pixel at column I and row J of the
+   canvas, and into RETURN_RAY_DIRECTION the unit vector from the camera through it. IMAGE_WIDTH is the width of the
+   image plane in world coordinates. */
+void getPrimaryRay(int i, int j, GLfloat imageWidth, Point3 &returnPixelWorldCoord, Direction3 &returnRayDirection);
+
+
+/* Places into RETURN_PIXEL_WORLD_COORD the position in world coordinates of the point OFFSET_X pixels to the right of
+   and OFFSET_Y pixels above the pixel at column I and row J of the canvas, and into RETURN_RAY_DIRECTION the unit vector
+   from the camera through it. IMAGE_WIDTH is the width of the image plane in world coordinates. */
+void getSampleRay(int i, int j, GLfloat offsetX, GLfloat offsetY, GLfloat imageWidth, Point3 &returnPixelWorldCoord, Direction3 &returnRayDirection);
 
 
 /* Takes a point and returns a value between 0.0 and 1.0 representing how occluded the point is based on the scene lighting. */
-double getShadowAmount(const Vector &point);
+double getShadowAmount(const Point3 &point);
 
 
 /* Returns true if the OBJECT is a light, false otherwise. */
@@ -0,0 +1,33 @@
+/* Contains the scalar type the math and geometry core is built on. */
+
+#ifndef SCALAR
+#define SCALAR
+
+	#include <cfloat>
+
+
+	/* The floating point type Vectors, Matrices, Colors and Materials hold, and that rays are intersected with: the
+	   HitRecords of SceneObjects, the pools of a CompiledScene and the SIMD kernels all work in it. Building with
+	   -DSINGLE_PRECISION, as the raytrace-float target of the Makefile does, makes it float, which halves the memory
+	   they take up and fits twice as many lanes into each SIMD register; otherwise it is double. Acceleration
+	   structures keep their boxes and build their trees in double precision, and convert rays as they need to. */
+	#ifdef SINGLE_PRECISION
+		typedef float Scalar;
+
+		/* Difference between 1 and the next Scalar after it. */
+		#define SCALAR_EPSILON FLT_EPSILON
+
+		/* Largest finite Scalar. */
+		#define SCALAR_MAX FLT_MAX
+	#else
+		typedef double Scalar;
+
+		/* Difference between 1 and the next Scalar after it. */
+		#define SCALAR_EPSILON DBL_EPSILON
+
+		/* Largest finite Scalar. */
+		#define SCALAR_MAX DBL_MAX
+	#endif
+
+
+#endif
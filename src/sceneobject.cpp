@@ -3,11 +3,12 @@
 #include <vector> /* STL vector. */
 #include <cstdio>
 #include <list>
+#include <algorithm>
 #include <cmath>
 #include "common.h"
 #include "sceneobject.h"
 #include "geometry.h"
-#include "vector.h" /* My own implementation of a 4x1 vector. */
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
 #include "color.h"
 #include "material.h"
 #include "misc.h"
@@ -31,37 +32,94 @@ SceneObject::SceneObject () {
     this->material.refraction = 1.0;
 }
 
+/* Destructor. Virtual so that objects can be deleted through a SceneObject pointer. */
+SceneObject::~SceneObject () {
+}
+
+
 /* Takes a point and a direction from that point, and calculates whether the ray starting from that point along
    its direction intersects this object. If it does, returns true and modifies RETURN_INTERSECTION_POINT with 
    the point of intersection. Otherwise, returns false. */
-bool SceneObject::checkIntersection(const Vector &point, const Vector &direction, Vector &returnIntersectionPoint) const {
+bool SceneObject::checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const {
 	return false;
 }
 
+/* Takes a point and a direction from that point, and calculates whether the ray starting from that point along
+   its direction intersects this object. If it does, returns true and fills in RETURN_HIT. Otherwise, returns
+   false. By default this calls checkIntersection() and works out T from the point. */
+bool SceneObject::intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const {
+	returnHit.point = Point3(0.0, 0.0, 0.0);
+
+	if (!checkIntersection(point, direction, returnHit.point)) {
+		return false;
+	}
+
+	returnHit.t = (returnHit.point - point).dotProduct(direction) / direction.dotProduct(direction);
+	returnHit.primitive = 0;
+	returnHit.u = 0.0;
+	returnHit.v = 0.0;
+
+	return true;
+}
+
 /* Returns a normal vector at POINT on the SceneObject. Assumes POINT does lay on the outside of the SceneObject. 
    Return vector may not be of unit length! */
-Vector SceneObject::getNormal(const Vector &point) const {
+Direction3 SceneObject::getNormal(const Point3 &point) const {
 	return (point-position);
 }
 
+/* Returns a normal vector where HIT, found by intersect(), lies on the SceneObject. By default this is the normal
+   at HIT's point; objects made of many primitives can use HIT's primitive instead of searching for it. */
+Direction3 SceneObject::getNormal(const HitRecord &hit) const {
+	return getNormal(hit.point);
+}
+
 /* Returns the color of the SceneObject at POINT. */
-Color SceneObject::getColor(const Vector &point) const {
+Color SceneObject::getColor(const Point3 &point) const {
 	return material.color;
 }
 
 
+/* If the SceneObject has finite extent, places a box enclosing it into RETURN_BOUNDS and returns true.
+   A generic SceneObject has no known extent, so it is treated as unbounded. */
+bool SceneObject::getBounds(BoundingBox &returnBounds) const {
+	return false;
+}
+
+
+/* Places a box enclosing the part of the SceneObject inside BOX into RETURN_BOUNDS, and returns true if there
+   is such a part. By default this is the overlap of BOX and the SceneObject's bounds, which objects may tighten.
+   Returns false for unbounded objects. */
+bool SceneObject::getClippedBounds(const BoundingBox &box, BoundingBox &returnBounds) const {
+	if (!getBounds(returnBounds)) {
+		return false;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		returnBounds.lower[i] = max(returnBounds.lower[i], box.lower[i]);
+		returnBounds.upper[i] = min(returnBounds.upper[i], box.upper[i]);
+
+		if (returnBounds.lower[i] > returnBounds.upper[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 /* Returns a reference to the x component of the SceneObject's position. */
-double& SceneObject::x (void) {
+Scalar& SceneObject::x (void) {
 	return position[0];
 } 
 
 /* Returns a reference to the y component of the SceneObject's position. */
-double& SceneObject::y (void) {
+Scalar& SceneObject::y (void) {
 	return position[1];
 } 
 
 /* Returns a reference to the z component of the SceneObject's position. */
-double& SceneObject::z (void) {
+Scalar& SceneObject::z (void) {
 	return position[2];
 }
 
@@ -6,18 +6,38 @@
 	#include <vector> /* STL vector. */
 	#include <list>
 	#include "common.h"
-	#include "vector.h" /* My own implementation of a 4x1 vector. */
+	#include "vec3.h" /* Header-only 3 component vector for points and directions. */
 	#include "material.h"
+	#include "boundingbox.h"
 
 	using namespace std;
 
 
+	/* Where a ray intersects a SceneObject, as found by SceneObject::intersect(). */
+	struct HitRecord {
+		/* Ray parameter of the intersection: the point is the ray's start point plus T times its direction. Hits are
+		   ordered by T, so the closest is found without taking any distances. */
+		Scalar t;
+
+		/* Point of intersection. */
+		Point3 point;
+
+		/* For objects made of many primitives, such as mesh instances, the index of the primitive intersected. 0 otherwise. */
+		unsigned int primitive;
+
+		/* Barycentric coordinates of the point on the triangle intersected: the weights of its second and third corners.
+		   0 for objects that aren't made of triangles. */
+		Scalar u;
+		Scalar v;
+	};
+
+
 	/* Abstract class for an object in the scene. This could include primitives, polyhedra, or even lights. */
 	class SceneObject {
 		
 		public:
 			/* Position of the object in the scene. */
-			Vector position;
+			Point3 position;
 
 			/* A SceneObject must have a material associated with it. */
 			Material material;
@@ -26,25 +46,47 @@
 			/* Default contructor. */
 			SceneObject ();
 
+			/* Destructor. Virtual so that objects can be deleted through a SceneObject pointer. */
+			virtual ~SceneObject ();
+
 			/* Takes a point and a direction from that point, and calculates whether the ray starting from that point along
 			   its direction intersects this object. If it does, returns true and modifies RETURN_INTERSECTION_POINT with 
 			   the point of intersection. Otherwise, returns false. */
-			virtual bool checkIntersection(const Vector &point, const Vector &direction, Vector &returnIntersectionPoint) const;
+			virtual bool checkIntersection(const Point3 &point, const Direction3 &direction, Point3 &returnIntersectionPoint) const;
+
+			/* Takes a point and a direction from that point, and calculates whether the ray starting from that point along
+			   its direction intersects this object. If it does, returns true and fills in RETURN_HIT. Otherwise, returns
+			   false. By default this calls checkIntersection() and works out T from the point. */
+			virtual bool intersect(const Point3 &point, const Direction3 &direction, HitRecord &returnHit) const;
 
 			/* Returns a normal vector at POINT on the SceneObject. Assumes POINT does lay on the outside of the SceneObject. */
-			virtual Vector getNormal(const Vector &point) const;
+			virtual Direction3 getNormal(const Point3 &point) const;
+
+			/* Returns a normal vector where HIT, found by intersect(), lies on the SceneObject. By default this is the normal
+			   at HIT's point; objects made of many primitives can use HIT's primitive instead of searching for it. */
+			virtual Direction3 getNormal(const HitRecord &hit) const;
 
 			/* Returns the color of the SceneObject at POINT. */
-			virtual Color getColor(const Vector &point) const;
+			virtual Color getColor(const Point3 &point) const;
+
+			/* If the SceneObject has finite extent, places a box enclosing it into RETURN_BOUNDS and returns true.
+			   Returns false for unbounded objects such as infinite planes, which acceleration structures keep aside
+			   and test against every ray. */
+			virtual bool getBounds(BoundingBox &returnBounds) const;
+
+			/* Places a box enclosing the part of the SceneObject inside BOX into RETURN_BOUNDS, and returns true if there
+			   is such a part. By default this is the overlap of BOX and the SceneObject's bounds, which objects may tighten.
+			   Returns false for unbounded objects. */
+			virtual bool getClippedBounds(const BoundingBox &box, BoundingBox &returnBounds) const;
 
 			/* Returns a reference to the x component of the SceneObject's position. */
-			double& x (void); 
+			Scalar& x (void); 
 
 			/* Returns a reference to the y component of the SceneObject's position. */
-			double& y (void); 
+			Scalar& y (void); 
 
 			/* Returns a reference to the z component of the SceneObject's position. */
-			double& z (void); 
+			Scalar& z (void); 
 
 			/* Returns true if SCENE_OBJECT is equivalent to THIS, false otherwise. */
 			virtual bool equals (const SceneObject &sceneObject) const;
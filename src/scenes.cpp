@@ -0,0 +1,293 @@
+/* Contains definitions for functions that generate large scenes, used to measure how the raytracer scales. */
+
+#include <vector> /* STL vector. */
+#include <cstdlib>
+#include <cmath>
+
+#include "scenes.h"
+#include "raytrace.h"
+#include "geometry.h"
+#include "mesh.h"
+#include "transform.h"
+#include "matrix.h"
+#include "light.h"
+#include "misc.h"
+#include "vector.h" /* My own implementation of a 4x1 vector. */
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+using namespace std;
+
+
+/* The generated objects are scattered through this box, which the camera sees nearly all of. */
+#define SCENE_MIN_X -6.0
+#define SCENE_MAX_X  6.0
+#define SCENE_MIN_Y -4.0
+#define SCENE_MAX_Y  4.0
+#define SCENE_MIN_Z -30.0
+#define SCENE_MAX_Z -12.0
+
+/* Number of bands and segments around the mesh copied by the instance scene, which has twice as many triangles. */
+#define INSTANCE_MESH_BANDS 50
+#define INSTANCE_MESH_SEGMENTS 100
+
+/* Number of clusters in the clustered sphere scene, and the spread of each cluster around its center. */
+#define CLUSTER_COUNT 16
+#define CLUSTER_SPREAD 0.6
+
+
+
+/* Creates empty object and light lists for the scene, and adds a single white light behind the camera. */
+static void initLitScene(void) {
+    SCENE_OBJECTS = new vector <SceneObject *>;
+    SCENE_LIGHTS = new vector <PointLight *>;
+
+    PointLight *light = new PointLight(); {
+        light->x() = 5.0;
+        light->y() = 10.0;
+        light->z() = 5.0;
+        light->intensity = 2.0;
+
+        SCENE_LIGHTS->push_back(light);
+        SCENE_OBJECTS->push_back(light);
+    }
+}
+
+
+/* Returns the side length of the cube each of COUNT objects would get if the scene's box were split evenly between them. */
+static double getCellSize(unsigned int count) {
+    double volume = (SCENE_MAX_X - SCENE_MIN_X) * (SCENE_MAX_Y - SCENE_MIN_Y) * (SCENE_MAX_Z - SCENE_MIN_Z);
+    return cbrt(volume / count);
+}
+
+
+/* Returns a random point in the scene's box. */
+static Point3 getRandomPoint(void) {
+    return Point3(randomDouble(SCENE_MIN_X, SCENE_MAX_X), randomDouble(SCENE_MIN_Y, SCENE_MAX_Y), randomDouble(SCENE_MIN_Z, SCENE_MAX_Z));
+}
+
+
+/* Gives MATERIAL a random opaque color and fixed shading properties. */
+static void setRandomMaterial(Material &material) {
+    material.color.r = randomDouble(0.2, 1.0);
+    material.color.g = randomDouble(0.2, 1.0);
+    material.color.b = randomDouble(0.2, 1.0);
+    material.color.a = 1.0;
+    material.ambient = 0.1;
+    material.specular = 0.3;
+    material.shininess = 20;
+}
+
+
+
+/* Sets up a scene of COUNT small triangles scattered at random in front of the camera, lit by a single light.
+   The same COUNT always gives the same scene. */
+void initTriangleScene(unsigned int count) {
+    initLitScene();
+    srand(count);
+
+    /* Triangles are somewhat larger than their share of the box, so they overlap like the parts of a real mesh. */
+    double size = 1.5 * getCellSize(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        Point3 center = getRandomPoint();
+
+        /* The corners are made one at a time, so the random numbers are drawn in the same order every time. */
+        Point3 corners [3];
+        for (int j = 0; j < 3; j++) {
+            corners[j] = center + Direction3(randomDouble(-size, size), randomDouble(-size, size), randomDouble(-size, size));
+        }
+
+        Triangle *t = new Triangle; {
+            t->setVertices(corners[0], corners[1], corners[2]);
+            t->position = center;
+
+            setRandomMaterial(t->material);
+
+            SCENE_OBJECTS->push_back(t);
+        }
+    }
+}
+
+
+/* Sets up a scene of COUNT similarly sized spheres scattered at random in front of the camera, lit by a single
+   light. The same COUNT always gives the same scene. */
+void initSphereScene(unsigned int count) {
+    initLitScene();
+    srand(count);
+
+    double radius = 0.4 * getCellSize(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        Sphere *s = new Sphere; {
+            s->position = getRandomPoint();
+            s->radius = radius * randomDouble(0.75, 1.25);
+
+            setRandomMaterial(s->material);
+
+            SCENE_OBJECTS->push_back(s);
+        }
+    }
+}
+
+
+/* Adds the two triangles of the quad with corners A, B, C and D, in order around it, to the scene, colored with MATERIAL. */
+static void addQuad(const Point3 &a, const Point3 &b, const Point3 &c, const Point3 &d, const Material &material) {
+    Triangle *first = new Triangle; {
+        first->setVertices(a, b, c);
+        first->position = a;
+        first->material = material;
+
+        SCENE_OBJECTS->push_back(first);
+    }
+
+    Triangle *second = new Triangle; {
+        second->setVertices(a, c, d);
+        second->position = a;
+        second->material = material;
+
+        SCENE_OBJECTS->push_back(second);
+    }
+}
+
+
+/* Sets up a scene like a building's, of COUNT long, thin wall panels standing at random angles on a large ground
+   quad, lit by a single light. Each panel is a quad of two triangles, and the panels' boxes overlap a lot since
+   most stand diagonally. The same COUNT always gives the same scene. */
+void initWallScene(unsigned int count) {
+    initLitScene();
+    srand(count);
+
+    Material ground;
+    setRandomMaterial(ground);
+
+    addQuad(Point3(3*SCENE_MIN_X, SCENE_MIN_Y, SCENE_MAX_Z), Point3(3*SCENE_MAX_X, SCENE_MIN_Y, SCENE_MAX_Z),
+            Point3(3*SCENE_MAX_X, SCENE_MIN_Y, 2*SCENE_MIN_Z), Point3(3*SCENE_MIN_X, SCENE_MIN_Y, 2*SCENE_MIN_Z), ground);
+
+    /* A panel is several times longer than its share of the scene, and much shorter. */
+    double size = getCellSize(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        Point3 center = getRandomPoint();
+        double length = randomDouble(4.0, 12.0) * size;
+        double height = randomDouble(0.5, 1.5) * size;
+        double angle = randomDouble(0.0, PI);
+
+        Direction3 along (0.5*length*cos(angle), 0.0, 0.5*length*sin(angle));
+        Direction3 up (0.0, 0.5*height, 0.0);
+
+        Material material;
+        setRandomMaterial(material);
+
+        addQuad(center - along - up, center + along - up, center + along + up, center - along + up, material);
+    }
+}
+
+
+/* Returns a random number from a normal distribution with mean 0 and standard deviation 1, by the Box-Muller transform. */
+static double randomNormal(void) {
+    double u = randomDouble(1e-12, 1.0);
+    double v = randomDouble(0.0, 1.0);
+    return sqrt(-2.0*log(u)) * cos(2.0*PI*v);
+}
+
+
+/* Sets up a scene of COUNT similarly sized spheres gathered into a few dense clusters at random places in front of the
+   camera, with empty space between them, lit by a single light. The same COUNT always gives the same scene. */
+void initClusteredSphereScene(unsigned int count) {
+    initLitScene();
+    srand(count);
+
+    vector <Point3> centers;
+    for (int i = 0; i < CLUSTER_COUNT; i++) {
+        centers.push_back(getRandomPoint());
+    }
+
+    /* Smaller than in the uniform scene, since the clusters pack the spheres much closer together. */
+    double radius = 0.2 * getCellSize(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        const Point3 &center = centers[i % CLUSTER_COUNT];
+
+        Sphere *s = new Sphere; {
+            s->position = Point3(center.getEntry(0) + CLUSTER_SPREAD*randomNormal(),
+                                 center.getEntry(1) + CLUSTER_SPREAD*randomNormal(),
+                                 center.getEntry(2) + CLUSTER_SPREAD*randomNormal());
+            s->radius = radius * randomDouble(0.75, 1.25);
+
+            setRandomMaterial(s->material);
+
+            SCENE_OBJECTS->push_back(s);
+        }
+    }
+}
+
+
+/* Returns the point on a bumpy unit sphere at latitude THETA and longitude PHI. */
+static Point3 getBumpyPoint(double theta, double phi) {
+    double radius = 1.0 + 0.1*sin(5.0*theta)*sin(5.0*phi);
+    return Point3(radius*sin(theta)*cos(phi), radius*cos(theta), radius*sin(theta)*sin(phi));
+}
+
+
+/* Sets up a scene of COUNT copies of a bumpy sphere of 10,000 triangles, each scattered at random in front of the
+   camera with its own rotation, size and color, lit by a single light. The sphere's triangles are stored once and
+   shared by every copy. The same COUNT always gives the same scene. */
+void initInstanceScene(unsigned int count) {
+    initLitScene();
+    srand(count);
+
+    /* The sphere's vertices, a row of INSTANCE_MESH_SEGMENTS+1 for each of the INSTANCE_MESH_BANDS+1 latitudes, with
+       two triangles between each four neighbours. */
+    vector <Scalar> vertices [3];
+    vector <unsigned int> indices;
+
+    for (int band = 0; band <= INSTANCE_MESH_BANDS; band++) {
+        double theta = PI*band/INSTANCE_MESH_BANDS;
+
+        for (int segment = 0; segment <= INSTANCE_MESH_SEGMENTS; segment++) {
+            Point3 vertex = getBumpyPoint(theta, 2.0*PI*segment/INSTANCE_MESH_SEGMENTS);
+
+            for (int axis = 0; axis < 3; axis++) {
+                vertices[axis].push_back(vertex[axis]);
+            }
+        }
+    }
+
+    for (int band = 0; band < INSTANCE_MESH_BANDS; band++) {
+        for (int segment = 0; segment < INSTANCE_MESH_SEGMENTS; segment++) {
+            unsigned int corner00 = band*(INSTANCE_MESH_SEGMENTS+1) + segment;
+            unsigned int corner01 = corner00 + 1;
+            unsigned int corner10 = corner00 + (INSTANCE_MESH_SEGMENTS+1);
+            unsigned int corner11 = corner10 + 1;
+
+            unsigned int triangles [6] = {corner00, corner10, corner11, corner00, corner11, corner01};
+            indices.insert(indices.end(), triangles, triangles + 6);
+        }
+    }
+
+    /* Never deleted, like the scene's objects. */
+    Mesh *mesh = new Mesh;
+    mesh->addTriangles(vertices[0].data(), vertices[1].data(), vertices[2].data(), vertices[0].size(), indices.data(), indices.size()/3);
+
+    mesh->build();
+
+    double radius = 0.4 * getCellSize(count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        Point3 center = getRandomPoint();
+        Vector axis = Vector(randomDouble(-1.0, 1.0), randomDouble(-1.0, 1.0), randomDouble(-1.0, 1.0), 0.0).normalize();
+        double size = radius * randomDouble(0.75, 1.25);
+
+        /* Each matrix function applies its transformation before M's, so the copy is scaled, then rotated, then moved. */
+        Matrix objectToWorld = Matrix::getIdentity();
+        objectToWorld = translate(objectToWorld, center.getEntry(0), center.getEntry(1), center.getEntry(2));
+        objectToWorld = rotate(objectToWorld, axis, randomDouble(0.0, 2.0*PI));
+        objectToWorld = scale(objectToWorld, size, size, size);
+
+        MeshInstance *instance = new MeshInstance(mesh, objectToWorld); {
+            setRandomMaterial(instance->material);
+
+            SCENE_OBJECTS->push_back(instance);
+        }
+    }
+}
@@ -0,0 +1,30 @@
+/* Contains declarations for functions that generate large scenes, used to measure how the raytracer scales. */
+
+#ifndef SCENES
+#define SCENES
+
+
+	/* Sets up a scene of COUNT small triangles scattered at random in front of the camera, lit by a single light.
+	   The same COUNT always gives the same scene. */
+	void initTriangleScene(unsigned int count);
+
+	/* Sets up a scene of COUNT similarly sized spheres scattered at random in front of the camera, lit by a single
+	   light. The same COUNT always gives the same scene. */
+	void initSphereScene(unsigned int count);
+
+	/* Sets up a scene of COUNT similarly sized spheres gathered into a few dense clusters at random places in front of the
+	   camera, with empty space between them, lit by a single light. The same COUNT always gives the same scene. */
+	void initClusteredSphereScene(unsigned int count);
+
+	/* Sets up a scene like a building's, of COUNT long, thin wall panels standing at random angles on a large ground
+	   quad, lit by a single light. Each panel is a quad of two triangles, and the panels' boxes overlap a lot since
+	   most stand diagonally. The same COUNT always gives the same scene. */
+	void initWallScene(unsigned int count);
+
+	/* Sets up a scene of COUNT copies of a bumpy sphere of 10,000 triangles, each scattered at random in front of the
+	   camera with its own rotation, size and color, lit by a single light. The sphere's triangles are stored once and
+	   shared by every copy. The same COUNT always gives the same scene. */
+	void initInstanceScene(unsigned int count);
+
+
+#endif
@@ -3,6 +3,9 @@
 #include <iostream>
 #include <cstdio>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 
 #include "test.h"
 #include "color.h"
@@ -11,16 +14,39 @@
 #include "raytrace.h"
 #include "lowlevel.h"
 #include "vector.h"
+#include "kernels.h"
+#include "matrix.h"
+#include "transform.h"
+#include "cpu.h"
+#include "misc.h"
+#include "random.h"
+#include "boundingbox.h"
 
 using namespace std;
 
 
+/* Number of batches of random rays and spheres testSphereKernel() tries at each width. */
+#define TEST_KERNEL_TRIALS 10000
+
+/* Number of random matrices testBatchTransforms() tries at each width. */
+#define TEST_TRANSFORM_TRIALS 2000
+
+/* Number of random colors testColorKernel() converts at each width. */
+#define TEST_COLOR_COUNT 100003
+
+/* Number of counters testRandomStreams() makes random numbers for at each width. */
+#define TEST_RANDOM_COUNT 100003
+
+
 
 void test(void) {
 	//testColor();
 	//testScene();
 	testVector();
 	// testSphereIntersection();
+	testSphereKernel();
+	testBatchTransforms();
+	testColorKernel();
 }
 
 
@@ -133,39 +159,39 @@ void testVector(void) {
 void testSphereIntersection(void) {
 
 	bool intersection;
-	Vector returnIntersectionPoint;
+	Point3 returnIntersectionPoint;
 
 	Sphere a = Sphere(10, 10, 10, 5);
 	cout << "a: " << a << endl;
 
-	Vector rayDirectionA = Vector(1, 1, 1, 1);
-
-	Vector rayStartA = Vector(0, 0, 0, 1);
-	Vector rayStartF = Vector(4, 0, 0, 1);
-	Vector rayStartB = Vector(5, 0, 0, 1);
-	Vector rayStartC = Vector(6, 0, 0, 1);
-	Vector rayStartD = Vector(7, 0, 0, 1);
-	Vector rayStartE = Vector(8, 0, 0, 1);
-	// Vector rayStartF;
-	Vector rayStartG;
-	Vector rayStartH;
-	Vector rayStartI;
-	Vector rayStartJ;
-	Vector rayStartK;
-	Vector rayStartL;
-
-	rayStartA = Vector(0, 0, 0, 1);
-	rayStartB = Vector(0, 1, 0, 1);
-	rayStartC = Vector(0, 2, 0, 1);
-	rayStartD = Vector(0, 3, 0, 1);
-	rayStartK = Vector(0, 3.99, 0, 1);
-	rayStartE = Vector(0, 4, 0, 1);
-	rayStartL = Vector(0, 4.01, 0, 1);
-	rayStartF = Vector(0, 4.50, 0, 1);
-	rayStartG = Vector(0, 5, 0, 1);
-	rayStartH = Vector(0, 6, 0, 1);
-	rayStartI = Vector(0, 7, 0, 1);
-	rayStartJ = Vector(0, 8, 0, 1);
+	Direction3 rayDirectionA = Point3(1, 1, 1);
+
+	Point3 rayStartA = Point3(0, 0, 0);
+	Point3 rayStartF = Point3(4, 0, 0);
+	Point3 rayStartB = Point3(5, 0, 0);
+	Point3 rayStartC = Point3(6, 0, 0);
+	Point3 rayStartD = Point3(7, 0, 0);
+	Point3 rayStartE = Point3(8, 0, 0);
+	// Point3 rayStartF;
+	Point3 rayStartG;
+	Point3 rayStartH;
+	Point3 rayStartI;
+	Point3 rayStartJ;
+	Point3 rayStartK;
+	Point3 rayStartL;
+
+	rayStartA = Point3(0, 0, 0);
+	rayStartB = Point3(0, 1, 0);
+	rayStartC = Point3(0, 2, 0);
+	rayStartD = Point3(0, 3, 0);
+	rayStartK = Point3(0, 3.99, 0);
+	rayStartE = Point3(0, 4, 0);
+	rayStartL = Point3(0, 4.01, 0);
+	rayStartF = Point3(0, 4.50, 0);
+	rayStartG = Point3(0, 5, 0);
+	rayStartH = Point3(0, 6, 0);
+	rayStartI = Point3(0, 7, 0);
+	rayStartJ = Point3(0, 8, 0);
    
     
 
@@ -201,14 +227,14 @@ void testSphereIntersection(void) {
     GLfloat imageWidth;
     /* declare data structures on stack to avoid dynamic allocation */
     // point worldPix;  /* current pixel in world coordinates */
-    Vector worldPixel;
+    Point3 worldPixel;
 
     // point direction; 
     // ray r;
     // Color c;
 
-    Vector rayStartPoint;
-    Vector rayDirection;
+    Point3 rayStartPoint;
+    Direction3 rayDirection;
     
 
     /* initialize */
@@ -251,7 +277,7 @@ void testSphereIntersection(void) {
             // calculateDirection(viewpoint,&worldPix,&direction);
             rayDirection = worldPixel - CAMERA_LOCATION;
 
-            Vector returnIntersectionPoint;
+            Point3 returnIntersectionPoint;
             // SceneObject *s1 = (*SCENE_OBJECTS)[0];
             // cout << "s1: " << *s1 << endl;
             // bool intersection = s1->checkIntersection(rayStartPoint, rayDirection, returnIntersectionPoint);
@@ -270,3 +296,534 @@ void testSphereIntersection(void) {
     }
 }
 
+
+
+/* Returns true if the kernel's result T agrees with SPHERE's own test of the ray from START along DIRECTION: both
+   miss, or both hit, and the point at T is exactly the point the sphere found. */
+static bool agreesWithSphere(Scalar t, const Sphere &sphere, const Scalar start[3], const Scalar direction[3]) {
+	Point3 point;
+	bool hit = sphere.checkIntersection(Point3(start[0], start[1], start[2]), Direction3(direction[0], direction[1], direction[2]), point);
+
+	if (t == KERNEL_MISS) {
+		return !hit;
+	}
+
+	return hit && point.getEntry(0) == start[0] + t*direction[0] && point.getEntry(1) == start[1] + t*direction[1] &&
+	       point.getEntry(2) == start[2] + t*direction[2];
+}
+
+
+
+/* Tests intersectSpheres() and intersectRaysWithSphere() at every width against Sphere::checkIntersection(), on
+   batches of random rays and spheres of every size up to one more than KERNEL_BATCH_SIZE, so that lanes left over
+   at the end of a batch are covered. Rays start inside, outside and behind the spheres. Prints the number of results
+   that disagree with the sphere's own, and returns true if there are none. */
+bool testSphereKernel(void) {
+	cout << "------------------------" << endl;
+	cout << "Testing sphere kernel..." << endl;
+	cout << "------------------------" << endl;
+
+	int widths [4] = {1, 2, 4, 8};
+	bool passed = true;
+
+	for (int w = 0; w < 4; w++) {
+		unsigned int tests = 0, hits = 0, failures = 0;
+		srand(w);
+
+		/* A width the instruction set in use doesn't have would only repeat a narrower one. */
+		if (getKernelWidth(widths[w]) != widths[w]) {
+			continue;
+		}
+
+		for (int trial = 0; trial < TEST_KERNEL_TRIALS; trial++) {
+			unsigned int count = 1 + trial % (KERNEL_BATCH_SIZE + 1);
+
+			vector <Scalar> starts [3], directions [3], centers [3], radii;
+			vector <Sphere> spheres;
+
+			for (unsigned int i = 0; i < count; i++) {
+				for (int axis = 0; axis < 3; axis++) {
+					starts[axis].push_back(randomDouble(-10.0, 10.0));
+					centers[axis].push_back(randomDouble(-3.0, 3.0));
+
+					/* Roughly towards the spheres, so that many rays hit. */
+					directions[axis].push_back(randomDouble(-4.0, 4.0) - starts[axis][i]);
+				}
+				radii.push_back(randomDouble(0.5, 8.0));
+				spheres.push_back(Sphere(radii[i], centers[0][i], centers[1][i], centers[2][i]));
+			}
+
+			vector <Scalar> t (count);
+
+			/* The first ray against every sphere. */
+			Scalar start [3] = {starts[0][0], starts[1][0], starts[2][0]};
+			Scalar direction [3] = {directions[0][0], directions[1][0], directions[2][0]};
+
+			intersectSpheres(start, direction, &centers[0][0], &centers[1][0], &centers[2][0], &radii[0], count, &t[0], widths[w]);
+
+			for (unsigned int i = 0; i < count; i++) {
+				tests++;
+				hits += (t[i] != KERNEL_MISS);
+				failures += !agreesWithSphere(t[i], spheres[i], start, direction);
+			}
+
+			/* Every ray against the first sphere. */
+			Scalar center [3] = {centers[0][0], centers[1][0], centers[2][0]};
+
+			intersectRaysWithSphere(&starts[0][0], &starts[1][0], &starts[2][0], &directions[0][0], &directions[1][0], &directions[2][0],
+			                        count, center, radii[0], &t[0], widths[w]);
+
+			for (unsigned int i = 0; i < count; i++) {
+				Scalar rayStart [3] = {starts[0][i], starts[1][i], starts[2][i]};
+				Scalar rayDirection [3] = {directions[0][i], directions[1][i], directions[2][i]};
+
+				tests++;
+				hits += (t[i] != KERNEL_MISS);
+				failures += !agreesWithSphere(t[i], spheres[0], rayStart, rayDirection);
+			}
+		}
+
+		cout << "Width " << widths[w] << ": " << tests << " tests, " << hits << " hits, " << failures << " failures" << endl;
+
+		if (failures > 0) {
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+
+
+/* Places into RETURN_LANE, RETURN_T, RETURN_U and RETURN_V the hit intersectTrianglePacket() should find for the ray
+   from START along DIRECTION against the first COUNT triangles of TRIANGLES, packed in that order, and returns the mask
+   of those it hits. Each is tested with Triangle::intersect(), and of hits at the same distance the lowest lane is
+   kept. */
+static unsigned int getExpectedPacketHit(const vector <Triangle> &triangles, unsigned int count, const Scalar start[3],
+                                         const Scalar direction[3], unsigned int &returnLane, Scalar &returnT, Scalar &returnU,
+                                         Scalar &returnV) {
+	unsigned int mask = 0;
+
+	for (unsigned int lane = 0; lane < count; lane++) {
+		HitRecord hit;
+
+		if (!triangles[lane].intersect(Point3(start[0], start[1], start[2]), Direction3(direction[0], direction[1], direction[2]), hit)) {
+			continue;
+		}
+
+		if (mask == 0 || hit.t < returnT) {
+			returnLane = lane;
+			returnT = hit.t;
+			returnU = hit.u;
+			returnV = hit.v;
+		}
+		mask |= (1u << lane);
+	}
+
+	return mask;
+}
+
+
+/* Tests intersectTrianglePacket() at every width against Triangle::intersect(), on random rays and packets of every
+   size from 1 to KERNEL_PACKET_WIDTH triangles, the unused lanes left as zeros. Some packets hold the same triangle
+   twice, so that the lowest lane must win the tie. Prints the number of results whose mask, lane, ray parameter or
+   barycentric coordinates disagree, and returns true if there are none. */
+bool testTrianglePacketKernel(void) {
+	cout << "------------------------" << endl;
+	cout << "Testing triangle packet kernel..." << endl;
+	cout << "------------------------" << endl;
+
+	int widths [3] = {1, 2, 4};
+	bool passed = true;
+
+	for (int w = 0; w < 3; w++) {
+		unsigned int tests = 0, hits = 0, failures = 0;
+		srand(w);
+
+		/* A width the instruction set in use doesn't have would only repeat a narrower one. */
+		if (getKernelWidth(widths[w]) != widths[w]) {
+			continue;
+		}
+
+		for (int trial = 0; trial < TEST_KERNEL_TRIALS; trial++) {
+			unsigned int count = 1 + trial % KERNEL_PACKET_WIDTH;
+
+			vector <Triangle> triangles (count);
+			TrianglePacket packet;
+			memset(&packet, 0, sizeof(packet));
+
+			for (unsigned int lane = 0; lane < count; lane++) {
+				Point3 corners [3];
+				for (int c = 0; c < 3; c++) {
+					corners[c] = Point3(randomDouble(-3.0, 3.0), randomDouble(-3.0, 3.0), randomDouble(-3.0, 3.0));
+				}
+
+				/* The last lane sometimes repeats the first. */
+				if (lane > 0 && lane == count - 1 && trial % 3 == 0) {
+					triangles[lane] = triangles[0];
+				}
+				else {
+					triangles[lane].setVertices(corners[0], corners[1], corners[2]);
+				}
+
+				for (int axis = 0; axis < 3; axis++) {
+					packet.vertex0[axis][lane] = triangles[lane].getVertex(0).getEntry(axis);
+					packet.edge1[axis][lane] = triangles[lane].getEdge1().getEntry(axis);
+					packet.edge2[axis][lane] = triangles[lane].getEdge2().getEntry(axis);
+				}
+			}
+
+			Scalar start [3], direction [3];
+			for (int axis = 0; axis < 3; axis++) {
+				start[axis] = randomDouble(-10.0, 10.0);
+
+				/* Roughly towards the triangles, so that many rays hit. */
+				direction[axis] = randomDouble(-2.0, 2.0) - start[axis];
+			}
+
+			unsigned int lane = 0, expectedLane = 0;
+			Scalar t = 0.0, u = 0.0, v = 0.0, expectedT = 0.0, expectedU = 0.0, expectedV = 0.0;
+
+			unsigned int mask = intersectTrianglePacket(packet, start, direction, lane, t, u, v, widths[w]);
+			unsigned int expectedMask = getExpectedPacketHit(triangles, count, start, direction, expectedLane, expectedT, expectedU, expectedV);
+
+			tests++;
+			hits += (mask != 0);
+
+			if (mask != expectedMask) {
+				failures++;
+			}
+			else if (mask != 0 && (lane != expectedLane || t != expectedT || u != expectedU || v != expectedV)) {
+				failures++;
+			}
+		}
+
+		cout << "Width " << widths[w] << ": " << tests << " tests, " << hits << " hits, " << failures << " failures" << endl;
+
+		if (failures > 0) {
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+
+
+/* Tests intersectRaysWithBox() at every width against intersectRay(), on random boxes and groups of random rays of
+   every size up to KERNEL_MAX_RAYS, only some of them active. Some rays run parallel to a slab, with an infinite
+   reciprocal along that axis, and some of those start exactly on one of the slab's faces, where the reciprocal times
+   zero gives NaN; others start on a face and cross it. Prints the number of rays whose bit disagrees, and returns true
+   if there are none. */
+bool testBoxKernel(void) {
+	cout << "------------------------" << endl;
+	cout << "Testing box kernel..." << endl;
+	cout << "------------------------" << endl;
+
+	int widths [4] = {1, 2, 4, 8};
+	bool passed = true;
+
+	for (int w = 0; w < 4; w++) {
+		unsigned int tests = 0, hits = 0, failures = 0;
+		srand(w);
+
+		/* A width the instruction set in use doesn't have would only repeat a narrower one. */
+		if (getKernelWidth(widths[w]) != widths[w]) {
+			continue;
+		}
+
+		for (int trial = 0; trial < TEST_KERNEL_TRIALS; trial++) {
+			unsigned int count = 1 + trial % KERNEL_MAX_RAYS;
+
+			BoundingBox box;
+			for (int axis = 0; axis < 3; axis++) {
+				double a = randomDouble(-3.0, 3.0), b = randomDouble(-3.0, 3.0);
+				box.lower[axis] = (a < b) ? a : b;
+				box.upper[axis] = (a < b) ? b : a;
+			}
+
+			vector <double> starts [3], inverses [3], maxT;
+			unsigned long long active = 0;
+
+			for (unsigned int i = 0; i < count; i++) {
+				double start [3], direction [3];
+
+				for (int axis = 0; axis < 3; axis++) {
+					start[axis] = randomDouble(-6.0, 6.0);
+
+					/* Roughly towards the box, so that many rays hit. */
+					direction[axis] = randomDouble(box.lower[axis], box.upper[axis]) - start[axis];
+				}
+
+				int axis = rand() % 3;
+				double face = (rand() % 2 == 0) ? box.lower[axis] : box.upper[axis];
+
+				switch (i % 4) {
+					case 1:
+						/* Parallel to the slab, inside or outside it. */
+						direction[axis] = (rand() % 2 == 0) ? 0.0 : -0.0;
+						break;
+					case 2:
+						/* Parallel to the slab, on one of its faces. */
+						direction[axis] = (rand() % 2 == 0) ? 0.0 : -0.0;
+						start[axis] = face;
+						break;
+					case 3:
+						/* On one of the slab's faces, crossing it. */
+						start[axis] = face;
+						break;
+				}
+
+				for (int k = 0; k < 3; k++) {
+					starts[k].push_back(start[k]);
+					inverses[k].push_back(1.0 / direction[k]);
+				}
+
+				maxT.push_back((rand() % 4 == 0) ? HUGE_VAL : randomDouble(0.0, 2.0));
+
+				if (rand() % 4 != 0) {
+					active |= (1ull << i);
+				}
+			}
+
+			unsigned long long mask = intersectRaysWithBox(box.lower, box.upper, &starts[0][0], &starts[1][0], &starts[2][0],
+			                                               &inverses[0][0], &inverses[1][0], &inverses[2][0], &maxT[0], count, active, widths[w]);
+
+			for (unsigned int i = 0; i < count; i++) {
+				double start [3] = {starts[0][i], starts[1][i], starts[2][i]};
+				double inverse [3] = {inverses[0][i], inverses[1][i], inverses[2][i]};
+				double tNear;
+
+				bool expected = ((active >> i) & 1) && intersectRay(box, start, inverse, maxT[i], tNear);
+				bool hit = (mask >> i) & 1;
+
+				tests++;
+				hits += hit;
+				failures += (hit != expected);
+			}
+
+			/* Rays past COUNT must be left clear. */
+			if (count < KERNEL_MAX_RAYS && (mask >> count) != 0) {
+				failures++;
+			}
+		}
+
+		cout << "Width " << widths[w] << ": " << tests << " tests, " << hits << " hits, " << failures << " failures" << endl;
+
+		if (failures > 0) {
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+
+
+/* Returns a random transformation made the way scenes make them: a scaling, then a rotation, then a translation. */
+static Matrix getRandomTransform(void) {
+	Vector axis = Vector(randomDouble(-1.0, 1.0), randomDouble(-1.0, 1.0), randomDouble(-1.0, 1.0), 0.0).normalize();
+
+	Matrix m = getTranslation(randomDouble(-10.0, 10.0), randomDouble(-10.0, 10.0), randomDouble(-10.0, 10.0));
+	m = rotate(m, axis, randomDouble(0.0, 2.0*PI));
+	return scale(m, randomDouble(0.1, 4.0), randomDouble(0.1, 4.0), randomDouble(0.1, 4.0));
+}
+
+
+
+/* Tests transformPoints() and transformNormals() at every width against transforming one Vector or Vec3 at a time,
+   on random transformations and batches of every size up to one more than KERNEL_BATCH_SIZE, so that lanes left
+   over at the end of a batch are covered. Some normals are zero, which must stay zero. Prints the number of results
+   that disagree, and returns true if there are none. */
+bool testBatchTransforms(void) {
+	cout << "------------------------" << endl;
+	cout << "Testing batch transforms..." << endl;
+	cout << "------------------------" << endl;
+
+	int widths [3] = {1, 2, 4};
+	bool passed = true;
+
+	for (int w = 0; w < 3; w++) {
+		unsigned int tests = 0, failures = 0;
+		srand(w);
+
+		if (getKernelWidth(widths[w]) != widths[w]) {
+			continue;
+		}
+
+		for (int trial = 0; trial < TEST_TRANSFORM_TRIALS; trial++) {
+			unsigned int count = 1 + trial % (KERNEL_BATCH_SIZE + 1);
+
+			Matrix m = getRandomTransform();
+			bool invertible;
+			Matrix inverse = m.inverse(invertible);
+
+			vector <Scalar> points [3], normals [3], results [3];
+
+			for (int axis = 0; axis < 3; axis++) {
+				results[axis].resize(count);
+
+				for (unsigned int i = 0; i < count; i++) {
+					points[axis].push_back(randomDouble(-10.0, 10.0));
+					normals[axis].push_back(i % 4 == 3 ? 0.0 : randomDouble(-1.0, 1.0));
+				}
+			}
+
+			transformPoints(m, &points[0][0], &points[1][0], &points[2][0], count, &results[0][0], &results[1][0], &results[2][0], widths[w]);
+
+			for (unsigned int i = 0; i < count; i++) {
+				Vector expected = m * Vector(points[0][i], points[1][i], points[2][i], 1.0);
+
+				tests++;
+				failures += !(results[0][i] == expected.getEntry(0) && results[1][i] == expected.getEntry(1) && results[2][i] == expected.getEntry(2));
+			}
+
+			transformNormals(inverse, &normals[0][0], &normals[1][0], &normals[2][0], count, &results[0][0], &results[1][0], &results[2][0], widths[w]);
+
+			for (unsigned int i = 0; i < count; i++) {
+				Direction3 expected (0.0, 0.0, 0.0);
+
+				for (int row = 0; row < 3; row++) {
+					for (int column = 0; column < 3; column++) {
+						expected[row] += inverse.getEntry(column, row) * normals[column][i];
+					}
+				}
+				expected.normalize();
+
+				tests++;
+				failures += !(results[0][i] == expected[0] && results[1][i] == expected[1] && results[2][i] == expected[2]);
+			}
+		}
+
+		cout << "Width " << widths[w] << ": " << tests << " tests, " << failures << " failures" << endl;
+
+		if (failures > 0) {
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+
+
+/* Tests convertColors() at every width against the conversion drawPixel() does, on random colors from a little below
+   0 to a little above 1, with 0, 1 and halfway mixed in, since colors aren't always clamped before they are drawn. The
+   count is odd, so that colors left over at the end are covered. Prints the number of bytes that disagree, and returns
+   true if there are none. */
+bool testColorKernel(void) {
+	cout << "------------------------" << endl;
+	cout << "Testing color kernel..." << endl;
+	cout << "------------------------" << endl;
+
+	double exact [3] = {0.0, 0.5, 1.0};
+	vector <Color> colors (TEST_COLOR_COUNT);
+	srand(0);
+
+	for (unsigned int i = 0; i < colors.size(); i++) {
+		Scalar *components [4] = {&colors[i].r, &colors[i].g, &colors[i].b, &colors[i].a};
+
+		for (int c = 0; c < 4; c++) {
+			*components[c] = (rand() % 8 == 0) ? exact[rand() % 3] : randomDouble(-0.25, 1.25);
+		}
+	}
+
+	int widths [3] = {1, 2, 4};
+	bool passed = true;
+
+	for (int w = 0; w < 3; w++) {
+		if (getKernelWidth(widths[w]) != widths[w]) {
+			continue;
+		}
+
+		vector <unsigned char> bytes (3*colors.size());
+		convertColors(&colors[0], colors.size(), &bytes[0], widths[w]);
+
+		unsigned int failures = 0;
+		for (unsigned int i = 0; i < colors.size(); i++) {
+			float components [3] = {(float)colors[i].r, (float)colors[i].g, (float)colors[i].b};
+
+			for (int c = 0; c < 3; c++) {
+				failures += (bytes[3*i + c] != (unsigned char)(char)(components[c]*255));
+			}
+		}
+
+		cout << "Width " << widths[w] << ": " << 3*colors.size() << " tests, " << failures << " failures" << endl;
+
+		if (failures > 0) {
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+
+
+/* Tests philox() against known answers published with the generator, then generateRandomDoubles() at every width
+   against getRandomDouble(), over counters for a run of pixels, samples and dimensions along with the largest of each.
+   The count is odd, so that counters left over at the end are covered. Prints the number of numbers that disagree
+   or fall outside [0, 1), and returns true if there are none. */
+bool testRandomStreams(void) {
+	cout << "------------------------" << endl;
+	cout << "Testing random streams..." << endl;
+	cout << "------------------------" << endl;
+
+	unsigned int counters [3][RANDOM_WORDS] = {{0x00000000, 0x00000000, 0x00000000, 0x00000000},
+	                                           {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+	                                           {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+	unsigned int keys [3][2] = {{0x00000000, 0x00000000}, {0xffffffff, 0xffffffff}, {0xa4093822, 0x299f31d0}};
+	unsigned int answers [3][RANDOM_WORDS] = {{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+	                                          {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+	                                          {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+	bool passed = true;
+
+	unsigned int failures = 0;
+	for (int i = 0; i < 3; i++) {
+		unsigned int words [RANDOM_WORDS];
+		philox(counters[i], keys[i], words);
+
+		for (int k = 0; k < RANDOM_WORDS; k++) {
+			failures += (words[k] != answers[i][k]);
+		}
+	}
+
+	cout << "Philox4x32-10: " << 3*RANDOM_WORDS << " tests, " << failures << " failures" << endl;
+	if (failures > 0) {
+		passed = false;
+	}
+
+	unsigned long long seed = 0x0123456789abcdefull;
+	vector <unsigned int> pixels, samples, dimensions;
+
+	for (unsigned int i = 0; i < TEST_RANDOM_COUNT; i++) {
+		pixels.push_back((i % 7 == 6) ? 0xffffffff : i/16);
+		samples.push_back((i % 11 == 10) ? 0xffffffff : (i/4) % 4);
+		dimensions.push_back((i % 13 == 12) ? 0xffffffff : i % 4);
+	}
+
+	int widths [4] = {1, 2, 4, 8};
+
+	for (int w = 0; w < 4; w++) {
+		if (getKernelWidth(widths[w]) != widths[w]) {
+			continue;
+		}
+
+		vector <double> values (TEST_RANDOM_COUNT);
+		generateRandomDoubles(seed, &pixels[0], &samples[0], &dimensions[0], TEST_RANDOM_COUNT, &values[0], widths[w]);
+
+		failures = 0;
+		for (unsigned int i = 0; i < TEST_RANDOM_COUNT; i++) {
+			double expected = getRandomDouble(seed, pixels[i], samples[i], dimensions[i]);
+			failures += (values[i] != expected || values[i] < 0.0 || values[i] >= 1.0);
+		}
+
+		cout << "Width " << widths[w] << ": " << TEST_RANDOM_COUNT << " tests, " << failures << " failures" << endl;
+
+		if (failures > 0) {
+			passed = false;
+		}
+	}
+
+	return passed;
+}
@@ -9,5 +9,11 @@ void testColor(void);
 void testScene(void);
 void testVector(void);
 void testSphereIntersection(void);
+bool testSphereKernel(void);
+bool testTrianglePacketKernel(void);
+bool testBoxKernel(void);
+bool testBatchTransforms(void);
+bool testColorKernel(void);
+bool testRandomStreams(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,204 @@
+/* Contains definitions for a tile renderer, which splits the image into square tiles and traces them on every core.
+
+   Tracing a pixel reads the scene, its acceleration structure and the camera, and writes nothing but its own color,
+   so tiles can be traced in any order on any thread and each pixel still comes out exactly as it would on its own.
+   The random points several samples of a pixel go through are numbered by pixel, sample and axis rather than drawn
+   one after another, so they don't depend on the thread or the order either.
+   Tiles differ a lot in how long they take, since some see only the background and others many reflective objects,
+   so they are handed out by parallelForEach(), whose threads steal tiles from each other once they run out. */
+
+#include <vector> /* STL vector. */
+#include <climits>
+#include <algorithm>
+
+#include "common.h"
+#include "tiles.h"
+#include "raytrace.h"
+#include "accelerator.h"
+#include "sceneobject.h"
+#include "lowlevel.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "random.h"
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+using namespace std;
+
+
+/* Scratch space a thread traces its tiles in, one per thread, so that no two threads write to the same memory. */
+struct TileScratch {
+
+    /* Colors of the pixels of a tile, a column at a time, and the bytes to draw them as. */
+    Color colors [TILE_SIZE*TILE_SIZE];
+    unsigned char bytes [3*TILE_SIZE*TILE_SIZE];
+
+    /* The rays of a block of pixels traced together, what each hits, and the index in SCENE_OBJECTS of the object it
+       hits. */
+    Point3 rayStartPoints [MAX_PACKET_SIZE];
+    Direction3 rayDirections [MAX_PACKET_SIZE];
+    HitRecord hits [MAX_PACKET_SIZE];
+    unsigned int hitIndices [MAX_PACKET_SIZE];
+
+    /* The counters of the random numbers for the sample points of a pixel, the x offset of each sample followed by its
+       y offset, and the numbers made from them. */
+    unsigned int samplePixels [2*MAX_SAMPLE_COUNT];
+    unsigned int samples [2*MAX_SAMPLE_COUNT];
+    unsigned int sampleAxes [2*MAX_SAMPLE_COUNT];
+    double sampleOffsets [2*MAX_SAMPLE_COUNT];
+};
+
+
+/* What every thread tracing the tiles of a frame shares, and only reads, besides its own SCRATCH. */
+struct TileRender {
+    GLfloat imageWidth;
+
+    /* Number of tiles across the canvas. */
+    int tileColumns;
+
+    /* Size in pixels of the blocks traced together, or 1 to trace one ray at a time. */
+    int packetSize;
+
+    /* Number of rays traced through random points of each pixel, or 1 to trace one through its corner. */
+    int sampleCount;
+
+    vector <TileScratch> scratch;
+};
+
+
+
+/* Returns the color of the pixel at column I and row J of the canvas, averaged over the sample count of RENDER rays
+   through random points of the pixel, which are drawn in one batch into SCRATCH. Sample k is offset along the x axis
+   by the random number for dimension 0 of sample k of the pixel, and along the y axis by the one for dimension 1. */
+static Color traceSamples(const TileRender &render, TileScratch &scratch, int i, int j) {
+    unsigned int count = 2*render.sampleCount;
+
+    for (unsigned int k = 0; k < count; k++) {
+        scratch.samplePixels[k] = j*CANVAS_WIDTH + i;
+        scratch.samples[k] = k/2;
+        scratch.sampleAxes[k] = k%2;
+    }
+
+    generateRandomDoubles(SAMPLE_SEED, scratch.samplePixels, scratch.samples, scratch.sampleAxes, count, scratch.sampleOffsets, 0);
+
+    Color sum = {0.0, 0.0, 0.0, 0.0};
+
+    for (int sample = 0; sample < render.sampleCount; sample++) {
+        Point3 sampleWorldCoord;
+        Direction3 rayDirection;
+
+        getSampleRay(i, j, scratch.sampleOffsets[2*sample], scratch.sampleOffsets[2*sample + 1], render.imageWidth, sampleWorldCoord, rayDirection);
+        sum += traceRay(sampleWorldCoord, rayDirection, 0);
+    }
+
+    return sum / (Scalar)render.sampleCount;
+}
+
+
+/* Traces the rays of the TILE_WIDTH by TILE_HEIGHT pixels whose bottom left pixel is at column TILE_I and row TILE_J
+   of the canvas into the colors of SCRATCH, one at a time, or in blocks of the packet size of RENDER through
+   SCENE_ACCELERATOR. Blocks at the edges of the tile may be cut short. With more than one sample per pixel, the
+   samples are traced one at a time. */
+static void traceTile(const TileRender &render, TileScratch &scratch, int tileI, int tileJ, int tileWidth, int tileHeight) {
+
+    if (render.sampleCount > 1) {
+        for (int i = 0; i < tileWidth; i++) {
+            for (int j = 0; j < tileHeight; j++) {
+                scratch.colors[i*tileHeight + j] = traceSamples(render, scratch, tileI + i, tileJ + j);
+            }
+        }
+        return;
+    }
+
+    if (render.packetSize <= 1) {
+        for (int i = 0; i < tileWidth; i++) {
+            for (int j = 0; j < tileHeight; j++) {
+                Point3 pixelWorldCoord;
+                Direction3 rayDirection;
+
+                getPrimaryRay(tileI + i, tileJ + j, render.imageWidth, pixelWorldCoord, rayDirection);
+                scratch.colors[i*tileHeight + j] = traceRay(pixelWorldCoord, rayDirection, 0);
+            }
+        }
+        return;
+    }
+
+    for (int blockI = 0; blockI < tileWidth; blockI += render.packetSize) {
+        for (int blockJ = 0; blockJ < tileHeight; blockJ += render.packetSize) {
+
+            int blockWidth = min(render.packetSize, tileWidth - blockI);
+            int blockHeight = min(render.packetSize, tileHeight - blockJ);
+            unsigned int count = 0;
+
+            for (int i = blockI; i < blockI + blockWidth; i++) {
+                for (int j = blockJ; j < blockJ + blockHeight; j++) {
+                    getPrimaryRay(tileI + i, tileJ + j, render.imageWidth, scratch.rayStartPoints[count], scratch.rayDirections[count]);
+                    count++;
+                }
+            }
+
+            SCENE_ACCELERATOR->findFirstIntersections(scratch.rayStartPoints, scratch.rayDirections, count, scratch.hits, scratch.hitIndices);
+
+            /* Shade each pixel on its own as traceRay() would, placing it among the tile's columns. */
+            count = 0;
+            for (int i = blockI; i < blockI + blockWidth; i++) {
+                for (int j = blockJ; j < blockJ + blockHeight; j++) {
+                    Color &color = scratch.colors[i*tileHeight + j];
+                    color = BG_COLOR;
+
+                    if (scratch.hitIndices[count] != UINT_MAX) {
+                        color = shadeIntersection(scratch.rayStartPoints[count], scratch.rayDirections[count], scratch.hits[count],
+                                                  *(*SCENE_OBJECTS)[scratch.hitIndices[count]], 0);
+                    }
+                    count++;
+                }
+            }
+        }
+    }
+}
+
+
+/* Traces tile number TILE of the canvas, counting across each row of tiles from the bottom left, in the scratch space
+   of THREAD, and draws it onto the canvas. A ParallelItemBody over a TileRender. */
+static void drawTile(void *context, unsigned int thread, unsigned int tile) {
+    TileRender &render = *(TileRender *)context;
+    TileScratch &scratch = render.scratch[thread];
+
+    int tileI = (tile % render.tileColumns) * TILE_SIZE;
+    int tileJ = (tile / render.tileColumns) * TILE_SIZE;
+    int tileWidth = min(TILE_SIZE, CANVAS_WIDTH - tileI);
+    int tileHeight = min(TILE_SIZE, CANVAS_HEIGHT - tileJ);
+
+    traceTile(render, scratch, tileI, tileJ, tileWidth, tileHeight);
+
+    /* The tile's pixels are in column order, a column of TILE_HEIGHT at a time. */
+    convertColors(scratch.colors, tileWidth*tileHeight, scratch.bytes, 0);
+
+    for (int i = 0; i < tileWidth; i++) {
+        drawPixels(tileI + i, tileJ, tileHeight, &scratch.bytes[3*i*tileHeight]);
+    }
+}
+
+
+
+/* Draws the scene as drawScene() always has, one ray per pixel through traceRay(), or in blocks of PACKET_SIZE by
+   PACKET_SIZE pixels if PACKET_SIZE is greater than 1 and there is an acceleration structure, producing exactly the
+   same image on any number of threads. If SAMPLE_COUNT is greater than 1, that many rays are traced one at a time
+   through random points of each pixel instead, drawn from the streams SAMPLE_SEED picks by pixel, sample and axis, and
+   their colors averaged, which also gives the same image on any number of threads. Combining -samples with -packet is
+   rejected when the arguments are parsed. The canvas is split into tiles of TILE_SIZE by TILE_SIZE pixels, handed out
+   to getThreadCount() threads by parallelForEach(). Each thread keeps the colors and rays of the tile it is tracing in
+   scratch space of its own, and only reads the scene, so threads share nothing but the canvas, where each tile draws
+   its own pixels. IMAGE_WIDTH is the width of the image plane in world coordinates. */
+void drawSceneTiles(GLfloat imageWidth) {
+    TileRender render;
+
+    render.imageWidth = imageWidth;
+    render.tileColumns = (CANVAS_WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+    render.packetSize = (PACKET_SIZE > 1 && SCENE_ACCELERATOR != NULL) ? PACKET_SIZE : 1;
+    render.sampleCount = max(SAMPLE_COUNT, 1);
+    render.scratch.resize(getThreadCount());
+
+    int tileRows = (CANVAS_HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+
+    parallelForEach(render.tileColumns * tileRows, drawTile, &render);
+}
@@ -0,0 +1,30 @@
+/* Contains declarations for a tile renderer, which splits the image into square tiles and traces them on every core. */
+
+#ifndef TILES
+#define TILES
+
+	#include "common.h"
+
+
+	/* Width and height in pixels of the tiles the image is split into. Tiles at the right and top edges of the canvas
+	   may be cut short. */
+	#define TILE_SIZE 16
+
+	/* Most rays SAMPLE_COUNT may trace through each pixel. */
+	#define MAX_SAMPLE_COUNT 256
+
+
+	/* Draws the scene as drawScene() always has, one ray per pixel through traceRay(), or in blocks of PACKET_SIZE by
+	   PACKET_SIZE pixels if PACKET_SIZE is greater than 1 and there is an acceleration structure, producing exactly the
+	   same image on any number of threads. If SAMPLE_COUNT is greater than 1, that many rays are traced one at a time
+	   through random points of each pixel instead, drawn from the streams SAMPLE_SEED picks by pixel, sample and axis,
+	   and their colors averaged, which also gives the same image on any number of threads. Combining -samples with
+	   -packet is rejected when the arguments are parsed. The canvas is split into tiles of TILE_SIZE by TILE_SIZE
+	   pixels, handed out to getThreadCount() threads by parallelForEach(). Each thread keeps the colors and rays of the
+	   tile it is tracing in scratch space of its own, and only reads the scene, so threads share nothing but the
+	   canvas, where each tile draws its own pixels. IMAGE_WIDTH is the width of the image plane in world
+	   coordinates. */
+	void drawSceneTiles(GLfloat imageWidth);
+
+
+#endif
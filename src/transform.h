@@ -9,6 +9,28 @@
 
 
 
+	/*
+
+	Transformation Matrices:
+	========================
+
+	The functions below all build one of these matrices and multiply by it, so a transformation applied many times,
+	or to many points at once with transformPoints(), can build its matrix once with these instead.
+
+	*/
+
+
+	/* Returns the matrix that translates by (XTRANSLATE, YTRANSLATE, ZTRANSLATE). */
+	Matrix getTranslation (double xTranslate, double yTranslate, double zTranslate);
+
+	/* Returns the matrix that scales each component by XSCALE, YSCALE, and ZSCALE. */
+	Matrix getScaling (double xScale, double yScale, double zScale);
+
+	/* Returns the matrix that rotates by THETA radians along AXIS, a unit vector. Uses quaternions. */
+	Matrix getRotation (const Vector &axis, double theta);
+
+
+
 	/*
 
 	Vector Functions:
@@ -51,13 +73,13 @@
 
 
 	/* Translates M by (XTRANSLATE, YTRANSLATE, ZTRANSLATE). */
-	Matrix translate (Matrix m, double xTranslate, double yTranslate, double zTranslate);
+	Matrix translate (const Matrix &m, double xTranslate, double yTranslate, double zTranslate);
 
 	/* Scales each of M's components by XSCALE, YSCALE, and ZSCALE. */
-	Matrix scale (Matrix m, double xScale, double yScale, double zScale); 
+	Matrix scale (const Matrix &m, double xScale, double yScale, double zScale); 
 
 	/* Rotates M by THETA radians along AXIS. Uses quaternions. */
-	Matrix rotate (Matrix m, Vector axis, double theta);
+	Matrix rotate (const Matrix &m, Vector axis, double theta);
 
 
 #endif
@@ -0,0 +1,280 @@
+/* Defines a header-only 3 component vector for the points and directions rays are traced and shaded with. */
+
+#ifndef VEC3
+#define VEC3
+
+	#include <iostream>
+	#include <cstdio>
+	#include <cmath>
+
+	#include "scalar.h"
+	#include "vector.h" /* My own implementation of a 4x1 vector. */
+
+	#if defined(__AVX__)
+		#include <immintrin.h>
+	#elif defined(__SSE2__)
+		#include <emmintrin.h>
+	#endif
+
+	using namespace std;
+
+
+	/* A point or direction in space with x, y and z entries, indexed 0 to 2. Intersection and shading work with these,
+	   while Vector, with its fourth homogeneous entry, is kept for transforms by a Matrix.
+
+	   Every function is defined here so that it inlines wherever it is used, and nothing is bounds-checked. The entries
+	   are stored in a block of four Scalars, the last always 0, aligned so that a whole Vec3 loads into one AVX register,
+	   or two SSE registers, when the compiler targets them. Entry-wise arithmetic uses those registers; dot products add
+	   up their terms in order, x then y then z. Results are exactly those Vector gives for vectors whose fourth entry is
+	   0, such as directions and differences of points. */
+	class alignas(4*sizeof(Scalar)) Vec3 {
+
+		private:
+			/* The x, y and z entries, and a fourth that is always 0. */
+			Scalar entries [4];
+
+
+			/* Places A + B, entry by entry, into RESULT. */
+			static void add(const Scalar *a, const Scalar *b, Scalar *result) {
+			#if defined(__AVX__) && !defined(SINGLE_PRECISION)
+				_mm256_store_pd(result, _mm256_add_pd(_mm256_load_pd(a), _mm256_load_pd(b)));
+			#elif defined(__SSE2__) && !defined(SINGLE_PRECISION)
+				_mm_store_pd(result, _mm_add_pd(_mm_load_pd(a), _mm_load_pd(b)));
+				_mm_store_pd(result + 2, _mm_add_pd(_mm_load_pd(a + 2), _mm_load_pd(b + 2)));
+			#elif defined(__SSE2__)
+				_mm_store_ps(result, _mm_add_ps(_mm_load_ps(a), _mm_load_ps(b)));
+			#else
+				for (int i = 0; i < 4; i++) {
+					result[i] = a[i] + b[i];
+				}
+			#endif
+			}
+
+			/* Places A - B, entry by entry, into RESULT. */
+			static void subtract(const Scalar *a, const Scalar *b, Scalar *result) {
+			#if defined(__AVX__) && !defined(SINGLE_PRECISION)
+				_mm256_store_pd(result, _mm256_sub_pd(_mm256_load_pd(a), _mm256_load_pd(b)));
+			#elif defined(__SSE2__) && !defined(SINGLE_PRECISION)
+				_mm_store_pd(result, _mm_sub_pd(_mm_load_pd(a), _mm_load_pd(b)));
+				_mm_store_pd(result + 2, _mm_sub_pd(_mm_load_pd(a + 2), _mm_load_pd(b + 2)));
+			#elif defined(__SSE2__)
+				_mm_store_ps(result, _mm_sub_ps(_mm_load_ps(a), _mm_load_ps(b)));
+			#else
+				for (int i = 0; i < 4; i++) {
+					result[i] = a[i] - b[i];
+				}
+			#endif
+			}
+
+			/* Places A times VALUE, entry by entry, into RESULT. */
+			static void multiply(const Scalar *a, Scalar value, Scalar *result) {
+			#if defined(__AVX__) && !defined(SINGLE_PRECISION)
+				_mm256_store_pd(result, _mm256_mul_pd(_mm256_load_pd(a), _mm256_set1_pd(value)));
+			#elif defined(__SSE2__) && !defined(SINGLE_PRECISION)
+				__m128d values = _mm_set1_pd(value);
+				_mm_store_pd(result, _mm_mul_pd(_mm_load_pd(a), values));
+				_mm_store_pd(result + 2, _mm_mul_pd(_mm_load_pd(a + 2), values));
+			#elif defined(__SSE2__)
+				_mm_store_ps(result, _mm_mul_ps(_mm_load_ps(a), _mm_set1_ps(value)));
+			#else
+				for (int i = 0; i < 4; i++) {
+					result[i] = a[i] * value;
+				}
+			#endif
+			}
+
+			/* Places A divided by VALUE, entry by entry, into RESULT. The fourth entry is left 0 even if VALUE is. */
+			static void divide(const Scalar *a, Scalar value, Scalar *result) {
+			#if defined(__AVX__) && !defined(SINGLE_PRECISION)
+				_mm256_store_pd(result, _mm256_div_pd(_mm256_load_pd(a), _mm256_setr_pd(value, value, value, 1.0)));
+			#elif defined(__SSE2__) && !defined(SINGLE_PRECISION)
+				_mm_store_pd(result, _mm_div_pd(_mm_load_pd(a), _mm_set1_pd(value)));
+				_mm_store_pd(result + 2, _mm_div_pd(_mm_load_pd(a + 2), _mm_setr_pd(value, 1.0)));
+			#elif defined(__SSE2__)
+				_mm_store_ps(result, _mm_div_ps(_mm_load_ps(a), _mm_setr_ps(value, value, value, 1.0f)));
+			#else
+				for (int i = 0; i < 3; i++) {
+					result[i] = a[i] / value;
+				}
+				result[3] = 0;
+			#endif
+			}
+
+
+		public:
+			/* Default constructor. Initializes all entries to zero. */
+			Vec3 () {
+				entries[0] = 0;
+				entries[1] = 0;
+				entries[2] = 0;
+				entries[3] = 0;
+			}
+
+			/* Constructor that initializes the entries with X, Y and Z. */
+			Vec3 (Scalar x, Scalar y, Scalar z) {
+				entries[0] = x;
+				entries[1] = y;
+				entries[2] = z;
+				entries[3] = 0;
+			}
+
+			/* Constructor that takes the first three entries of V, dropping its homogeneous entry. */
+			explicit Vec3 (const Vector &v) {
+				entries[0] = v.getEntry(0);
+				entries[1] = v.getEntry(1);
+				entries[2] = v.getEntry(2);
+				entries[3] = 0;
+			}
+
+
+			/* Returns a Vector with the entries of this vector and W as its homogeneous entry: 1 for a point, or 0 for a
+			   direction, to be transformed by a Matrix. */
+			Vector toVector (Scalar w) const {
+				return Vector(entries[0], entries[1], entries[2], w);
+			}
+
+
+			/* Performs vector addition with V and returns a new vector. */
+			Vec3 operator+ (const Vec3 &v) const {
+				Vec3 result;
+				add(entries, v.entries, result.entries);
+				return result;
+			}
+
+			/* Performs vector addition with V in place and returns a reference to this vector. Modifies this vector. */
+			Vec3& operator+= (const Vec3 &v) {
+				add(entries, v.entries, entries);
+				return *this;
+			}
+
+			/* Performs vector subtraction with V and returns a new vector. */
+			Vec3 operator- (const Vec3 &v) const {
+				Vec3 result;
+				subtract(entries, v.entries, result.entries);
+				return result;
+			}
+
+			/* Performs vector subtraction with V in place and returns a reference to this vector. Modifies this vector. */
+			Vec3& operator-= (const Vec3 &v) {
+				subtract(entries, v.entries, entries);
+				return *this;
+			}
+
+			/* Performs scalar multiplication with VALUE and returns a new vector. */
+			Vec3 operator* (Scalar value) const {
+				Vec3 result;
+				multiply(entries, value, result.entries);
+				return result;
+			}
+
+			/* Performs scalar multiplication with VALUE in place and returns a reference to this vector. Modifies this vector. */
+			Vec3& operator*= (Scalar value) {
+				multiply(entries, value, entries);
+				return *this;
+			}
+
+			/* Performs scalar division with VALUE and returns a new vector. */
+			Vec3 operator/ (Scalar value) const {
+				Vec3 result;
+				divide(entries, value, result.entries);
+				return result;
+			}
+
+			/* Performs scalar division with VALUE in place and returns a reference to this vector. Modifies this vector. */
+			Vec3& operator/= (Scalar value) {
+				divide(entries, value, entries);
+				return *this;
+			}
+
+			/* Returns true if the entries of V are the same as the entries of this vector, false otherwise. */
+			bool operator== (const Vec3 &v) const {
+				return entries[0] == v.entries[0] && entries[1] == v.entries[1] && entries[2] == v.entries[2];
+			}
+
+			/* Returns true if the entries of V aren't exactly the same as the entries of this vector, false otherwise. */
+			bool operator!= (const Vec3 &v) const {
+				return !(*this == v);
+			}
+
+			/* Returns a reference to the entry at I, from 0 to 2. */
+			Scalar& operator[] (int i) {
+				return entries[i];
+			}
+
+			/* Returns the entry at I, from 0 to 2. */
+			Scalar operator[] (int i) const {
+				return entries[i];
+			}
+
+
+			/* Returns the dot product of this vector with V. */
+			Scalar dotProduct (const Vec3 &v) const {
+				return entries[0]*v.entries[0] + entries[1]*v.entries[1] + entries[2]*v.entries[2];
+			}
+
+			/* Computes the cross product of this vector with V. */
+			Vec3 crossProduct (const Vec3 &v) const {
+				return Vec3(entries[1]*v.entries[2] - entries[2]*v.entries[1],
+				            entries[2]*v.entries[0] - entries[0]*v.entries[2],
+				            entries[0]*v.entries[1] - entries[1]*v.entries[0]);
+			}
+
+			/* Returns the distance between this point and V. */
+			Scalar distance (const Vec3 &v) const {
+				return (*this - v).magnitude();
+			}
+
+			/* Returns the magnitude of this vector. */
+			Scalar magnitude (void) const {
+				return sqrt(dotProduct(*this));
+			}
+
+			/* Normalizes this vector in place to an unit vector and returns a reference to this vector. Modifies this vector.
+			   The zero vector is left unchanged. */
+			Vec3& normalize (void) {
+				Scalar magnitude = this->magnitude();
+				if (magnitude != 0) {
+					divide(entries, magnitude, entries);
+				}
+				return *this;
+			}
+
+
+			/* Sets the entry at I, from 0 to 2, to VALUE. */
+			void setEntry (int i, Scalar value) {
+				entries[i] = value;
+			}
+
+			/* Returns the entry at I, from 0 to 2. */
+			Scalar getEntry (int i) const {
+				return entries[i];
+			}
+
+
+			/* Print member function. */
+			void print (ostream *os) const {
+				printf("[Vec3: %5.3f, %5.3f, %5.3f]", (double)entries[0], (double)entries[1], (double)entries[2]);
+			}
+	};
+
+
+	/* A Vec3 holding a position in space. */
+	typedef Vec3 Point3;
+
+	/* A Vec3 holding a direction, or the difference of two points. */
+	typedef Vec3 Direction3;
+
+
+	/* Performs scalar multiplication with V and returns a new vector. Scalar multiplication is commutative. */
+	inline Vec3 operator* (Scalar value, const Vec3 &v) {
+		return v * value;
+	}
+
+	/* Printing operator for Vec3. */
+	inline ostream& operator<< (ostream &os, const Vec3 &v) {
+		v.print(&os);
+		return os;
+	}
+
+
+#endif
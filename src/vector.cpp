@@ -27,7 +27,7 @@ Vector::Vector () {
 
 
 /* Constructor that initializes vector entries with the supplied values. */
-Vector::Vector (double value0, double value1, double value2, double value3) {
+Vector::Vector (Scalar value0, Scalar value1, Scalar value2, Scalar value3) {
 	entries[0] = value0;
 	entries[1] = value1;
 	entries[2] = value2;
@@ -85,7 +85,7 @@ Vector& Vector::operator-= (const Vector &v) {
 
 
 /* Performs scalar multiplication with V in place and returns a reference to this vector. Modifies this vector. */
-Vector& Vector::operator*= (double value) {
+Vector& Vector::operator*= (Scalar value) {
 	entries[0] *= value;
 	entries[1] *= value;
 	entries[2] *= value;
@@ -97,7 +97,7 @@ Vector& Vector::operator*= (double value) {
 
 
 /* Performs scalar division with V in place and returns a reference to this vector. Modifies this vector. */
-Vector& Vector::operator/= (double value) {
+Vector& Vector::operator/= (Scalar value) {
 	entries[0] /= value;
 	entries[1] /= value;
 	entries[2] /= value;
@@ -109,7 +109,7 @@ Vector& Vector::operator/= (double value) {
 
 
 /* Returns a reference to entry at i where i = row #. WARNING: Aborts program if i is out-of-bounds! */
-double& Vector::operator[] (int i) {
+Scalar& Vector::operator[] (int i) {
 	assert(i >= 0 && i <= 3);
 	return entries[i];
 }
@@ -117,8 +117,8 @@ double& Vector::operator[] (int i) {
 
 
 /* Returns the dot product of this vector with V. */
-double Vector::dotProduct (const Vector &v) const {
-	double sum = 0.0;
+Scalar Vector::dotProduct (const Vector &v) const {
+	Scalar sum = 0.0;
 	for (int i = 0; i < 4; i++) {
 		sum += entries[i] * v.entries[i];
 	}
@@ -139,8 +139,8 @@ Vector Vector::crossProduct (const Vector &v) const {
 
 
 /* Returns the distance between this vector and V, assuming both vectors are fixed in space. */
-double Vector::distance (const Vector &v) const {
-	double sum = 0.0;
+Scalar Vector::distance (const Vector &v) const {
+	Scalar sum = 0.0;
 	for (int i = 0; i < 4; i++) {
 		sum += ((entries[i]-v.entries[i]) * (entries[i]-v.entries[i]));
 	}
@@ -150,10 +150,10 @@ double Vector::distance (const Vector &v) const {
 
 
 /* Returns the magnitude of this vector. */
-double Vector::magnitude (void) const {
+Scalar Vector::magnitude (void) const {
 
-	double sum = 0.0;
-	double component = 0.0;
+	Scalar sum = 0.0;
+	Scalar component = 0.0;
 
 	/* Sum up squared components of vector. */
 	for (int i = 0; i < 4; i++) {
@@ -169,7 +169,7 @@ double Vector::magnitude (void) const {
 /* Normalizes this vector in place and returns a reference to this vector. Modifies this vector. */
 Vector& Vector::normalize (void) {
 
-	double magnitude = this->magnitude();
+	Scalar magnitude = this->magnitude();
 
 	/* If the zero vector, then terminate early. Normalization doesn't really make sense, so leave vector unchanged. */
 	if (magnitude == 0) {
@@ -187,7 +187,7 @@ Vector& Vector::normalize (void) {
 
 
 /* Sets entry at i to VALUE where i = row #. WARNING: Aborts program if i is out-of-bounds! */
-void Vector::setEntry(int i, double value) {
+void Vector::setEntry(int i, Scalar value) {
 	assert(i >= 0 && i <= 3);
 	entries[i] = value;
 }
@@ -195,7 +195,7 @@ void Vector::setEntry(int i, double value) {
 
 
 /* Gets value of entry at i where i = row #. WARNING: Aborts program if i is out-of-bounds! */
-double Vector::getEntry(int i) const {
+Scalar Vector::getEntry(int i) const {
 	assert(i >= 0 && i <= 3);
 	return entries[i];
 }
@@ -214,7 +214,7 @@ void Vector::print (ostream *os) const {
 
 
 /* Performs scalar multiplication with V and returns a new vector. Scalar multiplication is commutative. */
-Vector operator* (const Vector& v, double value) {
+Vector operator* (const Vector& v, Scalar value) {
 	return Vector (
 		v.entries[0] * value,
 		v.entries[1] * value,
@@ -226,7 +226,7 @@ Vector operator* (const Vector& v, double value) {
 
 
 /* Performs scalar multiplication with V and returns a new vector. Scalar multiplication is commutative. */
-Vector operator* (double value, const Vector& v) {
+Vector operator* (Scalar value, const Vector& v) {
 	return Vector (
 		v.entries[0] * value,
 		v.entries[1] * value,
@@ -238,7 +238,7 @@ Vector operator* (double value, const Vector& v) {
 
 
 /* Performs scalar division with V and returns a new vector. Scalar division is commutative. */
-Vector operator/ (const Vector& v, double value) {
+Vector operator/ (const Vector& v, Scalar value) {
 	return Vector (
 		v.entries[0] / value,
 		v.entries[1] / value,
@@ -250,7 +250,7 @@ Vector operator/ (const Vector& v, double value) {
 
 
 /* Performs scalar division with V and returns a new vector. Scalar division is commutative. */
-Vector operator/ (double value, const Vector& v) {
+Vector operator/ (Scalar value, const Vector& v) {
 	return Vector (
 		v.entries[0] / value,
 		v.entries[1] / value,
@@ -0,0 +1,473 @@
+/* Contains definitions for a wavefront renderer, which traces the rays of the image in large batches, one stage of
+   the work at a time.
+
+   The recursive tracer finds what a ray hits, shades the hit, tests its shadow rays and recurses into its reflection
+   and refraction before moving on to the next ray, so each kind of work keeps pushing the others' code and data out
+   of the caches. Here each stage runs over a whole queue of rays before the next starts. Every color is still worked
+   out by the same functions, from the same values, in the same order, as traceRay() and getPhong() do, so the image
+   comes out exactly the same. */
+
+#include <vector> /* STL vector. */
+#include <cstdio>
+#include <climits>
+#include <algorithm>
+
+#include "common.h"
+#include "wavefront.h"
+#include "raytrace.h"
+#include "accelerator.h"
+#include "boundingbox.h"
+#include "sceneobject.h"
+#include "light.h"
+#include "lowlevel.h"
+#include "misc.h"
+#include "kernels.h"
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+using namespace std;
+
+
+/* Number of pixels whose primary rays make up one wave. Waves are traced one after another, which bounds the memory
+   the queues of their rays take up. */
+#define WAVEFRONT_PIXELS 65536
+
+/* Bits per axis of the Morton codes of the start points and of the directions secondary rays are sorted by. */
+#define WAVEFRONT_SORT_BITS 10
+
+
+/* A ray in the queue of one depth of a wave. */
+struct WavefrontRay {
+    Point3 start;
+    Direction3 direction;
+
+    /* Where the ray hits, and the object it hits, once it has been extended. OBJECT is NULL if it hits nothing. */
+    HitRecord hit;
+    const SceneObject *object;
+
+    /* The ray's Phong shading, before reflection and refraction are added, if it hits something other than a light. */
+    Color localColor;
+
+    /* Positions in the next depth's queue of the reflection and refraction rays the hit makes. TRANSMITTED is UINT_MAX
+       for an opaque object. */
+    unsigned int reflected;
+    unsigned int transmitted;
+
+    /* The color seen along the ray, once every ray it led to has been traced. */
+    Color color;
+};
+
+
+/* The stages a wave goes through, each timed separately. */
+enum WavefrontStage {
+    STAGE_GENERATE,
+    STAGE_SORT,
+    STAGE_EXTEND,
+    STAGE_SHADE,
+    STAGE_SHADOW,
+    STAGE_RESOLVE,
+    STAGE_COUNT
+};
+
+static const char *STAGE_NAMES [STAGE_COUNT] = {"generate", "sort", "extend", "shade", "shadow", "resolve"};
+
+
+/* How many rays each stage handled and how long it took, over every wave, and the same for the stages that trace
+   rays at each depth, so that the time spent sorting can be weighed against the time it saves. */
+struct WavefrontStats {
+    double rays [STAGE_COUNT];
+    double seconds [STAGE_COUNT];
+
+    vector <double> extendRays;
+    vector <double> extendSortSeconds;
+    vector <double> extendSeconds;
+    vector <double> shadowRays;
+    vector <double> shadowSortSeconds;
+    vector <double> shadowSeconds;
+};
+
+
+/* The key a ray is sorted by, and its position in its queue. */
+struct RayKey {
+    unsigned long long key;
+    unsigned int position;
+};
+
+
+/* Orders RayKeys by key, and rays with the same key by their position, so the order never depends on the sort. */
+static bool compareRayKeys(const RayKey &key1, const RayKey &key2) {
+    if (key1.key != key2.key) {
+        return key1.key < key2.key;
+    }
+    return key1.position < key2.position;
+}
+
+
+
+/* Places the primary rays of the COUNT pixels starting at pixel FIRST into RAYS, in the column by column order
+   drawScene() traces them in. */
+static void generateRays(unsigned int first, unsigned int count, GLfloat imageWidth, vector <WavefrontRay> &rays) {
+    rays.resize(count);
+
+    for (unsigned int k = 0; k < count; k++) {
+        int i = (first + k) / CANVAS_HEIGHT;
+        int j = (first + k) % CANVAS_HEIGHT;
+
+        getPrimaryRay(i, j, imageWidth, rays[k].start, rays[k].direction);
+    }
+}
+
+
+/* Returns the key a ray from START along DIRECTION is sorted by, where BOUNDS holds the start points of every ray being
+   sorted. The octant the direction points into comes first, then a Morton code of the start point within BOUNDS, then a
+   Morton code of the direction, so that rays starting close together and heading the same way end up side by side. */
+static unsigned long long getRayKey(const Point3 &start, const Direction3 &direction, const BoundingBox &bounds) {
+    unsigned long long octant = 0;
+    unsigned long long startCode = 0;
+    unsigned long long directionCode = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+        double d = direction.getEntry(axis);
+
+        octant = (octant << 1) | (d < 0.0 ? 1 : 0);
+        startCode |= spreadBits10(quantize(start.getEntry(axis), bounds.lower[axis], bounds.upper[axis], WAVEFRONT_SORT_BITS)) << (2 - axis);
+        directionCode |= spreadBits10(quantize(d, -1.0, 1.0, WAVEFRONT_SORT_BITS)) << (2 - axis);
+    }
+
+    return (octant << (6*WAVEFRONT_SORT_BITS)) | (startCode << (3*WAVEFRONT_SORT_BITS)) | directionCode;
+}
+
+
+/* Sorts KEYS and places the positions they hold into RETURN_ORDER in sorted order. */
+static void sortKeys(vector <RayKey> &keys, vector <unsigned int> &returnOrder) {
+    sort(keys.begin(), keys.end(), compareRayKeys);
+
+    returnOrder.resize(keys.size());
+    for (unsigned int k = 0; k < keys.size(); k++) {
+        returnOrder[k] = keys[k].position;
+    }
+}
+
+
+/* Places into RETURN_ORDER the positions of the rays of RAYS in the order they should be traced in, sorted by
+   getRayKey(). */
+static void sortRays(const vector <WavefrontRay> &rays, vector <unsigned int> &returnOrder) {
+    BoundingBox bounds = getEmptyBoundingBox();
+    for (unsigned int k = 0; k < rays.size(); k++) {
+        expand(bounds, rays[k].start);
+    }
+
+    vector <RayKey> keys (rays.size());
+    for (unsigned int k = 0; k < rays.size(); k++) {
+        keys[k].key = getRayKey(rays[k].start, rays[k].direction, bounds);
+        keys[k].position = k;
+    }
+
+    sortKeys(keys, returnOrder);
+}
+
+
+/* Places into RETURN_ORDER the positions of the shadow rays of SAMPLES in the order they should be traced in, sorted
+   by getRayKey(). */
+static void sortShadowRays(const vector <LightSample> &samples, vector <unsigned int> &returnOrder) {
+    BoundingBox bounds = getEmptyBoundingBox();
+    for (unsigned int k = 0; k < samples.size(); k++) {
+        expand(bounds, samples[k].shadowRayStartPoint);
+    }
+
+    vector <RayKey> keys (samples.size());
+    for (unsigned int k = 0; k < samples.size(); k++) {
+        keys[k].key = getRayKey(samples[k].shadowRayStartPoint, samples[k].shadowRayDirection, bounds);
+        keys[k].position = k;
+    }
+
+    sortKeys(keys, returnOrder);
+}
+
+
+/* Finds the first object each ray of RAYS, the queue for DEPTH, hits. Rays beyond MAX_TRACING_DEPTH, rays that hit
+   nothing and rays that hit a light get their color at once, as traceRay() gives it to them; the positions of the rest
+   are placed into RETURN_LIVE, in order, for shading. The rays are traced in the order of the positions in ORDER, or
+   in queue order if it is empty. Primary rays are traced in packets when drawScene() would. */
+static void extendRays(vector <WavefrontRay> &rays, int depth, const vector <unsigned int> &order, vector <unsigned int> &returnLive) {
+    returnLive.clear();
+
+    if (depth > MAX_TRACING_DEPTH) {
+        for (unsigned int k = 0; k < rays.size(); k++) {
+            rays[k].object = NULL;
+            rays[k].color = BG_COLOR;
+        }
+        return;
+    }
+
+    bool usePackets = (depth == 0 && PACKET_SIZE > 1 && SCENE_ACCELERATOR != NULL);
+
+    Point3 startPoints [MAX_PACKET_SIZE];
+    Direction3 directions [MAX_PACKET_SIZE];
+    HitRecord hits [MAX_PACKET_SIZE];
+    unsigned int hitIndices [MAX_PACKET_SIZE];
+
+    for (unsigned int first = 0; first < rays.size(); first += MAX_PACKET_SIZE) {
+        unsigned int count = min((unsigned int)MAX_PACKET_SIZE, (unsigned int)rays.size() - first);
+
+        /* The queue of primary rays goes down columns of pixels, so a run of them is a narrow strip of the image. */
+        if (usePackets) {
+            for (unsigned int k = 0; k < count; k++) {
+                startPoints[k] = rays[first + k].start;
+                directions[k] = rays[first + k].direction;
+            }
+
+            SCENE_ACCELERATOR->findFirstIntersections(startPoints, directions, count, hits, hitIndices);
+
+            for (unsigned int k = 0; k < count; k++) {
+                rays[first + k].hit = hits[k];
+                rays[first + k].object = (hitIndices[k] != UINT_MAX) ? (*SCENE_OBJECTS)[hitIndices[k]] : NULL;
+            }
+        }
+        else {
+            for (unsigned int k = first; k < first + count; k++) {
+                WavefrontRay &ray = rays[order.empty() ? k : order[k]];
+
+                if (!findFirstIntersection(ray.start, ray.direction, ray.hit, ray.object)) {
+                    ray.object = NULL;
+                }
+            }
+        }
+    }
+
+    for (unsigned int k = 0; k < rays.size(); k++) {
+        WavefrontRay &ray = rays[k];
+
+        if (ray.object == NULL) {
+            ray.color = BG_COLOR;
+        }
+        else if (isLight(*ray.object)) {
+            ray.color = ray.object->material.color;
+        }
+        else {
+            returnLive.push_back(k);
+        }
+    }
+}
+
+
+/* Shades the hits of the rays of RAYS at positions LIVE. For each of them, works out the light every light source sheds
+   on the hit with sampleLight(), placing the samples into RETURN_SAMPLES, one per light per ray, in order, and appends
+   the reflection and refraction rays the hit makes to NEXT_RAYS, the queue for the next depth. */
+static void shadeRays(vector <WavefrontRay> &rays, const vector <unsigned int> &live, vector <LightSample> &returnSamples, vector <WavefrontRay> &nextRays) {
+    unsigned int lightCount = SCENE_LIGHTS->size();
+
+    returnSamples.resize(live.size() * lightCount);
+    nextRays.clear();
+
+    for (unsigned int k = 0; k < live.size(); k++) {
+        WavefrontRay &ray = rays[live[k]];
+        const Point3 &intersectionPoint = ray.hit.point;
+
+        /* As getPhong() does. */
+        Direction3 intersectionPointUnitNormal = ray.object->getNormal(ray.hit).normalize();
+        Direction3 cameraDirectionUnitVector = (CAMERA_LOCATION - intersectionPoint).normalize();
+
+        for (unsigned int i = 0; i < lightCount; i++) {
+            sampleLight(*(*SCENE_LIGHTS)[i], ray.hit, *ray.object, intersectionPointUnitNormal, cameraDirectionUnitVector, returnSamples[k*lightCount + i]);
+        }
+
+        /* As traceRay() does. */
+        WavefrontRay reflection;
+        reflection.direction = getReflectionDirection(ray.hit, *ray.object);
+        reflection.start = offsetRayStart(ray.hit, *ray.object, reflection.direction);
+
+        ray.reflected = nextRays.size();
+        nextRays.push_back(reflection);
+
+        ray.transmitted = UINT_MAX;
+
+        if (ray.object->material.color.a < 1.0) {
+            WavefrontRay transmission;
+            transmission.start = offsetRayStart(ray.hit, *ray.object, ray.direction);
+            transmission.direction = ray.direction;
+
+            ray.transmitted = nextRays.size();
+            nextRays.push_back(transmission);
+        }
+    }
+}
+
+
+/* Tests the shadow ray of every sample in SAMPLES, those of the rays of RAYS at positions LIVE, in the order of the
+   positions in ORDER, or in order if it is empty. Then dims the light of those in shadow, and adds up the Phong shading
+   of each ray from its samples into its localColor, as getPhong() does. */
+static void shadowRays(vector <WavefrontRay> &rays, const vector <unsigned int> &live, vector <LightSample> &samples, const vector <unsigned int> &order) {
+    unsigned int lightCount = SCENE_LIGHTS->size();
+
+    vector <char> occluded (samples.size());
+
+    for (unsigned int k = 0; k < samples.size(); k++) {
+        unsigned int position = order.empty() ? k : order[k];
+        const LightSample &sample = samples[position];
+
+        occluded[position] = isOccluded(sample.shadowRayStartPoint, sample.shadowRayDirection, sample.shadowRayLength);
+    }
+
+    for (unsigned int k = 0; k < live.size(); k++) {
+        WavefrontRay &ray = rays[live[k]];
+        Color phong = {0.0, 0.0, 0.0, 1.0};
+
+        for (unsigned int i = 0; i < lightCount; i++) {
+            LightSample &sample = samples[k*lightCount + i];
+
+            if (occluded[k*lightCount + i]) {
+                shadowLight(*(*SCENE_LIGHTS)[i], ray.hit.point, sample);
+            }
+
+            phong += sample.diffuseColor + sample.specularColor;
+        }
+
+        phong += AMBIENT_COLOR * ray.object->material.ambient;
+        ray.localColor = phong;
+    }
+}
+
+
+/* Puts together the colors of the rays of RAYS at positions LIVE from their own shading and the colors of the rays
+   they made in NEXT_RAYS, as traceRay() does. */
+static void resolveRays(vector <WavefrontRay> &rays, const vector <unsigned int> &live, const vector <WavefrontRay> &nextRays) {
+    Color noColor = {0.0, 0.0, 0.0, 1.0};
+
+    for (unsigned int k = 0; k < live.size(); k++) {
+        WavefrontRay &ray = rays[live[k]];
+        const Color &transmittedColor = (ray.transmitted != UINT_MAX) ? nextRays[ray.transmitted].color : noColor;
+
+        ray.color = combineColors(*ray.object, ray.localColor, nextRays[ray.reflected].color, transmittedColor);
+    }
+}
+
+
+/* Adds the time since START_TIME and RAYS rays to STAGE of STATS, and returns the time now. */
+static double recordStage(WavefrontStats &stats, WavefrontStage stage, double startTime, unsigned int rays) {
+    double now = getTime();
+
+    stats.rays[stage] += rays;
+    stats.seconds[stage] += now - startTime;
+
+    return now;
+}
+
+
+/* Draws the scene a wave of pixels at a time, producing exactly the image drawScene() does, and prints how many rays
+   each stage handled and how quickly. */
+void drawSceneWavefront(GLfloat imageWidth) {
+    unsigned int pixelCount = CANVAS_WIDTH * CANVAS_HEIGHT;
+
+    /* The queue of rays at each depth of the current wave, rays beyond MAX_TRACING_DEPTH included, and the positions in
+       each queue of the rays that hit something to shade. */
+    vector < vector <WavefrontRay> > queues (MAX_TRACING_DEPTH + 2);
+    vector < vector <unsigned int> > live (MAX_TRACING_DEPTH + 2);
+    vector <LightSample> samples;
+
+    /* The order to trace the rays of a queue, or the shadow rays of its samples, in. Left empty when rays aren't sorted. */
+    vector <unsigned int> order;
+
+    /* The colors of a wave's pixels, and the bytes to draw them as. */
+    vector <Color> colors (WAVEFRONT_PIXELS);
+    vector <unsigned char> bytes (3*WAVEFRONT_PIXELS);
+
+    WavefrontStats stats;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        stats.rays[stage] = 0.0;
+        stats.seconds[stage] = 0.0;
+    }
+    stats.extendRays.assign(MAX_TRACING_DEPTH + 1, 0.0);
+    stats.extendSortSeconds.assign(MAX_TRACING_DEPTH + 1, 0.0);
+    stats.extendSeconds.assign(MAX_TRACING_DEPTH + 1, 0.0);
+    stats.shadowRays.assign(MAX_TRACING_DEPTH + 1, 0.0);
+    stats.shadowSortSeconds.assign(MAX_TRACING_DEPTH + 1, 0.0);
+    stats.shadowSeconds.assign(MAX_TRACING_DEPTH + 1, 0.0);
+
+    for (unsigned int first = 0; first < pixelCount; first += WAVEFRONT_PIXELS) {
+        unsigned int count = min((unsigned int)WAVEFRONT_PIXELS, pixelCount - first);
+
+        double time = getTime();
+        generateRays(first, count, imageWidth, queues[0]);
+        time = recordStage(stats, STAGE_GENERATE, time, count);
+
+        /* Trace each depth in turn until no rays are left to shade, which happens at MAX_TRACING_DEPTH + 1 at the latest. */
+        int depth = 0;
+        for (; depth <= MAX_TRACING_DEPTH + 1; depth++) {
+            vector <WavefrontRay> &rays = queues[depth];
+            bool traced = (depth <= MAX_TRACING_DEPTH);
+
+            /* Primary rays are in pixel order already, which is as coherent as they get. */
+            order.clear();
+            if (SORT_SECONDARY_RAYS && depth > 0 && traced) {
+                sortRays(rays, order);
+                double sorted = recordStage(stats, STAGE_SORT, time, rays.size());
+                stats.extendSortSeconds[depth] += sorted - time;
+                time = sorted;
+            }
+
+            extendRays(rays, depth, order, live[depth]);
+            double extended = recordStage(stats, STAGE_EXTEND, time, rays.size());
+            if (traced) {
+                stats.extendRays[depth] += rays.size();
+                stats.extendSeconds[depth] += extended - time;
+            }
+            time = extended;
+
+            if (live[depth].empty()) {
+                break;
+            }
+
+            shadeRays(rays, live[depth], samples, queues[depth + 1]);
+            time = recordStage(stats, STAGE_SHADE, time, live[depth].size());
+
+            order.clear();
+            if (SORT_SECONDARY_RAYS) {
+                sortShadowRays(samples, order);
+                double sorted = recordStage(stats, STAGE_SORT, time, samples.size());
+                stats.shadowSortSeconds[depth] += sorted - time;
+                time = sorted;
+            }
+
+            shadowRays(rays, live[depth], samples, order);
+            double shadowed = recordStage(stats, STAGE_SHADOW, time, samples.size());
+            stats.shadowRays[depth] += samples.size();
+            stats.shadowSeconds[depth] += shadowed - time;
+            time = shadowed;
+        }
+
+        /* Put the colors together from the deepest rays that were shaded up to the primary rays. */
+        unsigned int resolved = 0;
+        for (int level = depth - 1; level >= 0; level--) {
+            resolveRays(queues[level], live[level], queues[level + 1]);
+            resolved += live[level].size();
+        }
+
+        for (unsigned int k = 0; k < count; k++) {
+            colors[k] = queues[0][k].color;
+        }
+        convertColors(&colors[0], count, &bytes[0], 0);
+
+        /* Pixels go up each column in turn, so the wave is drawn a column, or part of one, at a time. */
+        for (unsigned int k = 0; k < count; ) {
+            unsigned int row = (first + k) % CANVAS_HEIGHT;
+            unsigned int run = min(count - k, CANVAS_HEIGHT - row);
+
+            drawPixels((first + k) / CANVAS_HEIGHT, row, run, &bytes[3*k]);
+            k += run;
+        }
+        recordStage(stats, STAGE_RESOLVE, time, resolved);
+    }
+
+    printf("%-10s %12s %12s %12s\n", "stage", "rays", "time (ms)", "Mrays/s");
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        printf("%-10s %12.0f %12.3f %12.3f\n", STAGE_NAMES[stage], stats.rays[stage], 1000.0*stats.seconds[stage],
+               (stats.seconds[stage] > 0.0) ? stats.rays[stage]/stats.seconds[stage]/1e6 : 0.0);
+    }
+
+    /* The rays traced at each depth, and the time spent sorting and tracing them. */
+    printf("%-6s %12s %10s %12s %12s %10s %12s\n", "depth", "rays", "sort (ms)", "extend (ms)", "shadow rays", "sort (ms)", "shadow (ms)");
+    for (int depth = 0; depth <= MAX_TRACING_DEPTH; depth++) {
+        printf("%-6d %12.0f %10.3f %12.3f %12.0f %10.3f %12.3f\n", depth, stats.extendRays[depth], 1000.0*stats.extendSortSeconds[depth],
+               1000.0*stats.extendSeconds[depth], stats.shadowRays[depth], 1000.0*stats.shadowSortSeconds[depth], 1000.0*stats.shadowSeconds[depth]);
+    }
+}
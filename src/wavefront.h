@@ -0,0 +1,20 @@
+/* Contains declarations for a wavefront renderer, which traces the rays of the image in large batches, one stage of
+   the work at a time, rather than following each ray through the recursion of traceRay(). */
+
+#ifndef WAVEFRONT
+#define WAVEFRONT
+
+	#include "common.h"
+
+
+	/* Draws the scene as drawScene() does, producing exactly the same image, but traces its rays a wave at a time. The
+	   primary rays of a wave of pixels are generated together, then each depth of the rays they lead to goes through
+	   separate stages over the whole queue: extending the rays to the first object each hits, shading those hits and
+	   making the shadow, reflection and refraction rays they need, and testing the shadow rays. Rays that hit nothing
+	   or a light leave the queue after extension. Once every depth has been traced, the colors are put together from the
+	   deepest rays up. IMAGE_WIDTH is the width of the image plane in world coordinates. Prints the number of rays each
+	   stage handled and how many it handled per second. */
+	void drawSceneWavefront(GLfloat imageWidth);
+
+
+#endif
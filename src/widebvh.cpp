@@ -0,0 +1,748 @@
+/* Contains definitions for a wide bounding volume hierarchy, whose nodes are tested against a ray with SIMD instructions. */
+
+#include <vector> /* STL vector. */
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "widebvh.h"
+#include "bvh.h"
+#include "boundingbox.h"
+#include "cpu.h"
+#include "sceneobject.h"
+#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+using namespace std;
+
+
+/* Number of entries in the traversal stack. Every level of the tree can leave up to 7 children waiting. */
+#define WIDE_BVH_STACK_SIZE 640
+
+/* Relative amount the far end of each box's ray interval is widened by, covering single-precision rounding
+   in the box test so that a ray grazing a box is never wrongly reported as missing it. */
+#define WIDE_BVH_T_FAR_SCALE (1.0f + 5e-7f)
+
+/* Smallest power of two allowed between the grid steps of a compressed node, keeping the steps clear of denormals. */
+#define WIDE_BVH_MIN_EXPONENT -100
+
+
+
+/*
+----------------------
+    Box tests.
+----------------------
+*/
+
+
+/* A ray set up for testing against the single-precision boxes of WideBVHNodes. */
+struct WideRay {
+    /* Rows of a WideBVHNode's bounds holding the sides of each box the ray enters and leaves through along each axis. */
+    int nearRows [3];
+    int farRows [3];
+
+    /* The ray's start point, nudged forward for the near sides and backward for the far sides so that rounding it to
+       single precision can only make the ray's interval in each box longer. */
+    float nearOrigin [3];
+    float farOrigin [3];
+
+    float inverseDirection [3];
+};
+
+
+/* Sets up RAY for the ray starting at RAY_START_POINT going in RAY_DIRECTION. */
+static void initWideRay(WideRay &ray, const Point3 &rayStartPoint, const Direction3 &rayDirection) {
+    for (int axis = 0; axis < 3; axis++) {
+        double origin = rayStartPoint.getEntry(axis);
+        double inverseDirection = 1.0 / rayDirection.getEntry(axis);
+        bool negative = (inverseDirection < 0.0);
+
+        /* Far more than the error of rounding to single precision, but far less than any box's size. */
+        double margin = 1e-6*fabs(origin) + 1e-30;
+
+        ray.nearRows[axis] = 2*axis + (negative ? 1 : 0);
+        ray.farRows[axis] = 2*axis + (negative ? 0 : 1);
+        ray.nearOrigin[axis] = (float)(negative ? origin - margin : origin + margin);
+        ray.farOrigin[axis] = (float)(negative ? origin + margin : origin - margin);
+        ray.inverseDirection[axis] = (float)inverseDirection;
+    }
+}
+
+
+/* Tests RAY against each child of NODE, for ray parameters up to MAX_T. Returns a mask with bit i set if the ray
+   enters child i, and places the parameter where it enters child i into RETURN_T_NEAR[i].
+
+   A side parallel to the ray that the ray starts exactly on gives 0*infinity = NaN. The max and min instructions
+   return their second operand when the first is NaN, so such sides are simply ignored. */
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2")))
+static unsigned int intersectChildren(const WideBVHNode<8> &node, const WideRay &ray, float maxT, float *returnTNear) {
+    __m256 tNear = _mm256_setzero_ps();
+    __m256 tFar = _mm256_set1_ps(maxT);
+
+    for (int axis = 0; axis < 3; axis++) {
+        __m256 inverseDirection = _mm256_set1_ps(ray.inverseDirection[axis]);
+
+        __m256 nearT = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[ray.nearRows[axis]]), _mm256_set1_ps(ray.nearOrigin[axis])), inverseDirection);
+        __m256 farT = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[ray.farRows[axis]]), _mm256_set1_ps(ray.farOrigin[axis])), inverseDirection);
+
+        tNear = _mm256_max_ps(nearT, tNear);
+        tFar = _mm256_min_ps(farT, tFar);
+    }
+
+    tFar = _mm256_mul_ps(tFar, _mm256_set1_ps(WIDE_BVH_T_FAR_SCALE));
+
+    _mm256_storeu_ps(returnTNear, tNear);
+    return _mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ));
+}
+
+
+static unsigned int intersectChildren(const WideBVHNode<4> &node, const WideRay &ray, float maxT, float *returnTNear) {
+    __m128 tNear = _mm_setzero_ps();
+    __m128 tFar = _mm_set1_ps(maxT);
+
+    for (int axis = 0; axis < 3; axis++) {
+        __m128 inverseDirection = _mm_set1_ps(ray.inverseDirection[axis]);
+
+        __m128 nearT = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[ray.nearRows[axis]]), _mm_set1_ps(ray.nearOrigin[axis])), inverseDirection);
+        __m128 farT = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[ray.farRows[axis]]), _mm_set1_ps(ray.farOrigin[axis])), inverseDirection);
+
+        tNear = _mm_max_ps(nearT, tNear);
+        tFar = _mm_min_ps(farT, tFar);
+    }
+
+    tFar = _mm_mul_ps(tFar, _mm_set1_ps(WIDE_BVH_T_FAR_SCALE));
+
+    _mm_storeu_ps(returnTNear, tNear);
+    return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+}
+
+#else
+
+/* Without SSE or AVX the children are tested one at a time, following the same steps. */
+template <int WIDTH>
+static unsigned int intersectChildren(const WideBVHNode<WIDTH> &node, const WideRay &ray, float maxT, float *returnTNear) {
+    unsigned int mask = 0;
+
+    for (int i = 0; i < WIDTH; i++) {
+        float tNear = 0.0f;
+        float tFar = maxT;
+
+        for (int axis = 0; axis < 3; axis++) {
+            float nearT = (node.bounds[ray.nearRows[axis]][i] - ray.nearOrigin[axis]) * ray.inverseDirection[axis];
+            float farT = (node.bounds[ray.farRows[axis]][i] - ray.farOrigin[axis]) * ray.inverseDirection[axis];
+
+            tNear = (nearT > tNear) ? nearT : tNear;
+            tFar = (farT < tFar) ? farT : tFar;
+        }
+
+        returnTNear[i] = tNear;
+        if (tNear <= tFar * WIDE_BVH_T_FAR_SCALE) {
+            mask |= (1u << i);
+        }
+    }
+
+    return mask;
+}
+
+#endif
+
+
+
+/*
+----------------------
+    Compressed boxes.
+----------------------
+*/
+
+
+/* Returns 2^EXPONENT, for EXPONENT from WIDE_BVH_MIN_EXPONENT to 127, by building the float's bits directly. */
+static inline float getStepSize(int exponent) {
+    unsigned int bits = (unsigned int)(exponent + 127) << 23;
+    float stepSize;
+    memcpy(&stepSize, &bits, sizeof(stepSize));
+    return stepSize;
+}
+
+
+/* Returns the side STEP grid steps from ORIGIN, with STEP_SIZE between steps. The product is exact, so the only
+   rounding is in the sum, and the SIMD expansions below compute it the same way, giving the same floats. */
+static inline float getSide(float origin, float stepSize, int step) {
+    return origin + (float)step * stepSize;
+}
+
+
+/* Expands the boxes of the compressed NODE into the bounds of RETURN_NODE, which is all a WideRay is tested against. */
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2")))
+static void expandBounds(const CompressedWideBVHNode<8> &node, WideBVHNode<8> &returnNode) {
+    for (int axis = 0; axis < 3; axis++) {
+        __m256 origin = _mm256_set1_ps(node.origin[axis]);
+        __m256 stepSize = _mm256_set1_ps(getStepSize(node.exponents[axis]));
+
+        for (int row = 2*axis; row < 2*axis + 2; row++) {
+            __m256i steps = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)node.quantized[row]));
+            _mm256_store_ps(returnNode.bounds[row], _mm256_add_ps(origin, _mm256_mul_ps(_mm256_cvtepi32_ps(steps), stepSize)));
+        }
+    }
+}
+
+
+static void expandBounds(const CompressedWideBVHNode<4> &node, WideBVHNode<4> &returnNode) {
+    __m128i zero = _mm_setzero_si128();
+
+    for (int axis = 0; axis < 3; axis++) {
+        __m128 origin = _mm_set1_ps(node.origin[axis]);
+        __m128 stepSize = _mm_set1_ps(getStepSize(node.exponents[axis]));
+
+        for (int row = 2*axis; row < 2*axis + 2; row++) {
+            int packed;
+            memcpy(&packed, node.quantized[row], sizeof(packed));
+
+            /* SSE2 has no single instruction widening bytes to integers, so interleave them with zeros twice. */
+            __m128i steps = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+            _mm_store_ps(returnNode.bounds[row], _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(steps), stepSize)));
+        }
+    }
+}
+
+#else
+
+template <int WIDTH>
+static void expandBounds(const CompressedWideBVHNode<WIDTH> &node, WideBVHNode<WIDTH> &returnNode) {
+    for (int axis = 0; axis < 3; axis++) {
+        float stepSize = getStepSize(node.exponents[axis]);
+
+        for (int row = 2*axis; row < 2*axis + 2; row++) {
+            for (int i = 0; i < WIDTH; i++) {
+                returnNode.bounds[row][i] = getSide(node.origin[axis], stepSize, node.quantized[row][i]);
+            }
+        }
+    }
+}
+
+#endif
+
+
+
+/*
+----------------------
+    Collapsing.
+----------------------
+*/
+
+
+/* Returns VALUE rounded to a float no greater than it. */
+static float roundDown(double value) {
+    float rounded = (float)value;
+    return ((double)rounded > value) ? nextafterf(rounded, -INFINITY) : rounded;
+}
+
+
+/* Returns VALUE rounded to a float no less than it. */
+static float roundUp(double value) {
+    float rounded = (float)value;
+    return ((double)rounded < value) ? nextafterf(rounded, INFINITY) : rounded;
+}
+
+
+/* Places into CHILDREN the binary nodes that become the children of the wide node taking the place of
+   BINARY_NODES[BINARY_INDEX]. Returns how many there are, at most WIDTH. */
+template <int WIDTH>
+static int selectChildren(const vector <BVHNode> &binaryNodes, unsigned int binaryIndex, unsigned int children[WIDTH]) {
+
+    /* Start from the binary node's children, then keep opening up the child with the largest surface area, which
+       is the one most likely to be entered, until the wide node is full. */
+    int childCount = 0;
+
+    const BVHNode &binaryNode = binaryNodes[binaryIndex];
+
+    if (binaryNode.primitiveCount > 0) {
+        children[childCount++] = binaryIndex;
+    }
+    else {
+        children[childCount++] = binaryIndex + 1;
+        children[childCount++] = binaryNode.offset;
+    }
+
+    while (childCount < WIDTH) {
+        int largest = -1;
+        double largestArea = -1.0;
+
+        for (int i = 0; i < childCount; i++) {
+            const BVHNode &child = binaryNodes[children[i]];
+            double area = surfaceArea(child.bounds);
+
+            if (child.primitiveCount == 0 && area > largestArea) {
+                largest = i;
+                largestArea = area;
+            }
+        }
+
+        if (largest < 0) {
+            break;
+        }
+
+        unsigned int opened = children[largest];
+        children[largest] = opened + 1;
+        children[childCount++] = binaryNodes[opened].offset;
+    }
+
+    return childCount;
+}
+
+
+/* Builds the wide node that takes the place of the binary subtree rooted at BINARY_NODES[BINARY_INDEX], and the wide
+   nodes below it, appending them to WIDE_NODES. Returns the index of the new node. */
+template <int WIDTH>
+static unsigned int collapseNode(const vector <BVHNode> &binaryNodes, unsigned int binaryIndex, vector < WideBVHNode<WIDTH> > &wideNodes) {
+
+    unsigned int children [WIDTH];
+    int childCount = selectChildren<WIDTH>(binaryNodes, binaryIndex, children);
+
+    unsigned int wideIndex = wideNodes.size();
+    wideNodes.push_back(WideBVHNode<WIDTH>());
+
+    for (int i = 0; i < WIDTH; i++) {
+        WideBVHNode<WIDTH> &wideNode = wideNodes[wideIndex];
+
+        if (i >= childCount) {
+            for (int axis = 0; axis < 3; axis++) {
+                wideNode.bounds[2*axis][i] = INFINITY;
+                wideNode.bounds[2*axis + 1][i] = -INFINITY;
+            }
+            wideNode.children[i] = 0;
+            wideNode.primitiveCounts[i] = 0;
+            continue;
+        }
+
+        const BVHNode &child = binaryNodes[children[i]];
+
+        for (int axis = 0; axis < 3; axis++) {
+            wideNode.bounds[2*axis][i] = roundDown(child.bounds.lower[axis]);
+            wideNode.bounds[2*axis + 1][i] = roundUp(child.bounds.upper[axis]);
+        }
+
+        if (child.primitiveCount > 0) {
+            wideNode.children[i] = child.offset;
+            wideNode.primitiveCounts[i] = child.primitiveCount;
+        }
+        else {
+            /* Collapsing appends to WIDE_NODES, which may move it, so look the node up again afterward. */
+            unsigned int grandchild = collapseNode<WIDTH>(binaryNodes, children[i], wideNodes);
+            wideNodes[wideIndex].children[i] = grandchild;
+            wideNodes[wideIndex].primitiveCounts[i] = 0;
+        }
+    }
+
+    return wideIndex;
+}
+
+
+/* Returns the power of two between the grid steps of a compressed node whose box runs from ORIGIN to UPPER along an
+   axis: the smallest for which 255 steps reach UPPER. */
+static int getStepExponent(float origin, double upper) {
+    int exponent = WIDE_BVH_MIN_EXPONENT;
+
+    if (upper - origin > 0.0) {
+        exponent = max(exponent, (int)ceil(log2((upper - origin) / 255.0)));
+    }
+
+    /* log2 may be a little off, and the sum is rounded, so check the top step and go up until it's enough. */
+    while (exponent < 127 && (double)getSide(origin, getStepSize(exponent), 255) < upper) {
+        exponent++;
+    }
+
+    return exponent;
+}
+
+
+/* Builds the compressed node at COMPRESSED_NODES[COMPRESSED_INDEX], which takes the place of the binary subtree
+   rooted at BINARY_NODES[BINARY_INDEX], and the compressed nodes below it. Space for the node must already have been
+   made; the nodes below it are appended. The objects of its leaves are appended to COMPRESSED_PRIMITIVE_INDICES, taken
+   from the binary tree's PRIMITIVE_INDICES. */
+template <int WIDTH>
+static void compressNode(const vector <BVHNode> &binaryNodes, const vector <unsigned int> &primitiveIndices, unsigned int binaryIndex,
+                         unsigned int compressedIndex, vector < CompressedWideBVHNode<WIDTH> > &compressedNodes,
+                         vector <unsigned int> &compressedPrimitiveIndices) {
+
+    unsigned int children [WIDTH];
+    int childCount = selectChildren<WIDTH>(binaryNodes, binaryIndex, children);
+
+    BoundingBox bounds = getEmptyBoundingBox();
+    for (int i = 0; i < childCount; i++) {
+        expand(bounds, binaryNodes[children[i]].bounds);
+    }
+
+    CompressedWideBVHNode<WIDTH> node;
+    float stepSizes [3];
+
+    for (int axis = 0; axis < 3; axis++) {
+        node.origin[axis] = roundDown(bounds.lower[axis]);
+        node.exponents[axis] = (signed char)getStepExponent(node.origin[axis], bounds.upper[axis]);
+        stepSizes[axis] = getStepSize(node.exponents[axis]);
+    }
+
+    node.internalMask = 0;
+    node.childBase = compressedNodes.size();
+    node.primitiveBase = compressedPrimitiveIndices.size();
+
+    unsigned int internalCount = 0;
+
+    for (int i = 0; i < WIDTH; i++) {
+        node.primitiveOffsets[i] = 0;
+        node.primitiveCounts[i] = 0;
+
+        if (i >= childCount) {
+            for (int axis = 0; axis < 3; axis++) {
+                node.quantized[2*axis][i] = 255;
+                node.quantized[2*axis + 1][i] = 0;
+            }
+            continue;
+        }
+
+        const BVHNode &child = binaryNodes[children[i]];
+
+        /* Start from the nearest step, then move outward until the step's side, rounded as it is when expanded, is
+           outside the child's box. Step 0 is the node's lower side and step 255 reaches past its upper side, so
+           this always ends inside the grid. */
+        for (int axis = 0; axis < 3; axis++) {
+            double lower = (child.bounds.lower[axis] - node.origin[axis]) / stepSizes[axis];
+            double upper = (child.bounds.upper[axis] - node.origin[axis]) / stepSizes[axis];
+
+            int lowerStep = (int)min(max(floor(lower), 0.0), 255.0);
+            int upperStep = (int)min(max(ceil(upper), 0.0), 255.0);
+
+            while (lowerStep > 0 && (double)getSide(node.origin[axis], stepSizes[axis], lowerStep) > child.bounds.lower[axis]) {
+                lowerStep--;
+            }
+            while (upperStep < 255 && (double)getSide(node.origin[axis], stepSizes[axis], upperStep) < child.bounds.upper[axis]) {
+                upperStep++;
+            }
+
+            node.quantized[2*axis][i] = (unsigned char)lowerStep;
+            node.quantized[2*axis + 1][i] = (unsigned char)upperStep;
+        }
+
+        if (child.primitiveCount > 0) {
+            node.primitiveOffsets[i] = compressedPrimitiveIndices.size() - node.primitiveBase;
+            node.primitiveCounts[i] = child.primitiveCount;
+
+            for (unsigned int j = 0; j < child.primitiveCount; j++) {
+                compressedPrimitiveIndices.push_back(primitiveIndices[child.offset + j]);
+            }
+        }
+        else {
+            node.internalMask |= (1u << i);
+            internalCount++;
+        }
+    }
+
+    /* Make space for the child nodes together, so they can be found from childBase alone, then fill them in. */
+    compressedNodes.resize(compressedNodes.size() + internalCount);
+    compressedNodes[compressedIndex] = node;
+
+    unsigned int nextChild = node.childBase;
+
+    for (int i = 0; i < childCount; i++) {
+        if (node.internalMask & (1u << i)) {
+            compressNode<WIDTH>(binaryNodes, primitiveIndices, children[i], nextChild++, compressedNodes, compressedPrimitiveIndices);
+        }
+    }
+}
+
+
+
+/* Appends the position in primitiveIndices of the first object of every leaf of the compressed NODES to RETURN_OFFSETS. */
+template <int WIDTH>
+static void getCompressedLeafOffsets(const vector < CompressedWideBVHNode<WIDTH> > &nodes, vector <unsigned int> &returnOffsets) {
+    for (unsigned int i = 0; i < nodes.size(); i++) {
+        for (int j = 0; j < WIDTH; j++) {
+            if (!(nodes[i].internalMask & (1u << j)) && nodes[i].primitiveCounts[j] > 0) {
+                returnOffsets.push_back(nodes[i].primitiveBase + nodes[i].primitiveOffsets[j]);
+            }
+        }
+    }
+}
+
+
+
+/*
+----------------------
+    Traversal.
+----------------------
+*/
+
+
+/* An entry of the traversal stack: a child node or leaf still to visit, and where the ray enters it. */
+struct WideStackEntry {
+    unsigned int child;
+    unsigned int primitiveCount;
+    float tNear;
+};
+
+
+/* Searches the tree made of NODES for the closest intersection with the ray, narrowing CLOSEST as
+   closer intersections are found. */
+template <int WIDTH>
+void WideBVH::traverseNodes(const vector < WideBVHNode<WIDTH> > &nodes, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+
+    WideRay ray;
+    initWideRay(ray, rayStartPoint, rayDirection);
+
+
+    WideStackEntry stack [WIDE_BVH_STACK_SIZE];
+    int stackSize = 1;
+
+    stack[0].child = 0;
+    stack[0].primitiveCount = 0;
+    stack[0].tNear = 0.0f;
+
+    while (stackSize > 0) {
+        WideStackEntry entry = stack[--stackSize];
+
+        /* Round the limit up so single precision never makes it tighter. */
+        float maxT = roundUp(getMaxT(closest));
+
+        if (entry.tNear > maxT) {
+            continue;
+        }
+
+        if (entry.primitiveCount > 0) {
+            testLeaf(primitiveIndices.data(), entry.child, entry.primitiveCount, rayStartPoint, rayDirection, closest);
+            continue;
+        }
+
+        const WideBVHNode<WIDTH> &node = nodes[entry.child];
+        float tNear [WIDTH];
+        unsigned int mask = intersectChildren(node, ray, maxT, tNear);
+
+        /* Push the children that were entered from farthest to nearest, so the nearest is visited first. */
+        int first = stackSize;
+
+        for (int i = 0; i < WIDTH; i++) {
+            if (!(mask & (1u << i))) {
+                continue;
+            }
+
+            WideStackEntry child;
+            child.child = node.children[i];
+            child.primitiveCount = node.primitiveCounts[i];
+            child.tNear = tNear[i];
+
+            /* Insertion sort into the new entries, largest tNear at the bottom. */
+            int j = stackSize;
+            while (j > first && stack[j-1].tNear < child.tNear) {
+                stack[j] = stack[j-1];
+                j--;
+            }
+            stack[j] = child;
+            stackSize++;
+        }
+    }
+}
+
+
+
+/* Searches the compressed tree made of NODES for the closest intersection with the ray, narrowing CLOSEST
+   as closer intersections are found. */
+template <int WIDTH>
+void WideBVH::traverseCompressedNodes(const vector < CompressedWideBVHNode<WIDTH> > &nodes, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+
+    WideRay ray;
+    initWideRay(ray, rayStartPoint, rayDirection);
+
+
+    WideStackEntry stack [WIDE_BVH_STACK_SIZE];
+    int stackSize = 1;
+
+    stack[0].child = 0;
+    stack[0].primitiveCount = 0;
+    stack[0].tNear = 0.0f;
+
+    /* Each node's boxes are expanded here before they're tested. */
+    WideBVHNode<WIDTH> expanded;
+
+    while (stackSize > 0) {
+        WideStackEntry entry = stack[--stackSize];
+
+        /* Round the limit up so single precision never makes it tighter. */
+        float maxT = roundUp(getMaxT(closest));
+
+        if (entry.tNear > maxT) {
+            continue;
+        }
+
+        if (entry.primitiveCount > 0) {
+            testLeaf(primitiveIndices.data(), entry.child, entry.primitiveCount, rayStartPoint, rayDirection, closest);
+            continue;
+        }
+
+        const CompressedWideBVHNode<WIDTH> &node = nodes[entry.child];
+        expandBounds(node, expanded);
+
+        float tNear [WIDTH];
+        unsigned int mask = intersectChildren(expanded, ray, maxT, tNear);
+
+        /* Push the children that were entered from farthest to nearest, so the nearest is visited first. */
+        int first = stackSize;
+        unsigned int nextChild = node.childBase;
+
+        for (int i = 0; i < WIDTH; i++) {
+            bool internal = (node.internalMask & (1u << i)) != 0;
+            unsigned int childIndex = internal ? nextChild++ : node.primitiveBase + node.primitiveOffsets[i];
+
+            if (!(mask & (1u << i))) {
+                continue;
+            }
+
+            WideStackEntry child;
+            child.child = childIndex;
+            child.primitiveCount = node.primitiveCounts[i];
+            child.tNear = tNear[i];
+
+            /* Insertion sort into the new entries, largest tNear at the bottom. */
+            int j = stackSize;
+            while (j > first && stack[j-1].tNear < child.tNear) {
+                stack[j] = stack[j-1];
+                j--;
+            }
+            stack[j] = child;
+            stackSize++;
+        }
+    }
+}
+
+
+
+/*
+----------------------
+    WideBVH methods.
+----------------------
+*/
+
+
+/* Constructor. WIDTH is the number of children per node, either 8 or 4. A WIDTH of 0 picks 8 if the kernels
+   use AVX2 or wider, and 4 otherwise. A WIDTH of 8 without AVX2 also falls back to 4. If COMPRESSED is true, the
+   nodes are stored as CompressedWideBVHNodes. */
+WideBVH::WideBVH (int width, bool compressed) {
+    this->width = (width != 4 && getInstructionSet() >= INSTRUCTION_SET_AVX2) ? 8 : 4;
+    this->compressed = compressed;
+}
+
+
+/* Builds the wide BVH over OBJECTS, replacing anything built before. */
+void WideBVH::build(const vector <SceneObject *> &objects) {
+
+    BVH::build(objects);
+
+    nodes8.clear();
+    nodes4.clear();
+    compressedNodes8.clear();
+    compressedNodes4.clear();
+
+    if (!nodes.empty() && compressed) {
+        /* The leaves' objects are stored again in the order the compressed nodes refer to them. */
+        vector <unsigned int> compressedPrimitiveIndices;
+        compressedPrimitiveIndices.reserve(primitiveIndices.size());
+
+        if (width == 8) {
+            compressedNodes8.reserve(nodes.size()/4 + 1);
+            compressedNodes8.resize(1);
+            compressNode<8>(nodes, primitiveIndices, 0, 0, compressedNodes8, compressedPrimitiveIndices);
+        }
+        else {
+            compressedNodes4.reserve(nodes.size()/2 + 1);
+            compressedNodes4.resize(1);
+            compressNode<4>(nodes, primitiveIndices, 0, 0, compressedNodes4, compressedPrimitiveIndices);
+        }
+
+        primitiveIndices.swap(compressedPrimitiveIndices);
+
+        /* The leaves have moved, so pack their triangles again. */
+        vector <unsigned int> leafOffsets;
+        if (width == 8) {
+            getCompressedLeafOffsets<8>(compressedNodes8, leafOffsets);
+        }
+        else {
+            getCompressedLeafOffsets<4>(compressedNodes4, leafOffsets);
+        }
+        packTriangles(primitiveIndices, leafOffsets);
+    }
+    else if (!nodes.empty()) {
+        if (width == 8) {
+            nodes8.reserve(nodes.size()/4 + 1);
+            collapseNode<8>(nodes, 0, nodes8);
+        }
+        else {
+            nodes4.reserve(nodes.size()/2 + 1);
+            collapseNode<4>(nodes, 0, nodes4);
+        }
+    }
+
+    /* Only the wide nodes are traced, so free the binary ones. */
+    vector <BVHNode>().swap(nodes);
+}
+
+
+/* Searches the wide tree for the closest intersection with the ray, narrowing CLOSEST as closer
+   intersections are found. Boxes farther away than CLOSEST are skipped. */
+void WideBVH::traverse(const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const {
+    if (width == 8 && !compressedNodes8.empty()) {
+        traverseCompressedNodes<8>(compressedNodes8, rayStartPoint, rayDirection, closest);
+    }
+    else if (width == 4 && !compressedNodes4.empty()) {
+        traverseCompressedNodes<4>(compressedNodes4, rayStartPoint, rayDirection, closest);
+    }
+    else if (width == 8 && !nodes8.empty()) {
+        traverseNodes<8>(nodes8, rayStartPoint, rayDirection, closest);
+    }
+    else if (width == 4 && !nodes4.empty()) {
+        traverseNodes<4>(nodes4, rayStartPoint, rayDirection, closest);
+    }
+}
+
+
+/* Traces each of COUNT rays through the wide tree on its own, narrowing CLOSEST[i] for ray i. */
+void WideBVH::traversePacket(const Point3 *rayStartPoints, const Direction3 *rayDirections, unsigned int count, Intersection *closest) const {
+    for (unsigned int i = 0; i < count; i++) {
+        traverse(rayStartPoints[i], rayDirections[i], closest[i]);
+    }
+}
+
+
+/* Builds the whole wide BVH again, since its nodes can't be refit. Returns ACCELERATOR_REBUILD. */
+AcceleratorUpdate WideBVH::update(const vector <unsigned int> &movedIndices) {
+    return Accelerator::update(movedIndices);
+}
+
+
+/* Returns 1.0, since the wide BVH is always rebuilt. */
+double WideBVH::getCostRatio(void) const {
+    return Accelerator::getCostRatio();
+}
+
+
+/* Returns the number of children per node, 8 or 4. */
+int WideBVH::getWidth(void) const {
+    return width;
+}
+
+
+/* Returns true if the nodes are stored compressed. */
+bool WideBVH::isCompressed(void) const {
+    return compressed;
+}
+
+
+/* Returns the number of bytes the wide BVH takes up. */
+size_t WideBVH::getMemoryUsage(void) const {
+    return BVH::getMemoryUsage() - sizeof(BVH) + sizeof(WideBVH) +
+           nodes8.capacity()*sizeof(WideBVHNode<8>) + nodes4.capacity()*sizeof(WideBVHNode<4>) +
+           compressedNodes8.capacity()*sizeof(CompressedWideBVHNode<8>) + compressedNodes4.capacity()*sizeof(CompressedWideBVHNode<4>);
+}
@@ -0,0 +1,137 @@
+/* Contains declarations for a wide bounding volume hierarchy, a BVH whose nodes have up to 8 children so that
+   a ray can be tested against all of a node's children at once with SIMD instructions. */
+
+#ifndef WIDE_BVH
+#define WIDE_BVH
+
+	#include <vector> /* STL vector. */
+	#include "bvh.h"
+	#include "accelerator.h"
+	#include "sceneobject.h"
+	#include "vec3.h" /* Header-only 3 component vector for points and directions. */
+
+	using namespace std;
+
+
+	/* A node of a wide BVH with WIDTH children. The children's boxes are stored as single-precision structure-of-arrays,
+	   one array per box side, so one SIMD instruction handles the same side of every child. The node is aligned to
+	   and sized in whole cache lines: 256 bytes with 8 children, 128 bytes with 4.
+
+	   Boxes are rounded outward when they're converted from double precision, so they still enclose their objects. */
+	template <int WIDTH>
+	struct alignas(64) WideBVHNode {
+		/* bounds[2*axis] holds the lower sides of the children's boxes along the axis, bounds[2*axis + 1] the upper sides.
+		   Unused children have lower sides of +infinity and upper sides of -infinity, so every ray misses them. */
+		float bounds [6][WIDTH];
+
+		/* For a child node, its index in the node list. For a leaf, the index of its first object in primitiveIndices. */
+		unsigned int children [WIDTH];
+
+		/* For a leaf, the number of objects in it. Zero for a child node or an unused child. */
+		unsigned char primitiveCounts [WIDTH];
+	};
+
+
+	/* A node of a compressed wide BVH with WIDTH children. Each side of each child's box is stored as one byte, a step
+	   on a grid laid over the node's own box: along each axis the steps start at origin[axis] and are 2^exponents[axis]
+	   apart. A node is 88 bytes with 8 children and 56 with 4, against 256 and 128 for a WideBVHNode.
+
+	   The children that are nodes are stored one after another, as are the objects of the children that are leaves,
+	   so a single index for each is enough. Boxes are rounded outward to the grid, so they still enclose their objects. */
+	template <int WIDTH>
+	struct CompressedWideBVHNode {
+		/* Lower corner of the grid, and the power of two between its steps along each axis. */
+		float origin [3];
+		signed char exponents [3];
+
+		/* Bit i is set if child i is a node. */
+		unsigned char internalMask;
+
+		/* Index in the node list of the first child that is a node. The others follow it, in the order of their bits
+		   in internalMask. */
+		unsigned int childBase;
+
+		/* Index in primitiveIndices of the first object of the node's leaves. Leaf i's objects start primitiveOffsets[i]
+		   after it, and there are primitiveCounts[i] of them. */
+		unsigned int primitiveBase;
+		unsigned char primitiveOffsets [WIDTH];
+		unsigned char primitiveCounts [WIDTH];
+
+		/* quantized[2*axis] holds the lower sides of the children's boxes along the axis in grid steps, rounded down,
+		   and quantized[2*axis + 1] the upper sides, rounded up. Unused children have lower sides of 255 and upper
+		   sides of 0, so every ray misses them. */
+		unsigned char quantized [6][WIDTH];
+	};
+
+
+	/* A BVH that is built like the binary BVH, then collapsed so that each node takes the place of up to 8 (or 4)
+	   binary nodes. Testing a ray against 8 boxes at once with AVX2 needs about as long as testing it against one,
+	   and the tree is a third as deep, so far fewer nodes are fetched from memory. Hosts without AVX2 get 4-wide
+	   nodes tested with SSE.
+
+	   A compressed wide BVH stores its nodes as CompressedWideBVHNodes, a third of the size, for scenes too large for
+	   the nodes to stay in the caches. Each node's boxes are expanded back to single precision before they are tested,
+	   which costs a little time for every node visited. */
+	class WideBVH : public BVH {
+
+		protected:
+			/* Number of children per node: 8 or 4. */
+			int width;
+
+			/* True if the nodes are stored compressed. */
+			bool compressed;
+
+			/* Nodes of the tree for whichever width is used. The root is element 0. */
+			vector < WideBVHNode<8> > nodes8;
+			vector < WideBVHNode<4> > nodes4;
+
+			/* Nodes of a compressed tree for whichever width is used. The root is element 0. */
+			vector < CompressedWideBVHNode<8> > compressedNodes8;
+			vector < CompressedWideBVHNode<4> > compressedNodes4;
+
+
+			/* Searches the tree made of NODES for the closest intersection with the ray, narrowing CLOSEST as
+			   closer intersections are found. */
+			template <int WIDTH>
+			void traverseNodes(const vector < WideBVHNode<WIDTH> > &nodes, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* Searches the compressed tree made of NODES for the closest intersection with the ray, narrowing CLOSEST
+			   as closer intersections are found. */
+			template <int WIDTH>
+			void traverseCompressedNodes(const vector < CompressedWideBVHNode<WIDTH> > &nodes, const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* Searches the wide tree for the closest intersection with the ray, narrowing CLOSEST as closer
+			   intersections are found. Boxes farther away than CLOSEST are skipped. */
+			void traverse(const Point3 &rayStartPoint, const Direction3 &rayDirection, Intersection &closest) const;
+
+			/* Traces each of COUNT rays through the wide tree on its own with traverse(), since the wide nodes already
+			   test several boxes at once. */
+			void traversePacket(const Point3 *rayStartPoints, const Direction3 *rayDirections, unsigned int count, Intersection *closest) const;
+
+		public:
+			/* Constructor. WIDTH is the number of children per node, either 8 or 4. A WIDTH of 0 picks 8 if the kernels
+			   use AVX2 or wider (see cpu.h), and 4 otherwise. A WIDTH of 8 without AVX2 also falls back to 4. If
+			   COMPRESSED is true, the nodes are stored as CompressedWideBVHNodes. */
+			WideBVH (int width, bool compressed);
+
+			/* Builds the wide BVH over OBJECTS, replacing anything built before. */
+			void build(const vector <SceneObject *> &objects);
+
+			/* Builds the whole wide BVH again, since its nodes can't be refit. Returns ACCELERATOR_REBUILD. */
+			AcceleratorUpdate update(const vector <unsigned int> &movedIndices);
+
+			/* Returns 1.0, since the wide BVH is always rebuilt. */
+			double getCostRatio(void) const;
+
+			/* Returns the number of bytes the wide BVH takes up. */
+			size_t getMemoryUsage(void) const;
+
+			/* Returns the number of children per node, 8 or 4. */
+			int getWidth(void) const;
+
+			/* Returns true if the nodes are stored compressed. */
+			bool isCompressed(void) const;
+	};
+
+
+#endif